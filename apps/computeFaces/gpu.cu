@@ -15,6 +15,7 @@
 // ======================================================================== //
 
 #include "umesh/UMesh.h"
+#include "umesh/io/Registry.h"
 #ifdef __CUDACC__
 # include <thrust/sort.h>
 #endif
@@ -763,7 +764,7 @@ namespace umesh {
           }
           if (inFileName == "")
               throw std::runtime_error("no test file specified");
-          UMesh::SP input = UMesh::loadFrom(inFileName);
+          UMesh::SP input = io::load(inFileName);
           std::vector<SharedFace> result
               = computeFaces(input);
           std::cout << "done computing shared faces, found " << result.size() << " faces for mesh of " << input->toString() << std::endl;
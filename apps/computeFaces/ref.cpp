@@ -20,6 +20,7 @@
 
 #include "umesh/io/ugrid32.h"
 #include "umesh/io/UMesh.h"
+#include "umesh/io/Registry.h"
 #include "umesh/io/btm/BTM.h"
 #include "umesh/RemeshHelper.h"
 #include <chrono>
@@ -188,7 +189,7 @@ namespace umesh {
             }
 
             std::cout << "loading umesh from " << inFileName << std::endl;
-            UMesh::SP in = io::loadBinaryUMesh(inFileName);
+            UMesh::SP in = io::load(inFileName);
             if (!in->pyrs.empty() ||
                 !in->wedges.empty() ||
                 !in->hexes.empty())
@@ -20,6 +20,7 @@
 #include "umesh/UMesh.h"
 #include "umesh/TetConn.h"
 #include "umesh/io/IO.h"
+#include "umesh/io/Registry.h"
 
 namespace umesh {
 
@@ -52,7 +53,7 @@ namespace umesh {
           if (inFileName == "") usage("no input file specified");
           if (outFileName == "") usage("no output file specified");
           std::cout << "loading umesh from " << inFileName << std::endl;
-          UMesh::SP in = UMesh::loadFrom(inFileName);
+          UMesh::SP in = io::load(inFileName);
 
           if (!in->pyrs.empty() ||
               !in->wedges.empty() ||
@@ -0,0 +1,118 @@
+// ======================================================================== //
+// Copyright 2018-2020 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+/* converts between any two of the file formats known to
+   io::Registry; conversions to .umesh get streamed (ie, done without
+   ever holding the entire mesh in memory) for all formats that support
+   that */
+
+#include "umesh/io/Registry.h"
+
+namespace umesh {
+
+  void usage(const std::string error="")
+  {
+    if (error != "")
+      std::cerr << "\nError : " << error  << "\n\n";
+
+    std::cout << "Usage: ./umeshConvert <in> -o <out> [args]\n"
+              << "  --in-format <name>   : format of input file (default: auto-detect)\n"
+              << "  --out-format <name>  : format of output file (default: from extension)\n"
+              << "  --scalars <file>     : load per-vertex scalars from given file\n"
+              << "  -var|--variable <v>  : scalar field (vtk) or variable (fun3d data file) to load\n"
+              << "  -ts|--time-step <t>  : time step to load from fun3d data file (default: last)\n"
+              << "  -z|--compress        : compress output (vtu)\n"
+              << "  --formats            : list known formats\n\n";
+    exit(error != "");
+  };
+
+  void listFormats()
+  {
+    for (auto &format : io::Registry::get().formats) {
+      std::cout << "  " << format.name << " :";
+      for (auto &ext : format.extensions)
+        std::cout << " " << ext;
+      std::cout << " ("
+                << (format.load ? "r" : "")
+                << (format.save ? "w" : "")
+                << (format.stream ? ", streaming" : "")
+                << ")" << std::endl;
+    }
+  }
+  
+  extern "C" int main(int ac, char **av)
+  {
+    try {
+      std::string inFileName;
+      std::string outFileName;
+      io::Options inOptions;
+      io::Options outOptions;
+      for (int i=1;i<ac;i++) {
+        const std::string arg = av[i];
+        if (arg == "-h")
+          usage();
+        else if (arg == "--formats") {
+          listFormats();
+          exit(0);
+        }
+        else if (arg == "-o")
+          outFileName = av[++i];
+        else if (arg == "--in-format")
+          inOptions.format = av[++i];
+        else if (arg == "--out-format")
+          outOptions.format = av[++i];
+        else if (arg == "--scalars")
+          inOptions.scalarFileName = av[++i];
+        else if (arg == "-var" || arg == "--variable")
+          inOptions.variable = av[++i];
+        else if (arg == "-ts" || arg == "--time-step")
+          inOptions.timeStep = atoi(av[++i]);
+        else if (arg == "-z" || arg == "--compress")
+          outOptions.compress = true;
+        else if (arg[0] != '-')
+          inFileName = arg;
+        else
+          usage("unknown cmd-line arg '"+arg+"'");
+      }
+    
+      if (inFileName == "") usage("no input file specified");
+      if (outFileName == "") usage("no output file specified");
+
+      const io::Format *outFormat
+        = outOptions.format == ""
+        ? io::Registry::get().findByExtension(outFileName,/*forSaving*/true)
+        : io::Registry::get().findByName(outOptions.format);
+      if (outFormat && outFormat->name == "umesh") {
+        std::cout << "converting " << inFileName
+                  << " to " << outFileName << std::endl;
+        io::convertToUMesh(inFileName,outFileName,inOptions);
+      } else {
+        std::cout << "loading " << inFileName << std::endl;
+        UMesh::SP mesh = io::load(inFileName,inOptions);
+        std::cout << "done loading, found " << mesh->toString() << std::endl;
+        std::cout << "saving to " << outFileName << std::endl;
+        io::save(outFileName,mesh,outOptions);
+      }
+      std::cout << "done ..." << std::endl;
+    }
+    catch (std::exception &e) {
+      std::cerr << "fatal error " << e.what() << std::endl;
+      exit(1);
+    }
+    return 0;
+  }
+  
+} // ::umesh
@@ -16,13 +16,19 @@
 
 #include "umesh/UMesh.h"
 #include "umesh/io/IO.h"
+#include "umesh/io/UMeshStream.h"
 #include "umesh/check.h"
+#if UMESH_HAVE_TBB
+# include "tbb/parallel_sort.h"
+#endif
 // #include "tetty/UMesh.h"
 #include <set>
 #include <map>
 #include <fstream>
 #include <atomic>
 #include <array>
+#include <limits>
+#include <chrono>
 
 #define DEBUG 0
 
@@ -100,6 +106,8 @@ namespace umesh {
   
     struct Cell : public LogicalCell {
       float scalar;
+      /*! index of this cell in the .cells file it was read from */
+      int   fileIndex;
     };
   
     void add(Cell cell)
@@ -115,29 +123,99 @@ namespace umesh {
 
     size_t size() const { return cellList.size(); }
 
+    /*! open-addressing hash table over all cells of one level,
+        keyed on the cell's level-aligned integer position (ie, its
+        position in units of that level's cell width, relative to
+        the lower corner of all of that level's cells) */
+    struct LevelTable {
+      static const uint64_t emptyKey = ~0ull;
+      /*! bits per dimension in a key */
+      enum { keyBits = 21 };
+
+      /*! computes key for given cell position (in units of this
+          level's cell width); returns false if that position is
+          outside of what this level covers */
+      inline bool makeKey(const vec3i &cellPos, uint64_t &key) const
+      {
+        const vec3i p = cellPos - lower;
+        if (p.x < 0 || p.y < 0 || p.z < 0 ||
+            p.x >= extent.x || p.y >= extent.y || p.z >= extent.z)
+          return false;
+        key = uint64_t(p.x) | (uint64_t(p.y) << keyBits) | (uint64_t(p.z) << (2*keyBits));
+        return true;
+      }
+
+      inline size_t slotOf(uint64_t key) const
+      { return size_t((key * 0x9e3779b97f4a7c15ull) >> hashShift); }
+
+      /*! returns index of cell with given key, or -1 */
+      inline int lookup(uint64_t key) const
+      {
+        if (keys.empty()) return -1;
+        for (size_t slot = slotOf(key);;slot = (slot+1) & mask) {
+          const uint64_t slotKey = keys[slot].load(std::memory_order_relaxed);
+          if (slotKey == key) return values[slot];
+          if (slotKey == emptyKey) return -1;
+        }
+      }
+
+      /*! insert - thread-safe with other insert()s, but not with
+          lookup()s */
+      inline void insert(uint64_t key, int cellID)
+      {
+        for (size_t slot = slotOf(key);;slot = (slot+1) & mask) {
+          uint64_t expected = emptyKey;
+          if (keys[slot].compare_exchange_strong(expected,key)) {
+            values[slot] = cellID;
+            return;
+          }
+          if (expected == key)
+            // same cell listed twice; keep whichever got in first
+            return;
+        }
+      }
+
+      /*! lower corner and size (in cells) of this level's cells */
+      vec3i lower, extent;
+      size_t mask = 0;
+      int    hashShift = 64;
+      std::vector<std::atomic<uint64_t>> keys;
+      std::vector<int>                   values;
+    };
+
+    /*! builds the per-level lookup tables used by find(); has to be
+        called after all cells got added and cellList got sorted,
+        and before the first find() */
+    void buildLookup();
+
     box3f bounds;
     int minLevel=100, maxLevel=0;
     // stores cell and ID
     std::vector<Cell>  cellList;
     // std::map<Cell,size_t> cells;
+    /*! one lookup table for each level in [minLevel..maxLevel] */
+    std::vector<LevelTable> levelTables;
     
     bool find(int &cellID, const vec3f &pos) const;
   };
 
+  /*! orders cells by y, then x, then level, then z (comparing the
+      unsigned bit patterns of those values) - which is the same
+      order as comparing each cell's two 64-bit halves, but without
+      reading the (4-byte aligned) cells through uint64_t pointers,
+      which breaks once the optimizer relies on strict aliasing */
   inline bool operator<(const Exa::LogicalCell &a, const Exa::LogicalCell &b)
   {
-    const uint64_t *pa = (uint64_t *)&a;
-    const uint64_t *pb = (uint64_t *)&b;
-    return
-      (pa[0] < pb[0])
-      || (pa[0] == pb[0] && pa[1] < pb[1]);
+    const uint32_t ka[4] = { uint32_t(a.pos.y), uint32_t(a.pos.x), uint32_t(a.level), uint32_t(a.pos.z) };
+    const uint32_t kb[4] = { uint32_t(b.pos.y), uint32_t(b.pos.x), uint32_t(b.level), uint32_t(b.pos.z) };
+    return std::lexicographical_compare(ka,ka+4,kb,kb+4);
   }
 
   inline bool operator==(const Exa::LogicalCell &a, const Exa::LogicalCell &b)
   {
-    const uint64_t *pa = (uint64_t *)&a;
-    const uint64_t *pb = (uint64_t *)&b;
-    return pa[0] == pb[0] && pa[1] == pb[1];
+    return
+      a.pos.x == b.pos.x && a.pos.y == b.pos.y && a.pos.z == b.pos.z &&
+      a.level == b.level;
   }
 
   inline bool operator<(const Exa::Cell &a, const Exa::Cell &b)
@@ -180,28 +258,108 @@ namespace umesh {
     return f*(1<<level);
   }
 
+  void Exa::buildLookup()
+  {
+    const int numLevels = maxLevel-minLevel+1;
+    levelTables.clear();
+    if (cellList.empty()) return;
+    levelTables.resize(numLevels);
+
+    // per-level cell counts and bounds (in cell widths of that
+    // level), over blocks of cells in parallel
+    std::vector<size_t> count(numLevels,0);
+    std::vector<vec3i>  lower(numLevels,vec3i(std::numeric_limits<int>::max()));
+    std::vector<vec3i>  upper(numLevels,vec3i(std::numeric_limits<int>::min()));
+    std::mutex mutex;
+    parallel_for_blocked(0,cellList.size(),64*1024,[&](size_t begin, size_t end){
+        std::vector<size_t> blockCount(numLevels,0);
+        std::vector<vec3i>  blockLower(numLevels,vec3i(std::numeric_limits<int>::max()));
+        std::vector<vec3i>  blockUpper(numLevels,vec3i(std::numeric_limits<int>::min()));
+        for (size_t i=begin;i<end;i++) {
+          const Cell &cell = cellList[i];
+          const int l = cell.level-minLevel;
+          const vec3i cellPos(cell.pos.x >> cell.level,
+                              cell.pos.y >> cell.level,
+                              cell.pos.z >> cell.level);
+          blockCount[l]++;
+          for (int dim=0;dim<3;dim++) {
+            blockLower[l][dim] = std::min(blockLower[l][dim],cellPos[dim]);
+            blockUpper[l][dim] = std::max(blockUpper[l][dim],cellPos[dim]);
+          }
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int l=0;l<numLevels;l++) {
+          count[l] += blockCount[l];
+          for (int dim=0;dim<3;dim++) {
+            lower[l][dim] = std::min(lower[l][dim],blockLower[l][dim]);
+            upper[l][dim] = std::max(upper[l][dim],blockUpper[l][dim]);
+          }
+        }
+      });
+
+    for (int l=0;l<numLevels;l++) {
+      if (count[l] == 0) continue;
+      LevelTable &table = levelTables[l];
+      table.lower  = lower[l];
+      table.extent = upper[l]-lower[l]+vec3i(1);
+      const int maxExtent = 1<<LevelTable::keyBits;
+      if (table.extent.x > maxExtent || table.extent.y > maxExtent || table.extent.z > maxExtent)
+        throw std::runtime_error("level "+std::to_string(l+minLevel)
+                                 +" is too wide for exa cell lookup");
+      // at most half full
+      int log2Size = 1;
+      while ((size_t(1) << log2Size) < 2*count[l]) log2Size++;
+      const size_t tableSize = size_t(1) << log2Size;
+      table.mask      = tableSize-1;
+      table.hashShift = 64-log2Size;
+      table.keys = std::vector<std::atomic<uint64_t>>(tableSize);
+      table.values.resize(tableSize);
+      parallel_for_blocked(0,tableSize,64*1024,[&](size_t begin, size_t end){
+          for (size_t i=begin;i<end;i++)
+            table.keys[i].store(LevelTable::emptyKey,std::memory_order_relaxed);
+        });
+    }
+
+    // tables got sized from these very cells, so every cell has to
+    // have a key - if one does not, that's a bug in the above
+    std::atomic<bool> missingKey(false);
+    parallel_for_blocked(0,cellList.size(),64*1024,[&](size_t begin, size_t end){
+        for (size_t i=begin;i<end;i++) {
+          const Cell &cell = cellList[i];
+          LevelTable &table = levelTables[cell.level-minLevel];
+          uint64_t key;
+          if (!table.makeKey(vec3i(cell.pos.x >> cell.level,
+                                   cell.pos.y >> cell.level,
+                                   cell.pos.z >> cell.level),key)) {
+            missingKey = true;
+            continue;
+          }
+          table.insert(key,(int)i);
+        }
+      });
+    if (missingKey)
+      throw std::runtime_error("bug in exa::buildLookup(): cell outside"
+                               " of its level's lookup table");
+  }
+
   // return vector-index of given cell, if exists, or -1
   bool Exa::find(int &result, const vec3f &where) const
   {
-    // std::cout << "=======================================================" << std::endl;
-    // // dbg = true;
-    // PING;
     DBG(PING; PRINT(where));
     for (int level=minLevel;level<=maxLevel;level++) {
-      // std::cout << "-------------------------------------------------------" << std::endl;
-      int width = 1<<level;
-      Cell query;
-      query.pos.x = lowerOnLevel(where.x,level); //int(floorf(where.x)) & ~(width-1);
-      query.pos.y = lowerOnLevel(where.y,level); //int(floorf(where.y)) & ~(width-1);
-      query.pos.z = lowerOnLevel(where.z,level); //int(floorf(where.z)) & ~(width-1);
-      query.level = level;
-      auto it = std::lower_bound(cellList.begin(),cellList.end(),query,
-                                 [&](const Cell &a, const Cell &b)->bool{return (const Exa::LogicalCell&)a < (const Exa::LogicalCell&)b;});
+      const LevelTable &table = levelTables[level-minLevel];
+      const int width = 1<<level;
+      const vec3i cellPos(lowerOnLevel(where.x,level)/width,
+                          lowerOnLevel(where.y,level)/width,
+                          lowerOnLevel(where.z,level)/width);
+      uint64_t key;
+      if (!table.makeKey(cellPos,key))
+        continue;
+      const int cellID = table.lookup(key);
       DBG(PRINT(level));
-      DBG(PRINT(query));
-      DBG(PRINT(*it));
-      if (it != cellList.end() && (const LogicalCell&)*it == (const LogicalCell&)query) {
-        result = it-cellList.begin();
+      DBG(PRINT(cellPos));
+      if (cellID >= 0) {
+        result = cellID;
         return true;
       }
     }
@@ -214,36 +372,124 @@ namespace umesh {
   // managing output vertex and scalar generation
   // ##################################################################
 
-  std::map<vec3f,int> vertexIndex;
-  std::mutex vertexMutex;
+  /*! dual vertices are the centers of the input cells, so rather
+      than emitting (and de-duplicating) them one by one, each dual
+      vertex is simply identified by the index of the cell it is the
+      center of: elements directly refer to cell indices. Cells whose
+      center no element uses (eg, cells that are not part of any
+      complete dual cell, or, with --boundary-only, all interior
+      ones) get marked while elements are generated; once all
+      elements are written, only the used cells' centers and scalars
+      get written - in cell order (see writeDualVertices()) - and the
+      writer re-indexes the elements accordingly. Each vertex's tag
+      is the index of its cell in the input .cells file, which is all
+      it takes to apply other .scalars files for the same cells to
+      the dual mesh later on (see gatherScalars()) */
+
+  /*! elements (and statistics about them) generated from one block
+      of input cells. each block of cells gets its own, so
+      generating elements does not need any locks; blocks then get
+      written out in order once a slab of blocks is done */
+  struct DualCells {
+    std::vector<UMesh::Tet>   tets;
+    std::vector<UMesh::Pyr>   pyrs;
+    std::vector<UMesh::Wedge> wedges;
+    std::vector<UMesh::Hex>   hexes;
+
+    size_t numPyramidsPerfect = 0, numPyramidsTwisted = 0;
+    size_t numWedgesPerfect   = 0, numWedgesTwisted   = 0;
+    size_t numHexesPerfect    = 0, numHexesTwisted    = 0;
+  };
 
-  std::shared_ptr<UMesh> output;
-  std::mutex outputMutex;
+  /*! marks all vertices (ie, cells) used by the given block's
+      elements */
+  template<typename T>
+  void markUsedVertices(const std::vector<T> &elements,
+                        std::vector<std::atomic<bool>> &used)
+  {
+    for (auto &elt : elements)
+      for (int i=0;i<T::numVertices;i++)
+        used[elt[i]].store(true,std::memory_order_relaxed);
+  }
 
-  int findOrEmitVertex(const vec4f &v)
+  void markUsedVertices(const DualCells &block,
+                        std::vector<std::atomic<bool>> &used)
   {
-    std::lock_guard<std::mutex> lock(vertexMutex);
+    markUsedVertices(block.tets,used);
+    markUsedVertices(block.pyrs,used);
+    markUsedVertices(block.wedges,used);
+    markUsedVertices(block.hexes,used);
+  }
 
-    auto it = vertexIndex.find((const vec3f&)v);
-    if (it != vertexIndex.end()) return it->second;
-  
-    size_t newID = output->vertices.size();
-    output->vertices.push_back(vec3f{v.x, v.y, v.z});
-    output->perVertex->values.push_back(v.w);
-  
-    if (newID >= 0x7fffffffull) {
-      PING;
-      throw std::runtime_error("vertex index overflow ...");
-    }
-  
-    vertexIndex[(const vec3f&)v] = (int)newID;
+  /*! computes, for each cell, the index of its center in the
+      compacted list of used vertices (or -1 if not used), with a
+      (blocked) scan over the used flags */
+  std::vector<int> computeNewVertexIDs(const std::vector<std::atomic<bool>> &used)
+  {
+    const size_t numCells  = used.size();
+    const size_t blockSize = 64*1024;
+    const size_t numBlocks = divRoundUp(numCells,blockSize);
+    std::vector<size_t> blockOffset(numBlocks+1,0);
+    parallel_for(numBlocks,[&](size_t blockID){
+        const size_t begin = blockID*blockSize;
+        const size_t end   = std::min(begin+blockSize,numCells);
+        for (size_t i=begin;i<end;i++)
+          if (used[i]) blockOffset[blockID+1]++;
+      });
+    for (size_t b=0;b<numBlocks;b++)
+      blockOffset[b+1] += blockOffset[b];
+    std::vector<int> newID(numCells);
+    parallel_for(numBlocks,[&](size_t blockID){
+        const size_t begin = blockID*blockSize;
+        const size_t end   = std::min(begin+blockSize,numCells);
+        size_t out = blockOffset[blockID];
+        for (size_t i=begin;i<end;i++)
+          newID[i] = used[i] ? int(out++) : -1;
+      });
     return newID;
   }
 
-
-
-
-
+  /*! writes the centers (and scalars, and file indices as vertex
+      tags) of all cells that have a valid newID as vertices to the
+      given writer(s), in chunks of cells */
+  void writeDualVertices(const Exa &exa,
+                         const std::vector<int> &newID,
+                         const std::vector<io::UMeshWriter *> &writers)
+  {
+    const size_t numCells = exa.cellList.size();
+    const size_t chunkSize = 16*1024*1024;
+    std::vector<vec3f> vertices;
+    std::vector<float> scalars;
+    std::vector<size_t> tags;
+    size_t numWritten = 0;
+    for (size_t chunkBegin=0;chunkBegin<numCells;chunkBegin+=chunkSize) {
+      const size_t chunkEnd = std::min(chunkBegin+chunkSize,numCells);
+      // newIDs are ascending, so the last used cell tells how many
+      // vertices this chunk has
+      size_t last = chunkEnd;
+      while (last > chunkBegin && newID[last-1] < 0) --last;
+      if (last == chunkBegin) continue;
+      const size_t count = size_t(newID[last-1])+1-numWritten;
+      vertices.resize(count);
+      scalars.resize(count);
+      tags.resize(count);
+      parallel_for_blocked(chunkBegin,last,64*1024,[&](size_t begin, size_t end){
+          for (size_t i=begin;i<end;i++) {
+            if (newID[i] < 0) continue;
+            const size_t out = newID[i]-numWritten;
+            const Exa::Cell &cell = exa.cellList[i];
+            vertices[out] = cell.center();
+            scalars[out]  = cell.scalar;
+            tags[out]     = cell.fileIndex;
+          }
+        });
+      for (auto writer : writers) {
+        writer->addVertices(vertices.data(),scalars.data(),count);
+        writer->addVertexTags(tags.data(),count);
+      }
+      numWritten += count;
+    }
+  }
 
 
 
@@ -255,10 +501,10 @@ namespace umesh {
     do a general planarity test (eg, it would not detect rotations of
     the vertices) */
   template<int U, int V>
-  inline bool isPlanarQuadFaceT(const vec4f v0,
-                                const vec4f v1,
-                                const vec4f v2,
-                                const vec4f v3)
+  inline bool isPlanarQuadFaceT(const vec3f &v0,
+                                const vec3f &v1,
+                                const vec3f &v2,
+                                const vec3f &v3)
   {
     const vec2f v00 = vec2f(v0[U],v0[V]);
     const vec2f v01 = vec2f(v1[U],v1[V]);
@@ -273,11 +519,16 @@ namespace umesh {
     this will ONLY wok for (possibly degen) dual cells, it will _NOT_
     do a general planarity test (eg, it would not detect rotations of
     the vertices) */
-  bool isPlanarQuadFace(const vec4f base00,
-                        const vec4f base01,
-                        const vec4f base11,
-                        const vec4f base10)
+  bool isPlanarQuadFace(const Exa &exa,
+                        int vertex00,
+                        int vertex01,
+                        int vertex11,
+                        int vertex10)
   {
+    const vec3f base00 = exa.cellList[vertex00].center();
+    const vec3f base01 = exa.cellList[vertex01].center();
+    const vec3f base11 = exa.cellList[vertex11].center();
+    const vec3f base10 = exa.cellList[vertex10].center();
     return
       isPlanarQuadFaceT<0,1>(base00,base01,base11,base10) ||
       isPlanarQuadFaceT<0,2>(base00,base01,base11,base10) ||
@@ -315,6 +566,21 @@ namespace umesh {
               << std::endl;
   }
 
+  /*! adds the given block's element counts to the global ones */
+  void addCounts(const DualCells &out)
+  {
+    numTets     += out.tets.size();
+    numPyramids += out.pyrs.size();
+    numWedges   += out.wedges.size();
+    numHexes    += out.hexes.size();
+    numPyramidsPerfect += out.numPyramidsPerfect;
+    numPyramidsTwisted += out.numPyramidsTwisted;
+    numWedgesPerfect   += out.numWedgesPerfect;
+    numWedgesTwisted   += out.numWedgesTwisted;
+    numHexesPerfect    += out.numHexesPerfect;
+    numHexesTwisted    += out.numHexesTwisted;
+  }
+
 
   void sanityCheckFace(vec3i face, const vec4i &tet, int pyrTop)
   {
@@ -351,121 +617,84 @@ namespace umesh {
     sanityCheckFace({tet.x,tet.y,tet.z},tet,-1);
   }
   
-  void emitTet(const std::array<vec4f,4> &vertices)
+  void emitTet(DualCells &out, const std::array<int,4> &vertices)
   {
-    const vec4f &A = vertices[0];    
-    const vec4f &B = vertices[1];    
-    const vec4f &C = vertices[2];    
-    const vec4f &D = vertices[3];
-    
-    const vec4i tet(findOrEmitVertex(A),
-                    findOrEmitVertex(B),
-                    findOrEmitVertex(C),
-                    findOrEmitVertex(D));
+    const vec4i tet(vertices[0],
+                    vertices[1],
+                    vertices[2],
+                    vertices[3]);
   
     sanityCheckTet(tet);
     
-    std::lock_guard<std::mutex> lock(outputMutex);
-    output->tets.push_back({(int)tet.x, (int)tet.y, (int)tet.z, (int)tet.w});
-  
-    static int nextPing = 1;
-    if (numTets++ >= nextPing) {
-      nextPing*=2;
-      printCounts();
-    }
+    out.tets.push_back({(int)tet.x, (int)tet.y, (int)tet.z, (int)tet.w});
   };
 
   // ##################################################################
-  void emitPyramid(const std::array<vec4f,4> &base,
-                   const vec4f &top)
+  void emitPyramid(DualCells &out,
+                   const Exa &exa,
+                   const std::array<int,4> &base,
+                   int top)
   {
     UMesh::Pyr pyr;
-    pyr[4]    = findOrEmitVertex(top);
-    pyr[0] = findOrEmitVertex(base[0]);
-    pyr[1] = findOrEmitVertex(base[1]);
-    pyr[2] = findOrEmitVertex(base[2]);
-    pyr[3] = findOrEmitVertex(base[3]);
-
-    if (isPlanarQuadFace(base[0],base[1],base[2],base[3]))
-      numPyramidsPerfect++;
+    pyr[4] = top;
+    pyr[0] = base[0];
+    pyr[1] = base[1];
+    pyr[2] = base[2];
+    pyr[3] = base[3];
+
+    if (isPlanarQuadFace(exa,base[0],base[1],base[2],base[3]))
+      out.numPyramidsPerfect++;
     else
-      numPyramidsTwisted++;
+      out.numPyramidsTwisted++;
 
     sanityCheckFace({pyr[0],pyr[1],pyr[4]},(const vec4i&)pyr, pyr[4]);
     sanityCheckFace({pyr[1],pyr[2],pyr[4]},(const vec4i&)pyr, pyr[4]);
     sanityCheckFace({pyr[2],pyr[3],pyr[4]},(const vec4i&)pyr, pyr[4]);
     sanityCheckFace({pyr[3],pyr[0],pyr[4]},(const vec4i&)pyr, pyr[4]);
     
-    std::lock_guard<std::mutex> lock(outputMutex);
-    output->pyrs.push_back(pyr);
-
-    static int nextPing = 1;
-    if (numPyramids++ >= nextPing) {
-      nextPing*=2;
-      printCounts();
-    }
+    out.pyrs.push_back(pyr);
   }
 
-  void emitWedge(const std::array<vec4f,3> &front,
-                 const std::array<vec4f,3> &back)
+  void emitWedge(DualCells &out,
+                 const Exa &exa,
+                 const std::array<int,3> &front,
+                 const std::array<int,3> &back)
   {
     UMesh::Wedge wedge;
-    wedge[0] = findOrEmitVertex(front[0]);
-    wedge[1] = findOrEmitVertex(front[1]);
-    wedge[2] = findOrEmitVertex(front[2]);
-    wedge[3] = findOrEmitVertex(back[0]);
-    wedge[4] = findOrEmitVertex(back[1]);
-    wedge[5] = findOrEmitVertex(back[2]);
-
-    if (isPlanarQuadFace(front[0],front[1],back[0],back[1]) &&
-        isPlanarQuadFace(front[0],front[2],back[0],back[2]) &&
-        isPlanarQuadFace(front[1],front[2],back[1],back[2]))
-      numWedgesPerfect++;
+    wedge[0] = front[0];
+    wedge[1] = front[1];
+    wedge[2] = front[2];
+    wedge[3] = back[0];
+    wedge[4] = back[1];
+    wedge[5] = back[2];
+
+    if (isPlanarQuadFace(exa,front[0],front[1],back[0],back[1]) &&
+        isPlanarQuadFace(exa,front[0],front[2],back[0],back[2]) &&
+        isPlanarQuadFace(exa,front[1],front[2],back[1],back[2]))
+      out.numWedgesPerfect++;
     else
-      numWedgesTwisted++;
+      out.numWedgesTwisted++;
     
-    std::lock_guard<std::mutex> lock(outputMutex);
-    output->wedges.push_back(wedge);
-  
-    static int nextPing = 1;
-    if (numWedges++ >= nextPing) {
-      nextPing*=2;
-      printCounts();
-    }
+    out.wedges.push_back(wedge);
   }
 
 
 
 
 
-  void emitHex(const std::array<vec4f,8> corner, bool perfect)
+  void emitHex(DualCells &out, const std::array<int,8> &corner, bool perfect)
   {
     UMesh::Hex hex;
     // vtk order:
-    hex[0] = findOrEmitVertex(corner[0]);
-    hex[1] = findOrEmitVertex(corner[1]);
-    hex[2] = findOrEmitVertex(corner[2]);
-    hex[3] = findOrEmitVertex(corner[3]);
-  
-    hex[4] = findOrEmitVertex(corner[4]);
-    hex[5] = findOrEmitVertex(corner[5]);
-    hex[6] = findOrEmitVertex(corner[6]);
-    hex[7] = findOrEmitVertex(corner[7]);
+    for (int i=0;i<8;i++)
+      hex[i] = corner[i];
   
-  
-    std::lock_guard<std::mutex> lock(outputMutex);
-    output->hexes.push_back(hex);
+    out.hexes.push_back(hex);
 
     if (perfect)
-      numHexesPerfect++;
+      out.numHexesPerfect++;
     else
-      numHexesTwisted++;
-  
-    static int nextPing = 1;
-    if (numHexes++ >= nextPing) {
-      nextPing*=2;
-      printCounts();
-    }
+      out.numHexesTwisted++;
   }
 
 
@@ -493,34 +722,36 @@ namespace umesh {
     other four could still have duplicates .... we further do know
     that the base face has NOT collapsed completely (else we'd have
     had more than 5 duplicates, which gets tested first) */
-  void tryPyramid(const std::array<vec4f,4> &base,
-                  const vec4f &top,
+  void tryPyramid(DualCells &out,
+                  const Exa &exa,
+                  const std::array<int,4> &base,
+                  int top,
                   int numUniqueVertices)
   {
     if (numUniqueVertices == 5) {
       // MUST be a pyramid
-      emitPyramid(base,top);
+      emitPyramid(out,exa,base,top);
       return;
     }
 
     if (numUniqueVertices == 4) {
       // check if any of the EDGES of the base collapsed, then it's a tet.
       if (base[0]==base[1]) {
-        emitTet({base[1],base[2],base[3],top});
+        emitTet(out,{base[1],base[2],base[3],top});
         return;
       }
       if (base[1]==base[2]) {
-        emitTet({base[2],base[3],base[0],top});
+        emitTet(out,{base[2],base[3],base[0],top});
         return;
       }
 
       if (base[2]==base[3]) {
-        emitTet({base[3],base[0],base[1],top});
+        emitTet(out,{base[3],base[0],base[1],top});
         return;
       }
       
       if (base[3]==base[0]) {
-        emitTet({base[0],base[1],base[2],top});
+        emitTet(out,{base[0],base[1],base[2],top});
         return;
       }
       
@@ -606,7 +837,9 @@ namespace umesh {
     have collapsed)...BUT we could still have other collapses going
     on on the 'base' spanned by front[0],front[1],back[0],back[1]
     (vertices 0,1,3,4 in vtk corder) */
-  void tryWedge(const std::array<vec4f,8> &corner,
+  void tryWedge(DualCells &out,
+                const Exa &exa,
+                const std::array<int,8> &corner,
                 const vec3i &frontIdx,
                 const vec3i &backIdx,
                 int numUniqueVertices)
@@ -616,7 +849,8 @@ namespace umesh {
     // MUST be a wedge - possibly curved faces, but that's a
     // differnt story.
     emitWedge
-      ({corner[frontIdx.x],
+      (out,exa,
+       {corner[frontIdx.x],
         corner[frontIdx.y],
         corner[frontIdx.z]},
         {corner[backIdx.x],
@@ -659,12 +893,12 @@ namespace umesh {
   // logic of processing a dual mesh cell
   // ##################################################################
 
-  bool allSame(const vec4f &a, const vec4f &b, const vec4f &c, const vec4f &d)
+  bool allSame(int a, int b, int c, int d)
   {
     return (a==b) && (a==c) && (a==d);
   }
 
-  bool same(const vec4f &a, const vec4f &b)
+  bool same(int a, int b)
   {
     return (a==b);
   }
@@ -730,7 +964,7 @@ namespace umesh {
   // ##################################################################
   // code that actually generates the (possibly-degenerate) dual cells
   // ##################################################################
-  void doCell(const Exa &exa, const Exa::Cell &cell)
+  void doCell(DualCells &out, const Exa &exa, const Exa::Cell &cell)
   {
     int selfID;
     exa.find(selfID,cell.center());
@@ -806,14 +1040,14 @@ namespace umesh {
             // some other cell will generate this
             continue;
 
-          vec4f vertex[2][2][2];
-          for (int iz=0;iz<2;iz++)
-            for (int iy=0;iy<2;iy++)
-              for (int ix=0;ix<2;ix++) {
-                const Exa::Cell &c = exa.cellList[corner[iz][iy][ix]];
-                if (dbg) PRINT(c);
-                vertex[iz][iy][ix] = vec4f(c.center(),c.scalar);
-              }
+          // dual vertices are cell centers, with the cell's index as
+          // vertex index
+          const int (&vertex)[2][2][2] = corner;
+          if (dbg)
+            for (int iz=0;iz<2;iz++)
+              for (int iy=0;iy<2;iy++)
+                for (int ix=0;ix<2;ix++)
+                  PRINT(exa.cellList[corner[iz][iy][ix]]);
 
 
           // const vec4f &v000 = vertex[0][0][0];
@@ -826,7 +1060,7 @@ namespace umesh {
           // const vec4f &v111 = vertex[1][1][1];
 
           // VTK order
-          std::array<vec4f,8> v;
+          std::array<int,8> v;
           if ((dx<0) ^ (dy<0) ^ (dz<0)) {
             // hex is mirrored an un-even time, so has negative volume... swap
             v[0] = vertex[1][0][0];
@@ -859,10 +1093,11 @@ namespace umesh {
               PRINT(vtx);
           }
           
-          std::set<vec4f> uniqueVertices;
-          for (auto vtx : v)
-            uniqueVertices.insert(vtx);
-          int numUniqueVertices = uniqueVertices.size();
+          std::array<int,8> uniqueVertices = v;
+          std::sort(uniqueVertices.begin(),uniqueVertices.end());
+          const int numUniqueVertices
+            = int(std::unique(uniqueVertices.begin(),uniqueVertices.end())
+                  - uniqueVertices.begin());
 
           const auto &v0 = v[0];
           const auto &v1 = v[1];
@@ -879,7 +1114,7 @@ namespace umesh {
           if (minLevel == maxLevel) {
             if (!boundaryOnly) {
               // PING; std::cout << "PERFECT HEX" << std::endl;
-              emitHex(v,/*perfect:*/true);
+              emitHex(out,v,/*perfect:*/true);
             }
             continue;
             // return;
@@ -889,7 +1124,7 @@ namespace umesh {
           // ==================================================================
           // no duplicates, MUST be a general hex
           if (numUniqueVertices == 8) {
-            emitHex(v,/*perfect:*/false);
+            emitHex(out,v,/*perfect:*/false);
             continue;
             // return;
           }
@@ -915,37 +1150,37 @@ namespace umesh {
           // ==================================================================
           // bottom:
           if (allSame(v0,v1,v2,v3)) {
-            tryPyramid(/*facing down:*/{ v4,v7,v6,v5 }, v0, numUniqueVertices);
+            tryPyramid(out,exa,/*facing down:*/{ v4,v7,v6,v5 }, v0, numUniqueVertices);
             continue;
             // return;
           }
           // top:
           if (allSame(v4,v5,v6,v7)) {
-            tryPyramid(/* up:*/{ v0,v1,v2,v3 }, v4, numUniqueVertices);
+            tryPyramid(out,exa,/* up:*/{ v0,v1,v2,v3 }, v4, numUniqueVertices);
             continue;
             // return;
           }
           // front:
           if (allSame(v0,v1,v4,v5)) {
-            tryPyramid(/* face forward*/{v2,v6,v7,v3}, v0, numUniqueVertices);
+            tryPyramid(out,exa,/* face forward*/{v2,v6,v7,v3}, v0, numUniqueVertices);
             continue;
             // return;
           }
           // back:
           if (allSame(v2,v3,v6,v7)) {
-            tryPyramid(/* face back*/{v0,v4,v5,v1}, v2, numUniqueVertices);
+            tryPyramid(out,exa,/* face back*/{v0,v4,v5,v1}, v2, numUniqueVertices);
             continue;
             // return;
           }
           //left:
           if (allSame(v0,v3,v4,v7)) {
-            tryPyramid(/* face right*/{v1,v5,v6,v2}, v0, numUniqueVertices);
+            tryPyramid(out,exa,/* face right*/{v1,v5,v6,v2}, v0, numUniqueVertices);
             continue;
             // return;
           }
           //right:
           if (allSame(v1,v2,v5,v6)) {
-            tryPyramid(/* face left*/{v0,v3,v7,v4}, v1, numUniqueVertices);
+            tryPyramid(out,exa,/* face left*/{v0,v3,v7,v4}, v1, numUniqueVertices);
             continue;
             // return;
           }
@@ -959,72 +1194,72 @@ namespace umesh {
 
           // check front side:
           if (same(v0,v1) && same(v4,v5)) {
-            tryWedge(v,{3,2,0},{7,6,4}, numUniqueVertices);
+            tryWedge(out,exa,v,{3,2,0},{7,6,4}, numUniqueVertices);
             continue;
             // return;
           }
           if (same(v0,v4) && same(v1,v5)) {
-            tryWedge(v,{2,6,5},{3,7,4}, numUniqueVertices);
+            tryWedge(out,exa,v,{2,6,5},{3,7,4}, numUniqueVertices);
             continue;
             // return;
           }
 
           // check back side:
           if (same(v3,v7) && same(v2,v6)) {
-            tryWedge(v,{5,1,2},{4,0,3}, numUniqueVertices);
+            tryWedge(out,exa,v,{5,1,2},{4,0,3}, numUniqueVertices);
             continue;
             // return;
           }
           if (same(v2,v3) && same(v6,v7)) {
-            tryWedge(v,{1,0,3},{5,4,7}, numUniqueVertices);
+            tryWedge(out,exa,v,{1,0,3},{5,4,7}, numUniqueVertices);
             continue;
             // return;
           }
 
           // check top side:
           if (same(v4,v7) && same(v5,v6)) {
-            tryWedge(v,{3,0,4},{2,1,6}, numUniqueVertices);
+            tryWedge(out,exa,v,{3,0,4},{2,1,6}, numUniqueVertices);
             continue;
             // return;
           }
           if (same(v4,v5) && same(v6,v7)) {
-            tryWedge(v,{0,1,4},{3,2,7}, numUniqueVertices);
+            tryWedge(out,exa,v,{0,1,4},{3,2,7}, numUniqueVertices);
             continue;
             // return;
           }
 
           // check bottom side:
           if (same(v0,v1) && same(v3,v2)) {
-            tryWedge(v,{5,4,0},{6,7,3}, numUniqueVertices);
+            tryWedge(out,exa,v,{5,4,0},{6,7,3}, numUniqueVertices);
             continue;
             // return;
           }
           if (same(v0,v3) && same(v1,v2)) {
-            tryWedge(v,{4,7,3},{5,6,2}, numUniqueVertices);
+            tryWedge(out,exa,v,{4,7,3},{5,6,2}, numUniqueVertices);
             continue;
             // return;
           }
 
           // check left side:
           if (same(v0,v3) && same(v4,v7)) {
-            tryWedge(v,{5,6,7},{1,2,3}, numUniqueVertices);
+            tryWedge(out,exa,v,{5,6,7},{1,2,3}, numUniqueVertices);
             continue;
             // return;
           }
           if (same(v0,v4) && same(v3,v7)) {
-            tryWedge(v,{1,5,4},{2,6,7}, numUniqueVertices);
+            tryWedge(out,exa,v,{1,5,4},{2,6,7}, numUniqueVertices);
             continue;
             // return;
           }
 
           // check right side:
           if (same(v1,v2) && same(v5,v6)) {
-            tryWedge(v,{7,4,5},{3,0,1}, numUniqueVertices);
+            tryWedge(out,exa,v,{7,4,5},{3,0,1}, numUniqueVertices);
             continue;
             // return;
           }
           if (same(v1,v5) && same(v2,v6)) {
-            tryWedge(v,{4,0,1},{7,3,2}, numUniqueVertices);
+            tryWedge(out,exa,v,{4,0,1},{7,3,2}, numUniqueVertices);
             continue;
             // return;
           }
@@ -1033,47 +1268,282 @@ namespace umesh {
           // fallback - there's still cases of only ONE collapsed vertex,
           // for example, so let's just make this into a deformed hex 
           // ==================================================================
-          emitHex(v,/*perfect:*/false);
+          emitHex(out,v,/*perfect:*/false);
           continue;
           // return;
         }
   }
   
   
-  void process(Exa &exa)
+  /*! reads cells from a .cells file, and their scalars from a
+      .scalars file, in large chunks; number of cells is whatever
+      both files have data for */
+  void readCells(Exa &exa,
+                 const std::string &cellsFileName,
+                 const std::string &scalarsFileName)
   {
-    std::cout << "sorting cell list for query" << std::endl;
+    std::ifstream in_cells(cellsFileName,std::ios::binary);
+    if (!in_cells.good())
+      throw std::runtime_error("could not open '"+cellsFileName+"'");
+    std::ifstream in_scalars(scalarsFileName,std::ios::binary);
+    if (!in_scalars.good())
+      throw std::runtime_error("could not open '"+scalarsFileName+"'");
+    in_cells.seekg(0,std::ios::end);
+    in_scalars.seekg(0,std::ios::end);
+    const size_t numCells
+      = std::min(size_t(in_cells.tellg())/sizeof(Exa::LogicalCell),
+                 size_t(in_scalars.tellg())/sizeof(float));
+    if (numCells >= 0x7fffffffull)
+      throw std::runtime_error("too many cells ...");
+    in_cells.seekg(0,std::ios::beg);
+    in_scalars.seekg(0,std::ios::beg);
+
+    exa.cellList.resize(numCells);
+    const size_t chunkSize = 16*1024*1024;
+    std::vector<Exa::LogicalCell> cells;
+    std::vector<float> scalars;
+    std::mutex mutex;
+    for (size_t chunkBegin=0;chunkBegin<numCells;chunkBegin+=chunkSize) {
+      const size_t count = std::min(chunkSize,numCells-chunkBegin);
+      cells.resize(count);
+      scalars.resize(count);
+      io::readArray(in_cells,cells.data(),count);
+      io::readArray(in_scalars,scalars.data(),count);
+      parallel_for_blocked(0,count,64*1024,[&](size_t begin, size_t end){
+          box3f bounds;
+          int minLevel = 100, maxLevel = 0;
+          for (size_t i=begin;i<end;i++) {
+            Exa::Cell &cell = exa.cellList[chunkBegin+i];
+            (Exa::LogicalCell &)cell = cells[i];
+            cell.scalar    = scalars[i];
+            cell.fileIndex = int(chunkBegin+i);
+            minLevel = min(minLevel,cell.level);
+            maxLevel = max(maxLevel,cell.level);
+            bounds.extend(cell.bounds());
+          }
+          std::lock_guard<std::mutex> lock(mutex);
+          exa.minLevel = min(exa.minLevel,minLevel);
+          exa.maxLevel = max(exa.maxLevel,maxLevel);
+          exa.bounds.extend(bounds);
+        });
+    }
+  }
+
+  void sortCells(Exa &exa)
+  {
+#if UMESH_HAVE_TBB
+    tbb::parallel_sort(exa.cellList.begin(),exa.cellList.end());
+#else
     std::sort(exa.cellList.begin(),exa.cellList.end());
+#endif
+  }
+
+  /*! writes the elements of all given blocks - in order - to the
+      given writer; if 'typeWriters' are specified, also writes each
+      type of element to its respective writer (tets, pyrs, wedges,
+      hexes order) */
+  void writeDualCells(const std::vector<DualCells> &blocks,
+                      io::UMeshWriter &writer,
+                      const std::vector<io::UMeshWriter *> &typeWriters)
+  {
+    for (auto &block : blocks) {
+      writer.addTets(block.tets.data(),block.tets.size());
+      writer.addPyrs(block.pyrs.data(),block.pyrs.size());
+      writer.addWedges(block.wedges.data(),block.wedges.size());
+      writer.addHexes(block.hexes.data(),block.hexes.size());
+      if (typeWriters.empty()) continue;
+      typeWriters[0]->addTets(block.tets.data(),block.tets.size());
+      typeWriters[1]->addPyrs(block.pyrs.data(),block.pyrs.size());
+      typeWriters[2]->addWedges(block.wedges.data(),block.wedges.size());
+      typeWriters[3]->addHexes(block.hexes.data(),block.hexes.size());
+    }
+  }
+  
+  /*! generates the dual mesh, and streams it to the given file (and,
+      if 'splitByType' is set, also to one file per type of
+      element). Cells get processed in slabs of consecutive cells;
+      since cells are sorted by y first (see operator<), these are
+      slabs in y. Within a slab, blocks of cells are processed in
+      parallel, and once all are done, their elements get written
+      out - so only one slab's worth of elements is ever in memory */
+  void process(Exa &exa,
+               const std::string &outFileName,
+               bool splitByType)
+  {
+    std::cout << "sorting cell list for query" << std::endl;
+    sortCells(exa);
+    std::cout << "building per-level cell lookup tables" << std::endl;
+    exa.buildLookup();
     std::cout << "Sorted .... starting to query" << std::endl;
+
+    io::UMeshWriter writer(outFileName);
+    std::vector<std::unique_ptr<io::UMeshWriter>> typeWriterStorage;
+    std::vector<io::UMeshWriter *> typeWriters;
+    if (splitByType)
+      for (auto type : { "_tets", "_pyrs", "_wedges", "_hexes" }) {
+        typeWriterStorage.emplace_back(new io::UMeshWriter(outFileName+type+".umesh"));
+        typeWriters.push_back(typeWriterStorage.back().get());
+      }
+    std::vector<io::UMeshWriter *> allWriters = typeWriters;
+    allWriters.push_back(&writer);
+
+    const size_t numCells      = exa.cellList.size();
+    if (numCells >= 0x7fffffffull)
+      throw std::runtime_error("vertex index overflow ...");
+    std::vector<std::atomic<bool>> used(numCells);
+    parallel_for_blocked(0,numCells,64*1024,[&](size_t begin, size_t end){
+        for (size_t i=begin;i<end;i++)
+          used[i].store(false,std::memory_order_relaxed);
+      });
+    const size_t blockSize     = 16*1024;
+    const size_t blocksPerSlab = 64;
+    const size_t numBlocks     = divRoundUp(numCells,blockSize);
+    size_t nextPing = 1;
+    for (size_t slabBegin=0;slabBegin<numBlocks;slabBegin+=blocksPerSlab) {
+      const size_t slabEnd = std::min(slabBegin+blocksPerSlab,numBlocks);
+      std::vector<DualCells> blocks(slabEnd-slabBegin);
 #if DEBUG
-    serial_for
+      serial_for
 #else
-      parallel_for
+        parallel_for
 #endif
-      (exa.cellList.size(),
-       [&](size_t cellID){
-         // PING; PRINT(cellID);
-         const Exa::Cell &cell = exa.cellList[cellID];
-         doCell(exa,cell);
-       });
-  }
+        (blocks.size(),
+         [&](size_t i){
+           const size_t begin = (slabBegin+i)*blockSize;
+           const size_t end   = std::min(begin+blockSize,numCells);
+           DualCells &out = blocks[i];
+           for (size_t cellID=begin;cellID<end;cellID++) {
+             // PING; PRINT(cellID);
+             const Exa::Cell &cell = exa.cellList[cellID];
+             doCell(out,exa,cell);
+           }
+           markUsedVertices(out,used);
+           addCounts(out);
+         });
+      writeDualCells(blocks,writer,typeWriters);
+      const size_t numCellsDone = std::min(slabEnd*blockSize,numCells);
+      if (numCellsDone >= nextPing) {
+        while (nextPing <= numCellsDone) nextPing *= 2;
+        printCounts();
+      }
+    }
 
+    // now that all elements are out, write only the vertices they
+    // actually use, and have the writers re-index the elements
+    const std::vector<int> newID = computeNewVertexIDs(used);
+    std::vector<std::atomic<bool>>().swap(used);
+    writeDualVertices(exa,newID,allWriters);
+    std::cout << "dual mesh uses " << prettyNumber(writer.numVertices())
+              << " out of " << prettyNumber(numCells) << " cell centers" << std::endl;
 
+    std::cout << "saving to " << outFileName << std::endl;
+    for (auto w : allWriters) {
+      w->setVertexRemap(&newID);
+      w->close();
+    }
 
+#if UMESH_ENABLE_SANITY_CHECKS
+    // the mesh never exists in memory while generating it, so for
+    // checking it has to get read back in
+    std::cout << "running sanity checks:" << std::endl;
+    sanityCheck(UMesh::loadFrom(outFileName));
+#endif
+  }
+
+  /*! applies other .scalars files (for the same .cells file) to an
+      already generated dual mesh, by gathering each vertex's scalar
+      from the cell that the vertex's tag refers to. Each field gets
+      written as raw floats, one per vertex of the dual mesh (as
+      understood by, eg, umeshExtractIsoSurface --floats) */
+  void gatherScalars(const std::string &dualFileName,
+                     const std::vector<std::string> &scalarsFileNames,
+                     const std::string &outFileName)
+  {
+    io::UMeshReader dual(dualFileName);
+    std::vector<size_t> cellOfVertex;
+    dual.readVertexTags(cellOfVertex);
+    if (cellOfVertex.empty() || cellOfVertex.size() != dual.numVertices)
+      throw std::runtime_error("'"+dualFileName+"' does not have the vertex tags"
+                               " that umeshExaToUMesh writes");
+    size_t numCells = 0;
+    for (auto cellID : cellOfVertex)
+      numCells = std::max(numCells,cellID+1);
+
+    std::vector<float> cellScalars, vertexScalars(cellOfVertex.size());
+    for (size_t f=0;f<scalarsFileNames.size();f++) {
+      const auto begin = std::chrono::steady_clock::now();
+      std::ifstream in(scalarsFileNames[f],std::ios::binary);
+      if (!in.good())
+        throw std::runtime_error("could not open '"+scalarsFileNames[f]+"'");
+      in.seekg(0,std::ios::end);
+      if (size_t(in.tellg()) < numCells*sizeof(float))
+        throw std::runtime_error("'"+scalarsFileNames[f]+"' has fewer scalars"
+                                 " than the dual mesh has cells");
+      in.seekg(0,std::ios::beg);
+      cellScalars.resize(numCells);
+      io::readArray(in,cellScalars.data(),numCells);
+      parallel_for_blocked(0,cellOfVertex.size(),64*1024,[&](size_t begin, size_t end){
+          for (size_t i=begin;i<end;i++)
+            vertexScalars[i] = cellScalars[cellOfVertex[i]];
+        });
+
+      std::string fileName = outFileName;
+      if (scalarsFileNames.size() > 1) {
+        const size_t dot = fileName.find_last_of('.');
+        const size_t slash = fileName.find_last_of('/');
+        const std::string suffix = "_field"+std::to_string(f);
+        if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+          fileName = fileName.substr(0,dot)+suffix+fileName.substr(dot);
+        else
+          fileName = fileName+suffix;
+      }
+      std::ofstream out(fileName,std::ios::binary);
+      io::writeArray(out,vertexScalars.data(),vertexScalars.size());
+      if (!out.good())
+        throw std::runtime_error("error writing '"+fileName+"'");
+      const auto end = std::chrono::steady_clock::now();
+      std::cout << "gathered " << scalarsFileNames[f] << " into " << fileName
+                << " (" << prettyNumber(vertexScalars.size()) << " floats), took "
+                << std::chrono::duration<double>(end-begin).count() << "s" << std::endl;
+    }
+  }
+
+  void usage(const std::string &error = "")
+  {
+    if (error != "")
+      std::cerr << "Error : " << error  << "\n\n";
+    std::cout << "./umeshExaToUMesh in.cells in.scalars -o out.umesh [--boundary-only] [--split-by-type]" << std::endl;
+    std::cout << "./umeshExaToUMesh --gather dual.umesh other.scalars [more.scalars ...] -o out.floats" << std::endl;
+    std::cout << "--boundary-only : only emit dual cells that are not perfect hexes (ie, the ones at level boundaries)" << std::endl;
+    std::cout << "--split-by-type : also write each type of element to its own file, <out.umesh>_tets.umesh, _pyrs.umesh, _wedges.umesh, and _hexes.umesh" << std::endl;
+    std::cout << "--gather <dual.umesh> : do not generate a dual mesh, but apply the given .scalars file(s) - for the same cells - to a dual mesh previously generated by this tool; writes one raw float per dual vertex for each field (inserting _field<i> before the extension if there is more than one)" << std::endl;
+    exit(error != "");
+  }
 
   extern "C" int main(int ac, char **av)
   {
     std::string cellsFileName = "";
     std::string scalarsFileName = "";
     std::string outFileName = "";
+    bool splitByType = false;
+    std::string dualFileName = "";
+    std::vector<std::string> gatherFileNames;
     for (int i=1;i<ac;i++) {
       const std::string arg = av[i];
-      if (arg == "-o")
+      if (arg == "-h")
+        usage();
+      else if (arg == "-o")
         outFileName = av[++i];
       else if (arg == "--boundary-only")
         boundaryOnly = true;
+      else if (arg == "--split-by-type")
+        splitByType = true;
+      else if (arg == "--gather")
+        dualFileName = av[++i];
       else if (arg[0] == '-')
-        throw std::runtime_error("./exa2umesh in.cells scalar.scalars -o out.umesh [--boundary-only]\n");
+        usage("unknown cmd-line arg '"+arg+"'");
+      else if (dualFileName != "")
+        gatherFileNames.push_back(arg);
       else {
         if (cellsFileName == "")
           cellsFileName = arg;
@@ -1082,86 +1552,24 @@ namespace umesh {
         else if (outFileName == "")
           outFileName = arg;
         else 
-          throw std::runtime_error("./exa2umesh in.cells scalar.scalars -o out.umesh [--boundary-only]\n");
+          usage("too many file names");
       }
     }
+    if (outFileName == "") usage("no output file specified");
+    if (dualFileName != "") {
+      if (gatherFileNames.empty()) usage("no scalars file(s) to gather specified");
+      gatherScalars(dualFileName,gatherFileNames,outFileName);
+      return 0;
+    }
+    if (scalarsFileName == "") usage("no cells and/or scalars file specified");
     cout.precision(10);
     Exa exa;
-    std::ifstream in_cells(cellsFileName);
-    std::ifstream in_scalars(scalarsFileName);
-    output = std::make_shared<UMesh>();
-  
-    while (!in_cells.eof()) {
-      Exa::Cell cell;
-      in_cells.read((char*)&cell,sizeof(Exa::LogicalCell));
-      in_scalars.read((char*)&cell.scalar,sizeof(float));
-    
-      if (!(in_cells.good() && in_scalars.good()))
-        break;
-    
-      exa.add(cell);
-      // static size_t nextPing = 1;
-      // if (exa.size() >= nextPing) {
-      //   std::cout << "read so far : " << exa.size() << ", bounds " << exa.bounds << std::endl;
-      //   nextPing *= 2;
-      // }
-    }
+    readCells(exa,cellsFileName,scalarsFileName);
     std::cout << "done reading, found " << prettyNumber(exa.size()) << " cells" << std::endl;
 
-    output->perVertex = std::make_shared<Attribute>();
-    
-    process(exa);
-
-    output->finalize();
-    std::cout << "created umesh " << output->toString() << std::endl;
-    std::cout << "running sanity checks:" << std::endl;
-    sanityCheck(output);
-    //io::saveBinaryUMesh(outFileName,output);
-    std::cout << "saving to " << outFileName << std::endl;
-
-    PRINT(output->vertices.size());
-    PRINT(output->hexes.size());
-    output->saveTo(outFileName);
-
-#if 1
-    {
-      UMesh::SP tmp = std::make_shared<UMesh>();
-      tmp->vertices = output->vertices;
-      tmp->perVertex = output->perVertex;
-      tmp->hexes = output->hexes;
-      tmp->saveTo(outFileName+"_hexes.umesh");
-    }
-#endif
-
-#if 1
-    {
-      UMesh::SP tmp = std::make_shared<UMesh>();
-      tmp->vertices = output->vertices;
-      tmp->perVertex = output->perVertex;
-      tmp->pyrs = output->pyrs;
-      tmp->saveTo(outFileName+"_pyrs.umesh");
-    }
-#endif
-
-#if 1
-    {
-      UMesh::SP tmp = std::make_shared<UMesh>();
-      tmp->vertices = output->vertices;
-      tmp->perVertex = output->perVertex;
-      tmp->wedges = output->wedges;
-      tmp->saveTo(outFileName+"_wedges.umesh");
-    }
-#endif
-
-#if 1
-    {
-      UMesh::SP tmp = std::make_shared<UMesh>();
-      tmp->vertices = output->vertices;
-      tmp->perVertex = output->perVertex;
-      tmp->tets = output->tets;
-      tmp->saveTo(outFileName+"_tets.umesh");
-    }
-#endif
+    process(exa,outFileName,splitByType);
+    printCounts();
+    std::cout << "done" << std::endl;
   }
 
 }
@@ -16,6 +16,8 @@
 
 #include "umesh/io/ugrid32.h"
 #include "umesh/io/UMesh.h"
+#include "umesh/io/Registry.h"
+#include "umesh/io/obj.h"
 #include "umesh/extractIsoSurface.h"
 
 namespace umesh {
@@ -25,18 +27,63 @@ namespace umesh {
     if (error != "")
       std::cerr << "Error : " << error  << "\n\n";
 
-    std::cout << "Usage: ./umeshExtractIsoSurface <in.umesh> -iso scalarValue (-o <out.umesh> | --obj file.obj)" << std::endl;;
+    std::cout << "Usage: ./umeshExtractIsoSurface <in.umesh> -iso scalarValue [-iso scalarValue ...] (-o <out.umesh> | --obj file.obj) [--index <file.vri>] [--floats <timeStep.floats> ...]" << std::endl;;
+    std::cout << "-iso <value> : iso-value to extract; can be specified multiple times, in which case all surfaces get extracted in a single pass, and get saved as <out>_iso<i>.umesh (or .obj)" << std::endl;
+    std::cout << "--floats <file> : use per-vertex scalars from given file (raw floats, one per vertex) rather than the mesh's own; can be specified multiple times (eg, for time steps), in which case outputs get saved as <out>_field<f>_iso<i>.umesh (or .obj)" << std::endl;
+    std::cout << "--index <file.vri> : use value range index stored in given file to visit only active elements; if the file does not exist yet, or was built for a different mesh or scalar field, the index gets (re-)built and saved there" << std::endl;
     exit (error != "");
   };
+
+  /*! if we produce more than one surface, name them by field and
+      iso-value index, and insert that before the given file's
+      extension */
+  std::string outputName(const std::string &fileName,
+                         const std::string &ext,
+                         const std::string &suffix)
+  {
+    if (suffix == "") return fileName;
+    std::string base = fileName;
+    if (base.size() > ext.size() &&
+        base.substr(base.size()-ext.size()) == ext)
+      base = base.substr(0,base.size()-ext.size());
+    return base+suffix+ext;
+  }
+
+  void saveResult(UMesh::SP result,
+                  const std::string &outFileName,
+                  const std::string &objFileName)
+  {
+    if (outFileName != "") {
+      std::cout << "saving to " << outFileName << std::endl;
+      result->saveTo(outFileName);
+    }
+    if (objFileName != "") {
+      std::cout << "writing in OBJ format to " << objFileName << std::endl;
+      io::saveOBJ(objFileName,result);
+    }
+  }
+
+  /*! read a raw per-vertex float array, as, eg, written by umeshBreakApartFun3D */
+  Attribute::SP loadFloats(const std::string &fileName, size_t numVertices)
+  {
+    std::ifstream in(fileName,std::ios::binary);
+    if (!in.good())
+      throw std::runtime_error("could not open '"+fileName+"'");
+    Attribute::SP field = std::make_shared<Attribute>((int)numVertices);
+    field->name = fileName;
+    io::readArray(in,field->values.data(),numVertices);
+    field->finalize();
+    return field;
+  }
   
   extern "C" int main(int ac, char **av)
   {
-    float isoValue = std::numeric_limits<float>::infinity();
+    std::vector<float> isoValues;
+    std::vector<std::string> floatsFileNames;
     std::string inFileName;
     std::string outFileName;
     std::string objFileName;
-    /*! if enabled, we'll only save the tets that _we_ created, not
-        those that were in the file initially */
+    std::string indexFileName;
     for (int i=1;i<ac;i++) {
       const std::string arg = av[i];
       if (arg == "-h")
@@ -44,9 +91,13 @@ namespace umesh {
       else if (arg == "-o")
         outFileName = av[++i];
       else if (arg == "-iso" || arg == "--iso-value" || arg == "--iso")
-        isoValue = std::stof(av[++i]);
+        isoValues.push_back(std::stof(av[++i]));
       else if (arg == "--obj")
         objFileName = av[++i];
+      else if (arg == "--index")
+        indexFileName = av[++i];
+      else if (arg == "--floats")
+        floatsFileNames.push_back(av[++i]);
       else if (arg[0] != '-')
         inFileName = arg;
       else
@@ -56,11 +107,13 @@ namespace umesh {
     if (inFileName == "") usage("no input file specified");
     if (outFileName == "" && objFileName == "") usage("neither obj nor umesh output file specified");
     
-    if (isoValue == std::numeric_limits<float>::infinity())
+    if (isoValues.empty())
       usage("no iso-value specified");
+    if (indexFileName != "" && (isoValues.size() > 1 || !floatsFileNames.empty()))
+      usage("--index can only be used with a single iso-value on the mesh's own scalars");
     
     std::cout << "loading umesh from " << inFileName << std::endl;
-    UMesh::SP in = UMesh::loadFrom(inFileName);
+    UMesh::SP in = io::load(inFileName);
     
     std::cout << "done loading, found " << in->toString()
               << " ... now extracting iso-surface" << std::endl;
@@ -73,22 +126,63 @@ namespace umesh {
       std::cout << "*******************************************************" << std::endl;
       std::cout << UMESH_TERMINAL_DEFAULT << std::endl;
     }
+
+    if (!floatsFileNames.empty()) {
+      std::vector<Attribute::SP> fields;
+      for (auto fileName : floatsFileNames) {
+        std::cout << "loading scalars from " << fileName << std::endl;
+        fields.push_back(loadFloats(fileName,in->vertices.size()));
+      }
+      std::vector<std::vector<UMesh::SP>> results
+        = extractIsoSurfaces(in,fields,isoValues);
+      for (size_t f=0;f<fields.size();f++)
+        for (size_t k=0;k<isoValues.size();k++) {
+          std::cout << "done extracting isovalue " << isoValues[k]
+                    << " for " << floatsFileNames[f]
+                    << ", found " << results[f][k]->toString() << std::endl;
+          const std::string suffix
+            = (fields.size() > 1 ? "_field"+std::to_string(f) : std::string(""))
+            + (isoValues.size() > 1 ? "_iso"+std::to_string(k) : std::string(""));
+          saveResult(results[f][k],
+                     outFileName == "" ? "" : outputName(outFileName,".umesh",suffix),
+                     objFileName == "" ? "" : outputName(objFileName,".obj",suffix));
+        }
+    } else if (isoValues.size() > 1) {
+      std::vector<UMesh::SP> results = extractIsoSurfaces(in,isoValues);
+      for (size_t k=0;k<isoValues.size();k++) {
+        std::cout << "done extracting isovalue " << isoValues[k]
+                  << ", found " << results[k]->toString() << std::endl;
+        const std::string suffix = "_iso"+std::to_string(k);
+        saveResult(results[k],
+                   outFileName == "" ? "" : outputName(outFileName,".umesh",suffix),
+                   objFileName == "" ? "" : outputName(objFileName,".obj",suffix));
+      }
+    } else {
+      const float isoValue = isoValues[0];
+      ValueRangeIndex::SP index;
+      if (indexFileName != "") {
+        if (std::ifstream(indexFileName).good()) {
+          std::cout << "loading value range index from " << indexFileName << std::endl;
+          index = ValueRangeIndex::loadFrom(indexFileName);
+          if (!index->matches(*in)) {
+            std::cout << "value range index was built for a different mesh"
+                      << " or scalar field; rebuilding" << std::endl;
+            index = nullptr;
+          }
+        }
+        if (!index) {
+          std::cout << "building value range index ..." << std::endl;
+          index = ValueRangeIndex::build(in);
+          std::cout << "saving value range index to " << indexFileName << std::endl;
+          index->saveTo(indexFileName);
+        }
+        std::cout << "index has " << prettyNumber(index->countActive(isoValue))
+                  << " active elements for this iso-value" << std::endl;
+      }
     
-    UMesh::SP result = extractIsoSurface(in,isoValue);
-    std::cout << "done extracting isovalue, found " << result->toString() << std::endl;
-    if (outFileName != "") {
-      std::cout << "saving to " << outFileName << std::endl;
-      result->saveTo(outFileName);
-    }
-    if (objFileName != "") {
-      std::cout << "writing in OBJ format to " << objFileName << std::endl;
-      std::cout << UMESH_TERMINAL_RED << "# WARNING - this can take a while!"
-                << UMESH_TERMINAL_DEFAULT << std::endl;
-      std::ofstream out(objFileName);
-      for (auto v : result->vertices)
-        out << "v " << v.x << " " << v.y << " " << v.z << std::endl;
-      for (auto t : result->triangles)
-        out << "f " << (t.x+1) << " " << (t.y+1) << " " << (t.z+1) << std::endl;
+      UMesh::SP result = extractIsoSurface(in,isoValue,index);
+      std::cout << "done extracting isovalue, found " << result->toString() << std::endl;
+      saveResult(result,outFileName,objFileName);
     }
       
     std::cout << "done all ..." << std::endl;
@@ -14,24 +14,32 @@
 // limitations under the License.                                           //
 // ======================================================================== //
 
-/* no computations at all - just dumps the mesh that's implicit in the
-   input umesh, and dumps it in obj format (other prims get
-   ignored) */ 
+/* computes the outer shell of a volumetric umesh - ie, all the
+   triangle and/or bilinear faces that are _not_ shared between two
+   neighboring elements - and dumps it in umesh, obj, or binary
+   triangle mesh (btm) format */ 
 
-#include "umesh/io/ugrid64.h"
-#include "umesh/io/UMesh.h"
-#include "umesh/RemeshHelper.h"
+#include "umesh/io/Registry.h"
+#include "umesh/io/btm/BTM.h"
+#include "umesh/io/text.h"
 #include "umesh/extractShellFaces.h"
 #include <algorithm>
 
 namespace umesh {
 
-  typedef enum { INVALID, UMESH, OBJ } Format;
+  typedef enum { INVALID, UMESH, OBJ, BTM } Format;
 
+  inline bool endsWith(const std::string &s, const std::string &suffix)
+  {
+    return s.size() >= suffix.size()
+      && s.substr(s.size()-suffix.size()) == suffix;
+  }
+  
   Format formatFromFileName(const std::string &fileName)
   {
-    if (fileName.substr(fileName.size()-4) == ".obj") return OBJ;
-    if (fileName.substr(fileName.size()-6) == ".umesh") return UMESH;
+    if (endsWith(fileName,".obj")) return OBJ;
+    if (endsWith(fileName,".umesh")) return UMESH;
+    if (endsWith(fileName,".btm") || endsWith(fileName,".tribin")) return BTM;
     return INVALID;
   }
 
@@ -49,60 +57,66 @@ namespace umesh {
     n1 = normalize(n1);
     return dot(n0,n1) >= .99f;
   }
+
   void saveToOBJ(const std::string &outFileName, UMesh::SP mesh)
   {
     std::cout << "... saving (in OBJ format) to " << outFileName << std::endl;
-    std::ofstream out(outFileName);
-    for (auto vtx : mesh->vertices)
-      out << "v " << vtx.x << " " << vtx.y << " " << vtx.z << std::endl;
-    for (auto idx : mesh->triangles)
-      out << "f " << (idx.x+1) << " " << (idx.y+1) << " " << (idx.z+1) << std::endl;
-    for (auto idx : mesh->quads) {
-      vec3f v0 = mesh->vertices[idx.x];
-      vec3f v1 = mesh->vertices[idx.y];
-      vec3f v2 = mesh->vertices[idx.z];
-      vec3f v3 = mesh->vertices[idx.w];
-      if (flat(v0,v1,v2,v3)) {
-        out << "f " << (idx.x+1) << " " << (idx.y+1) << " " << (idx.z+1) << " " << (idx.w+1) << std::endl;
-      } else {
-        // write mini-bilinear patch of NxN vertices ((N-1)x(N-1) quads)
-        int N = 6;
-        for (int ix=0;ix<N;ix++)
-          for (int iy=0;iy<N;iy++) {
-            float u = ix / float(N-1);
-            float v = iy / float(N-1);
-            vec3f p
-              = (1.f-u)*(1.f-v)*v0
-              + (1.f-u)*(    v)*v1
-              + (    u)*(1.f-v)*v3
-              + (    u)*(    v)*v2
-              ;
-            out << "v " << p.x << " " << p.y << " " << p.z << std::endl;
-          }
-        for (int ix=0;ix<N-1;ix++)
-          for (int iy=0;iy<N-1;iy++) {
-            out << "f " << ((ix+0)*N+(iy+0)-N*N)
-                << "  " << ((ix+1)*N+(iy+0)-N*N)
-                << "  " << ((ix+1)*N+(iy+1)-N*N)
-                << "  " << ((ix+0)*N+(iy+1)-N*N) << std::endl;
-          }
-      }
-    }
+    std::ofstream out(outFileName,std::ios::binary);
+    if (!out.good())
+      throw std::runtime_error("could not open '"+outFileName+"' for writing");
+    io::writeTextParallel(out,mesh->vertices.size(),[&](io::TextBlock &out, size_t i){
+        const vec3f vtx = mesh->vertices[i];
+        out << "v " << vtx.x << " " << vtx.y << " " << vtx.z << "\n";
+      });
+    io::writeTextParallel(out,mesh->triangles.size(),[&](io::TextBlock &out, size_t i){
+        const vec3i idx = mesh->triangles[i];
+        out << "f " << (idx.x+1) << " " << (idx.y+1) << " " << (idx.z+1) << "\n";
+      });
+    // note non-flat quads get written as little patches with their own
+    // vertices, but since those use relative indices every quad's text
+    // is still independent of all others'
+    io::writeTextParallel(out,mesh->quads.size(),[&](io::TextBlock &out, size_t i){
+        const vec4i idx = mesh->quads[i];
+        vec3f v0 = mesh->vertices[idx.x];
+        vec3f v1 = mesh->vertices[idx.y];
+        vec3f v2 = mesh->vertices[idx.z];
+        vec3f v3 = mesh->vertices[idx.w];
+        if (flat(v0,v1,v2,v3)) {
+          out << "f " << (idx.x+1) << " " << (idx.y+1) << " " << (idx.z+1) << " " << (idx.w+1) << "\n";
+        } else {
+          // write mini-bilinear patch of NxN vertices ((N-1)x(N-1) quads)
+          int N = 6;
+          for (int ix=0;ix<N;ix++)
+            for (int iy=0;iy<N;iy++) {
+              float u = ix / float(N-1);
+              float v = iy / float(N-1);
+              vec3f p
+                = (1.f-u)*(1.f-v)*v0
+                + (1.f-u)*(    v)*v1
+                + (    u)*(1.f-v)*v3
+                + (    u)*(    v)*v2
+                ;
+              out << "v " << p.x << " " << p.y << " " << p.z << "\n";
+            }
+          for (int ix=0;ix<N-1;ix++)
+            for (int iy=0;iy<N-1;iy++) {
+              out << "f " << ((ix+0)*N+(iy+0)-N*N)
+                  << "  " << ((ix+1)*N+(iy+0)-N*N)
+                  << "  " << ((ix+1)*N+(iy+1)-N*N)
+                  << "  " << ((ix+0)*N+(iy+1)-N*N) << "\n";
+            }
+        }
+      });
     std::cout << "... done" << std::endl;
   }
 
-  UMesh::SP load(const std::string &fileName)
+  void saveToBTM(const std::string &outFileName, UMesh::SP mesh)
   {
-    if (fileName.substr(fileName.size()-6) == ".umesh")
-      return UMesh::loadFrom(fileName);
-    
-    if (fileName.substr(fileName.size()-8) == ".ugrid64")
-      return io::UGrid64Loader::load(fileName);
-
-    throw std::runtime_error("could not determine input format"
-                             " (only supporting ugrid64 or umesh for now)");
+    std::cout << "... saving (in BTM format) to " << outFileName << std::endl;
+    btm::fromUMesh(mesh)->save(outFileName);
+    std::cout << "... done" << std::endl;
   }
-  
+
   extern "C" int main(int ac, char **av)
   {
     try {
@@ -118,10 +132,12 @@ namespace umesh {
           format = OBJ;
         else if (arg == "--umesh")
           format = UMESH;
+        else if (arg == "--btm" || arg == "--tribin")
+          format = BTM;
         else if (arg[0] != '-')
           inFileName = arg;
         else {
-          throw std::runtime_error("./umeshExtractShell <in.umesh> [--obj|--umesh] -o <out.obj|.umesh>");
+          throw std::runtime_error("./umeshExtractShell <in.umesh> [--obj|--umesh|--btm] -o <out.obj|.umesh|.btm>");
         }
       }
 
@@ -129,7 +145,7 @@ namespace umesh {
         format = formatFromFileName(outFileName);
       
       std::cout << "loading umesh from " << inFileName << std::endl;
-      UMesh::SP inMesh = load(inFileName);
+      UMesh::SP inMesh = io::load(inFileName);
 
       std::cout << "extracting shell faces .... this can take a while" << std::endl;
       UMesh::SP outMesh = extractShellFaces(inMesh,1);
@@ -142,6 +158,9 @@ namespace umesh {
       case UMESH:
         outMesh->saveTo(outFileName);
         break;
+      case BTM:
+        saveToBTM(outFileName,outMesh);
+        break;
       default:
         throw std::runtime_error("invalid/unsupported format!?");
       }
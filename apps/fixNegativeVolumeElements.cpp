@@ -20,6 +20,7 @@
 
 #include "umesh/io/ugrid32.h"
 #include "umesh/io/UMesh.h"
+#include "umesh/io/Registry.h"
 #include "umesh/io/btm/BTM.h"
 #include "umesh/RemeshHelper.h"
 #include <algorithm>
@@ -162,7 +163,7 @@ namespace umesh {
         throw std::runtime_error("no output filename specified (-o)");
 
       std::cout << "loading umesh from " << inFileName << std::endl;
-      UMesh::SP in = io::loadBinaryUMesh(inFileName);
+      UMesh::SP in = io::load(inFileName);
       std::cout << "flipping negative elements ....\n\n";
       fixNegativeVolumes(in);
 
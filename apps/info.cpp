@@ -16,6 +16,7 @@
 
 #include "umesh/io/ugrid32.h"
 #include "umesh/io/UMesh.h"
+#include "umesh/io/Registry.h"
 
 namespace umesh {
 
@@ -44,7 +45,7 @@ namespace umesh {
     if (inFileName == "") usage("no input file specified");
     
     std::cout << "loading umesh from " << inFileName << std::endl;
-    UMesh::SP in = io::loadBinaryUMesh(inFileName);
+    UMesh::SP in = io::load(inFileName);
 
     std::cout << "UMesh info:\n" << in->toString(false) << std::endl;
   }
@@ -23,8 +23,9 @@
 
 #include "umesh/io/ugrid32.h"
 #include "umesh/io/UMesh.h"
+#include "umesh/io/Registry.h"
 #include "umesh/RemeshHelper.h"
-#include <queue>
+#include "umesh/partition.h"
 
 namespace umesh {
 
@@ -37,75 +38,42 @@ namespace umesh {
     std::cout << "-o <baseName>\n\tbase path for all output files (there will be multiple)" << std::endl;
     std::cout << "-n|-mb|--max-bricks <N>\n\tmax number of bricks to create" << std::endl;
     std::cout << "-lt|--leaf-threshold <N>\n\tnum prims at which we make a leaf" << std::endl;
+    std::cout << "--sah|--median\n\tsplit bricks using binned SAH (default), or at the object median" << std::endl;
+    std::cout << "--morton|--hilbert\n\tinstead of splitting, cut elements sorted along a space filling curve into <N> bricks (requires -n)" << std::endl;
+    std::cout << "--graph\n\tinstead of splitting, partition the mesh's dual graph into <N> bricks, minimizing the number of faces shared between bricks (requires -n); reports the resulting edge cut" << std::endl;
+    std::cout << "--imbalance <f>\n\tfraction by which bricks' weights may exceed the average with --graph (default: 0.03)" << std::endl;
+    std::cout << "--weight elements|vertices|bytes\n\twhat to balance across bricks with --morton/--hilbert/--graph (default: elements)" << std::endl;
+    std::cout << "--halo <k>\n\tadd <k> rings of ghost elements from neighboring bricks to each brick (default: 0)" << std::endl;
+    std::cout << "--halo-adjacency face|vertex\n\twhether halo rings grow through shared faces (default) or shared vertices" << std::endl;
     std::cout << std::endl;
     std::cout << "generated files are:" << std::endl;
-    std::cout << "<baseName>.bricks : one box3f for each generated brick" << std::endl;
+    std::cout << "<baseName>.bounds : one box3f for each generated brick" << std::endl;
     std::cout << "<baseName>_%05d.umesh : the extracted umeshes for each brick" << std::endl;
+    std::cout << "with --halo, each brick's ghost elements come after its owned ones," << std::endl;
+    std::cout << "with the per-type counts of owned elements stored in the brick's umesh" << std::endl;
     exit( error != "");
   }
 
-  struct Brick {
-    std::vector<UMesh::PrimRef> prims;
-    box3f bounds;
-    box3f centBounds;
-  };
-
-  void split(UMesh::SP mesh,
-             Brick *in,
-             Brick *out[2])
-  {
-    // PING;
-    // PRINT(in->prims.size());
-    // PRINT(in->bounds);
-    // PRINT(in->centBounds);
-
-    if (in->centBounds.lower == in->centBounds.upper)
-      throw std::runtime_error("can't split this any more ...");
-
-    int dim = arg_max(in->centBounds.size());
-    float pos = in->centBounds.center()[dim];
-    std::cout << "splitting brick\tw/ bounds " << in->bounds << " cent " << in->centBounds << std::endl;
-    std::cout << "splitting at " << char('x'+dim) << "=" << pos << std::endl;
-
-    out[0] = new Brick;
-    out[1] = new Brick;
-    for (auto prim : in->prims) {
-      const box3f pb = mesh->getBounds(prim);
-      int side = (pb.center()[dim] < pos) ? 0 : 1;
-      out[side]->prims.push_back(prim);
-      out[side]->bounds.extend(pb);
-      out[side]->centBounds.extend(pb.center());
-    }
-    std::cout << "done splitting " << prettyNumber(in->prims.size()) << " prims\tw/ bounds " << in->bounds << std::endl;
-    std::cout << "into L = " << prettyNumber(out[0]->prims.size()) << " prims\tw/ bounds " << out[0]->bounds << std::endl;
-    std::cout << " and R = " << prettyNumber(out[1]->prims.size()) << " prims\tw/ bounds " << out[1]->bounds << std::endl;
-  }
-  
-  void createInitialBrick(std::priority_queue<std::pair<int,Brick *>> &bricks,
-                          UMesh::SP in)
-  {
-    Brick *brick = new Brick;
-    in->createVolumePrimRefs(brick->prims);
-    for (auto prim : brick->prims) {
-      const box3f pb = in->getBounds(prim);
-      brick->bounds.extend(pb);
-      brick->centBounds.extend(pb.center());
-    }
-           
-    bricks.push({(int)brick->prims.size(),brick});
-  }
-
   void writeBrick(UMesh::SP in,
                   const std::string &fileBase,
-                  Brick *brick)
+                  const ObjectSpaceBrick &brick,
+                  const std::vector<UMesh::PrimRef> *ghosts)
   {
-    UMesh::SP out = std::make_shared<UMesh>();
-    RemeshHelper indexer(*out);
-    for (auto prim : brick->prims) 
-      indexer.add(in,prim);
+    UMesh::SP out;
+    if (ghosts)
+      out = extractSubMesh(in,brick.prims,*ghosts);
+    else {
+      out = std::make_shared<UMesh>();
+      RemeshHelper indexer(*out);
+      for (auto prim : brick.prims) 
+        indexer.add(in,prim);
+    }
     const std::string fileName = fileBase+".umesh";
     std::cout << "saving out " << fileName
-              << " w/ " << prettyNumber(out->size()) << " prims" << std::endl;
+              << " w/ " << prettyNumber(out->size()) << " prims";
+    if (ghosts)
+      std::cout << " (" << prettyNumber(ghosts->size()) << " of which are ghosts)";
+    std::cout << std::endl;
     io::saveBinaryUMesh(fileName,out);
   }
   
@@ -113,17 +81,61 @@ namespace umesh {
   {
     std::string inFileName;
     std::string outFileBase;
-    int leafThreshold = 1<<30;
-    int maxBricks = 1<<30;
+    size_t leafThreshold = 0;
+    size_t maxBricks = 0;
+    SplitMethod splitMethod = SPLIT_SAH;
+    bool useCurve = false;
+    SpaceFillingCurve curve = CURVE_HILBERT;
+    bool useGraph = false;
+    float imbalance = .03f;
+    BrickWeight weight = WEIGHT_ELEMENTS;
+    int numHaloRings = 0;
+    HaloAdjacency haloAdjacency = HALO_FACE_NEIGHBORS;
     
     for (int i=1;i<ac;i++) {
       const std::string arg = av[i];
       if (arg == "-o")
         outFileBase = av[++i];
       else if (arg == "-lt" || arg == "--leaf-threshold")
-        leafThreshold = atoi(av[++i]);
-      else if (arg == "-mb" || arg == "--max-bricks")
-        leafThreshold = atoi(av[++i]);
+        leafThreshold = std::stoull(av[++i]);
+      else if (arg == "-n" || arg == "-mb" || arg == "--max-bricks")
+        maxBricks = std::stoull(av[++i]);
+      else if (arg == "--sah")
+        splitMethod = SPLIT_SAH;
+      else if (arg == "--median")
+        splitMethod = SPLIT_MEDIAN;
+      else if (arg == "--morton") {
+        useCurve = true;
+        curve = CURVE_MORTON;
+      } else if (arg == "--hilbert") {
+        useCurve = true;
+        curve = CURVE_HILBERT;
+      } else if (arg == "--graph")
+        useGraph = true;
+      else if (arg == "--imbalance")
+        imbalance = std::stof(av[++i]);
+      else if (arg == "--weight") {
+        const std::string w = av[++i];
+        if (w == "elements")
+          weight = WEIGHT_ELEMENTS;
+        else if (w == "vertices")
+          weight = WEIGHT_VERTICES;
+        else if (w == "bytes")
+          weight = WEIGHT_BYTES;
+        else
+          usage("unknown brick weight '"+w+"'");
+      }
+      else if (arg == "--halo")
+        numHaloRings = std::stoi(av[++i]);
+      else if (arg == "--halo-adjacency") {
+        const std::string a = av[++i];
+        if (a == "face")
+          haloAdjacency = HALO_FACE_NEIGHBORS;
+        else if (a == "vertex")
+          haloAdjacency = HALO_VERTEX_NEIGHBORS;
+        else
+          usage("unknown halo adjacency '"+a+"'");
+      }
       else if (arg[0] != '-')
         inFileName = arg;
       else
@@ -132,46 +144,53 @@ namespace umesh {
     
     if (outFileBase == "") usage("no output file name specified");
     if (inFileName == "") usage("no input file name specified");
-    if (leafThreshold == 1<<30 && maxBricks == 1<<30)
+    if (leafThreshold == 0 && maxBricks == 0)
       usage("neither leaf threshold nor max bricks specified");
+    if (useCurve && maxBricks == 0)
+      usage("space filling curve partitioning requires number of bricks (-n)");
+    if (useGraph && maxBricks == 0)
+      usage("graph partitioning requires number of bricks (-n)");
+    if (maxBricks == 0)
+      maxBricks = size_t(-1);
     std::cout << "loading umesh from " << inFileName << std::endl;
-    UMesh::SP in = io::loadBinaryUMesh(inFileName);
+    UMesh::SP in = io::load(inFileName);
     std::cout << "done loading, found " << in->toString() << std::endl;
 
-    std::priority_queue<std::pair<int,Brick *>> bricks;
-    createInitialBrick(bricks,in);
-    
-    while (bricks.size() < maxBricks) {
-      auto biggest = bricks.top(); 
-      std::cout << "########### currently having " << bricks.size()
-                << " bricks, biggest of which has "
-                << prettyNumber(biggest.first) << " prims" << std::endl;
-      if (biggest.first < leafThreshold)
-        break;
-      bricks.pop();
+    std::cout << "partitioning..." << std::endl;
+    std::vector<ObjectSpaceBrick> bricks
+      = useGraph
+      ? partitionGraph(in,maxBricks,weight,imbalance)
+      : useCurve
+      ? partitionSpaceFillingCurve(in,maxBricks,curve,weight)
+      : partitionObjectSpace(in,leafThreshold,maxBricks,splitMethod);
+    std::cout << "done partitioning, found " << bricks.size() << " bricks" << std::endl;
+    if (useGraph) {
+      // (the graph partitioner minimizes exactly this, so that's the
+      // only mode where it's worth a full face-matching pass)
+      const size_t numCutFaces = countCutFaces(in,bricks);
+      std::cout << "edge cut: " << prettyNumber(numCutFaces)
+                << " faces shared between bricks" << std::endl;
+    }
 
-      std::cout << "splitting..." << std::endl;
-      Brick *half[2];
-      split(in,biggest.second,half);
-      bricks.push({(int)half[0]->prims.size(),half[0]});
-      bricks.push({(int)half[1]->prims.size(),half[1]});
-      delete biggest.second;
+    std::vector<std::vector<UMesh::PrimRef>> halos;
+    if (numHaloRings > 0) {
+      std::cout << "computing " << numHaloRings << "-ring halos..." << std::endl;
+      halos = computeHalos(in,bricks,numHaloRings,haloAdjacency);
     }
 
     char ext[20];
     std::vector<box3f> brickBounds;
-    for (int brickID=0;!bricks.empty();brickID++) {
-      Brick *brick = bricks.top().second;
-      bricks.pop();
-      sprintf(ext,"_%05d",brickID);
-      writeBrick(in,outFileBase+ext,brick);
-      brickBounds.push_back(brick->bounds);
-      delete brick;
+    for (size_t brickID=0;brickID<bricks.size();brickID++) {
+      sprintf(ext,"_%05d",(int)brickID);
+      writeBrick(in,outFileBase+ext,bricks[brickID],
+                 halos.empty() ? nullptr : &halos[brickID]);
+      brickBounds.push_back(bricks[brickID].bounds);
     }
 
     std::ofstream boundsFile(outFileBase+".bounds",std::ios::binary);
     io::writeVector(boundsFile,brickBounds);
     std::cout << "done wirting bounds... done all" << std::endl;
+    return 0;
   }
   
 } // ::umesh
@@ -23,8 +23,10 @@
 
 #include "umesh/io/ugrid32.h"
 #include "umesh/io/UMesh.h"
+#include "umesh/io/Registry.h"
 #include "umesh/RemeshHelper.h"
 #include <queue>
+#include <mutex>
 
 namespace umesh {
 
@@ -41,6 +43,7 @@ namespace umesh {
     std::cout << "-o <baseName>\n\tbase path for all output files (there will be multiple)" << std::endl;
     std::cout << "-n|-mb|--max-bricks <N>\n\tmax number of bricks to create" << std::endl;
     std::cout << "-lt|--leaf-threshold <N>\n\tnum prims at which we make a leaf" << std::endl;
+    std::cout << "-j|--max-bricks-in-flight <N>\n\tmax number of bricks to extract and write concurrently (default 8)" << std::endl;
     std::cout << "-pro|--prim-refs-only\n\tdump _only_ the primrefs going into each brick, do not create the actual umeshes" << std::endl;
     std::cout << std::endl;
     std::cout << "generated files are:" << std::endl;
@@ -106,31 +109,52 @@ namespace umesh {
     bricks.push({(int)brick->prims.size(),brick});
   }
 
+  /*! value range of all prims in given brick */
+  range1f computeValueRange(UMesh::SP in, const Brick *brick)
+  {
+    const size_t blockSize = 16*1024;
+    const size_t numBlocks = (brick->prims.size()+blockSize-1)/blockSize;
+    std::vector<range1f> blockRange(numBlocks);
+    parallel_for(numBlocks,[&](size_t blockID){
+        const size_t begin = blockID*blockSize;
+        const size_t end   = std::min(begin+blockSize,brick->prims.size());
+        for (size_t i=begin;i<end;i++)
+          blockRange[blockID].extend(in->getValueRange(brick->prims[i]));
+      });
+    range1f valueRange;
+    for (auto &r : blockRange)
+      valueRange.extend(r);
+    return valueRange;
+  }
+
+  /*! serializes log output from bricks being written concurrently */
+  std::mutex logMutex;
+  
   void writeBrick(UMesh::SP in,
                   const std::string &fileBase,
                   Brick *brick,
                   range1f &valueRange)
   {
-    UMesh::SP out = std::make_shared<UMesh>();
-    RemeshHelper indexer(*out);
-
-    valueRange = range1f();
-    for (auto pr : brick->prims)
-      valueRange.extend(in->getValueRange(pr));
+    valueRange = computeValueRange(in,brick);
     
     if (primRefsOnly) {
       const std::string fileName = fileBase+".primRefs";
-      std::cout << "saving out " << fileName
-                << " w/ " << prettyNumber(brick->prims.size()) << " primsRefs" << std::endl;
+      {
+        std::lock_guard<std::mutex> lock(logMutex);
+        std::cout << "saving out " << fileName
+                  << " w/ " << prettyNumber(brick->prims.size()) << " primsRefs" << std::endl;
+      }
       std::ofstream out(fileName,std::ios::binary);
       io::writeVector(out,brick->prims);
       io::writeElement(out,valueRange);
     } else {
-      for (auto prim : brick->prims) 
-        indexer.add(in,prim);
+      UMesh::SP out = extractSubMesh(in,brick->prims);
       const std::string fileName = fileBase+".umesh";
-      std::cout << "saving out " << fileName
-                << " w/ " << prettyNumber(out->size()) << " prims" << std::endl;
+      {
+        std::lock_guard<std::mutex> lock(logMutex);
+        std::cout << "saving out " << fileName
+                  << " w/ " << prettyNumber(out->size()) << " prims" << std::endl;
+      }
       io::saveBinaryUMesh(fileName,out);
     }
   }
@@ -141,6 +165,7 @@ namespace umesh {
     std::string outFileBase;
     int leafThreshold = 1<<30;
     int maxBricks = 1<<30;
+    int maxBricksInFlight = 8;
     
     for (int i=1;i<ac;i++) {
       const std::string arg = av[i];
@@ -152,6 +177,8 @@ namespace umesh {
         leafThreshold = atoi(av[++i]);
       else if (arg == "-n" || arg == "-mb" || arg == "--max-bricks")
         maxBricks = atoi(av[++i]);
+      else if (arg == "-j" || arg == "--max-bricks-in-flight")
+        maxBricksInFlight = std::max(1,atoi(av[++i]));
       else if (arg == "-pro" || arg == "--prim-refs-only")
         primRefsOnly = true;
       else if (arg[0] != '-')
@@ -166,7 +193,7 @@ namespace umesh {
       usage("neither leaf threshold nor max bricks specified");
 
     std::cout << "loading umesh from " << inFileName << std::endl;
-    UMesh::SP in = io::loadBinaryUMesh(inFileName);
+    UMesh::SP in = io::load(inFileName);
     std::cout << "done loading, found " << in->toString() << std::endl;
     
     std::priority_queue<std::pair<int,Brick *>> bricks;
@@ -196,18 +223,28 @@ namespace umesh {
       delete biggest.second;
     }
 
-    char ext[20];
-    std::vector<box3f> brickDomains;
-    std::vector<range1f> valueRanges;
-    for (int brickID=0;!bricks.empty();brickID++) {
-      Brick *brick = bricks.top().second;
+    std::vector<Brick *> brickList;
+    while (!bricks.empty()) {
+      brickList.push_back(bricks.top().second);
       bricks.pop();
-      sprintf(ext,"_%05d",brickID);
-      range1f valueRange;
-      writeBrick(in,outFileBase+ext,brick,valueRange);
-      brickDomains.push_back(brick->domain);
-      valueRanges.push_back(valueRange);
-      delete brick;
+    }
+
+    // extract and write bricks concurrently, but at most
+    // 'maxBricksInFlight' at a time, to bound memory use
+    const size_t numBricks = brickList.size();
+    std::vector<box3f> brickDomains(numBricks);
+    std::vector<range1f> valueRanges(numBricks);
+    for (size_t waveBegin=0;waveBegin<numBricks;waveBegin+=maxBricksInFlight) {
+      const size_t waveEnd = std::min(waveBegin+maxBricksInFlight,numBricks);
+      parallel_for(waveEnd-waveBegin,[&](size_t i){
+          const size_t brickID = waveBegin+i;
+          Brick *brick = brickList[brickID];
+          char ext[20];
+          sprintf(ext,"_%05d",(int)brickID);
+          writeBrick(in,outFileBase+ext,brick,valueRanges[brickID]);
+          brickDomains[brickID] = brick->domain;
+          delete brick;
+        });
     }
 
     std::ofstream boundsFile(outFileBase+".domains",std::ios::binary);
@@ -0,0 +1,112 @@
+// ======================================================================== //
+// Copyright 2018-2020 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+
+/* resamples a umesh's per-vertex scalar field onto a regular grid,
+   and writes that grid as raw floats (x-fastest, then y, then z) */
+
+#include "umesh/io/UMesh.h"
+#include "umesh/io/Registry.h"
+#include "umesh/resampleToGrid.h"
+#include <chrono>
+
+namespace umesh {
+
+  void usage(const std::string error="")
+  {
+    if (error != "")
+      std::cerr << "Error : " << error  << "\n\n";
+
+    std::cout << "Usage: ./umeshResample <in.umesh> -o <out.raw> --dims <nx> <ny> <nz> [--bounds <lx> <ly> <lz> <ux> <uy> <uz>] [--outside <value>]" << std::endl;
+    std::cout << "--dims <nx> <ny> <nz> : number of voxels of the output grid" << std::endl;
+    std::cout << "--bounds <lx> <ly> <lz> <ux> <uy> <uz> : region of space covered by the grid (default: the mesh's bounding box); voxels sample the field at their centers" << std::endl;
+    std::cout << "--outside <value> : value for voxels that are not inside any element (default 0)" << std::endl;
+    exit (error != "");
+  };
+
+  extern "C" int main(int ac, char **av)
+  {
+    std::string inFileName;
+    std::string outFileName;
+    vec3i dims(0);
+    box3f bounds;
+    bool haveBounds = false;
+    float outsideValue = 0.f;
+    for (int i=1;i<ac;i++) {
+      const std::string arg = av[i];
+      if (arg == "-h")
+        usage();
+      else if (arg == "-o")
+        outFileName = av[++i];
+      else if (arg == "--dims") {
+        dims.x = std::stoi(av[++i]);
+        dims.y = std::stoi(av[++i]);
+        dims.z = std::stoi(av[++i]);
+      } else if (arg == "--bounds") {
+        bounds.lower.x = std::stof(av[++i]);
+        bounds.lower.y = std::stof(av[++i]);
+        bounds.lower.z = std::stof(av[++i]);
+        bounds.upper.x = std::stof(av[++i]);
+        bounds.upper.y = std::stof(av[++i]);
+        bounds.upper.z = std::stof(av[++i]);
+        haveBounds = true;
+      } else if (arg == "--outside")
+        outsideValue = std::stof(av[++i]);
+      else if (arg[0] != '-')
+        inFileName = arg;
+      else
+        usage("unknown cmd-line arg '"+arg+"'");
+    }
+
+    if (inFileName == "") usage("no input file specified");
+    if (outFileName == "") usage("no output file specified");
+    if (dims.x < 1 || dims.y < 1 || dims.z < 1) usage("no (or invalid) grid dims specified");
+
+    std::cout << "loading umesh from " << inFileName << std::endl;
+    UMesh::SP in = io::load(inFileName);
+    std::cout << "done loading, found " << in->toString() << std::endl;
+    if (!in->perVertex)
+      usage("input mesh does not have a scalar field");
+    if (!haveBounds)
+      bounds = in->getBounds();
+
+    std::ofstream out(outFileName,std::ios::binary);
+    if (!out.good())
+      throw std::runtime_error("could not open '"+outFileName+"' for writing");
+
+    std::cout << "resampling to " << dims.x << "x" << dims.y << "x" << dims.z
+              << " grid over " << bounds << std::endl;
+    const auto begin = std::chrono::steady_clock::now();
+    const size_t sliceSize = size_t(dims.x)*dims.y;
+    range1f valueRange;
+    resampleToGrid(in,bounds,dims,
+                   [&](int zBegin, int zEnd, const float *voxels){
+                     const size_t numVoxels = sliceSize*(zEnd-zBegin);
+                     for (size_t i=0;i<numVoxels;i++)
+                       valueRange.extend(voxels[i]);
+                     io::writeArray(out,voxels,numVoxels);
+                     if (!out.good())
+                       throw std::runtime_error("error writing to '"+outFileName+"'");
+                   },outsideValue);
+    const auto end = std::chrono::steady_clock::now();
+    std::cout << "done resampling, took "
+              << std::chrono::duration<double>(end-begin).count() << "s;"
+              << " voxel values are in " << valueRange << std::endl;
+    std::cout << "written to " << outFileName
+              << " (raw floats, " << dims.x << "x" << dims.y << "x" << dims.z << ")" << std::endl;
+  }
+
+} // ::umesh
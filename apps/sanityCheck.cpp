@@ -16,7 +16,11 @@
 
 #include "umesh/io/ugrid32.h"
 #include "umesh/io/UMesh.h"
+#include "umesh/io/Registry.h"
+#include "umesh/io/TestCase.h"
 #include "umesh/check.h"
+#include "umesh/BVH.h"
+#include <random>
 
 namespace umesh {
 
@@ -25,27 +29,91 @@ namespace umesh {
     if (error != "")
       std::cerr << "\nError : " << error  << "\n\n";
 
-    std::cout << "Usage: ./umeshSanityCheck <in.umesh>\n\n";
+    std::cout << "Usage: ./umeshSanityCheck <in.umesh>\n";
+    std::cout << "   or: ./umeshSanityCheck --check-sampling\n\n";
+    std::cout << "--check-sampling : check point location and sampling on synthetic"
+              << " hex grids (at various offsets from the origin) with a linear"
+              << " scalar field, against the analytic answer\n\n";
     exit(error != "");
   };
+
+  /*! samples a linear field over an NxNxN hex grid that spans
+      [offset,offset+size]^3 at random interior points, and checks
+      that every point gets located, and that the sampled values
+      match the field. Returns true if all went well */
+  bool checkSampling(float offset, float size)
+  {
+    const int N = 20;
+    UMesh::SP mesh = io::createTestCase(N);
+    auto field = [&](const vec3f &P) {
+      const vec3f p = P-vec3f(offset);
+      return p.x+2.f*p.y+3.f*p.z;
+    };
+    for (size_t i=0;i<mesh->vertices.size();i++) {
+      mesh->vertices[i] = vec3f(offset)+mesh->vertices[i]*(size/N);
+      mesh->perVertex->values[i] = field(mesh->vertices[i]);
+    }
+    mesh->perVertex->finalize();
+    mesh->finalize();
+
+    BVH::SP bvh = BVH::build(mesh);
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<float> random(.001f,.999f);
+    std::vector<vec3f> points(10000);
+    for (auto &P : points)
+      P = vec3f(offset)+size*vec3f(random(rng),random(rng),random(rng));
+    std::vector<UMesh::PrimRef> prims;
+    bvh->locate(points,prims);
+    std::vector<float> values;
+    bvh->sample(points,values);
+
+    size_t numMissed = 0;
+    float maxError = 0.f;
+    for (size_t i=0;i<points.size();i++) {
+      if (prims[i].type == UMesh::INVALID) { ++numMissed; continue; }
+      maxError = std::max(maxError,fabsf(values[i]-field(points[i])));
+    }
+    // field spans [0,6*size]; allow for some float rounding
+    const bool ok = (numMissed == 0) && (maxError <= 1e-5f*6.f*size);
+    std::cout << "sampling grid at offset " << offset << ", size " << size
+              << ": " << numMissed << " of " << points.size() << " points not found,"
+              << " max error " << maxError << (ok ? " (OK)" : " (FAILED)") << std::endl;
+    return ok;
+  }
   
   extern "C" int main(int ac, char **av)
   {
     std::string inFileName;
+    bool checkSamplingOnly = false;
     for (int i=1;i<ac;i++) {
       const std::string arg = av[i];
       if (arg == "-h")
         usage();
+      else if (arg == "--check-sampling")
+        checkSamplingOnly = true;
       else if (arg[0] != '-')
         inFileName = arg;
       else
         usage("unknown cmd-line arg '"+arg+"'");
     }
     
+    if (checkSamplingOnly) {
+      bool ok = true;
+      ok &= checkSampling(0.f,1.f);
+      ok &= checkSampling(1.f,1.f);
+      ok &= checkSampling(100.f,1.f);
+      ok &= checkSampling(1000.f,10.f);
+      if (!ok) {
+        std::cerr << "sampling check failed" << std::endl;
+        return 1;
+      }
+      std::cout << "all sampling checks went through ..." << std::endl;
+      return 0;
+    }
     if (inFileName == "") usage("no input file specified");
     
     std::cout << "loading umesh from " << inFileName << std::endl;
-    UMesh::SP in = io::loadBinaryUMesh(inFileName);
+    UMesh::SP in = io::load(inFileName);
 
     std::cout << "UMesh info:\n" << in->toString(false) << std::endl;
     sanityCheck(in);
@@ -16,6 +16,7 @@
 
 #include "umesh/io/ugrid32.h"
 #include "umesh/io/UMesh.h"
+#include "umesh/io/Registry.h"
 #include "umesh/tetrahedralize.h"
 
 namespace umesh {
@@ -25,14 +26,17 @@ namespace umesh {
     if (error != "")
       std::cerr << "Error : " << error  << "\n\n";
 
-    std::cout << "Usage: ./umeshTetrahedralize <in.umesh> -o <out.umesh> [--keep-flat]" << std::endl;;
+    std::cout << "Usage: ./umeshTetrahedralize <in.umesh> -o <out.umesh> [--keep-flat] [--streaming [--chunk-size <numElements>]]" << std::endl;;
     std::cout << "--keep-flat: elements with all flat sides get passed through w/o tetrahedralization" << std::endl;
+    std::cout << "--streaming: process input in chunks, without ever loading all elements (for meshes that do not fit in memory)" << std::endl;
     exit (error != "");
   };
   
   extern "C" int main(int ac, char **av)
   {
     bool maintainFlatElements = false;
+    bool streaming = false;
+    size_t chunkSize = 1ull<<20;
     std::string inFileName;
     std::string outFileName;
     /*! if enabled, we'll only save the tets that _we_ created, not
@@ -45,6 +49,10 @@ namespace umesh {
         outFileName = av[++i];
       else if (arg == "--maintain-flat-elements" || arg == "--keep-flat")
         maintainFlatElements = true;
+      else if (arg == "--streaming")
+        streaming = true;
+      else if (arg == "--chunk-size")
+        chunkSize = std::stoll(av[++i]);
       else if (arg[0] != '-')
         inFileName = arg;
       else
@@ -54,8 +62,18 @@ namespace umesh {
     if (inFileName == "") usage("no input file specified");
     if (outFileName == "") usage("no output file specified");
     
+    if (streaming) {
+      if (maintainFlatElements)
+        usage("--keep-flat is not supported in streaming mode");
+      std::cout << "tetrahedralizing " << inFileName
+                << " in chunks of " << prettyNumber(chunkSize) << " elements" << std::endl;
+      tetrahedralizeStreaming(inFileName,outFileName,chunkSize);
+      std::cout << "done all ..." << std::endl;
+      return 0;
+    }
+    
     std::cout << "loading umesh from " << inFileName << std::endl;
-    UMesh::SP in = io::loadBinaryUMesh(inFileName);
+    UMesh::SP in = io::load(inFileName);
     
     std::cout << "done loading, found " << in->toString()
               << " ... now tetrahedralizing" << std::endl;
@@ -0,0 +1,134 @@
+// ======================================================================== //
+// Copyright 2018-2020 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+
+/* imports one or more vtk unstructured grids (xml .vtu and/or legacy
+   .vtk files), and writes them - merged into a single mesh - as a
+   .umesh file. Uses umesh's own vtk readers, so does not need libvtk */
+
+#include "umesh/io/vtk.h"
+#include <chrono>
+
+namespace umesh {
+
+  void usage(const std::string error="")
+  {
+    if (error != "")
+      std::cerr << "Error : " << error  << "\n\n";
+
+    std::cout << "Usage: ./umeshImportVTK <in.vtu|in.vtk>+ -o <out.umesh> [--field <name>] [--max-files <n>]" << std::endl;
+    std::cout << "--field <name> : scalar field to import (point or cell data; default: the active, or else first, point data array)" << std::endl;
+    std::cout << "--max-files <n> : only import the first n input files" << std::endl;
+    exit (error != "");
+  };
+
+  /*! appends all vertices and elements of 'piece' to 'mesh', with
+      the piece's vertex indices shifted accordingly */
+  template<typename Prim>
+  void appendPrims(std::vector<Prim> &out, const std::vector<Prim> &in, int vertexOffset)
+  {
+    const size_t begin = out.size();
+    out.resize(begin+in.size());
+    parallel_for_blocked(0,in.size(),64*1024,[&](size_t b, size_t e){
+        for (size_t i=b;i<e;i++) {
+          Prim prim = in[i];
+          for (int j=0;j<Prim::numVertices;j++)
+            prim[j] += vertexOffset;
+          out[begin+i] = prim;
+        }
+      });
+  }
+  
+  void append(UMesh::SP mesh, UMesh::SP piece)
+  {
+    if (!mesh->vertices.empty() && ((bool)mesh->perVertex != (bool)piece->perVertex))
+      throw std::runtime_error("either all or none of the input files need a scalar field");
+    const int vertexOffset = (int)mesh->vertices.size();
+    mesh->vertices.insert(mesh->vertices.end(),
+                          piece->vertices.begin(),piece->vertices.end());
+    if (piece->perVertex) {
+      if (!mesh->perVertex) {
+        mesh->perVertex = std::make_shared<Attribute>();
+        mesh->perVertex->name = piece->perVertex->name;
+      }
+      std::vector<float> &values = mesh->perVertex->values;
+      values.insert(values.end(),
+                    piece->perVertex->values.begin(),piece->perVertex->values.end());
+    }
+    appendPrims(mesh->triangles,piece->triangles,vertexOffset);
+    appendPrims(mesh->quads,piece->quads,vertexOffset);
+    appendPrims(mesh->tets,piece->tets,vertexOffset);
+    appendPrims(mesh->pyrs,piece->pyrs,vertexOffset);
+    appendPrims(mesh->wedges,piece->wedges,vertexOffset);
+    appendPrims(mesh->hexes,piece->hexes,vertexOffset);
+  }
+  
+  extern "C" int main(int ac, char **av)
+  {
+    std::vector<std::string> inFileNames;
+    std::string outFileName;
+    std::string fieldName;
+    size_t maxFiles = 1ULL<<60;
+    for (int i=1;i<ac;i++) {
+      const std::string arg = av[i];
+      if (arg == "-h")
+        usage();
+      else if (arg == "-o")
+        outFileName = av[++i];
+      else if (arg == "--field")
+        fieldName = av[++i];
+      else if (arg == "--max-files")
+        maxFiles = std::stoull(av[++i]);
+      else if (arg[0] != '-')
+        inFileNames.push_back(arg);
+      else
+        usage("unknown cmd-line arg '"+arg+"'");
+    }
+
+    if (inFileNames.empty()) usage("no input file(s) specified");
+    if (outFileName == "") usage("no output file specified");
+    if (inFileNames.size() > maxFiles)
+      inFileNames.resize(maxFiles);
+
+    const auto begin = std::chrono::steady_clock::now();
+    UMesh::SP mesh;
+    for (auto fileName : inFileNames) {
+      std::cout << "reading " << fileName << std::endl;
+      UMesh::SP piece = io::loadVTK(fileName,fieldName);
+      std::cout << " - found " << piece->toString() << std::endl;
+      if (!mesh)
+        mesh = piece;
+      else
+        append(mesh,piece);
+    }
+    if (inFileNames.size() > 1) {
+      if (mesh->perVertex)
+        mesh->perVertex->finalize();
+      mesh->finalize();
+    }
+    const auto end = std::chrono::steady_clock::now();
+    std::cout << "done importing, took "
+              << std::chrono::duration<double>(end-begin).count() << "s;"
+              << " final mesh is " << mesh->toString() << std::endl;
+    if (mesh->perVertex)
+      std::cout << "scalar field '" << mesh->perVertex->name << "', values in "
+                << mesh->perVertex->valueRange << std::endl;
+    std::cout << "saving to " << outFileName << std::endl;
+    mesh->saveTo(outFileName);
+    std::cout << "done" << std::endl;
+  }
+
+} // ::umesh
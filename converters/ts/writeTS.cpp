@@ -6,6 +6,8 @@
  */
 
 #include "umesh/io/UMesh.h"
+#include "umesh/io/Registry.h"
+#include "umesh/io/text.h"
 #include "umesh/math.h"
 #include "umesh/UMesh.h"
 
@@ -30,7 +32,7 @@ int main ( int argc, char *argv[] )
 
   // read umesh file
   std::cout << "parsing umesh file " << inFileName << std::endl;
-  umesh::UMesh::SP inMesh = umesh::io::loadBinaryUMesh(inFileName);
+  umesh::UMesh::SP inMesh = umesh::io::load(inFileName);
   std::cout << "Done reading.\n UMesh info:\n" << inMesh->toString(false) << std::endl;
 
   // check triangles
@@ -74,89 +76,43 @@ int main ( int argc, char *argv[] )
   std::cout << "=======================================================" << std::endl;
 
   // create the output file
-  FILE *file = fopen(outFileName.c_str(), "w");
+  std::ofstream file(outFileName, std::ios::binary);
+  if (!file.good()) {
+    std::cerr << "Could not open " << outFileName << " for writing!" << std::endl;
+    return EXIT_FAILURE;
+  }
 
-  // insert points
+  // header: number of points and tets
   size_t n = inMesh->vertices.size(), m = inMesh->tets.size();
-  fprintf(file, "%ld %ld\n", n, m);
-  int barWidth = 60;
-  float progress = 0.0f;
+  umesh::io::TextBlock header;
+  header << n << " " << m << "\n";
+  file.write(header.text.data(), header.text.size());
 
   // insert per-vertex data 
-  if (inMesh->perVertex == nullptr) {
+  const umesh::Attribute::SP scalars = inMesh->perVertex;
+  if (scalars == nullptr) {
     std::cout << "The input umesh does not contain per-vertex data!" << std::endl;
-    // insert vertex and its scalar value
-    for (size_t i = 0; i < n; ++i) {
-      umesh::vec3f &p = inMesh->vertices[i];
-      fprintf(file, "%f %f %f\n", p.x, p.y, p.z);
-      // print out the progress bar
-      float cur = float(i + 1) / n;
-      if (cur - progress >= 0.08f || i == n-1) {
-        int pos = barWidth * cur;
-        std::cout << "[";
-        for (int j = 0; j < barWidth; ++j) {
-          if (j < pos) std::cout << "=";
-          else if (j == pos) std::cout << ">";
-          else std::cout << " ";
-        }
-        std::cout << "] " << int(cur * 100.0) << "% \r";
-        std::cout.flush();
-        progress = cur;
-      }
-    }
-    std::cout << "\nSuccessfully insert all the points!" << std::endl;
-  } else {
-    if (inMesh->perVertex->values.size() != inMesh->vertices.size()) {
-      std::cerr << "The size of scalars does not matach the number of vertices!" << std::endl;
-      return EXIT_FAILURE;
-    }
-    // insert vertex and its scalar value
-    for (size_t i = 0; i < n; ++i) {
-      umesh::vec3f &p = inMesh->vertices[i];
-      fprintf(file, "%f %f %f %f\n", p.x, p.y, p.z, inMesh->perVertex->values[i]);
-      // print out the progress bar
-      float cur = float(i + 1) / n;
-      if (cur - progress >= 0.08f || i == n-1) {
-        int pos = barWidth * cur;
-        std::cout << "[";
-        for (int j = 0; j < barWidth; ++j) {
-          if (j < pos) std::cout << "=";
-          else if (j == pos) std::cout << ">";
-          else std::cout << " ";
-        }
-        std::cout << "] " << int(cur * 100.0) << "% \r";
-        std::cout.flush();
-        progress = cur;
-      }
-    }
-    std::cout << "\nSuccessfully insert all the points and scalar values!" << std::endl;
+  } else if (scalars->values.size() != n) {
+    std::cerr << "The size of scalars does not matach the number of vertices!" << std::endl;
+    return EXIT_FAILURE;
   }
+  // insert vertex (and its scalar value, if present)
+  umesh::io::writeTextParallel(file, n, [&](umesh::io::TextBlock &out, size_t i) {
+      const umesh::vec3f &p = inMesh->vertices[i];
+      out << p.x << " " << p.y << " " << p.z;
+      if (scalars)
+        out << " " << scalars->values[i];
+      out << "\n";
+    });
+  std::cout << "Successfully insert all the points"
+            << (scalars ? " and scalar values!" : "!") << std::endl;
 
   // insert tetrahedra
-  if (!inMesh->tets.empty()) {
-    progress = 0.0f;
-    for (size_t i = 0; i < m; ++i) {
-      // print out the progress bar
-      float cur = float(i + 1) / m;
-      if (cur - progress >= 0.08f || i == m-1) {
-        int pos = barWidth * cur;
-        std::cout << "[";
-        for (int j = 0; j < barWidth; ++j) {
-          if (j < pos) std::cout << "=";
-          else if (j == pos) std::cout << ">";
-          else std::cout << " ";
-        }
-        std::cout << "] " << int(cur * 100.0) << "% \r";
-        std::cout.flush();
-        progress = cur;
-      }
-      auto &tet = inMesh->tets[i];
-      fprintf(file, "%ld %ld %ld %ld\n", tet[0], tet[1], tet[2], tet[3]);
-    }
-    std::cout << "\nSuccessfully insert all the tetrahedra!" << std::endl;
-  }
+  umesh::io::writeTextParallel(file, m, [&](umesh::io::TextBlock &out, size_t i) {
+      const umesh::Tet &tet = inMesh->tets[i];
+      out << tet[0] << " " << tet[1] << " " << tet[2] << " " << tet[3] << "\n";
+    });
+  std::cout << "Successfully insert all the tetrahedra!" << std::endl;
 
-  fclose(file);
-  
   return EXIT_SUCCESS;
 }
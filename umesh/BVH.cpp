@@ -0,0 +1,459 @@
+// ======================================================================== //
+// Copyright 2018-2020 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+
+#include "umesh/BVH.h"
+#include "umesh/sampleElement.h"
+#include <memory>
+
+namespace umesh {
+
+  /*! number of bins per axis for SAH splits */
+  enum { numBVHBins = 16 };
+
+  /*! ranges with fewer prims than this get binned, and their
+      children built, serially */
+  const size_t bvhParallelThreshold = 16*1024;
+
+  /*! beyond this depth we only do object median splits, so the tree
+      (and thus the traversal stack) stays bounded even for
+      pathological inputs */
+  enum { maxSAHDepth = 48 };
+
+  /*! max depth of traversal stack; 3 entries per level of (4-wide)
+      nodes is enough for the deepest tree the builder can create */
+  enum { maxStackDepth = 256 };
+
+  inline float halfArea(const box3f &box)
+  {
+    const vec3f d = box.upper-box.lower;
+    return d.x*d.y+d.y*d.z+d.z*d.x;
+  }
+
+  /*! a node of the temporary (pointer-based) tree that the builder
+      creates; this gets flattened into BVH::nodes in the end */
+  struct BVHBuildNode {
+    /*! range of (builder's) prims; for inner nodes this is the range
+        of all prims in the subtree */
+    size_t begin, end;
+    box3f  bounds;
+    box3f  centBounds;
+    int    numChildren = 0;
+    std::unique_ptr<BVHBuildNode> child[BVH::width];
+  };
+
+  /*! SAH bins along all three axes */
+  struct BVHBins {
+    inline void extend(const BVHBins &other)
+    {
+      for (int dim=0;dim<3;dim++)
+        for (int b=0;b<numBVHBins;b++) {
+          bounds[dim][b].extend(other.bounds[dim][b]);
+          centBounds[dim][b].extend(other.centBounds[dim][b]);
+          count[dim][b] += other.count[dim][b];
+        }
+    }
+    box3f  bounds[3][numBVHBins];
+    box3f  centBounds[3][numBVHBins];
+    size_t count[3][numBVHBins] = {};
+  };
+
+  struct BVHBuilder {
+    BVHBuilder(const UMesh &mesh, const std::vector<UMesh::PrimRef> &prims);
+
+    /*! build the (wide) subtree over the given build node's prims */
+    void build(BVHBuildNode *node, int depth);
+
+    /*! splits given node's prims in two, writes the two halves into
+        the given (new) nodes. Uses binned SAH, or object median
+        splits beyond maxSAHDepth or if all centroids are the same */
+    void split(const BVHBuildNode &node, int depth,
+               BVHBuildNode &left, BVHBuildNode &right);
+
+    /*! compute bounds and centroid bounds of given node's prims */
+    void computeBounds(BVHBuildNode &node);
+
+    /*! flatten given (wide) subtree into bvh's nodes, returns index
+        of the subtree's root */
+    uint32_t flatten(const BVHBuildNode *node, BVH &bvh);
+
+    inline int binOf(const vec3f &centroid, const box3f &centBounds, int dim) const
+    {
+      const float width = centBounds.upper[dim]-centBounds.lower[dim];
+      const int bin = int(numBVHBins*(centroid[dim]-centBounds.lower[dim])/width);
+      return std::min(int(numBVHBins)-1,std::max(0,bin));
+    }
+
+    std::vector<box3f>  primBounds;
+    std::vector<vec3f>  centroids;
+    /*! indices into the input prims; gets re-ordered during the
+        build, such that each node's prims are a contiguous range */
+    std::vector<size_t> primIDs;
+  };
+
+  BVHBuilder::BVHBuilder(const UMesh &mesh,
+                         const std::vector<UMesh::PrimRef> &prims)
+  {
+    const size_t numPrims = prims.size();
+    primBounds.resize(numPrims);
+    centroids.resize(numPrims);
+    primIDs.resize(numPrims);
+    parallel_for_blocked(0,numPrims,16*1024,[&](size_t begin, size_t end){
+        for (size_t i=begin;i<end;i++) {
+          primBounds[i] = mesh.getBounds(prims[i]);
+          centroids[i]  = primBounds[i].center();
+          primIDs[i]    = i;
+        }
+      });
+  }
+
+  void BVHBuilder::computeBounds(BVHBuildNode &node)
+  {
+    node.bounds = node.centBounds = box3f();
+    for (size_t i=node.begin;i<node.end;i++) {
+      node.bounds.extend(primBounds[primIDs[i]]);
+      node.centBounds.extend(centroids[primIDs[i]]);
+    }
+  }
+  
+  void BVHBuilder::split(const BVHBuildNode &node, int depth,
+                         BVHBuildNode &left, BVHBuildNode &right)
+  {
+    const size_t begin = node.begin;
+    const size_t end   = node.end;
+    const box3f &centBounds = node.centBounds;
+    const vec3f extent = centBounds.upper-centBounds.lower;
+    size_t mid = begin;
+    if (depth < maxSAHDepth && (extent.x > 0.f || extent.y > 0.f || extent.z > 0.f)) {
+      // bin all prims along all three axes ...
+      BVHBins bins;
+      auto binRange = [&](size_t rangeBegin, size_t rangeEnd, BVHBins &bins){
+        for (size_t i=rangeBegin;i<rangeEnd;i++) {
+          const size_t primID = primIDs[i];
+          for (int dim=0;dim<3;dim++) {
+            if (extent[dim] == 0.f) continue;
+            const int bin = binOf(centroids[primID],centBounds,dim);
+            bins.bounds[dim][bin].extend(primBounds[primID]);
+            bins.centBounds[dim][bin].extend(centroids[primID]);
+            bins.count[dim][bin]++;
+          }
+        }
+      };
+      if (end-begin < bvhParallelThreshold)
+        binRange(begin,end,bins);
+      else {
+        const size_t blockSize = 16*1024;
+        const size_t numBlocks = (end-begin+blockSize-1)/blockSize;
+        std::vector<BVHBins> blockBins(numBlocks);
+        parallel_for(numBlocks,[&](size_t blockID){
+            const size_t blockBegin = begin+blockID*blockSize;
+            binRange(blockBegin,std::min(blockBegin+blockSize,end),
+                     blockBins[blockID]);
+          });
+        for (auto &b : blockBins)
+          bins.extend(b);
+      }
+
+      // ... find the cheapest split plane ...
+      int bestDim = -1, bestBin = -1;
+      float bestCost = INFINITY;
+      for (int dim=0;dim<3;dim++) {
+        if (extent[dim] == 0.f) continue;
+        float rightArea[numBVHBins];
+        size_t rightCount[numBVHBins];
+        box3f  rightBounds;
+        size_t count = 0;
+        for (int b=numBVHBins-1;b>0;--b) {
+          rightBounds.extend(bins.bounds[dim][b]);
+          count += bins.count[dim][b];
+          rightArea[b]  = halfArea(rightBounds);
+          rightCount[b] = count;
+        }
+        box3f  leftBounds;
+        size_t leftCount = 0;
+        for (int b=1;b<numBVHBins;b++) {
+          leftBounds.extend(bins.bounds[dim][b-1]);
+          leftCount += bins.count[dim][b-1];
+          if (leftCount == 0 || rightCount[b] == 0) continue;
+          const float cost
+            = halfArea(leftBounds)*leftCount + rightArea[b]*rightCount[b];
+          if (cost < bestCost) {
+            bestCost = cost;
+            bestDim  = dim;
+            bestBin  = b;
+          }
+        }
+      }
+
+      // ... and partition
+      if (bestDim >= 0) {
+        mid = std::partition(primIDs.begin()+begin,primIDs.begin()+end,
+                             [&](size_t primID){
+                               return binOf(centroids[primID],centBounds,bestDim) < bestBin;
+                             }) - primIDs.begin();
+        left.bounds = left.centBounds = right.bounds = right.centBounds = box3f();
+        for (int b=0;b<numBVHBins;b++) {
+          BVHBuildNode &side = (b < bestBin) ? left : right;
+          side.bounds.extend(bins.bounds[bestDim][b]);
+          side.centBounds.extend(bins.centBounds[bestDim][b]);
+        }
+      }
+    }
+    if (mid == begin || mid == end) {
+      // no SAH split (too deep, or all centroids the same) - split
+      // at object median
+      mid = (begin+end)/2;
+      const int dim = arg_max(extent);
+      std::nth_element(primIDs.begin()+begin,primIDs.begin()+mid,primIDs.begin()+end,
+                       [&](size_t a, size_t b){
+                         return centroids[a][dim] < centroids[b][dim];
+                       });
+      left.begin  = begin; left.end  = mid;
+      right.begin = mid;   right.end = end;
+      computeBounds(left);
+      computeBounds(right);
+      return;
+    }
+    left.begin  = begin; left.end  = mid;
+    right.begin = mid;   right.end = end;
+  }
+
+  void BVHBuilder::build(BVHBuildNode *node, int depth)
+  {
+    // open up the largest (by surface area) child until we have
+    // 'width' children, or all children are small enough to be leaves
+    node->numChildren = 1;
+    node->child[0].reset(new BVHBuildNode);
+    node->child[0]->begin      = node->begin;
+    node->child[0]->end        = node->end;
+    node->child[0]->bounds     = node->bounds;
+    node->child[0]->centBounds = node->centBounds;
+    while (node->numChildren < BVH::width) {
+      int bestChild = -1;
+      float bestArea = -1.f;
+      for (int c=0;c<node->numChildren;c++) {
+        const BVHBuildNode &child = *node->child[c];
+        if (child.end-child.begin <= BVH::maxLeafSize) continue;
+        const float area = halfArea(child.bounds);
+        if (area > bestArea) {
+          bestArea  = area;
+          bestChild = c;
+        }
+      }
+      if (bestChild < 0) break;
+      std::unique_ptr<BVHBuildNode> left(new BVHBuildNode);
+      std::unique_ptr<BVHBuildNode> right(new BVHBuildNode);
+      split(*node->child[bestChild],depth,*left,*right);
+      node->child[bestChild] = std::move(left);
+      node->child[node->numChildren++] = std::move(right);
+    }
+
+    // then recurse into all children that aren't leaves
+    auto buildChild = [&](int c){
+      BVHBuildNode *child = node->child[c].get();
+      if (child->end-child->begin > BVH::maxLeafSize)
+        build(child,depth+1);
+    };
+    if (node->end-node->begin < bvhParallelThreshold)
+      for (int c=0;c<node->numChildren;c++)
+        buildChild(c);
+    else
+      parallel_for(node->numChildren,buildChild);
+  }
+
+  /*! quantizes child box 'box' relative to node's origin and scale,
+      such that the de-quantized box contains the original one */
+  inline void quantize(BVH::Node &node, int c, const box3f &box)
+  {
+    for (int dim=0;dim<3;dim++) {
+      const float origin = node.origin[dim];
+      const float scale  = node.scale[dim];
+      int lo = int(floorf((box.lower[dim]-origin)/scale));
+      int hi = int(ceilf((box.upper[dim]-origin)/scale));
+      lo = std::max(0,std::min(255,lo));
+      hi = std::max(0,std::min(255,hi));
+      // fix up whatever floating point rounding may have done
+      while (lo > 0   && origin+lo*scale > box.lower[dim]) --lo;
+      while (hi < 255 && origin+hi*scale < box.upper[dim]) ++hi;
+      node.lower[dim][c] = (uint8_t)lo;
+      node.upper[dim][c] = (uint8_t)hi;
+    }
+  }
+  
+  uint32_t BVHBuilder::flatten(const BVHBuildNode *buildNode, BVH &bvh)
+  {
+    const uint32_t nodeID = (uint32_t)bvh.nodes.size();
+    bvh.nodes.push_back(BVH::Node());
+    {
+      BVH::Node &node = bvh.nodes[nodeID];
+      std::fill(&node.child[0],&node.child[BVH::width],0);
+      std::fill(&node.numPrims[0],&node.numPrims[BVH::width],0);
+      node.origin = buildNode->bounds.lower;
+      for (int dim=0;dim<3;dim++) {
+        const float extent = buildNode->bounds.upper[dim]-buildNode->bounds.lower[dim];
+        // scale such that upper end of bounds is (at most) at 255
+        // steps; step up a little, so rounding can't put it beyond
+        node.scale[dim]
+          = (extent > 0.f) ? nextafterf(extent/255.f,INFINITY) : 1e-30f;
+      }
+      for (int c=0;c<BVH::width;c++) {
+        if (c < buildNode->numChildren)
+          quantize(node,c,buildNode->child[c]->bounds);
+        else {
+          // unused slots get an empty box
+          for (int dim=0;dim<3;dim++) {
+            node.lower[dim][c] = 255;
+            node.upper[dim][c] = 0;
+          }
+        }
+      }
+    }
+    for (int c=0;c<buildNode->numChildren;c++) {
+      const BVHBuildNode *child = buildNode->child[c].get();
+      const size_t numPrims = child->end-child->begin;
+      if (numPrims <= BVH::maxLeafSize) {
+        bvh.nodes[nodeID].child[c]    = (uint32_t)child->begin;
+        bvh.nodes[nodeID].numPrims[c] = (uint8_t)numPrims;
+      } else {
+        const uint32_t childID = flatten(child,bvh);
+        bvh.nodes[nodeID].child[c] = childID;
+      }
+    }
+    return nodeID;
+  }
+  
+  /*! build a BVH over all volume elements of the given mesh */
+  BVH::SP BVH::build(UMesh::SP mesh)
+  {
+    if (!mesh) throw std::runtime_error("null input mesh");
+    BVH::SP bvh = std::make_shared<BVH>();
+    bvh->mesh = mesh;
+
+    std::vector<UMesh::PrimRef> prims;
+    mesh->createVolumePrimRefs(prims);
+    const size_t numPrims = prims.size();
+    if (numPrims == 0)
+      return bvh;
+    if (numPrims >= (1ull<<32))
+      throw std::runtime_error("#umesh.bvh: too many elements for 32-bit BVH");
+
+    BVHBuilder builder(*mesh,prims);
+    BVHBuildNode root;
+    root.begin = 0;
+    root.end   = numPrims;
+    builder.computeBounds(root);
+    builder.build(&root,0);
+    bvh->bounds = root.bounds;
+    builder.flatten(&root,*bvh);
+    bvh->nodes.shrink_to_fit();
+
+    bvh->prims.resize(numPrims);
+    parallel_for_blocked(0,numPrims,16*1024,[&](size_t begin, size_t end){
+        for (size_t i=begin;i<end;i++)
+          bvh->prims[i] = prims[builder.primIDs[i]];
+      });
+    return bvh;
+  }
+
+  template<typename Visit>
+  bool BVH::traverse(const vec3f &P, const Visit &visit) const
+  {
+    if (nodes.empty() ||
+        P.x < bounds.lower.x || P.x > bounds.upper.x ||
+        P.y < bounds.lower.y || P.y > bounds.upper.y ||
+        P.z < bounds.lower.z || P.z > bounds.upper.z)
+      return false;
+    uint32_t stack[maxStackDepth];
+    int stackTop = 0;
+    stack[stackTop++] = 0;
+    while (stackTop > 0) {
+      const Node &node = nodes[stack[--stackTop]];
+      // express P in node's quantized coordinates
+      const vec3f q((P.x-node.origin.x)/node.scale.x,
+                    (P.y-node.origin.y)/node.scale.y,
+                    (P.z-node.origin.z)/node.scale.z);
+      for (int c=0;c<width;c++) {
+        if (q.x < node.lower[0][c] || q.x > node.upper[0][c] ||
+            q.y < node.lower[1][c] || q.y > node.upper[1][c] ||
+            q.z < node.lower[2][c] || q.z > node.upper[2][c])
+          continue;
+        const uint32_t numPrims = node.numPrims[c];
+        if (numPrims) {
+          for (uint32_t i=0;i<numPrims;i++)
+            if (visit(prims[node.child[c]+i]))
+              return true;
+        } else
+          stack[stackTop++] = node.child[c];
+      }
+    }
+    return false;
+  }
+
+  /*! find the element containing P; returns false if P is outside
+      of all elements */
+  bool BVH::locate(const vec3f &P, UMesh::PrimRef &prim) const
+  {
+    float w[8];
+    return traverse(P,[&](const UMesh::PrimRef &candidate){
+        if (!locateInElement(*mesh,candidate,P,w))
+          return false;
+        prim = candidate;
+        return true;
+      });
+  }
+
+  /*! find the element containing P, and interpolate the mesh's
+      (first) per-vertex scalar field at P; returns false if P is
+      outside of all elements */
+  bool BVH::sample(const vec3f &P, float &value) const
+  {
+    if (!mesh->perVertex)
+      throw std::runtime_error("#umesh.bvh: cannot sample mesh w/o scalar field");
+    return traverse(P,[&](const UMesh::PrimRef &candidate){
+        return sampleElement(*mesh,candidate,P,value);
+      });
+  }
+
+  /*! locate all given points (in parallel); points that are outside
+      of all elements get a PrimRef of type UMesh::INVALID */
+  void BVH::locate(const std::vector<vec3f> &points,
+                   std::vector<UMesh::PrimRef> &result) const
+  {
+    result.resize(points.size());
+    parallel_for_blocked(0,points.size(),1024,[&](size_t begin, size_t end){
+        for (size_t i=begin;i<end;i++)
+          if (!locate(points[i],result[i]))
+            result[i] = UMesh::PrimRef(UMesh::INVALID,0);
+      });
+  }
+
+  /*! sample mesh's scalar field at all given points (in parallel);
+      points that are outside of all elements get 'outsideValue' */
+  void BVH::sample(const std::vector<vec3f> &points,
+                   std::vector<float> &values,
+                   float outsideValue) const
+  {
+    if (!mesh->perVertex)
+      throw std::runtime_error("#umesh.bvh: cannot sample mesh w/o scalar field");
+    values.resize(points.size());
+    parallel_for_blocked(0,points.size(),1024,[&](size_t begin, size_t end){
+        for (size_t i=begin;i<end;i++)
+          if (!sample(points[i],values[i]))
+            values[i] = outsideValue;
+      });
+  }
+  
+} // ::umesh
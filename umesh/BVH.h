@@ -0,0 +1,103 @@
+// ======================================================================== //
+// Copyright 2018-2020 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+
+#pragma once
+
+#include "umesh/UMesh.h"
+
+namespace umesh {
+
+  /*! a bounding volume hierarchy over a mesh's volume elements, for
+      point location ("which element contains P") and sampling of the
+      mesh's scalar field at arbitrary points.
+
+      The hierarchy is built top-down with binned SAH splits (in
+      parallel), and stored as a tree of 4-wide nodes in depth-first
+      order. Each node stores its children's boxes quantized to 8
+      bits per coordinate, relative to the node's own bounds - so a
+      node (with four children) is 68 bytes, less than a quarter of
+      the three binary nodes with full-precision boxes it replaces.
+      Quantization is conservative, so quantized boxes always contain
+      the exact ones.
+
+      The BVH only references the mesh it was built over; the mesh
+      has to stay alive (and unchanged) for as long as the BVH is
+      used. */
+  struct BVH {
+    typedef std::shared_ptr<BVH> SP;
+
+    enum { width = 4 };
+    /*! max number of elements in a leaf */
+    enum { maxLeafSize = 8 };
+
+    struct Node {
+      /*! lower corner of this node's bounds, and size of one
+          quantization step in each dimension */
+      vec3f    origin;
+      vec3f    scale;
+      /*! quantized children's boxes, per dimension and child */
+      uint8_t  lower[3][width];
+      uint8_t  upper[3][width];
+      /*! for inner children, index of child node; for leaf
+          children, offset of leaf's first element in BVH::prims */
+      uint32_t child[width];
+      /*! number of elements in each (leaf) child; 0 for inner
+          children, and for unused child slots */
+      uint8_t  numPrims[width];
+    };
+
+    /*! build a BVH over all volume elements of the given mesh */
+    static BVH::SP build(UMesh::SP mesh);
+
+    /*! find the element containing P; returns false if P is outside
+        of all elements */
+    bool locate(const vec3f &P, UMesh::PrimRef &prim) const;
+
+    /*! find the element containing P, and interpolate the mesh's
+        (first) per-vertex scalar field at P; returns false if P is
+        outside of all elements */
+    bool sample(const vec3f &P, float &value) const;
+
+    /*! locate all given points (in parallel); points that are outside
+        of all elements get a PrimRef of type UMesh::INVALID */
+    void locate(const std::vector<vec3f> &points,
+                std::vector<UMesh::PrimRef> &prims) const;
+
+    /*! sample mesh's scalar field at all given points (in parallel);
+        points that are outside of all elements get 'outsideValue' */
+    void sample(const std::vector<vec3f> &points,
+                std::vector<float> &values,
+                float outsideValue = 0.f) const;
+
+    /*! the mesh this BVH was built over */
+    UMesh::SP mesh;
+    /*! bounds of all elements */
+    box3f bounds;
+    /*! the nodes, root first; empty if the mesh has no volume
+        elements */
+    std::vector<Node> nodes;
+    /*! the elements, in leaf order */
+    std::vector<UMesh::PrimRef> prims;
+
+  private:
+    /*! calls 'visit(prim)' for each element whose (quantized) leaf
+        box contains P, until visit() returns true */
+    template<typename Visit>
+    bool traverse(const vec3f &P, const Visit &visit) const;
+  };
+
+} // ::umesh
@@ -15,6 +15,7 @@
 // ======================================================================== //
 
 #include "FaceConn.h"
+#include "umesh/Facets.h"
 #include "umesh/io/IO.h"
 
 # ifdef UMESH_HAVE_TBB
@@ -41,8 +42,6 @@
 
 namespace umesh {
 
-  using std::swap;
-  
   using SharedFace   = FaceConn::SharedFace;
   using PrimFacetRef = FaceConn::PrimFacetRef;
 
@@ -52,17 +51,6 @@ namespace umesh {
     return out;
   }
   
-  /*! one "face" of a given prim, defined through the (global) vertex
-      indices, the gloabl primitive index, and the (local to the prim)
-      facet index; orientation defines whether the given vertex
-      indices point inwards, or outwards, allowing to later keeping
-      track of which side of a face the given facet belons */
-  struct Facet {
-    vec4i        vertexIdx;
-    PrimFacetRef prim;
-    int          orientation;
-  };
-
   std::ostream &operator<<(std::ostream &out, const Facet &facet)
   {
     out << "Facet{vtx="<<facet.vertexIdx<<",prim="<<facet.prim<<",orientation="<<facet.orientation<<"}";
@@ -96,126 +84,6 @@ namespace umesh {
   };
 
                
-  /*! describes input data through plain pointers, so we can run the
-    same algorithm once with std::vector::data() (on the host) or
-    cuda-malloced data (on gpu) */
-  struct InputMesh {
-    Tet   *tets;
-    size_t numTets;
-    Pyr   *pyrs;
-    size_t numPyrs;
-    Wedge *wedges;
-    size_t numWedges;
-    Hex   *hexes;
-    size_t numHexes;
-  };
-
-  inline int numUniqueVertices(vec3i v)
-  {
-    std::sort(&v.x,&v.x+3);
-    int cnt = 1;
-    for (int i=1;i<3;i++)
-      if (v[i] != v[i-1]) cnt++;
-    return cnt;
-  }
-  inline int numUniqueVertices(vec4i v)
-  {
-    std::sort(&v.x,&v.x+4);
-    int cnt = 1;
-    for (int i=1;i<4;i++)
-      if (v[i] != v[i-1]) cnt++;
-    return cnt;
-  }
-  
-  // ==================================================================
-  // compute vertex order stage
-  // ==================================================================
-  
-  /*! computes a unique vertex order such that two different prims
-    that share the same face - but have written thie facets with
-    differnetly ordered vertex indices - will end up with the same
-    vector of indices. of course, re-ordeirng indices can change
-    orientation, which this function keeps track of */
-  inline 
-  void computeUniqueVertexOrder(Facet &facet)
-  {
-    vec4i idx = facet.vertexIdx;
-    // \todo optimize this - all we need is detect the number of
-    // unique vertices, for which this is overkill
-    // std::set<int> uniqueIDs;
-    // uniqueIDs.insert(idx.x);
-    // uniqueIDs.insert(idx.y);
-    // uniqueIDs.insert(idx.z);
-    
-    if (idx.w < 0) {
-      int numUnique = numUniqueVertices((const vec3i&)idx);
-      if (numUnique < 3) {
-        facet.vertexIdx = vec4i(-1);
-        return;
-      }
-      if (idx.y < idx.x)
-        { swap(idx.x,idx.y); facet.orientation = 1-facet.orientation; }
-      if (idx.z < idx.x)
-        { swap(idx.x,idx.z); facet.orientation = 1-facet.orientation; }
-      if (idx.z < idx.y)
-        { swap(idx.y,idx.z); facet.orientation = 1-facet.orientation; }
-    } else {
-      // uniqueIDs.insert(idx.w);
-      int numUnique = numUniqueVertices(idx);
-      
-      if (numUnique == 2) {
-        facet.vertexIdx = vec4i(-1);
-        return;
-      }
-      
-      if (numUnique == 3) {
-        if (idx.x==idx.y) {
-          idx = { idx.x, idx.z, idx.w, -1 };
-        } else if (idx.x == idx.z) {
-          // oooooh... this one is fishy
-          PING;
-          idx = { idx.x, idx.y, idx.w, -1 };
-        } else if (idx.x == idx.w) {
-          idx = { idx.x, idx.y, idx.z, -1 };
-        } else if (idx.y == idx.z) {
-          idx = { idx.x, idx.y, idx.w, -1 };
-        } else if (idx.y == idx.w) {
-          // oooooh... this one is fishy
-          PING;
-          idx = { idx.x, idx.y, idx.z, -1 };
-        } else if (idx.z == idx.w) {
-          idx = { idx.x, idx.y, idx.z, -1 };
-        } else throw std::runtime_error("???");
-        
-        if (idx.y < idx.x)
-          { swap(idx.x,idx.y); facet.orientation = 1-facet.orientation; }
-        if (idx.z < idx.x)
-          { swap(idx.x,idx.z); facet.orientation = 1-facet.orientation; }
-        if (idx.z < idx.y)
-          { swap(idx.y,idx.z); facet.orientation = 1-facet.orientation; }
-      } else {
-
-        int lv = idx.x, li=0;
-        if (idx.y < lv) { lv = idx.y; li = 1; }
-        if (idx.z < lv) { lv = idx.z; li = 2; }
-        if (idx.w < lv) { lv = idx.w; li = 3; }
-
-        switch (li) {
-        case 0: idx = { idx.x,idx.y,idx.z,idx.w }; break;
-        case 1: idx = { idx.y,idx.z,idx.w,idx.x }; break;
-        case 2: idx = { idx.z,idx.w,idx.x,idx.y }; break;
-        case 3: idx = { idx.w,idx.x,idx.y,idx.z }; break;
-        };
-
-        if (idx.w < idx.y) {
-          facet.orientation = 1-facet.orientation;
-          swap(idx.w,idx.y);
-        }
-      }
-    }
-    facet.vertexIdx = idx;
-  }
-
   void computeUniqueVertexOrder(Facet *facets, size_t numFacets)
   {
     parallel_for_blocked
@@ -227,119 +95,6 @@ namespace umesh {
        });
   }
 
-  // ==================================================================
-  // init faces
-  // ==================================================================
-  
-  /*! writes the four facets of a tet; for degenerate tets that may
-    end up with faces that collapse to points or lines - that's OK,
-    as it'll be fixed later on in computeUniqueVertexOrder() */
-  inline 
-  void writeTetFacets(Facet *facets,
-                      size_t tetIdx,
-                      InputMesh mesh
-                      )
-  {
-    for (int i=0;i<4;i++) facets[i].prim.primType = UMesh::TET;
-    for (int i=0;i<4;i++) facets[i].prim.facetIdx = i;
-    for (int i=0;i<4;i++) facets[i].prim.primIdx  = tetIdx;
-    for (int i=0;i<4;i++) facets[i].orientation   = 0;
-
-    vec4i tet = mesh.tets[tetIdx];
-
-    facets[0].vertexIdx = { tet.y,tet.w,tet.z,-1 };
-    facets[1].vertexIdx = { tet.x,tet.z,tet.w,-1 };
-    facets[2].vertexIdx = { tet.x,tet.w,tet.y,-1 };
-    facets[3].vertexIdx = { tet.x,tet.y,tet.z,-1 };
-  }
-  
-  /*! writes the five facets of a pyrs; for degenerate pyramids thta
-    may end up with quads that become triangles, and/or entire faces
-    that collapse to points or lines - that's OK, as it'll be fixed
-    later on in computeUniqueVertexOrder() */
-  inline 
-  void writePyrFacets(Facet *facets,
-                      size_t pyrIdx,
-                      InputMesh mesh
-                      )
-  {
-    for (int i=0;i<5;i++) facets[i].prim.primType = UMesh::PYR;
-    for (int i=0;i<5;i++) facets[i].prim.facetIdx = i;
-    for (int i=0;i<5;i++) facets[i].prim.primIdx  = pyrIdx;
-    for (int i=0;i<5;i++) facets[i].orientation   = 0;
-    
-    UMesh::Pyr pyr = mesh.pyrs[pyrIdx];
-    vec4i base = pyr.base;
-    facets[0].vertexIdx = { pyr.top,base.y,base.x,-1 };
-    facets[1].vertexIdx = { pyr.top,base.z,base.y,-1 };
-    facets[2].vertexIdx = { pyr.top,base.w,base.z,-1 };
-    facets[3].vertexIdx = { pyr.top,base.x,base.w,-1 };
-    facets[4].vertexIdx = { base.x,base.y,base.z,base.w };
-  }
-
-  /*! writes the five facets of a wedge; for degenerate wedges thta
-    may end up with quads that become triangles, and/or entire faces
-    that collapse to points or lines - that's OK, as it'll be fixed
-    later on in computeUniqueVertexOrder() */
-  inline 
-  void writeWedgeFacets(Facet *facets,
-                        size_t wedgeIdx,
-                        InputMesh mesh
-                        )
-  {
-    for (int i=0;i<5;i++) facets[i].prim.primType = UMesh::WEDGE;
-    for (int i=0;i<5;i++) facets[i].prim.facetIdx = i;
-    for (int i=0;i<5;i++) facets[i].prim.primIdx  = wedgeIdx;
-    for (int i=0;i<5;i++) facets[i].orientation   = 0;
-    
-    UMesh::Wedge wedge = mesh.wedges[wedgeIdx];
-    int i0 = wedge.front.x;
-    int i1 = wedge.front.y;
-    int i2 = wedge.front.z;
-    int i3 = wedge.back.x;
-    int i4 = wedge.back.y;
-    int i5 = wedge.back.z;
-
-    facets[0].vertexIdx = { i0,i2,i1,-1 };
-    facets[1].vertexIdx = { i3,i4,i5,-1 };
-    facets[2].vertexIdx = { i0,i3,i5,i2 };
-    facets[3].vertexIdx = { i1,i2,i5,i4 };
-    facets[4].vertexIdx = { i0,i1,i4,i3 };
-  }
-  
-  /*! writes the five facets of a hexes; for degenerate hexes that may
-    end up with quads that become triangles, and/or entire faces
-    that collapse to points or lines - that's OK, as it'll be fixed
-    later on in computeUniqueVertexOrder() */
-  inline 
-  void writeHexFacets(Facet *facets,
-                      size_t hexIdx,
-                      InputMesh mesh
-                      )
-  {
-    for (int i=0;i<6;i++) facets[i].prim.primType = UMesh::HEX;
-    for (int i=0;i<6;i++) facets[i].prim.facetIdx = i;
-    for (int i=0;i<6;i++) facets[i].prim.primIdx  = hexIdx;
-    for (int i=0;i<6;i++) facets[i].orientation   = 0;
-    
-    UMesh::Hex hex = mesh.hexes[hexIdx];
-    int i0 = hex.base.x;
-    int i1 = hex.base.y;
-    int i2 = hex.base.z;
-    int i3 = hex.base.w;
-    int i4 = hex.top.x;
-    int i5 = hex.top.y;
-    int i6 = hex.top.z;
-    int i7 = hex.top.w;
-
-    facets[0].vertexIdx = { i0,i1,i2,i3 };
-    facets[1].vertexIdx = { i4,i7,i6,i5 };
-    facets[2].vertexIdx = { i0,i4,i5,i1 };
-    facets[3].vertexIdx = { i2,i6,i7,i3 };
-    facets[4].vertexIdx = { i1,i5,i6,i2 };
-    facets[5].vertexIdx = { i0,i3,i7,i4 };
-  }
-
   /*! writes the facets given by the parallel launch that runs over
     all facets in the model */
   inline 
@@ -411,23 +166,6 @@ namespace umesh {
   // ==================================================================
   // set up / upload input mesh data
   // ==================================================================
-  template<typename T>
-  inline void upload(T *&ptr, size_t &count,
-                     const std::vector<T> &vec)
-  {
-    ptr = (T*)vec.data();
-    count = vec.size();
-  }
-
-  void setupInput(InputMesh &mesh, UMesh::SP input)
-  {
-    upload(mesh.tets,mesh.numTets,input->tets);
-    upload(mesh.pyrs,mesh.numPyrs,input->pyrs);
-    upload(mesh.wedges,mesh.numWedges,input->wedges);
-    upload(mesh.hexes,mesh.numHexes,input->hexes);
-  }
-  
-
   // ==================================================================
   // let facets write the facess
   // ==================================================================
@@ -18,6 +18,7 @@
 # ifdef UMESH_HAVE_TBB
 #  include "tbb/parallel_sort.h"
 # endif
+#include <array>
 
 namespace umesh {
 
@@ -307,87 +308,295 @@ namespace umesh {
     }
   }
 
+  /*! calls the given lambda once for each of the mesh's prim arrays
+      (surface and volume) */
+  template<typename Lambda>
+  inline void forEachPrimArray(UMesh &mesh, const Lambda &lambda)
+  {
+    lambda(mesh.triangles);
+    lambda(mesh.quads);
+    lambda(mesh.tets);
+    lambda(mesh.pyrs);
+    lambda(mesh.wedges);
+    lambda(mesh.hexes);
+  }
+
   void removeUnusedVertices(UMesh::SP mesh)
   {
-    std::vector<uint8_t> isUsed(mesh->vertices.size());
-    for (auto &flag : isUsed) flag = false;
-    
-    // mark 
-    for (auto &prim : mesh->triangles) {
-      for (int i=0;i<prim.numVertices;i++)
-        isUsed[prim[i]] = true;
-    }
-    for (auto &prim : mesh->quads) {
-      for (int i=0;i<prim.numVertices;i++)
-        isUsed[prim[i]] = true;
-    }
-    parallel_for_blocked
-      (0,mesh->tets.size(),1024*64,
-       [&](size_t begin, size_t end){
-        for (size_t primID=begin;primID<end;primID++){
-          auto &prim = mesh->tets[primID];
-          for (int i=0;i<prim.numVertices;i++)
-            isUsed[prim[i]] = true;
-        }});
-    for (auto &prim : mesh->pyrs) {
-      for (int i=0;i<prim.numVertices;i++)
-        isUsed[prim[i]] = true;
-    }
-    for (auto &prim : mesh->wedges) {
-      for (int i=0;i<prim.numVertices;i++)
-        isUsed[prim[i]] = true;
+    gatherUsedVertices(mesh,mesh);
+  }
+
+  void gatherUsedVertices(UMesh::SP mesh, UMesh::SP source)
+  {
+    const size_t numVertices = source->vertices.size();
+    const size_t blockSize   = 64*1024;
+
+    // mark - all writers only ever write the same value, so no
+    // synchronization required
+    std::vector<uint8_t> isUsed(numVertices,0);
+    forEachPrimArray(*mesh,[&](const auto &prims){
+        parallel_for_blocked
+          (0,prims.size(),blockSize,
+           [&](size_t begin, size_t end){
+            for (size_t primID=begin;primID<end;primID++) {
+              auto &prim = prims[primID];
+              for (int i=0;i<prim.numVertices;i++)
+                isUsed[prim[i]] = true;
+            }});
+      });
+
+    // count used vertices per block, and scan to get each block's
+    // first output vertex
+    const size_t numBlocks = (numVertices+blockSize-1)/blockSize;
+    std::vector<size_t> blockOffset(numBlocks+1,0);
+    parallel_for(numBlocks,[&](size_t blockID){
+        const size_t begin = blockID*blockSize;
+        const size_t end   = std::min(begin+blockSize,numVertices);
+        size_t count = 0;
+        for (size_t i=begin;i<end;i++)
+          count += isUsed[i];
+        blockOffset[blockID+1] = count;
+      });
+    for (size_t blockID=0;blockID<numBlocks;blockID++)
+      blockOffset[blockID+1] += blockOffset[blockID];
+    const size_t numUsed = blockOffset[numBlocks];
+
+    // compact
+    const bool hasScalars = (bool)source->perVertex;
+    const bool hasTags    = (source->vertexTag.size() == numVertices);
+    std::vector<int>    newID(numVertices);
+    std::vector<vec3f>  newVertices(numUsed);
+    std::vector<float>  newValues(hasScalars ? numUsed : 0);
+    std::vector<size_t> newTags(hasTags ? numUsed : 0);
+    parallel_for(numBlocks,[&](size_t blockID){
+        const size_t begin = blockID*blockSize;
+        const size_t end   = std::min(begin+blockSize,numVertices);
+        size_t out = blockOffset[blockID];
+        for (size_t i=begin;i<end;i++) {
+          if (!isUsed[i]) {
+            // won't get used, anyway....
+            newID[i] = -1;
+            continue;
+          }
+          newVertices[out] = source->vertices[i];
+          if (hasScalars)
+            newValues[out] = source->perVertex->values[i];
+          if (hasTags)
+            newTags[out] = source->vertexTag[i];
+          newID[i] = (int)out++;
+        }
+      });
+
+    // translate
+    forEachPrimArray(*mesh,[&](auto &prims){
+        parallel_for_blocked
+          (0,prims.size(),blockSize,
+           [&](size_t begin, size_t end){
+            for (size_t primID=begin;primID<end;primID++) {
+              auto &prim = prims[primID];
+              for (int i=0;i<prim.numVertices;i++)
+                prim[i] = newID[prim[i]];
+            }});
+      });
+
+    // and store - note the attribute may be shared with the source
+    // mesh, so always create a new one
+    mesh->vertices = std::move(newVertices);
+    if (hasScalars) {
+      Attribute::SP perVertex = std::make_shared<Attribute>();
+      perVertex->name   = source->perVertex->name;
+      perVertex->values = std::move(newValues);
+      perVertex->finalize();
+      mesh->perVertex = perVertex;
     }
-    for (auto &prim : mesh->hexes) {
-      for (int i=0;i<prim.numVertices;i++)
-        isUsed[prim[i]] = true;
+    if (hasTags)
+      mesh->vertexTag = std::move(newTags);
+  }
+  
+  /*! returns the input mesh's array of prims of the given type, as
+      well as that array in the output mesh */
+  template<typename Lambda>
+  inline void withPrimArrays(UMesh &in, UMesh &out, size_t type,
+                             const Lambda &lambda)
+  {
+    switch (type) {
+    case UMesh::TRI:   lambda(in.triangles,out.triangles); break;
+    case UMesh::QUAD:  lambda(in.quads,out.quads);         break;
+    case UMesh::TET:   lambda(in.tets,out.tets);           break;
+    case UMesh::PYR:   lambda(in.pyrs,out.pyrs);           break;
+    case UMesh::WEDGE: lambda(in.wedges,out.wedges);       break;
+    case UMesh::HEX:   lambda(in.hexes,out.hexes);         break;
+    default:
+      throw std::runtime_error("un-implemented prim type?");
     }
+  }
+
+  inline bool noDuplicates(const UMesh::PrimRef &pr, const UMesh &mesh)
+  {
+    if (pr.type == UMesh::TRI) return noDuplicates(mesh.triangles[pr.ID]);
+    if (pr.type == UMesh::TET) return noDuplicates(mesh.tets[pr.ID]);
+    return true;
+  }
+  
+  UMesh::SP extractSubMesh(UMesh::SP in,
+                           const std::vector<UMesh::PrimRef> &prims)
+  {
+    UMesh::SP out = std::make_shared<UMesh>();
+    enum { numPrimTypes = UMesh::INVALID };
+    
+    // count (non-degenerate) prims of each type per block, and scan
+    // to get each block's first output prim of each type ...
+    const size_t numPrims  = prims.size();
+    const size_t blockSize = 16*1024;
+    const size_t numBlocks = (numPrims+blockSize-1)/blockSize;
+    std::vector<std::array<size_t,numPrimTypes>> blockOffset(numBlocks+1);
+    for (auto &offset : blockOffset) offset.fill(0);
+    parallel_for(numBlocks,[&](size_t blockID){
+        const size_t begin = blockID*blockSize;
+        const size_t end   = std::min(begin+blockSize,numPrims);
+        for (size_t i=begin;i<end;i++)
+          if (noDuplicates(prims[i],*in))
+            blockOffset[blockID+1][prims[i].type]++;
+      });
+    for (size_t blockID=0;blockID<numBlocks;blockID++)
+      for (int t=0;t<numPrimTypes;t++)
+        blockOffset[blockID+1][t] += blockOffset[blockID][t];
+    for (int t=0;t<numPrimTypes;t++)
+      withPrimArrays(*in,*out,t,[&](const auto &, auto &outPrims){
+          outPrims.resize(blockOffset[numBlocks][t]);
+        });
 
-    std::vector<int> newID(mesh->vertices.size());
-    int curID = 0;
-    for (int i=0;i<newID.size();i++) {
-      if (isUsed[i]) {
-        mesh->vertices[curID] = mesh->vertices[i];
-        if (mesh->perVertex)
-          mesh->perVertex->values[curID] = mesh->perVertex->values[i];
-        newID[i] = curID++;
-      } else {
-        // won't get used, anyway....
-        newID[i] = -1;
+    // per-element values (if any) are in global element order, so
+    // we need to know where each type's elements start, in both
+    // input and output
+    const bool hasCellScalars = (bool)in->perElement;
+    std::array<size_t,numPrimTypes> inElementBegin, outElementBegin;
+    {
+      size_t inBegin = 0, outBegin = 0;
+      for (int t=0;t<numPrimTypes;t++) {
+        inElementBegin[t]  = inBegin;
+        outElementBegin[t] = outBegin;
+        withPrimArrays(*in,*out,t,[&](const auto &inPrims, const auto &outPrims){
+            inBegin  += inPrims.size();
+            outBegin += outPrims.size();
+          });
+      }
+      if (hasCellScalars) {
+        out->perElement = std::make_shared<Attribute>();
+        out->perElement->name = in->perElement->name;
+        out->perElement->values.resize(outBegin);
       }
     }
-    std::cout << "done compacting vertex array, num vertices found " << curID << std::endl;
-    mesh->vertices.resize(curID);
-    mesh->perVertex->values.resize(curID);
 
-    
-    for (auto &prim : mesh->triangles) {
-      for (int i=0;i<prim.numVertices;i++)
-        prim[i] = newID[prim[i]];
-    }
-    for (auto &prim : mesh->quads) {
-      for (int i=0;i<prim.numVertices;i++)
-        prim[i] = newID[prim[i]];
-    }
-    parallel_for_blocked
-      (0,mesh->tets.size(),1024*64,
-       [&](size_t begin, size_t end){
-        for (size_t primID=begin;primID<end;primID++){
-          auto &prim = mesh->tets[primID];
-          for (int i=0;i<prim.numVertices;i++)
-            prim[i] = newID[prim[i]];
-        }});
-    for (auto &prim : mesh->pyrs) {
-      for (int i=0;i<prim.numVertices;i++)
-        prim[i] = newID[prim[i]];
+    // ... gather the prims (still with input vertex indices) ...
+    parallel_for(numBlocks,[&](size_t blockID){
+        const size_t begin = blockID*blockSize;
+        const size_t end   = std::min(begin+blockSize,numPrims);
+        std::array<size_t,numPrimTypes> offset = blockOffset[blockID];
+        for (size_t i=begin;i<end;i++) {
+          const UMesh::PrimRef pr = prims[i];
+          if (!noDuplicates(pr,*in)) continue;
+          if (hasCellScalars)
+            out->perElement->values[outElementBegin[pr.type]+offset[pr.type]]
+              = in->perElement->values[inElementBegin[pr.type]+pr.ID];
+          withPrimArrays(*in,*out,pr.type,[&](const auto &inPrims, auto &outPrims){
+              outPrims[offset[pr.type]++] = inPrims[pr.ID];
+            });
+        }
+      });
+    if (hasCellScalars)
+      out->perElement->finalize();
+
+    // ... collect all vertex indices they use; sort and make those
+    // unique to get the vertices we need (in input order) ...
+    std::vector<int> usedVertices;
+    size_t numIndices = 0;
+    forEachPrimArray(*out,[&](const auto &outPrims){
+        if (!outPrims.empty())
+          numIndices += outPrims.size()*outPrims[0].numVertices;
+      });
+    usedVertices.resize(numIndices);
+    {
+      size_t offset = 0;
+      forEachPrimArray(*out,[&](const auto &outPrims){
+          if (outPrims.empty()) return;
+          const int N = outPrims[0].numVertices;
+          int *dst = usedVertices.data()+offset;
+          parallel_for_blocked(0,outPrims.size(),blockSize,[&](size_t begin, size_t end){
+              for (size_t i=begin;i<end;i++)
+                for (int j=0;j<N;j++)
+                  dst[i*N+j] = outPrims[i][j];
+            });
+          offset += outPrims.size()*N;
+        });
     }
-    for (auto &prim : mesh->wedges) {
-      for (int i=0;i<prim.numVertices;i++)
-        prim[i] = newID[prim[i]];
+# ifdef UMESH_HAVE_TBB
+    tbb::parallel_sort(usedVertices.begin(),usedVertices.end());
+# else
+    std::sort(usedVertices.begin(),usedVertices.end());
+# endif
+    usedVertices.erase(std::unique(usedVertices.begin(),usedVertices.end()),
+                       usedVertices.end());
+
+    // ... gather those ...
+    const size_t numUsed = usedVertices.size();
+    const bool hasScalars = (bool)in->perVertex;
+    const bool hasTags    = (in->vertexTag.size() == in->vertices.size());
+    out->vertices.resize(numUsed);
+    if (hasScalars) {
+      out->perVertex = std::make_shared<Attribute>(numUsed);
+      out->perVertex->name = in->perVertex->name;
     }
-    for (auto &prim : mesh->hexes) {
-      for (int i=0;i<prim.numVertices;i++)
-        prim[i] = newID[prim[i]];
+    if (hasTags)
+      out->vertexTag.resize(numUsed);
+    parallel_for_blocked(0,numUsed,blockSize,[&](size_t begin, size_t end){
+        for (size_t i=begin;i<end;i++) {
+          const int vertexID = usedVertices[i];
+          out->vertices[i] = in->vertices[vertexID];
+          if (hasScalars)
+            out->perVertex->values[i] = in->perVertex->values[vertexID];
+          if (hasTags)
+            out->vertexTag[i] = in->vertexTag[vertexID];
+        }
+      });
+    if (hasScalars)
+      out->perVertex->finalize();
+
+    // ... and translate the prims' vertex indices
+    forEachPrimArray(*out,[&](auto &outPrims){
+        parallel_for_blocked(0,outPrims.size(),blockSize,[&](size_t begin, size_t end){
+            for (size_t i=begin;i<end;i++) {
+              auto &prim = outPrims[i];
+              for (int j=0;j<prim.numVertices;j++)
+                prim[j] = int(std::lower_bound(usedVertices.begin(),
+                                               usedVertices.end(),
+                                               prim[j])
+                              - usedVertices.begin());
+            }
+          });
+      });
+    return out;
+  }
+  
+  UMesh::SP extractSubMesh(UMesh::SP in,
+                           const std::vector<UMesh::PrimRef> &owned,
+                           const std::vector<UMesh::PrimRef> &ghosts)
+  {
+    std::vector<UMesh::PrimRef> prims(owned.size()+ghosts.size());
+    std::copy(owned.begin(),owned.end(),prims.begin());
+    std::copy(ghosts.begin(),ghosts.end(),prims.begin()+owned.size());
+    UMesh::SP out = extractSubMesh(in,prims);
+
+    // extractSubMesh() keeps prims' order, and only ever drops
+    // degenerate ones, so the owned ones are those that come first
+    out->numOwned.assign(4,0);
+    for (auto pr : owned) {
+      if (pr.type < UMesh::TET || pr.type > UMesh::HEX)
+        throw std::runtime_error("ghost cells only supported for volume elements");
+      if (noDuplicates(pr,*in))
+        out->numOwned[pr.type-UMesh::TET]++;
     }
+    return out;
   }
   
 } // ::umesh
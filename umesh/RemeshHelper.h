@@ -80,4 +80,37 @@ namespace umesh {
       NOT have duplicate vertices */
   void removeUnusedVertices(UMesh::SP mesh);
 
+  /*! given a mesh whose prims' vertex indices refer to the vertex
+      array of _another_ mesh ('source'), fill in the mesh's own
+      vertex array (and scalars, and vertex tags, if source has those)
+      with only those of source's vertices that are actually used by
+      any prim, and re-index all prims accordingly. Vertices keep
+      their relative order. 'mesh' and 'source' may be the same mesh,
+      in which case this is the same as removeUnusedVertices() */
+  void gatherUsedVertices(UMesh::SP mesh, UMesh::SP source);
+
+  /*! creates a new mesh from only the given prims of the input mesh
+      (eg, the prims of one brick of a partition), with only those
+      vertices - and their scalars or vertex tags - that those prims
+      actually use; per-element scalars (if any) come along with
+      their prims. Prims keep their order (within each prim type),
+      vertices keep their relative order from the input mesh.
+
+      Unlike adding the prims one by one through a RemeshHelper, this
+      identifies vertices by their index (rather than by position),
+      runs in parallel, and its cost only depends on the number of
+      prims extracted (not on the size of the input mesh) - so it can
+      be called for many bricks of the same mesh concurrently */
+  UMesh::SP extractSubMesh(UMesh::SP mesh,
+                           const std::vector<UMesh::PrimRef> &prims);
+
+  /*! same as extractSubMesh(), but for a brick that also has 'ghost'
+      elements (owned by other bricks): the output's element arrays
+      will first contain the brick's own elements, then the ghosts,
+      and the output's numOwned will say how many of each type are
+      owned */
+  UMesh::SP extractSubMesh(UMesh::SP mesh,
+                           const std::vector<UMesh::PrimRef> &owned,
+                           const std::vector<UMesh::PrimRef> &ghosts);
+
 } // ::tetty
@@ -75,8 +75,15 @@ namespace umesh {
       size_t numPerVertexAttributes = 0;
       io::writeElement(out,numPerVertexAttributes);
     }
-    size_t numPerElementAttributes = 0;
-    io::writeElement(out,numPerElementAttributes);
+    if (perElement) {
+      size_t numPerElementAttributes = 1;
+      io::writeElement(out,numPerElementAttributes);
+      io::writeString(out,perElement->name);
+      io::writeVector(out,perElement->values);
+    } else {
+      size_t numPerElementAttributes = 0;
+      io::writeElement(out,numPerElementAttributes);
+    }
     
     io::writeVector(out,triangles);
     io::writeVector(out,quads);
@@ -85,6 +92,9 @@ namespace umesh {
     io::writeVector(out,wedges);
     io::writeVector(out,hexes);
     io::writeVector(out,vertexTag);
+    // optional, so files w/o ghost elements stay the same as before
+    if (!numOwned.empty())
+      io::writeVector(out,numOwned);
   }
   
   /*! write - binary - to given file */
@@ -122,7 +132,13 @@ namespace umesh {
     size_t numPerElementAttributes = 0;
     if (supportsMultipleAttributes)
       io::readElement(in,numPerElementAttributes);
-    assert(numPerElementAttributes == 0);
+    // only the first one gets kept
+    for (size_t i=0;i<numPerElementAttributes;i++) {
+      Attribute::SP attribute = std::make_shared<Attribute>();
+      io::readString(in,attribute->name);
+      io::readVector(in,attribute->values,"per-element values");
+      if (i == 0) this->perElement = attribute;
+    }
     
     io::readVector(in,this->triangles,"triangles");
     io::readVector(in,this->quads,"quads");
@@ -130,6 +146,9 @@ namespace umesh {
     io::readVector(in,this->pyrs,"pyramids");
     io::readVector(in,this->wedges,"wedges");
     io::readVector(in,this->hexes,"hexes");
+    if (perElement && perElement->values.size() != size())
+      throw std::runtime_error("#umesh: number of per-element values does not"
+                               " match number of elements");
     // try {
     if (!in.eof())
       try {
@@ -137,6 +156,15 @@ namespace umesh {
       } catch (...) {
         /* ignore ... */
       }
+    if (in.good())
+      try {
+        io::readVector(in,this->numOwned,"numOwned");
+        if (this->numOwned.size() != 4)
+          this->numOwned.clear();
+      } catch (...) {
+        /* ignore ... */
+        this->numOwned.clear();
+      }
   
     this->finalize();
   }
@@ -247,6 +275,7 @@ namespace umesh {
   void UMesh::finalize()
   {
     if (perVertex) perVertex->finalize();
+    if (perElement) perElement->finalize();
     bounds = box3f();
     std::mutex mutex;
     parallel_for_blocked
@@ -291,6 +320,8 @@ namespace umesh {
       } else {
         ss << ",scalars=no";
       }
+      if (perElement)
+        ss << ",cellScalars=yes(name='" << perElement->name << "')";
       ss << ")";
     } else {
       ss << "#verts : " << prettyNumber(vertices.size()) << std::endl;
@@ -310,6 +341,8 @@ namespace umesh {
           ss << "values : " << valueRange << std::endl;
       } else
         ss << "values : <none>" << std::endl;
+      if (perElement)
+        ss << "cells  : " << perElement->valueRange << std::endl;
     }
     return ss.str();
   }
@@ -340,14 +340,10 @@ namespace umesh {
     }
 
     inline range1f getValueRange() const {
-      // if (perVertex) {
       if (perVertex)
         return perVertex->valueRange;
-      // } else {
-      //   range1f result;
-      //   if (perTet)   result.extend(perTet->valueRange);
-      //   if (perHex)   result.extend(perHex->valueRange);
-      // }
+      if (perElement)
+        return perElement->valueRange;
       throw std::runtime_error("cannot get value range for umesh: no attributes!");
     }
     
@@ -506,8 +502,13 @@ namespace umesh {
     
     std::vector<vec3f> vertices;
     Attribute::SP      perVertex;
-    // Attribute::SP      perTet;
-    // Attribute::SP      perHex;
+    /*! optional per-element (cell-centered) attribute, with one value
+      per element, in global element order: all triangles first,
+      then quads, tets, pyramids, wedges, and hexes (the order in
+      which the element arrays get stored in .umesh and .vtu files).
+      See convertAttributes.h for converting between this and
+      perVertex */
+    Attribute::SP      perElement;
     
     // -------------------------------------------------------
     // surface elements:
@@ -526,6 +527,15 @@ namespace umesh {
     /*! in some cases, it makes sense to allow for storing a
       user-provided per-vertex tag (may be empty) */
     std::vector<size_t> vertexTag;
+
+    /*! for meshes that are one brick of a partitioned mesh, and that
+      contain 'ghost' (or 'halo') elements owned by other bricks: the
+      number of elements this brick actually owns, for each volume
+      element type (in tets, pyrs, wedges, hexes order). Owned
+      elements always come first in each element array, followed by
+      the ghost elements. Empty if the mesh does not distinguish
+      owned from ghost elements (in which case it owns all of them) */
+    std::vector<size_t> numOwned;
     
     box3f   bounds;
   };
@@ -0,0 +1,315 @@
+// ======================================================================== //
+// Copyright 2018-2020 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "umesh/ValueRangeIndex.h"
+#include "umesh/io/IO.h"
+#if UMESH_HAVE_TBB
+# include "tbb/parallel_sort.h"
+#endif
+#include <algorithm>
+#include <numeric>
+#include <cstring>
+
+namespace umesh {
+
+  const size_t valueRangeIndex_magic = 0x76726932ULL;
+
+  template<typename T, typename Compare>
+  inline void sortRange(T begin, T end, const Compare &compare)
+  {
+#if UMESH_HAVE_TBB
+    tbb::parallel_sort(begin,end,compare);
+#else
+    std::sort(begin,end,compare);
+#endif
+  }
+
+  /*! orders prim refs the same way createVolumePrimRefs() creates
+      them: by type first (tets, pyrs, wedges, hexes), then by ID */
+  inline bool primRefLess(const UMesh::PrimRef &a, const UMesh::PrimRef &b)
+  {
+    return (a.type < b.type) || ((a.type == b.type) && (a.ID < b.ID));
+  }
+
+  /*! computes range and a (cheap, FNV-1a style) checksum of the
+      given scalars. Blocks get hashed in parallel, and the block
+      hashes then get combined in order, so the result does not
+      depend on the number of threads */
+  void computeScalarSignature(const std::vector<float> &values,
+                              range1f &range,
+                              uint64_t &checksum)
+  {
+    const uint64_t fnvPrime = 0x100000001b3ull;
+    const uint64_t fnvBasis = 0xcbf29ce484222325ull;
+    const size_t blockSize = 64*1024;
+    const size_t numBlocks = divRoundUp(values.size(),blockSize);
+    std::vector<range1f>  blockRange(numBlocks);
+    std::vector<uint64_t> blockHash(numBlocks);
+    parallel_for(numBlocks,[&](size_t blockID){
+        const size_t begin = blockID*blockSize;
+        const size_t end   = std::min(begin+blockSize,values.size());
+        range1f  r;
+        uint64_t h = fnvBasis;
+        for (size_t i=begin;i<end;i++) {
+          r.extend(values[i]);
+          uint32_t bits;
+          memcpy(&bits,&values[i],sizeof(bits));
+          h = (h ^ bits) * fnvPrime;
+        }
+        blockRange[blockID] = r;
+        blockHash[blockID]  = h;
+      });
+    range    = range1f();
+    checksum = (fnvBasis ^ values.size()) * fnvPrime;
+    for (size_t b=0;b<numBlocks;b++) {
+      range.extend(blockRange[b]);
+      checksum = (checksum ^ blockHash[b]) * fnvPrime;
+    }
+  }
+
+  /*! build index over all volume elements of given mesh, using the
+      mesh's per-vertex scalar field */
+  ValueRangeIndex::SP ValueRangeIndex::build(UMesh::SP mesh, int numBuckets)
+  {
+    if (!mesh) throw std::runtime_error("null input mesh");
+    if (!mesh->perVertex) throw std::runtime_error("input mesh w/o scalar field");
+    if (numBuckets < 1) throw std::runtime_error("invalid number of buckets");
+
+    ValueRangeIndex::SP index = std::make_shared<ValueRangeIndex>();
+    index->numElements[0] = mesh->tets.size();
+    index->numElements[1] = mesh->pyrs.size();
+    index->numElements[2] = mesh->wedges.size();
+    index->numElements[3] = mesh->hexes.size();
+    computeScalarSignature(mesh->perVertex->values,
+                           index->scalarRange,index->scalarChecksum);
+
+    std::vector<UMesh::PrimRef> prims;
+    mesh->createVolumePrimRefs(prims);
+    const size_t numPrims = prims.size();
+    std::vector<range1f> ranges(numPrims);
+    parallel_for_blocked(0,numPrims,16*1024,[&](size_t begin, size_t end){
+        for (size_t i=begin;i<end;i++)
+          ranges[i] = mesh->getValueRange(prims[i]);
+      });
+
+    // sort by lower end of range, then cut into equal-sized buckets
+    std::vector<size_t> order(numPrims);
+    std::iota(order.begin(),order.end(),0);
+    sortRange(order.begin(),order.end(),[&](size_t a, size_t b){
+        return ranges[a].lower < ranges[b].lower;
+      });
+    numBuckets = (int)std::max(size_t(1),std::min(size_t(numBuckets),numPrims));
+    index->bucketBegin.resize(numBuckets+1);
+    for (int b=0;b<=numBuckets;b++)
+      index->bucketBegin[b] = (b*numPrims)/numBuckets;
+    index->bucketLowerRange.resize(numBuckets);
+
+    // within each bucket, sort by upper end of range, largest first
+    parallel_for(numBuckets,[&](int b){
+        const size_t begin = index->bucketBegin[b];
+        const size_t end   = index->bucketBegin[b+1];
+        range1f lowerRange;
+        for (size_t i=begin;i<end;i++)
+          lowerRange.extend(ranges[order[i]].lower);
+        index->bucketLowerRange[b] = lowerRange;
+        std::sort(order.begin()+begin,order.begin()+end,[&](size_t x, size_t y){
+            return ranges[x].upper > ranges[y].upper;
+          });
+      });
+
+    index->prims.resize(numPrims);
+    index->lower.resize(numPrims);
+    index->upper.resize(numPrims);
+    parallel_for_blocked(0,numPrims,16*1024,[&](size_t begin, size_t end){
+        for (size_t i=begin;i<end;i++) {
+          index->prims[i] = prims[order[i]];
+          index->lower[i] = ranges[order[i]].lower;
+          index->upper[i] = ranges[order[i]].upper;
+        }
+      });
+    for (auto &lr : index->bucketLowerRange)
+      index->valueRange.extend(lr.lower);
+    for (size_t b=0;b<(size_t)numBuckets;b++)
+      if (index->bucketBegin[b+1] > index->bucketBegin[b])
+        index->valueRange.extend(index->upper[index->bucketBegin[b]]);
+    return index;
+  }
+
+  /*! checks whether this index was built over a mesh with the same
+      number of elements (of each type) as the given one */
+  bool ValueRangeIndex::matchesElementCounts(const UMesh &mesh) const
+  {
+    return
+      numElements[0] == mesh.tets.size() &&
+      numElements[1] == mesh.pyrs.size() &&
+      numElements[2] == mesh.wedges.size() &&
+      numElements[3] == mesh.hexes.size();
+  }
+
+  /*! checks whether this index was built over the given mesh: same
+      number of elements (of each type), and same scalar range and
+      checksum */
+  bool ValueRangeIndex::matches(const UMesh &mesh) const
+  {
+    if (!matchesElementCounts(mesh))
+      return false;
+    if (!mesh.perVertex)
+      return false;
+    range1f  range;
+    uint64_t checksum;
+    computeScalarSignature(mesh.perVertex->values,range,checksum);
+    return
+      range.lower == scalarRange.lower &&
+      range.upper == scalarRange.upper &&
+      checksum    == scalarChecksum;
+  }
+
+  /*! computes the [begin,end) range of elements in given bucket
+      that can contain active elements: if all elements in that
+      bucket start at or below 'value' the active ones are a prefix
+      of the bucket, and that prefix is returned; otherwise the
+      entire bucket is returned, with 'needsScan' set to indicate
+      that each element still has to be checked individually */
+  inline void findActiveRange(const ValueRangeIndex &index,
+                              size_t bucket, float value,
+                              size_t &begin, size_t &end,
+                              bool &needsScan)
+  {
+    begin = index.bucketBegin[bucket];
+    end   = index.bucketBegin[bucket+1];
+    needsScan = false;
+    const range1f lowerRange = index.bucketLowerRange[bucket];
+    if (begin == end || lowerRange.lower > value) {
+      end = begin;
+      return;
+    }
+    if (lowerRange.upper > value) {
+      needsScan = true;
+      return;
+    }
+    // all elements start at or below value; active are those with
+    // upper >= value, which (sorted largest first) are a prefix
+    end = std::partition_point(index.upper.begin()+begin,
+                               index.upper.begin()+end,
+                               [&](float upper){ return upper >= value; })
+      - index.upper.begin();
+  }
+
+  /*! returns number of elements that findActive(value) would
+      return, without actually gathering them */
+  size_t ValueRangeIndex::countActive(float value) const
+  {
+    size_t count = 0;
+    const size_t numBuckets = bucketLowerRange.size();
+    for (size_t b=0;b<numBuckets;b++) {
+      size_t begin, end;
+      bool needsScan;
+      findActiveRange(*this,b,value,begin,end,needsScan);
+      if (needsScan) {
+        for (size_t i=begin;i<end;i++)
+          if (lower[i] <= value && upper[i] >= value)
+            ++count;
+      } else
+        count += end-begin;
+    }
+    return count;
+  }
+
+  /*! finds all elements whose value range contains the given value;
+      result gets cleared first. Elements get returned in ascending
+      order of their prim refs */
+  void ValueRangeIndex::findActive(float value,
+                                   std::vector<UMesh::PrimRef> &result) const
+  {
+    result.clear();
+    const size_t numBuckets = bucketLowerRange.size();
+    std::vector<size_t> offset(numBuckets+1,0);
+    parallel_for(numBuckets,[&](size_t b){
+        size_t begin, end;
+        bool needsScan;
+        findActiveRange(*this,b,value,begin,end,needsScan);
+        size_t count = 0;
+        if (needsScan) {
+          for (size_t i=begin;i<end;i++)
+            if (lower[i] <= value && upper[i] >= value)
+              ++count;
+        } else
+          count = end-begin;
+        offset[b+1] = count;
+      });
+    for (size_t b=0;b<numBuckets;b++)
+      offset[b+1] += offset[b];
+    result.resize(offset[numBuckets]);
+    parallel_for(numBuckets,[&](size_t b){
+        size_t begin, end;
+        bool needsScan;
+        findActiveRange(*this,b,value,begin,end,needsScan);
+        UMesh::PrimRef *out = result.data()+offset[b];
+        for (size_t i=begin;i<end;i++)
+          if (!needsScan || (lower[i] <= value && upper[i] >= value))
+            *out++ = prims[i];
+      });
+    // restore element order, for better memory access patterns
+    // during whatever the caller does with those elements
+    sortRange(result.begin(),result.end(),primRefLess);
+  }
+
+  /*! write - binary - to given file */
+  void ValueRangeIndex::saveTo(const std::string &fileName) const
+  {
+    std::ofstream out(fileName, std::ios_base::binary);
+    if (!out.good())
+      throw std::runtime_error("#umesh: could not open '"+fileName+"' for writing");
+    io::writeElement(out,valueRangeIndex_magic);
+    io::writeArray(out,numElements,4);
+    io::writeElement(out,scalarRange);
+    io::writeElement(out,scalarChecksum);
+    io::writeElement(out,valueRange);
+    io::writeVector(out,bucketBegin);
+    io::writeVector(out,bucketLowerRange);
+    io::writeVector(out,prims);
+    io::writeVector(out,lower);
+    io::writeVector(out,upper);
+  }
+
+  /*! read from given file, assuming file format as used by saveTo() */
+  ValueRangeIndex::SP ValueRangeIndex::loadFrom(const std::string &fileName)
+  {
+    std::ifstream in(fileName, std::ios_base::binary);
+    if (!in.good())
+      throw std::runtime_error("#umesh: could not open '"+fileName+"'");
+    size_t magic;
+    io::readElement(in,magic);
+    if (magic != valueRangeIndex_magic)
+      throw std::runtime_error("wrong magic number in value range index file ...");
+    ValueRangeIndex::SP index = std::make_shared<ValueRangeIndex>();
+    io::readArray(in,index->numElements,4);
+    io::readElement(in,index->scalarRange);
+    io::readElement(in,index->scalarChecksum);
+    io::readElement(in,index->valueRange);
+    io::readVector(in,index->bucketBegin);
+    io::readVector(in,index->bucketLowerRange);
+    io::readVector(in,index->prims);
+    io::readVector(in,index->lower);
+    io::readVector(in,index->upper);
+    if (index->bucketBegin.size() != index->bucketLowerRange.size()+1 ||
+        index->prims.size() != index->lower.size() ||
+        index->prims.size() != index->upper.size())
+      throw std::runtime_error("inconsistent value range index file '"+fileName+"'");
+    return index;
+  }
+
+} // ::umesh
@@ -0,0 +1,99 @@
+// ======================================================================== //
+// Copyright 2018-2020 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "umesh/UMesh.h"
+
+namespace umesh {
+
+  /*! an acceleration structure for finding all volumetric elements
+      whose (per-vertex scalar) value range contains a given value;
+      ie, the 'active' elements for an iso-value query.
+
+      This is a bucketed span-space index: all elements get sorted by
+      the lower end of their value range, and cut into buckets of
+      (roughly) equal size; within each bucket elements are then
+      re-sorted by the upper end of their range (largest first). For
+      a query value, all buckets whose elements all start below that
+      value produce their active elements as a prefix that can be
+      found by binary search; only the (usually single) bucket
+      straddling the query value needs to be scanned element by
+      element.
+
+      The index only depends on the mesh's topology and scalars, so
+      it can be built once, and then be saved next to the mesh (see
+      saveTo/loadFrom) for later sessions. */
+  struct ValueRangeIndex {
+    typedef std::shared_ptr<ValueRangeIndex> SP;
+
+    /*! build index over all volume elements of given mesh, using the
+        mesh's per-vertex scalar field */
+    static ValueRangeIndex::SP build(UMesh::SP mesh, int numBuckets = 1024);
+
+    /*! read from given file, assuming file format as used by saveTo() */
+    static ValueRangeIndex::SP loadFrom(const std::string &fileName);
+
+    /*! write - binary - to given file */
+    void saveTo(const std::string &fileName) const;
+
+    /*! finds all elements whose value range contains the given
+        value; result gets cleared first. Elements get returned in
+        ascending order of their prim refs */
+    void findActive(float value, std::vector<UMesh::PrimRef> &result) const;
+
+    /*! returns number of elements that findActive(value) would
+        return, without actually gathering them */
+    size_t countActive(float value) const;
+
+    /*! checks whether this index was built over the given mesh:
+        same number of elements (of each type), and same scalar
+        field - as far as a range-plus-checksum comparison of the
+        per-vertex scalars can tell. If this returns false, the
+        index is stale, and has to be rebuilt. This has to look at
+        all scalars, so do it once when loading an index for a mesh,
+        not for every query */
+    bool matches(const UMesh &mesh) const;
+
+    /*! cheap (constant-time) part of matches(): only checks the
+        number of elements of each type */
+    bool matchesElementCounts(const UMesh &mesh) const;
+
+    /*! number of elements of each volumetric type in the mesh this
+        was built over, in tets, pyrs, wedges, hexes order */
+    size_t numElements[4] = { 0,0,0,0 };
+
+    /*! range and checksum of the per-vertex scalars this was built
+        over (see matches()) */
+    range1f  scalarRange;
+    uint64_t scalarChecksum = 0;
+
+    /*! range of values across all elements */
+    range1f valueRange;
+
+    /*! bucket 'b' contains elements [bucketBegin[b],bucketBegin[b+1]) */
+    std::vector<size_t>         bucketBegin;
+    /*! smallest and largest lower end of any element range in each bucket */
+    std::vector<range1f>        bucketLowerRange;
+
+    /*! the elements, and their value ranges (as separate arrays, for
+        better access patterns during queries) */
+    std::vector<UMesh::PrimRef> prims;
+    std::vector<float>          lower;
+    std::vector<float>          upper;
+  };
+
+} // ::umesh
@@ -47,6 +47,8 @@ namespace umesh {
                 << "num volume elements in mesh is 0!?" << std::endl;
     if (mesh->perVertex && mesh->perVertex->values.size() != mesh->vertices.size())
       throw std::runtime_error("attribute size doesn't match vertex array size");
+    if (mesh->perElement && mesh->perElement->values.size() != mesh->size())
+      throw std::runtime_error("attribute size doesn't match number of elements");
     
     for (auto p : mesh->tets) {
       for (int i=0;i<p.numVertices;i++) {
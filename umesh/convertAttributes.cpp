@@ -0,0 +1,384 @@
+// ======================================================================== //
+// Copyright 2018-2020 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+
+#include "umesh/convertAttributes.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+
+namespace umesh {
+
+  /*! block size for all parallel loops in here */
+  const size_t attributeBlockSize = 16*1024;
+
+  /*! all elements of a mesh, as one list in global element order
+      (tris, quads, tets, pyrs, wedges, hexes): element 'e' lives in
+      array 'k' with begin[k] <= e < begin[k+1] */
+  struct ElementList {
+    enum { numArrays = 6 };
+
+    ElementList(const UMesh &mesh);
+
+    /*! total number of elements */
+    inline size_t size() const { return begin[numArrays]; }
+    /*! number of elements in array 'k' */
+    inline size_t count(int k) const { return begin[k+1]-begin[k]; }
+    /*! vertex indices of element 'i' (local to array 'k') */
+    inline const int *corners(int k, size_t i) const
+    { return indices[k]+i*numCorners[k]; }
+
+    const int *indices[numArrays];
+    int        numCorners[numArrays];
+    size_t     begin[numArrays+1];
+  };
+
+  ElementList::ElementList(const UMesh &mesh)
+  {
+    static_assert(sizeof(Hex) == 8*sizeof(int) && sizeof(Wedge) == 6*sizeof(int)
+                  && sizeof(Pyr) == 5*sizeof(int) && sizeof(Tet) == 4*sizeof(int)
+                  && sizeof(Quad) == 4*sizeof(int) && sizeof(Triangle) == 3*sizeof(int),
+                  "element vertex indices have to be laid out contiguously");
+    const size_t counts[numArrays] = {
+      mesh.triangles.size(), mesh.quads.size(), mesh.tets.size(),
+      mesh.pyrs.size(), mesh.wedges.size(), mesh.hexes.size()
+    };
+    indices[0] = (const int *)mesh.triangles.data(); numCorners[0] = 3;
+    indices[1] = (const int *)mesh.quads.data();     numCorners[1] = 4;
+    indices[2] = (const int *)mesh.tets.data();      numCorners[2] = 4;
+    indices[3] = (const int *)mesh.pyrs.data();      numCorners[3] = 5;
+    indices[4] = (const int *)mesh.wedges.data();    numCorners[4] = 6;
+    indices[5] = (const int *)mesh.hexes.data();     numCorners[5] = 8;
+    begin[0] = 0;
+    for (int k=0;k<numArrays;k++)
+      begin[k+1] = begin[k]+counts[k];
+  }
+
+  /*! calls lambda(k,begin,end) for blocks [begin,end) of (array-local)
+      element indices, for all element arrays, in parallel */
+  template<typename Lambda>
+  inline void forEachElementBlock(const ElementList &elements, const Lambda &lambda)
+  {
+    for (int k=0;k<ElementList::numArrays;k++)
+      parallel_for_blocked(0,elements.count(k),attributeBlockSize,
+                           [&](size_t begin, size_t end){ lambda(k,begin,end); });
+  }
+
+  // ==================================================================
+  // element volumes (and areas)
+  // ==================================================================
+
+  /*! faces of the volume elements, as indices into the element's
+      (VTK-ordered) corners, all consistently oriented; -1 marks
+      unused slots */
+  const int tetFaces[4][4]
+  = { { 0,1,3,-1 },{ 1,2,3,-1 },{ 2,0,3,-1 },{ 0,2,1,-1 } };
+  const int pyrFaces[5][4]
+  = { { 0,3,2,1 },{ 0,1,4,-1 },{ 1,2,4,-1 },{ 2,3,4,-1 },{ 3,0,4,-1 } };
+  const int wedgeFaces[5][4]
+  = { { 0,1,2,-1 },{ 3,5,4,-1 },{ 0,3,4,1 },{ 1,4,5,2 },{ 2,5,3,0 } };
+  const int hexFaces[6][4]
+  = { { 0,4,7,3 },{ 1,2,6,5 },{ 0,1,5,4 },{ 3,7,6,2 },{ 0,3,2,1 },{ 4,5,6,7 } };
+
+  /*! six times the signed volume of tet (a,b,c,d), in double precision */
+  inline double signedVolume6(const vec3f &a, const vec3f &b,
+                              const vec3f &c, const vec3f &d)
+  {
+    const double bx = b.x-a.x, by = b.y-a.y, bz = b.z-a.z;
+    const double cx = c.x-a.x, cy = c.y-a.y, cz = c.z-a.z;
+    const double dx = d.x-a.x, dy = d.y-a.y, dz = d.z-a.z;
+    return bx*(cy*dz-cz*dy) - by*(cx*dz-cz*dx) + bz*(cx*dy-cy*dx);
+  }
+
+  /*! twice the area of triangle (a,b,c), in double precision */
+  inline double area2(const vec3f &a, const vec3f &b, const vec3f &c)
+  {
+    const double bx = b.x-a.x, by = b.y-a.y, bz = b.z-a.z;
+    const double cx = c.x-a.x, cy = c.y-a.y, cz = c.z-a.z;
+    const double nx = by*cz-bz*cy, ny = bz*cx-bx*cz, nz = bx*cy-by*cx;
+    return sqrt(nx*nx+ny*ny+nz*nz);
+  }
+
+  inline vec3f centroid(const std::vector<vec3f> &vertices,
+                        const int *idx, int N)
+  {
+    vec3f sum(0.f);
+    for (int i=0;i<N;i++) sum = sum + vertices[idx[i]];
+    return sum * (1.f/N);
+  }
+
+  /*! volume of a volume element, computed by connecting the
+      element's centroid with the triangles that fan each face around
+      its own centroid; exact for planar faces, and a reasonable
+      approximation for bilinear ones */
+  template<int numFaces>
+  inline double elementVolume(const std::vector<vec3f> &vertices,
+                              const int *idx, int numCorners,
+                              const int (&faces)[numFaces][4])
+  {
+    const vec3f center = centroid(vertices,idx,numCorners);
+    double sum = 0.;
+    for (int f=0;f<numFaces;f++) {
+      const int N = faces[f][3] < 0 ? 3 : 4;
+      int faceIdx[4];
+      for (int j=0;j<N;j++) faceIdx[j] = idx[faces[f][j]];
+      const vec3f faceCenter = centroid(vertices,faceIdx,N);
+      for (int j=0;j<N;j++)
+        sum += signedVolume6(center,
+                             vertices[faceIdx[j]],
+                             vertices[faceIdx[(j+1)%N]],
+                             faceCenter);
+    }
+    return fabs(sum)/6.;
+  }
+
+  /*! the weight an element gets for volume-weighted averaging: its
+      volume, or - for surface elements - its area */
+  inline double elementWeight(const std::vector<vec3f> &vertices,
+                              int k, const int *idx)
+  {
+    switch (k) {
+    case UMesh::TRI:
+      return .5*area2(vertices[idx[0]],vertices[idx[1]],vertices[idx[2]]);
+    case UMesh::QUAD: {
+      const vec3f center = centroid(vertices,idx,4);
+      double sum = 0.;
+      for (int j=0;j<4;j++)
+        sum += area2(center,vertices[idx[j]],vertices[idx[(j+1)%4]]);
+      return .5*sum;
+    }
+    case UMesh::TET:   return elementVolume(vertices,idx,4,tetFaces);
+    case UMesh::PYR:   return elementVolume(vertices,idx,5,pyrFaces);
+    case UMesh::WEDGE: return elementVolume(vertices,idx,6,wedgeFaces);
+    case UMesh::HEX:   return elementVolume(vertices,idx,8,hexFaces);
+    default:
+      throw std::runtime_error("#umesh: invalid element type");
+    }
+  }
+
+  // ==================================================================
+  // cell to vertex
+  // ==================================================================
+
+  /*! builds, for each vertex, the (sorted) list of elements using it,
+      in CSR form: vertex v's elements are
+      adjacency[offsets[v]..offsets[v+1]). An element that uses the
+      same vertex more than once (eg, a collapsed hex) appears that
+      many times in that vertex's list */
+  template<typename elementID_t>
+  void buildVertexToElement(const ElementList &elements,
+                            size_t numVertices,
+                            std::vector<size_t> &offsets,
+                            std::vector<elementID_t> &adjacency)
+  {
+    // count number of element corners referencing each vertex
+    std::vector<std::atomic<size_t>> cursor(numVertices);
+    parallel_for_blocked(0,numVertices,attributeBlockSize,[&](size_t begin, size_t end){
+        for (size_t v=begin;v<end;v++)
+          cursor[v].store(0,std::memory_order_relaxed);
+      });
+    std::atomic<bool> invalidIndex(false);
+    forEachElementBlock(elements,[&](int k, size_t begin, size_t end){
+        const int N = elements.numCorners[k];
+        for (size_t i=begin;i<end;i++) {
+          const int *idx = elements.corners(k,i);
+          for (int c=0;c<N;c++) {
+            if (idx[c] < 0 || (size_t)idx[c] >= numVertices)
+              { invalidIndex = true; return; }
+            cursor[idx[c]].fetch_add(1,std::memory_order_relaxed);
+          }
+        }
+      });
+    if (invalidIndex)
+      throw std::runtime_error("#umesh: element with invalid vertex index");
+
+    // exclusive prefix sum over the counts, in blocks: sum up each
+    // block, scan the (few) block sums, then scan within blocks
+    const size_t numBlocks = divRoundUp(numVertices,attributeBlockSize);
+    std::vector<size_t> blockBegin(numBlocks+1,0);
+    parallel_for(numBlocks,[&](size_t block){
+        const size_t begin = block*attributeBlockSize;
+        const size_t end   = std::min(numVertices,begin+attributeBlockSize);
+        size_t sum = 0;
+        for (size_t v=begin;v<end;v++)
+          sum += cursor[v].load(std::memory_order_relaxed);
+        blockBegin[block+1] = sum;
+      });
+    for (size_t block=0;block<numBlocks;block++)
+      blockBegin[block+1] += blockBegin[block];
+    offsets.resize(numVertices+1);
+    offsets[numVertices] = blockBegin[numBlocks];
+    parallel_for(numBlocks,[&](size_t block){
+        const size_t begin = block*attributeBlockSize;
+        const size_t end   = std::min(numVertices,begin+attributeBlockSize);
+        size_t offset = blockBegin[block];
+        for (size_t v=begin;v<end;v++) {
+          const size_t count = cursor[v].load(std::memory_order_relaxed);
+          offsets[v] = offset;
+          cursor[v].store(offset,std::memory_order_relaxed);
+          offset += count;
+        }
+      });
+
+    // fill in each vertex's elements, then sort them, so the result
+    // does not depend on the order in which threads got there
+    adjacency.resize(offsets[numVertices]);
+    forEachElementBlock(elements,[&](int k, size_t begin, size_t end){
+        const int N = elements.numCorners[k];
+        for (size_t i=begin;i<end;i++) {
+          const int *idx = elements.corners(k,i);
+          const elementID_t elementID = elementID_t(elements.begin[k]+i);
+          for (int c=0;c<N;c++)
+            adjacency[cursor[idx[c]].fetch_add(1,std::memory_order_relaxed)]
+              = elementID;
+        }
+      });
+    parallel_for_blocked(0,numVertices,attributeBlockSize,[&](size_t begin, size_t end){
+        for (size_t v=begin;v<end;v++)
+          std::sort(adjacency.begin()+offsets[v],adjacency.begin()+offsets[v+1]);
+      });
+  }
+
+  template<typename elementID_t>
+  void cellToVertexT(const ElementList &elements,
+                     size_t numVertices,
+                     const float *cellValues,
+                     const double *weights,
+                     float *vertexValues)
+  {
+    std::vector<size_t>      offsets;
+    std::vector<elementID_t> adjacency;
+    buildVertexToElement(elements,numVertices,offsets,adjacency);
+    parallel_for_blocked(0,numVertices,attributeBlockSize,[&](size_t blockBegin, size_t blockEnd){
+        for (size_t v=blockBegin;v<blockEnd;v++) {
+          const size_t begin = offsets[v], end = offsets[v+1];
+          double sum = 0., sumWeights = 0.;
+          if (weights)
+            for (size_t j=begin;j<end;j++) {
+              sum        += weights[adjacency[j]]*cellValues[adjacency[j]];
+              sumWeights += weights[adjacency[j]];
+            }
+          if (sumWeights == 0.) {
+            // no weights, or only degenerate elements: plain average
+            sum = 0.;
+            for (size_t j=begin;j<end;j++)
+              sum += cellValues[adjacency[j]];
+            sumWeights = double(end-begin);
+          }
+          vertexValues[v] = (end > begin) ? float(sum/sumWeights) : 0.f;
+        }
+      });
+  }
+
+  /*! computes a per-vertex attribute from the given per-element one
+      (which needs one value per element of the mesh, in global
+      element order), by averaging - optionally volume-weighted - the
+      values of all elements that use the respective vertex */
+  Attribute::SP cellToVertex(UMesh::SP mesh,
+                             Attribute::SP perElement,
+                             CellToVertexWeighting weighting)
+  {
+    if (!mesh) throw std::runtime_error("#umesh: null input mesh");
+    if (!perElement) throw std::runtime_error("#umesh: null per-element attribute");
+    const ElementList elements(*mesh);
+    if (perElement->values.size() != elements.size())
+      throw std::runtime_error("#umesh: number of per-element values does not"
+                               " match number of elements");
+
+    std::vector<double> weights;
+    if (weighting == CELL_VOLUME_WEIGHTED) {
+      weights.resize(elements.size());
+      forEachElementBlock(elements,[&](int k, size_t begin, size_t end){
+          for (size_t i=begin;i<end;i++)
+            weights[elements.begin[k]+i]
+              = elementWeight(mesh->vertices,k,elements.corners(k,i));
+        });
+    }
+
+    const size_t numVertices = mesh->vertices.size();
+    Attribute::SP result = std::make_shared<Attribute>();
+    result->name = perElement->name;
+    result->values.resize(numVertices);
+    const double *weightsPtr = weights.empty() ? nullptr : weights.data();
+    if (elements.size() < (size_t)std::numeric_limits<uint32_t>::max())
+      cellToVertexT<uint32_t>(elements,numVertices,perElement->values.data(),
+                              weightsPtr,result->values.data());
+    else
+      cellToVertexT<uint64_t>(elements,numVertices,perElement->values.data(),
+                              weightsPtr,result->values.data());
+    result->finalize();
+    return result;
+  }
+
+  // ==================================================================
+  // vertex to cell
+  // ==================================================================
+
+  /*! computes a per-element attribute (in global element order) from
+      the given per-vertex one, by taking the mean, min, or max of
+      each element's vertex values */
+  Attribute::SP vertexToCell(UMesh::SP mesh,
+                             Attribute::SP perVertex,
+                             VertexToCellReduction reduction)
+  {
+    if (!mesh) throw std::runtime_error("#umesh: null input mesh");
+    if (!perVertex) throw std::runtime_error("#umesh: null per-vertex attribute");
+    const size_t numVertices = mesh->vertices.size();
+    if (perVertex->values.size() != numVertices)
+      throw std::runtime_error("#umesh: number of per-vertex values does not"
+                               " match number of vertices");
+    const ElementList elements(*mesh);
+    const float *vertexValues = perVertex->values.data();
+
+    Attribute::SP result = std::make_shared<Attribute>();
+    result->name = perVertex->name;
+    result->values.resize(elements.size());
+    std::atomic<bool> invalidIndex(false);
+    forEachElementBlock(elements,[&](int k, size_t begin, size_t end){
+        const int N = elements.numCorners[k];
+        float *out = result->values.data()+elements.begin[k];
+        for (size_t i=begin;i<end;i++) {
+          const int *idx = elements.corners(k,i);
+          for (int c=0;c<N;c++)
+            if (idx[c] < 0 || (size_t)idx[c] >= numVertices)
+              { invalidIndex = true; return; }
+          switch (reduction) {
+          case VERTEX_MIN: {
+            float value = vertexValues[idx[0]];
+            for (int c=1;c<N;c++) value = std::min(value,vertexValues[idx[c]]);
+            out[i] = value;
+          } break;
+          case VERTEX_MAX: {
+            float value = vertexValues[idx[0]];
+            for (int c=1;c<N;c++) value = std::max(value,vertexValues[idx[c]]);
+            out[i] = value;
+          } break;
+          default: {
+            double sum = 0.;
+            for (int c=0;c<N;c++) sum += vertexValues[idx[c]];
+            out[i] = float(sum/N);
+          }
+          }
+        }
+      });
+    if (invalidIndex)
+      throw std::runtime_error("#umesh: element with invalid vertex index");
+    result->finalize();
+    return result;
+  }
+
+} // ::umesh
@@ -0,0 +1,72 @@
+// ======================================================================== //
+// Copyright 2018-2020 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+
+#pragma once
+
+#include "umesh/UMesh.h"
+
+/* conversion of scalar fields between per-element (cell-centered)
+   and per-vertex (node-centered) form. Per-element attributes are
+   indexed in the mesh's global element order, ie, first all
+   triangles, then quads, tets, pyramids, wedges, and hexes (see
+   UMesh::perElement) */
+
+namespace umesh {
+
+  /*! how cellToVertex() weighs the values of the elements sharing a
+      vertex */
+  typedef enum {
+    /*! every element using the vertex counts the same */
+    CELL_AVERAGE,
+    /*! every element counts with its volume (or, for triangles and
+        quads, its area) */
+    CELL_VOLUME_WEIGHTED
+  } CellToVertexWeighting;
+
+  /*! how vertexToCell() combines the values of an element's
+      vertices */
+  typedef enum { VERTEX_MEAN, VERTEX_MIN, VERTEX_MAX } VertexToCellReduction;
+
+  /*! computes a per-vertex attribute from the given per-element one
+      (which needs one value per element of the mesh, in global
+      element order), by averaging - optionally volume-weighted - the
+      values of all elements that use the respective vertex. Vertices
+      not used by any element get a value of 0; vertices whose
+      elements all have zero volume get the plain average.
+
+      Rather than scattering each element's value to its vertices
+      (which would need atomics, and make the result depend on the
+      order in which threads get to each vertex), this first builds
+      a vertex-to-element adjacency in CSR form - with parallel
+      counting, prefix sum, and fill - and then computes each
+      vertex's value with a parallel gather over its (sorted) list of
+      elements; results are thus the same no matter how many threads
+      get used. Result has the same name as the input, and is
+      finalized. */
+  Attribute::SP cellToVertex(UMesh::SP mesh,
+                             Attribute::SP perElement,
+                             CellToVertexWeighting weighting = CELL_AVERAGE);
+
+  /*! computes a per-element attribute (in global element order) from
+      the given per-vertex one, by taking the mean, min, or max of
+      each element's vertex values. Result has the same name as the
+      input, and is finalized */
+  Attribute::SP vertexToCell(UMesh::SP mesh,
+                             Attribute::SP perVertex,
+                             VertexToCellReduction reduction = VERTEX_MEAN);
+
+} // ::umesh
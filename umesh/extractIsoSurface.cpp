@@ -15,12 +15,8 @@
 // ======================================================================== //
 
 #include "umesh/extractIsoSurface.h"
-#include <iterator>
-#if UMESH_HAVE_TBB
-# include "tbb/parallel_sort.h"
-#endif
 #include <algorithm>
-#include <string.h>
+#include <atomic>
 
 namespace umesh {
 
@@ -291,214 +287,636 @@ namespace umesh {
       {4,5}, {5,6}, {7,6}, {4,7},
       {0,4}, {1,5}, {3,7}, {2,6}};
 
-  struct FatVertex {
-    vec3f pos;
-    uint32_t idx;
+  /* case tables for tets, pyramids, and wedges, in the same style as
+     the (VTK) marching cubes tables above: bit 'i' of the case index
+     is set if vertex 'i' (in VTK vertex order) is above the
+     iso-value, and each case lists triangles as triplets of edge IDs
+     (into the respective xxxEdges[] table), terminated by -1.
+
+     These were generated by intersecting each face of the element
+     with the iso-surface, chaining the resulting segments into
+     closed loops, and triangulating each loop (never using a
+     diagonal that would run along one of the element's faces). Quad
+     faces with two diagonally opposite above-iso vertices are
+     resolved by always separating the above-iso vertices - which is
+     the same rule the VTK hex table uses, so faces shared between
+     different element types will always get cut the same way (ie, no
+     cracks). Triangles are oriented the same way as in the MC table,
+     with the normal pointing from the above-iso side to the
+     below-iso side. */
+  
+  const int8_t marchingTetEdges[6][2]
+  = { {0,1}, {1,2}, {2,0}, {0,3}, {1,3}, {2,3} };
+
+  const int8_t marchingPyrEdges[8][2]
+  = { {0,1}, {1,2}, {2,3}, {3,0},
+      {0,4}, {1,4}, {2,4}, {3,4} };
+
+  const int8_t marchingWedgeEdges[9][2]
+  = { {0,1}, {1,2}, {2,0},
+      {3,4}, {4,5}, {5,3},
+      {0,3}, {1,4}, {2,5} };
+
+  const int8_t marchingTetCases[16][7]
+  = {
+     {-1, -1, -1, -1, -1, -1, -1}, /* 0 */
+     { 0,  2,  3, -1, -1, -1, -1}, /* 1 */
+     { 0,  4,  1, -1, -1, -1, -1}, /* 2 */
+     { 1,  2,  4,  2,  3,  4, -1}, /* 3 */
+     { 1,  5,  2, -1, -1, -1, -1}, /* 4 */
+     { 0,  1,  3,  1,  5,  3, -1}, /* 5 */
+     { 0,  4,  5,  0,  5,  2, -1}, /* 6 */
+     { 3,  4,  5, -1, -1, -1, -1}, /* 7 */
+     { 3,  5,  4, -1, -1, -1, -1}, /* 8 */
+     { 0,  2,  4,  2,  5,  4, -1}, /* 9 */
+     { 0,  3,  5,  0,  5,  1, -1}, /* 10 */
+     { 1,  2,  5, -1, -1, -1, -1}, /* 11 */
+     { 1,  4,  3,  1,  3,  2, -1}, /* 12 */
+     { 0,  1,  4, -1, -1, -1, -1}, /* 13 */
+     { 0,  3,  2, -1, -1, -1, -1}, /* 14 */
+     {-1, -1, -1, -1, -1, -1, -1} /* 15 */
   };
 
-  struct FatVertexCompare {
-    inline bool operator()(const FatVertex &a, const FatVertex &b) const
-    {
-      return memcmp(&a,&b,sizeof(a)) < 0; // a.pos < b.pos;
-    }
+  const int8_t marchingPyrCases[32][13]
+  = {
+     {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, /* 0 */
+     { 0,  3,  4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, /* 1 */
+     { 0,  5,  1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, /* 2 */
+     { 1,  3,  5,  3,  4,  5, -1, -1, -1, -1, -1, -1, -1}, /* 3 */
+     { 1,  6,  2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, /* 4 */
+     { 0,  3,  4,  1,  6,  2, -1, -1, -1, -1, -1, -1, -1}, /* 5 */
+     { 0,  5,  6,  0,  6,  2, -1, -1, -1, -1, -1, -1, -1}, /* 6 */
+     { 2,  3,  6,  3,  4,  5,  3,  5,  6, -1, -1, -1, -1}, /* 7 */
+     { 2,  7,  3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, /* 8 */
+     { 0,  2,  4,  2,  7,  4, -1, -1, -1, -1, -1, -1, -1}, /* 9 */
+     { 0,  5,  1,  2,  7,  3, -1, -1, -1, -1, -1, -1, -1}, /* 10 */
+     { 1,  2,  5,  2,  7,  4,  2,  4,  5, -1, -1, -1, -1}, /* 11 */
+     { 1,  6,  7,  1,  7,  3, -1, -1, -1, -1, -1, -1, -1}, /* 12 */
+     { 0,  1,  4,  1,  6,  7,  1,  7,  4, -1, -1, -1, -1}, /* 13 */
+     { 0,  5,  6,  0,  6,  7,  0,  7,  3, -1, -1, -1, -1}, /* 14 */
+     { 4,  5,  7,  5,  6,  7, -1, -1, -1, -1, -1, -1, -1}, /* 15 */
+     { 4,  7,  6,  4,  6,  5, -1, -1, -1, -1, -1, -1, -1}, /* 16 */
+     { 0,  3,  5,  3,  7,  6,  3,  6,  5, -1, -1, -1, -1}, /* 17 */
+     { 0,  4,  7,  0,  7,  6,  0,  6,  1, -1, -1, -1, -1}, /* 18 */
+     { 1,  3,  6,  3,  7,  6, -1, -1, -1, -1, -1, -1, -1}, /* 19 */
+     { 1,  5,  4,  1,  4,  7,  1,  7,  2, -1, -1, -1, -1}, /* 20 */
+     { 0,  3,  5,  3,  7,  5,  2,  5,  7,  1,  5,  2, -1}, /* 21 */
+     { 0,  4,  7,  0,  7,  2, -1, -1, -1, -1, -1, -1, -1}, /* 22 */
+     { 2,  3,  7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, /* 23 */
+     { 2,  6,  5,  2,  5,  4,  2,  4,  3, -1, -1, -1, -1}, /* 24 */
+     { 0,  2,  5,  2,  6,  5, -1, -1, -1, -1, -1, -1, -1}, /* 25 */
+     { 3,  6,  4,  0,  4,  6,  2,  6,  3,  0,  6,  1, -1}, /* 26 */
+     { 1,  2,  6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, /* 27 */
+     { 1,  5,  4,  1,  4,  3, -1, -1, -1, -1, -1, -1, -1}, /* 28 */
+     { 0,  1,  5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, /* 29 */
+     { 0,  4,  3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, /* 30 */
+     {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1} /* 31 */
+  };
+
+  const int8_t marchingWedgeCases[64][13]
+  = {
+     {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, /* 0 */
+     { 0,  6,  2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, /* 1 */
+     { 0,  1,  7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, /* 2 */
+     { 1,  7,  6,  1,  6,  2, -1, -1, -1, -1, -1, -1, -1}, /* 3 */
+     { 1,  2,  8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, /* 4 */
+     { 0,  6,  8,  0,  8,  1, -1, -1, -1, -1, -1, -1, -1}, /* 5 */
+     { 0,  2,  7,  2,  8,  7, -1, -1, -1, -1, -1, -1, -1}, /* 6 */
+     { 6,  8,  7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, /* 7 */
+     { 3,  5,  6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, /* 8 */
+     { 0,  3,  5,  0,  5,  2, -1, -1, -1, -1, -1, -1, -1}, /* 9 */
+     { 0,  1,  7,  3,  5,  6, -1, -1, -1, -1, -1, -1, -1}, /* 10 */
+     { 1,  7,  3,  2,  3,  5,  1,  3,  2, -1, -1, -1, -1}, /* 11 */
+     { 1,  2,  8,  3,  5,  6, -1, -1, -1, -1, -1, -1, -1}, /* 12 */
+     { 0,  3,  5,  0,  5,  8,  0,  8,  1, -1, -1, -1, -1}, /* 13 */
+     { 0,  2,  7,  2,  8,  7,  3,  5,  6, -1, -1, -1, -1}, /* 14 */
+     { 3,  5,  7,  5,  8,  7, -1, -1, -1, -1, -1, -1, -1}, /* 15 */
+     { 3,  7,  4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, /* 16 */
+     { 0,  6,  2,  3,  7,  4, -1, -1, -1, -1, -1, -1, -1}, /* 17 */
+     { 0,  1,  3,  1,  4,  3, -1, -1, -1, -1, -1, -1, -1}, /* 18 */
+     { 3,  6,  4,  1,  4,  6,  1,  6,  2, -1, -1, -1, -1}, /* 19 */
+     { 1,  2,  8,  3,  7,  4, -1, -1, -1, -1, -1, -1, -1}, /* 20 */
+     { 0,  6,  8,  0,  8,  1,  3,  7,  4, -1, -1, -1, -1}, /* 21 */
+     { 0,  2,  3,  2,  8,  3,  3,  8,  4, -1, -1, -1, -1}, /* 22 */
+     { 3,  6,  8,  3,  8,  4, -1, -1, -1, -1, -1, -1, -1}, /* 23 */
+     { 4,  5,  7,  5,  6,  7, -1, -1, -1, -1, -1, -1, -1}, /* 24 */
+     { 0,  7,  4,  0,  4,  5,  0,  5,  2, -1, -1, -1, -1}, /* 25 */
+     { 0,  1,  6,  1,  4,  6,  4,  5,  6, -1, -1, -1, -1}, /* 26 */
+     { 1,  4,  5,  1,  5,  2, -1, -1, -1, -1, -1, -1, -1}, /* 27 */
+     { 1,  2,  8,  4,  5,  7,  5,  6,  7, -1, -1, -1, -1}, /* 28 */
+     { 0,  7,  4,  0,  4,  5,  0,  5,  8,  0,  8,  1, -1}, /* 29 */
+     { 0,  2,  4,  0,  4,  6,  2,  8,  4,  4,  5,  6, -1}, /* 30 */
+     { 4,  5,  8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, /* 31 */
+     { 4,  8,  5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, /* 32 */
+     { 0,  6,  2,  4,  8,  5, -1, -1, -1, -1, -1, -1, -1}, /* 33 */
+     { 0,  1,  7,  4,  8,  5, -1, -1, -1, -1, -1, -1, -1}, /* 34 */
+     { 1,  7,  6,  1,  6,  2,  4,  8,  5, -1, -1, -1, -1}, /* 35 */
+     { 1,  2,  4,  2,  5,  4, -1, -1, -1, -1, -1, -1, -1}, /* 36 */
+     { 4,  6,  5,  1,  6,  4,  0,  6,  1, -1, -1, -1, -1}, /* 37 */
+     { 0,  2,  5,  0,  5,  7,  4,  7,  5, -1, -1, -1, -1}, /* 38 */
+     { 4,  7,  6,  4,  6,  5, -1, -1, -1, -1, -1, -1, -1}, /* 39 */
+     { 3,  4,  6,  4,  8,  6, -1, -1, -1, -1, -1, -1, -1}, /* 40 */
+     { 2,  3,  4,  0,  3,  2,  2,  4,  8, -1, -1, -1, -1}, /* 41 */
+     { 0,  1,  7,  3,  4,  6,  4,  8,  6, -1, -1, -1, -1}, /* 42 */
+     { 1,  7,  3,  2,  3,  4,  1,  3,  2,  2,  4,  8, -1}, /* 43 */
+     { 1,  2,  6,  1,  6,  4,  3,  4,  6, -1, -1, -1, -1}, /* 44 */
+     { 0,  3,  4,  0,  4,  1, -1, -1, -1, -1, -1, -1, -1}, /* 45 */
+     { 0,  2,  4,  0,  4,  7,  2,  6,  4,  3,  4,  6, -1}, /* 46 */
+     { 3,  4,  7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, /* 47 */
+     { 3,  7,  8,  3,  8,  5, -1, -1, -1, -1, -1, -1, -1}, /* 48 */
+     { 0,  6,  2,  3,  7,  8,  3,  8,  5, -1, -1, -1, -1}, /* 49 */
+     { 0,  1,  5,  0,  5,  3,  1,  8,  5, -1, -1, -1, -1}, /* 50 */
+     { 1,  8,  5,  1,  5,  3,  1,  3,  6,  1,  6,  2, -1}, /* 51 */
+     { 1,  2,  7,  2,  5,  3,  2,  3,  7, -1, -1, -1, -1}, /* 52 */
+     { 1,  6,  5,  0,  6,  1,  1,  5,  3,  1,  3,  7, -1}, /* 53 */
+     { 0,  2,  3,  2,  5,  3, -1, -1, -1, -1, -1, -1, -1}, /* 54 */
+     { 3,  6,  5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, /* 55 */
+     { 6,  7,  8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, /* 56 */
+     { 0,  7,  8,  0,  8,  2, -1, -1, -1, -1, -1, -1, -1}, /* 57 */
+     { 0,  1,  6,  1,  8,  6, -1, -1, -1, -1, -1, -1, -1}, /* 58 */
+     { 1,  8,  2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, /* 59 */
+     { 1,  2,  7,  2,  6,  7, -1, -1, -1, -1, -1, -1, -1}, /* 60 */
+     { 0,  7,  1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, /* 61 */
+     { 0,  2,  6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, /* 62 */
+     {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1} /* 63 */
+  };
+
+  /*! selects the right case- and edge-tables for each element type */
+  template<typename Prim> struct IsoTables;
+  template<> struct IsoTables<Tet> {
+    static constexpr const auto &cases = marchingTetCases;
+    static constexpr const auto &edges = marchingTetEdges;
+  };
+  template<> struct IsoTables<Pyr> {
+    static constexpr const auto &cases = marchingPyrCases;
+    static constexpr const auto &edges = marchingPyrEdges;
+  };
+  template<> struct IsoTables<Wedge> {
+    static constexpr const auto &cases = marchingWedgeCases;
+    static constexpr const auto &edges = marchingWedgeEdges;
+  };
+  template<> struct IsoTables<Hex> {
+    static constexpr const auto &cases = vtkMarchingCubesTriangleCases;
+    static constexpr const auto &edges = vtkMarchingCubes_edges;
   };
   
-  /*! run marhing-cubes on given 8-vertex hexahedraon, in VTK vertex
-      ordering; and write every potentially gnerated triangle into the
-      'out' array, using three full vertices for each triangle (we'll
-      worry about vertex indexing later on */
-  void process(std::vector<FatVertex> &out,
-               const vec4f vertex[8],
-               const float isoValue)
+  /*! every vertex of the iso-surface lies on an edge of the input
+      mesh, and is thus uniquely identified by the (sorted) pair of
+      input vertex IDs spanning this edge - no matter which element
+      (or which of the element's triangles) produced it. If one of
+      the two vertices lies exactly on the iso-value the surface
+      vertex _is_ that input vertex, so we snap to key (v,v) - that
+      way all edges meeting in that vertex produce the same key */
+  inline uint64_t edgeKey(uint32_t v0, float w0,
+                          uint32_t v1, float w1,
+                          const float isoValue)
+  {
+    if (w0 == isoValue) v1 = v0;
+    else if (w1 == isoValue) v0 = v1;
+    else if (v0 > v1) std::swap(v0,v1);
+    return (uint64_t(v0) << 32) | uint64_t(v1);
+  }
+
+  /*! computes the marching-xyz case index for an element with given
+      vertex values: bit 'i' is set if vertex 'i' is above the
+      iso-value */
+  template<int N>
+  inline int caseIndex(const float (&value)[N], const float isoValue)
   {
     int index = 0;
-    for (int i=0;i<8;i++)
-      if (vertex[i].w > isoValue)
-        index += (1<<i);
-    if (index == 0 || index == 0xff) return;
+    for (int i=0;i<N;i++)
+      index |= int(value[i] > isoValue) << i;
+    return index;
+  }
+  
+  /*! run the marching-xyz case table for given element type on the
+      given element (with given per-vertex values, and given case
+      index as computed by caseIndex()), and call 'emit(k0,k1,k2)'
+      with the edge keys of every non-degenerate triangle
+      generated. Only looks at scalars, never at vertex positions */
+  template<typename Prim, typename EmitTriangle>
+  inline void marchElement(const Prim &prim,
+                           const float (&value)[Prim::numVertices],
+                           const int index,
+                           const float isoValue,
+                           const EmitTriangle &emit)
+  {
+    enum { N = Prim::numVertices };
+    if (index == 0 || index == (1<<N)-1) return;
 
-    for (const int8_t *edge = &vtkMarchingCubesTriangleCases[index][0];
+    for (const int8_t *edge = &IsoTables<Prim>::cases[index][0];
          edge[0] > -1;
          edge += 3 ) {
-      vec3f triVertex[3];
+      uint64_t key[3];
       for (int ii=0; ii<3; ii++) {
-        const int8_t *vert = vtkMarchingCubes_edges[edge[ii]];
-        const vec4f v0 = ((vertex[vert[0]]));
-        const vec4f v1 = ((vertex[vert[1]]));
-        const double t
-          = (v1.w == v0.w)
-          ? 0.f
-          : ((isoValue - v0.w) / double(v1.w - v0.w));
-        // do this explicitly in doubles here:
-        triVertex[ii].x = float((1.f-t)*v0.x+t*v1.x);
-        triVertex[ii].y = float((1.f-t)*v0.y+t*v1.y);
-        triVertex[ii].z = float((1.f-t)*v0.z+t*v1.z);
+        const int8_t *vert = IsoTables<Prim>::edges[edge[ii]];
+        key[ii] = edgeKey(prim[vert[0]],value[vert[0]],
+                          prim[vert[1]],value[vert[1]],
+                          isoValue);
       }
-      
-      if (triVertex[1] == triVertex[0]) continue;
-      if (triVertex[2] == triVertex[0]) continue;
-      if (triVertex[1] == triVertex[2]) continue;
-      
-      for (int j=0;j<3;j++)
-        out.push_back({triVertex[j],0});
+      if (key[1] == key[0]) continue;
+      if (key[2] == key[0]) continue;
+      if (key[1] == key[2]) continue;
+      emit(key[0],key[1],key[2]);
     }
   }
 
-  /*! blow a tet up into a hex (by replicating vertices), then run MC
-      tables on that hex */
-  void process(std::vector<FatVertex> &out,
-               UMesh::SP in,
-               const UMesh::Tet &tet,
-               const float isoValue)
-  {
-    const vec4f a(in->vertices[tet.x],in->perVertex->values[tet.x]);
-    const vec4f b(in->vertices[tet.y],in->perVertex->values[tet.y]);
-    const vec4f c(in->vertices[tet.z],in->perVertex->values[tet.z]);
-    const vec4f d(in->vertices[tet.w],in->perVertex->values[tet.w]);
-    vec4f asHex[8] = { a,b,c,c, d,d,d,d };
-#if 0
-    float lo = min(min(a.w,b.w),min(c.w,d.w));
-    float hi = max(max(a.w,b.w),max(c.w,d.w));
-    if (isoValue >= lo && isoValue <= hi) {
-      out.push_back({vec3f(a),0});
-      out.push_back({vec3f(b),0});
-      out.push_back({vec3f(c),0});
-
-      out.push_back({vec3f(a),0});
-      out.push_back({vec3f(b),0});
-      out.push_back({vec3f(d),0});
-
-      out.push_back({vec3f(a),0});
-      out.push_back({vec3f(c),0});
-      out.push_back({vec3f(d),0});
-
-      out.push_back({vec3f(b),0});
-      out.push_back({vec3f(c),0});
-      out.push_back({vec3f(d),0});
+  /*! the set of iso-surfaces to extract in one pass over the
+      elements: one surface for each combination of scalar field and
+      iso-value, with surface 'f*isoValues.size()+k' being the one
+      for field 'f' and iso-value 'k' */
+  struct IsoJobs {
+    std::vector<const float *> fields;
+    std::vector<float>         isoValues;
+    
+    size_t size() const { return fields.size()*isoValues.size(); }
+
+    /*! calls 'emit(jobID,k0,k1,k2)' for every triangle that any of
+        the jobs generates for the given element. For each field the
+        element's values get gathered only once, and the case indices
+        for all iso-values get computed in one tight (and
+        vectorizable) loop before marching any of them */
+    template<typename Prim, typename EmitTriangle>
+    inline void march(const Prim &prim,
+                      int *cases,
+                      const EmitTriangle &emit) const
+    {
+      enum { N = Prim::numVertices };
+      const size_t numIsoValues = isoValues.size();
+      for (size_t f=0;f<fields.size();f++) {
+        float value[N];
+        for (int i=0;i<N;i++)
+          value[i] = fields[f][prim[i]];
+        for (size_t k=0;k<numIsoValues;k++)
+          cases[k] = caseIndex(value,isoValues[k]);
+        for (size_t k=0;k<numIsoValues;k++) {
+          if (cases[k] == 0 || cases[k] == (1<<N)-1) continue;
+          const size_t jobID = f*numIsoValues+k;
+          marchElement(prim,value,cases[k],isoValues[k],
+                       [&](uint64_t k0, uint64_t k1, uint64_t k2)
+                       { emit(jobID,k0,k1,k2); });
+        }
+      }
     }
-#else
-    process(out,asHex,isoValue);
-#endif
-  }
+  };
 
-  /*! blow a pyr up into a hex (by replicating vertices), then run MC
-      tables on that hex */
-  void process(std::vector<FatVertex> &out,
-               UMesh::SP in,
-               const UMesh::Pyr &pyr,
-               const float isoValue)
-  {
-    const vec4f v0(in->vertices[pyr[0]],in->perVertex->values[pyr[0]]);
-    const vec4f v1(in->vertices[pyr[1]],in->perVertex->values[pyr[1]]);
-    const vec4f v2(in->vertices[pyr[2]],in->perVertex->values[pyr[2]]);
-    const vec4f v3(in->vertices[pyr[3]],in->perVertex->values[pyr[3]]);
-    const vec4f v4(in->vertices[pyr[4]],in->perVertex->values[pyr[4]]);
-    vec4f asHex[8] = { v0,v1,v2,v3, v4,v4,v4,v4 };
-    process(out,asHex,isoValue);
-  }
-  
-  /*! blow a wedge up into a hex (by replicating vertices), then run MC
-      tables on that hex */
-  void process(std::vector<FatVertex> &out,
-               UMesh::SP in,
-               const UMesh::Wedge &wedge,
-               const float isoValue)
-  {
-    const vec4f v0(in->vertices[wedge[0]],in->perVertex->values[wedge[0]]);
-    const vec4f v1(in->vertices[wedge[1]],in->perVertex->values[wedge[1]]);
-    const vec4f v2(in->vertices[wedge[2]],in->perVertex->values[wedge[2]]);
-    const vec4f v3(in->vertices[wedge[3]],in->perVertex->values[wedge[3]]);
-    const vec4f v4(in->vertices[wedge[4]],in->perVertex->values[wedge[4]]);
-    const vec4f v5(in->vertices[wedge[5]],in->perVertex->values[wedge[5]]);
-    vec4f asHex[8] = { v0,v1,v4,v3,v2,v2,v5,v5 };
-    process(out,asHex,isoValue);
-  }
-  
-  /*! convert our hex representation to 8x{vec3f+scalar}, then run MC
-      tabless */
-  void process(std::vector<FatVertex> &out,
-               UMesh::SP in,
-               const UMesh::Hex &hex,
-               const float isoValue)
-  {
-    const vec4f v0(in->vertices[hex[0]],in->perVertex->values[hex[0]]);
-    const vec4f v1(in->vertices[hex[1]],in->perVertex->values[hex[1]]);
-    const vec4f v2(in->vertices[hex[2]],in->perVertex->values[hex[2]]);
-    const vec4f v3(in->vertices[hex[3]],in->perVertex->values[hex[3]]);
-    const vec4f v4(in->vertices[hex[4]],in->perVertex->values[hex[4]]);
-    const vec4f v5(in->vertices[hex[5]],in->perVertex->values[hex[5]]);
-    const vec4f v6(in->vertices[hex[6]],in->perVertex->values[hex[6]]);
-    const vec4f v7(in->vertices[hex[7]],in->perVertex->values[hex[7]]);
-    vec4f asHex[8] = { v0,v1,v2,v3,v4,v5,v6,v7 };
-    process(out,asHex,isoValue);
-  }
-  
-  void doIsoSurfacePyrs(std::vector<FatVertex> &out,
-                        std::mutex &mutex,
-                        UMesh::SP in,
-                        size_t begin,
-                        size_t end,
-                        const float isoValue)
-  {
-    std::vector<FatVertex> localVertices;
-    for (size_t i=begin;i<end;i++)
-      process(localVertices,in,in->pyrs[i],isoValue);
-
-    std::lock_guard<std::mutex> lock(mutex);
-    std::copy(localVertices.begin(),
-              localVertices.end(),
-              std::back_insert_iterator<std::vector<FatVertex>>(out));
-  }
-  
-  void doIsoSurfaceWedges(std::vector<FatVertex> &out,std::mutex &mutex,
-                          UMesh::SP in,
-                          size_t begin,
-                          size_t end,
-                          const float isoValue)
-  {
-    std::vector<FatVertex> localVertices;
-    for (size_t i=begin;i<end;i++)
-      process(localVertices,in,in->wedges[i],isoValue);
-
-    std::lock_guard<std::mutex> lock(mutex);
-    std::copy(localVertices.begin(),
-              localVertices.end(),
-              std::back_insert_iterator<std::vector<FatVertex>>(out));
-  }
-  
-  void doIsoSurfaceHexes(std::vector<FatVertex> &out,std::mutex &mutex,
-                         UMesh::SP in,
-                         size_t begin,
-                         size_t end,
-                         const float isoValue)
+  /*! the set of all volumetric elements in a mesh, cut into blocks
+      of 'blockSize' elements each, with each block containing
+      elements of only one type */
+  struct AllElements {
+    enum { blockSize = 1024 };
+    
+    AllElements(const UMesh &mesh) : mesh(mesh)
+    {
+      firstBlock[0] = 0;
+      firstBlock[1] = firstBlock[0] + divRoundUp(mesh.tets.size(),(size_t)blockSize);
+      firstBlock[2] = firstBlock[1] + divRoundUp(mesh.pyrs.size(),(size_t)blockSize);
+      firstBlock[3] = firstBlock[2] + divRoundUp(mesh.wedges.size(),(size_t)blockSize);
+      firstBlock[4] = firstBlock[3] + divRoundUp(mesh.hexes.size(),(size_t)blockSize);
+    }
+    
+    size_t numBlocks() const { return firstBlock[4]; }
+
+    /*! call 'f(prim)' for every element in given block */
+    template<typename Lambda>
+    void forEach(size_t blockID, const Lambda &f) const
+    {
+      if (blockID < firstBlock[1])
+        forEach(mesh.tets,blockID-firstBlock[0],f);
+      else if (blockID < firstBlock[2])
+        forEach(mesh.pyrs,blockID-firstBlock[1],f);
+      else if (blockID < firstBlock[3])
+        forEach(mesh.wedges,blockID-firstBlock[2],f);
+      else
+        forEach(mesh.hexes,blockID-firstBlock[3],f);
+    }
+    
+    template<typename Prim, typename Lambda>
+    void forEach(const std::vector<Prim> &prims, size_t localBlockID,
+                 const Lambda &f) const
+    {
+      const size_t begin = localBlockID*blockSize;
+      const size_t end   = std::min(begin+blockSize,prims.size());
+      for (size_t i=begin;i<end;i++)
+        f(prims[i]);
+    }
+    
+    const UMesh &mesh;
+    size_t firstBlock[5];
+  };
+
+  /*! an explicit list of elements (eg, those found active by a
+      ValueRangeIndex), cut into blocks of 'blockSize' elements each */
+  struct ElementList {
+    enum { blockSize = 1024 };
+    
+    ElementList(const UMesh &mesh, const std::vector<UMesh::PrimRef> &prims)
+      : mesh(mesh), prims(prims)
+    {}
+    
+    size_t numBlocks() const { return divRoundUp(prims.size(),(size_t)blockSize); }
+
+    /*! call 'f(prim)' for every element in given block */
+    template<typename Lambda>
+    void forEach(size_t blockID, const Lambda &f) const
+    {
+      const size_t begin = blockID*blockSize;
+      const size_t end   = std::min(begin+blockSize,prims.size());
+      for (size_t i=begin;i<end;i++) {
+        const UMesh::PrimRef prim = prims[i];
+        switch (prim.type) {
+        case UMesh::TET:   f(mesh.tets[prim.ID]);   break;
+        case UMesh::PYR:   f(mesh.pyrs[prim.ID]);   break;
+        case UMesh::WEDGE: f(mesh.wedges[prim.ID]); break;
+        case UMesh::HEX:   f(mesh.hexes[prim.ID]);  break;
+        default:
+          throw std::runtime_error("un-supported prim type in iso-surface extraction");
+        }
+      }
+    }
+    
+    const UMesh &mesh;
+    const std::vector<UMesh::PrimRef> &prims;
+  };
+
+  /*! lock-free (open addressing, linear probing) hash table that maps
+      each edge key to the first (ie, lowest-numbered) triangle
+      corner that referenced it. Using the _first_ corner rather than
+      whichever corner happened to get inserted first makes the
+      resulting vertex numbering independent of thread scheduling.
+
+      The table is sized for an expected number of unique keys, and
+      will refuse to take more keys than it can hold with a
+      reasonable fill rate; in that case 'overflow' gets set, and the
+      caller has to retry with a larger table */
+  struct EdgeKeyTable {
+    static const uint64_t EMPTY = ~0ull;
+    
+    EdgeKeyTable(size_t expectedNumKeys)
+    {
+      size_t size = 16;
+      while (size < expectedNumKeys + expectedNumKeys/2) size += size;
+      mask    = size-1;
+      maxKeys = size/2 + size/4;
+      keys.reset(new std::atomic<uint64_t>[size]);
+      firstCorner.reset(new std::atomic<uint64_t>[size]);
+      parallel_for_blocked(0,size,16*1024,[&](size_t begin, size_t end){
+          for (size_t i=begin;i<end;i++) {
+            keys[i].store(EMPTY,std::memory_order_relaxed);
+            firstCorner[i].store(EMPTY,std::memory_order_relaxed);
+          }
+        });
+    }
+
+    static inline uint64_t hash(uint64_t key)
+    {
+      key ^= key >> 33;
+      key *= 0xff51afd7ed558ccdull;
+      key ^= key >> 33;
+      key *= 0xc4ceb9fe1a85ec53ull;
+      key ^= key >> 33;
+      return key;
+    }
+
+    /*! insert given key (if not already present), record given
+        corner for it, and return the slot the key lives in in
+        'slot'. Returns false (and sets 'overflow') if the key is
+        new, but the table is already as full as it is allowed to
+        get */
+    inline bool insert(uint64_t key, uint64_t cornerID, size_t &slot)
+    {
+      slot = hash(key) & mask;
+      while (true) {
+        uint64_t found = keys[slot].load(std::memory_order_relaxed);
+        if (found == EMPTY) {
+          // reserve room for a new key before claiming the slot, so
+          // there always are empty slots to end the probing
+          if (numKeys.fetch_add(1) >= maxKeys) {
+            overflow = true;
+            return false;
+          }
+          if (keys[slot].compare_exchange_strong(found,key))
+            found = key;
+          else
+            numKeys.fetch_sub(1);
+        }
+        if (found == key) break;
+        slot = (slot+1) & mask;
+      }
+      uint64_t current = firstCorner[slot].load(std::memory_order_relaxed);
+      while (cornerID < current &&
+             !firstCorner[slot].compare_exchange_weak(current,cornerID))
+        /* retry */;
+      return true;
+    }
+    
+    std::unique_ptr<std::atomic<uint64_t>[]> keys;
+    std::unique_ptr<std::atomic<uint64_t>[]> firstCorner;
+    size_t mask;
+    size_t maxKeys;
+    std::atomic<size_t> numKeys { 0 };
+    std::atomic<bool>   overflow { false };
+  };
+
+  /*! weld the triangle corners of one iso-surface by edge key
+      (through a lock-free hash table), and create the final vertex
+      and index arrays. 'cornerKey' gets destroyed in the process */
+  UMesh::SP weldIsoSurface(const UMesh &in,
+                           const float *scalars,
+                           const float isoValue,
+                           std::vector<uint64_t> &cornerKey)
   {
-    std::vector<FatVertex> localVertices;
-    for (size_t i=begin;i<end;i++)
-      process(localVertices,in,in->hexes[i],isoValue);
-
-    std::lock_guard<std::mutex> lock(mutex);
-    std::copy(localVertices.begin(),
-              localVertices.end(),
-              std::back_insert_iterator<std::vector<FatVertex>>(out));
+    UMesh::SP out = std::make_shared<UMesh>();
+    const size_t numCorners   = cornerKey.size();
+    const size_t numTriangles = numCorners/3;
+    if (numTriangles == 0) return out;
+    
+    // ------------------------------------------------------------------
+    // weld corners by edge key; from here on each corner stores the
+    // table slot of its key rather than the key itself
+    // ------------------------------------------------------------------
+    if (verbose)
+      std::cout << "#umesh.iso: creating vertex/index arrays ..." << std::endl;
+    const size_t cornerBlockSize = 16*1024;
+    // edge keys are (v0<<32|v1) with non-negative int v0, so bit 63
+    // is free to mark corners that already store a slot
+    const uint64_t slotFlag = 1ull<<63;
+    // interior vertices of a closed triangle mesh are shared by
+    // about six triangles, so start with a table for that many
+    // unique keys, and grow it only if the surface has more (eg, lots
+    // of open boundary)
+    size_t expectedNumKeys = numCorners/6+1;
+    std::unique_ptr<EdgeKeyTable> table;
+    while (true) {
+      table.reset(new EdgeKeyTable(expectedNumKeys));
+      parallel_for_blocked(0,numCorners,cornerBlockSize,[&](size_t begin, size_t end){
+          for (size_t i=begin;i<end;i++) {
+            size_t slot;
+            if (table->insert(cornerKey[i],i,slot))
+              cornerKey[i] = slot | slotFlag;
+            else
+              break;
+          }
+        });
+      if (!table->overflow) break;
+
+      // put back the keys of all corners that did get a slot, and
+      // retry with a larger table
+      parallel_for_blocked(0,numCorners,cornerBlockSize,[&](size_t begin, size_t end){
+          for (size_t i=begin;i<end;i++)
+            if (cornerKey[i] & slotFlag)
+              cornerKey[i] = table->keys[cornerKey[i] & ~slotFlag];
+        });
+      expectedNumKeys = std::min(4*expectedNumKeys,numCorners);
+      if (verbose)
+        std::cout << "#umesh.iso: growing edge key table to "
+                  << prettyNumber(expectedNumKeys) << " keys ..." << std::endl;
+    }
+    parallel_for_blocked(0,numCorners,cornerBlockSize,[&](size_t begin, size_t end){
+        for (size_t i=begin;i<end;i++)
+          cornerKey[i] &= ~slotFlag;
+      });
+
+    // the first corner referencing a key is that key's 'owner'; a
+    // scan over owners gives the (deterministic) vertex IDs
+    const size_t numCornerBlocks = divRoundUp(numCorners,cornerBlockSize);
+    std::vector<size_t> vertexOffset(numCornerBlocks+1,0);
+    parallel_for(numCornerBlocks,[&](size_t blockID){
+        const size_t begin = blockID*cornerBlockSize;
+        const size_t end   = std::min(begin+cornerBlockSize,numCorners);
+        size_t count = 0;
+        for (size_t i=begin;i<end;i++)
+          if (table->firstCorner[cornerKey[i]] == i) ++count;
+        vertexOffset[blockID+1] = count;
+      });
+    for (size_t i=0;i<numCornerBlocks;i++)
+      vertexOffset[i+1] += vertexOffset[i];
+    const size_t numVertices = vertexOffset[numCornerBlocks];
+    if (verbose)
+      std::cout << "#umesh.iso: found " << prettyNumber(numVertices)
+                << " unique vertices ..." << std::endl;
+    
+    /* this assumes that every triangle is three ints - make sure
+       that's the case! */
+    static_assert(sizeof(out->triangles[0]) == 3*sizeof(int),
+                  "make sure nobody changed the fact that triangles "
+                  "are three ints, and nothing but");
+    out->triangles.resize(numTriangles);
+    out->vertices.resize(numVertices);
+    int *index = (int*)out->triangles.data();
+    parallel_for(numCornerBlocks,[&](size_t blockID){
+        const size_t begin = blockID*cornerBlockSize;
+        const size_t end   = std::min(begin+cornerBlockSize,numCorners);
+        size_t vertexID = vertexOffset[blockID];
+        for (size_t i=begin;i<end;i++) {
+          const size_t slot = cornerKey[i];
+          if (table->firstCorner[slot] != i) continue;
+          const uint64_t key = table->keys[slot];
+          const int v0 = int(key >> 32);
+          const int v1 = int(key & 0xffffffffull);
+          const vec3f p0 = in.vertices[v0];
+          const vec3f p1 = in.vertices[v1];
+          const float w0 = scalars[v0];
+          const float w1 = scalars[v1];
+          const double t
+            = (w1 == w0)
+            ? 0.f
+            : ((isoValue - w0) / double(w1 - w0));
+          // do this explicitly in doubles here:
+          vec3f &pos = out->vertices[vertexID];
+          pos.x = float((1.f-t)*p0.x+t*p1.x);
+          pos.y = float((1.f-t)*p0.y+t*p1.y);
+          pos.z = float((1.f-t)*p0.z+t*p1.z);
+          index[i] = int(vertexID++);
+        }
+      });
+    // owners are now done; all other corners copy their owner's ID
+    parallel_for_blocked(0,numCorners,cornerBlockSize,[&](size_t begin, size_t end){
+        for (size_t i=begin;i<end;i++) {
+          const size_t owner = table->firstCorner[cornerKey[i]];
+          if (owner != i) index[i] = index[owner];
+        }
+      });
+    return out;
   }
   
-  void doIsoSurfaceTets(std::vector<FatVertex> &out,
-                        std::mutex &mutex,
-                        UMesh::SP in,
-                        size_t begin,
-                        size_t end,
-                        const float isoValue)
+  /*! run iso-extraction for all given jobs over given set of
+      elements, in two passes: the first one counts the triangles
+      each block of elements will generate (for each job), a prefix
+      sum over those gives each block its write offsets, and the
+      second pass then writes the triangles' edge keys directly into
+      their final place. Vertices are then welded by edge key, so no
+      locks, per-corner vertex copies, or global sorts are
+      required. Returns one surface per job */
+  template<typename ElementSet>
+  std::vector<UMesh::SP> extractIsoSurfaces(const UMesh &in,
+                                            const IsoJobs &jobs,
+                                            const ElementSet &elements)
   {
-    std::vector<FatVertex> localVertices;
-    for (size_t i=begin;i<end;i++)
-      process(localVertices,in,in->tets[i],isoValue);
-
-    std::lock_guard<std::mutex> lock(mutex);
-    std::copy(localVertices.begin(),
-              localVertices.end(),
-              std::back_insert_iterator<std::vector<FatVertex>>(out));
+    const size_t numJobs = jobs.size();
+    
+    // ------------------------------------------------------------------
+    // pass 1: count triangles per job and block, and compute write
+    // offsets (job-major, so each job's triangles end up contiguous)
+    // ------------------------------------------------------------------
+    const size_t numBlocks = elements.numBlocks();
+    std::vector<size_t> blockOffset(numJobs*(numBlocks+1),0);
+    parallel_for(numBlocks,[&](size_t blockID){
+        std::vector<size_t> count(numJobs,0);
+        std::vector<int>    cases(jobs.isoValues.size());
+        elements.forEach(blockID,[&](const auto &prim) {
+            jobs.march(prim,cases.data(),
+                       [&](size_t jobID, uint64_t, uint64_t, uint64_t)
+                       { ++count[jobID]; });
+          });
+        for (size_t j=0;j<numJobs;j++)
+          blockOffset[j*(numBlocks+1)+blockID+1] = count[j];
+      });
+    std::vector<std::vector<uint64_t>> cornerKey(numJobs);
+    for (size_t j=0;j<numJobs;j++) {
+      size_t *offset = blockOffset.data()+j*(numBlocks+1);
+      for (size_t i=0;i<numBlocks;i++)
+        offset[i+1] += offset[i];
+      cornerKey[j].resize(3*offset[numBlocks]);
+      if (verbose)
+        std::cout << "#umesh.iso: found " << prettyNumber(offset[numBlocks])
+                  << " triangles for iso-surface #" << j << " ..." << std::endl;
+    }
+
+    // ------------------------------------------------------------------
+    // pass 2: write each triangle's three edge keys
+    // ------------------------------------------------------------------
+    parallel_for(numBlocks,[&](size_t blockID){
+        std::vector<uint64_t *> write(numJobs);
+        for (size_t j=0;j<numJobs;j++)
+          write[j] = cornerKey[j].data()+3*blockOffset[j*(numBlocks+1)+blockID];
+        std::vector<int> cases(jobs.isoValues.size());
+        elements.forEach(blockID,[&](const auto &prim) {
+            jobs.march(prim,cases.data(),
+                       [&](size_t jobID, uint64_t k0, uint64_t k1, uint64_t k2){
+                         uint64_t *&w = write[jobID];
+                         *w++ = k0;
+                         *w++ = k1;
+                         *w++ = k2;
+                       });
+          });
+      });
+    
+    // ------------------------------------------------------------------
+    // and finally, weld each job's vertices
+    // ------------------------------------------------------------------
+    std::vector<UMesh::SP> result(numJobs);
+    const size_t numIsoValues = jobs.isoValues.size();
+    for (size_t j=0;j<numJobs;j++) {
+      result[j] = weldIsoSurface(in,
+                                 jobs.fields[j/numIsoValues],
+                                 jobs.isoValues[j%numIsoValues],
+                                 cornerKey[j]);
+      std::vector<uint64_t>().swap(cornerKey[j]);
+    }
+    return result;
   }
-  
+
   /*! given a umesh with volumetric elemnets (any sort), compute a new
     umesh (containing only triangles) that contains the triangular
     iso-surface for given iso-value. Input *must* have a per-vertex
@@ -509,85 +927,84 @@ namespace umesh {
   {
     if (!in) throw std::runtime_error("null input mesh");
     if (!in->perVertex) throw std::runtime_error("input mesh w/o scalar field");
-    
-    UMesh::SP out = std::make_shared<UMesh>();
-    std::mutex mutex;
 
-    std::vector<FatVertex> fatVertices;
-    
     if (verbose)
-      std::cout << "#umesh.iso: pushing " << prettyNumber(in->tets.size())
-              << " tets" << std::endl;
-    parallel_for_blocked
-      (0,in->tets.size(),1024,
-       [&](size_t begin, size_t end){
-        doIsoSurfaceTets(fatVertices,mutex,in,begin,end,isoValue);
-      });
+      std::cout << "#umesh.iso: extracting from "
+                << prettyNumber(in->tets.size()) << " tets, "
+                << prettyNumber(in->pyrs.size()) << " pyramids, "
+                << prettyNumber(in->wedges.size()) << " wedges, and "
+                << prettyNumber(in->hexes.size()) << " hexes" << std::endl;
+    IsoJobs jobs;
+    jobs.fields    = { in->perVertex->values.data() };
+    jobs.isoValues = { isoValue };
+    return extractIsoSurfaces(*in,jobs,AllElements(*in))[0];
+  }
+  
+  /*! same as extractIsoSurface(input,isoValue), but uses the given
+      value range index to visit only those elements whose value
+      range contains the iso-value */
+  UMesh::SP extractIsoSurface(UMesh::SP in, float isoValue,
+                              ValueRangeIndex::SP index)
+  {
+    if (!in) throw std::runtime_error("null input mesh");
+    if (!in->perVertex) throw std::runtime_error("input mesh w/o scalar field");
+    if (!index) return extractIsoSurface(in,isoValue);
+    // (only the cheap check here - the scalar checksum is the
+    // caller's job, once, see ValueRangeIndex::matches())
+    if (!index->matchesElementCounts(*in))
+      throw std::runtime_error("value range index was not built for this mesh");
 
-#if 0
+    std::vector<UMesh::PrimRef> activePrims;
+    index->findActive(isoValue,activePrims);
     if (verbose)
-    std::cout << "#umesh.iso: pushing " << prettyNumber(in->pyrs.size())
-              << " pyramids" << std::endl;
-    parallel_for_blocked
-      (0,in->pyrs.size(),1024,
-       [&](size_t begin, size_t end){
-        doIsoSurfacePyrs(fatVertices,mutex,in,begin,end,isoValue);
-      });
+      std::cout << "#umesh.iso: index found " << prettyNumber(activePrims.size())
+                << " active elements (out of "
+                << prettyNumber(in->numVolumeElements()) << ")" << std::endl;
+    IsoJobs jobs;
+    jobs.fields    = { in->perVertex->values.data() };
+    jobs.isoValues = { isoValue };
+    return extractIsoSurfaces(*in,jobs,ElementList(*in,activePrims))[0];
+  }
+  
+  /*! extract one iso-surface for each of the given iso-values, in a
+      single pass over the input's elements */
+  std::vector<UMesh::SP> extractIsoSurfaces(UMesh::SP in,
+                                            const std::vector<float> &isoValues)
+  {
+    if (!in) throw std::runtime_error("null input mesh");
+    if (!in->perVertex) throw std::runtime_error("input mesh w/o scalar field");
 
-    if (verbose)
-    std::cout << "#umesh.iso: pushing " << prettyNumber(in->wedges.size())
-              << " wedges" << std::endl;
-    parallel_for_blocked
-      (0,in->wedges.size(),1024,
-       [&](size_t begin, size_t end){
-        doIsoSurfaceWedges(fatVertices,mutex,in,begin,end,isoValue);
-      });
+    IsoJobs jobs;
+    jobs.fields    = { in->perVertex->values.data() };
+    jobs.isoValues = isoValues;
+    return extractIsoSurfaces(*in,jobs,AllElements(*in));
+  }
 
-    if (verbose)
-    std::cout << "#umesh.iso: pushing " << prettyNumber(in->hexes.size())
-              << " hexes" << std::endl;
-    parallel_for_blocked
-      (0,in->hexes.size(),1024,
-       [&](size_t begin, size_t end){
-        doIsoSurfaceHexes(fatVertices,mutex,in,begin,end,isoValue);
-      });
-#endif
-    const int numFatVertices = (int)fatVertices.size();
-    if (verbose)
-    std::cout << "#umesh.iso: found " << prettyNumber(numFatVertices/3) << " triangles ..." << std::endl;
-    if (verbose)
-    std::cout << "#umesh.iso: creating vertex/index arrays ..." << std::endl;
-    for (int i=0;i<numFatVertices;i++)
-      fatVertices[i].idx = i;
-#if UMESH_HAVE_TBB
-      tbb::parallel_sort(fatVertices.begin(),fatVertices.end(),FatVertexCompare());
-#else
-      std::sort(fatVertices.begin(),fatVertices.end(),FatVertexCompare());
-#endif
-
-    int numUniqueVertices = 0;
-    for (int i=0;i<numFatVertices;i++)
-      if ((i==0) || (fatVertices[i].pos != fatVertices[i-1].pos))
-        ++numUniqueVertices;
-    if (verbose)
-    std::cout << "#umesh.iso: found " << prettyNumber(numUniqueVertices) << " unique vertices ..." << std::endl;
-    out->triangles.resize(numFatVertices/3);
-    out->vertices.resize(numUniqueVertices);
-    int uniqueVertexID = -1;
-    for (int i=0;i<numFatVertices;i++) {
-      const auto &vtx = fatVertices[i];
-      if (i==0 || vtx.pos != fatVertices[i-1].pos) {
-        ++uniqueVertexID;
-        out->vertices[uniqueVertexID] = vtx.pos;
-      }
-      /* this line assumes that every triangle is three ints - make
-         sure that's the case! */
-      static_assert(sizeof(out->triangles[0]) == 3*sizeof(int),
-                    "make sure nobody changed the fact that triangles "
-                    "are three ints, and nothing but");
-      ((int*)out->triangles.data())[vtx.idx] = uniqueVertexID;
+  /*! extract iso-surfaces for multiple per-vertex fields (eg, time
+      steps) over the same topology, for each of the given
+      iso-values, in a single pass over the input's elements */
+  std::vector<std::vector<UMesh::SP>>
+  extractIsoSurfaces(UMesh::SP in,
+                     const std::vector<Attribute::SP> &fields,
+                     const std::vector<float> &isoValues)
+  {
+    if (!in) throw std::runtime_error("null input mesh");
+
+    IsoJobs jobs;
+    for (auto field : fields) {
+      if (!field || field->values.size() != in->vertices.size())
+        throw std::runtime_error("scalar field does not match input mesh's vertices");
+      jobs.fields.push_back(field->values.data());
     }
-    return out;
+    jobs.isoValues = isoValues;
+    std::vector<UMesh::SP> surfaces
+      = extractIsoSurfaces(*in,jobs,AllElements(*in));
+    
+    std::vector<std::vector<UMesh::SP>> result(fields.size());
+    for (size_t f=0;f<fields.size();f++)
+      result[f] = std::vector<UMesh::SP>(surfaces.begin()+f*isoValues.size(),
+                                         surfaces.begin()+(f+1)*isoValues.size());
+    return result;
   }
   
 } // ::umesh
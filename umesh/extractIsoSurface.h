@@ -17,6 +17,7 @@
 #pragma once
 
 #include "umesh/UMesh.h"
+#include "umesh/ValueRangeIndex.h"
 
 namespace umesh {
 
@@ -27,6 +28,35 @@ namespace umesh {
       elemnets; tris and quads in the input get ignored; input remains
       unchanged. */
   UMesh::SP extractIsoSurface(UMesh::SP input, float isoValue);
+
+  /*! same as extractIsoSurface(input,isoValue), but uses the given
+      value range index to visit only those elements whose value
+      range contains the iso-value. Index must have been built over
+      the same mesh (and scalar field); result is the same as without
+      the index. Only element counts get checked here, so that
+      queries do not have to touch all scalars; for an index that
+      was loaded from a file, check ValueRangeIndex::matches() once
+      after loading */
+  UMesh::SP extractIsoSurface(UMesh::SP input, float isoValue,
+                              ValueRangeIndex::SP index);
+
+  /*! extract one iso-surface for each of the given iso-values, in a
+      single pass over the input's elements (and with each element's
+      scalars getting fetched only once for all iso-values); result[i]
+      is the surface for isoValues[i] */
+  std::vector<UMesh::SP> extractIsoSurfaces(UMesh::SP input,
+                                            const std::vector<float> &isoValues);
+
+  /*! time-series version of extractIsoSurfaces(): given multiple
+      per-vertex fields (eg, time steps, each with one value per
+      input vertex) over the input's topology, extract iso-surfaces
+      for all fields and iso-values in a single pass;
+      result[f][i] is the surface for fields[f] and isoValues[i]. The
+      input's own perVertex field (if any) is ignored */
+  std::vector<std::vector<UMesh::SP>>
+  extractIsoSurfaces(UMesh::SP input,
+                     const std::vector<Attribute::SP> &fields,
+                     const std::vector<float> &isoValues);
   
 } // ::umesh
 
@@ -15,43 +15,213 @@
 // ======================================================================== //
 
 #include "umesh/extractShellFaces.h"
-#include "umesh/FaceConn.h"
+#include "umesh/Facets.h"
 #include "umesh/RemeshHelper.h"
 # ifdef UMESH_HAVE_TBB
 #  include "tbb/parallel_sort.h"
 # endif
-#include <set>
 #include <algorithm>
-#include <string.h>
-
-#ifndef PRINT
-#ifdef __CUDA_ARCH__
-# define PRINT(va) /**/
-# define PING /**/
-#else
-# define PRINT(var) std::cout << #var << "=" << var << std::endl;
-#ifdef __WIN32__
-# define PING std::cout << __FILE__ << "::" << __LINE__ << ": " << __FUNCTION__ << std::endl;
-#else
-# define PING std::cout << __FILE__ << "::" << __LINE__ << ": " << __PRETTY_FUNCTION__ << std::endl;
-#endif
-#endif
-#endif
+#include <atomic>
 
 namespace umesh {
 
-  // UMesh::SP dbg_input;
+  /*! a facet, reduced to only what we need to know about it for
+      finding the shell: its vertex indices in the unique order
+      computed by computeUniqueVertexOrder() (so all facets of the
+      same face end up with the same indices), plus its orientation
+      relative to that order. To keep this at 16 bytes the orientation
+      is stored in the sign bit of idx.z, which is otherwise always
+      zero for valid facets. Degenerate facets have idx.x < 0 */
+  struct ShellFacet {
+    inline int z() const { return idx.z & 0x7fffffff; }
+    inline int orientation() const { return (uint32_t)idx.z >> 31; }
+    
+    vec4i idx;
+  };
 
-  /*! given a umesh with mixed volumetric elements, create a a new
-      mesh of surface elemnts (ie, triangles and quads) that
-      corresponds to the outside facing "shell" faces of the input
-      elements (ie, all those that re not shared by two different
-      elements. All surface elements in the output mesh will be
-      INWARD facing. */
-  UMesh::SP extractShellFaces(UMesh::SP mesh);
-} // ::umesh
+  inline ShellFacet makeShellFacet(Facet facet)
+  {
+    computeUniqueVertexOrder(facet);
+    ShellFacet result;
+    result.idx = facet.vertexIdx;
+    if (result.idx.x >= 0 && facet.orientation)
+      result.idx.z |= 0x80000000;
+    return result;
+  }
 
-namespace umesh {
+  /*! checks if the two facets belong to the same face (no matter
+      which orientation) */
+  inline bool sameFace(const ShellFacet &a, const ShellFacet &b)
+  {
+    return
+      a.idx.x == b.idx.x &&
+      a.idx.y == b.idx.y &&
+      a.z()   == b.z()   &&
+      a.idx.w == b.idx.w;
+  }
+
+  /*! same order as FaceConn's FacetComparator, ignoring orientation */
+  struct ShellFacetComparator {
+    inline
+    bool operator()(const ShellFacet &a, const ShellFacet &b) const {
+      if (a.idx.x != b.idx.x) return a.idx.x < b.idx.x;
+      if (a.idx.y != b.idx.y) return a.idx.y < b.idx.y;
+      if (a.z()   != b.z())   return a.z()   < b.z();
+      return a.idx.w < b.idx.w;
+    }
+  };
+
+  inline int numFacetsOf(size_t primType)
+  {
+    switch (primType) {
+    case UMesh::TET:   return 4;
+    case UMesh::PYR:   return 5;
+    case UMesh::WEDGE: return 5;
+    case UMesh::HEX:   return 6;
+    default:
+      throw std::runtime_error("not a volume element!?");
+    }
+  }
+
+  /*! computes the facets of 'numPrims' volume elements of the given
+      mesh, with getPrim(i) returning the PrimRef of the i'th of those
+      elements */
+  template<typename GetPrim>
+  std::vector<ShellFacet> computeShellFacets(UMesh::SP mesh,
+                                             size_t numPrims,
+                                             const GetPrim &getPrim)
+  {
+    InputMesh input;
+    setupInput(input,mesh);
+
+    // count facets per block of prims, and scan to get each block's
+    // first facet ...
+    const size_t blockSize = 1024;
+    const size_t numBlocks = (numPrims+blockSize-1)/blockSize;
+    std::vector<size_t> blockOffset(numBlocks+1,0);
+    parallel_for(numBlocks,[&](size_t blockID){
+        const size_t begin = blockID*blockSize;
+        const size_t end   = std::min(begin+blockSize,numPrims);
+        size_t count = 0;
+        for (size_t i=begin;i<end;i++)
+          count += numFacetsOf(getPrim(i).type);
+        blockOffset[blockID+1] = count;
+      });
+    for (size_t blockID=0;blockID<numBlocks;blockID++)
+      blockOffset[blockID+1] += blockOffset[blockID];
+
+    // ... then write them
+    std::vector<ShellFacet> facets(blockOffset[numBlocks]);
+    parallel_for(numBlocks,[&](size_t blockID){
+        const size_t begin = blockID*blockSize;
+        const size_t end   = std::min(begin+blockSize,numPrims);
+        ShellFacet *out = facets.data()+blockOffset[blockID];
+        for (size_t i=begin;i<end;i++) {
+          const UMesh::PrimRef prim = getPrim(i);
+          Facet primFacets[6];
+          switch (prim.type) {
+          case UMesh::TET:   writeTetFacets(primFacets,prim.ID,input);   break;
+          case UMesh::PYR:   writePyrFacets(primFacets,prim.ID,input);   break;
+          case UMesh::WEDGE: writeWedgeFacets(primFacets,prim.ID,input); break;
+          case UMesh::HEX:   writeHexFacets(primFacets,prim.ID,input);   break;
+          }
+          const int N = numFacetsOf(prim.type);
+          for (int f=0;f<N;f++)
+            *out++ = makeShellFacet(primFacets[f]);
+        }
+      });
+    return facets;
+  }
+
+  /*! checks if the i'th of the (sorted) facets is a shell facet, ie,
+      the only facet of its face. Faces that are shared by more than
+      two prims (or twice by the same side) are not shell faces
+      either, but set 'invalidFace', so the caller can report them
+      once it's out of its parallel loop */
+  inline bool isShellFacet(const std::vector<ShellFacet> &facets, size_t i,
+                           std::atomic<bool> &invalidFace)
+  {
+    const ShellFacet &facet = facets[i];
+    if (facet.idx.x < 0)
+      // degenerate facet
+      return false;
+    if (i > 0 && sameFace(facets[i-1],facet)) {
+      if ((i > 1 && sameFace(facets[i-2],facet)) ||
+          facets[i-1].orientation() == facet.orientation())
+        invalidFace = true;
+      return false;
+    }
+    return (i+1 == facets.size()) || !sameFace(facet,facets[i+1]);
+  }
+
+  /*! the actual shell kernel: sorts the given facets such that all
+      facets of the same face end up next to each other, and emits
+      those that are the only one of their face, as OUTWARD facing
+      tris or quads of an (index-only) output mesh */
+  UMesh::SP computeShell(std::vector<ShellFacet> &facets)
+  {
+# ifdef UMESH_HAVE_TBB
+    tbb::parallel_sort(facets.begin(),facets.end(),ShellFacetComparator());
+# else
+    std::sort(facets.begin(),facets.end(),ShellFacetComparator());
+# endif
+
+    // first pass: count shell tris and quads in each block of facets
+    const size_t numFacets = facets.size();
+    const size_t blockSize = 16*1024;
+    const size_t numBlocks = (numFacets+blockSize-1)/blockSize;
+    std::vector<size_t> triOffset(numBlocks+1,0);
+    std::vector<size_t> quadOffset(numBlocks+1,0);
+    std::atomic<bool> invalidFace(false);
+    parallel_for(numBlocks,[&](size_t blockID){
+        const size_t begin = blockID*blockSize;
+        const size_t end   = std::min(begin+blockSize,numFacets);
+        size_t numTris = 0, numQuads = 0;
+        for (size_t i=begin;i<end;i++) {
+          if (!isShellFacet(facets,i,invalidFace)) continue;
+          if (facets[i].idx.w < 0) numTris++; else numQuads++;
+        }
+        triOffset[blockID+1]  = numTris;
+        quadOffset[blockID+1] = numQuads;
+      });
+    if (invalidFace)
+      throw std::runtime_error("face shared by more than two prims,"
+                               " or twice on the same side!?");
+
+    // scan, to get each block's first output tri and quad ...
+    for (size_t blockID=0;blockID<numBlocks;blockID++) {
+      triOffset[blockID+1]  += triOffset[blockID];
+      quadOffset[blockID+1] += quadOffset[blockID];
+    }
+    UMesh::SP output = std::make_shared<UMesh>();
+    output->triangles.resize(triOffset[numBlocks]);
+    output->quads.resize(quadOffset[numBlocks]);
+
+    // ... and second pass: write them. facets as written by the
+    // write<Prim>Facets() functions face inward, so we have to swap
+    // if the unique vertex order did not already do that
+    parallel_for(numBlocks,[&](size_t blockID){
+        const size_t begin = blockID*blockSize;
+        const size_t end   = std::min(begin+blockSize,numFacets);
+        UMesh::Triangle *tri  = output->triangles.data()+triOffset[blockID];
+        UMesh::Quad     *quad = output->quads.data()+quadOffset[blockID];
+        for (size_t i=begin;i<end;i++) {
+          if (!isShellFacet(facets,i,invalidFace)) continue;
+          const ShellFacet &facet = facets[i];
+          const vec4i idx(facet.idx.x,facet.idx.y,facet.z(),facet.idx.w);
+          const bool swap = !facet.orientation();
+          if (idx.w < 0)
+            *tri++ = swap
+              ? UMesh::Triangle(idx.x,idx.z,idx.y)
+              : UMesh::Triangle(idx.x,idx.y,idx.z);
+          else
+            *quad++ = swap
+              ? UMesh::Quad(idx.x,idx.w,idx.z,idx.y)
+              : UMesh::Quad(idx.x,idx.y,idx.z,idx.w);
+        }
+      });
+    return output;
+  }
   
   /*! given a umesh with mixed volumetric elements, create a a new
       mesh of surface elemnts (ie, triangles and quads) that
@@ -69,121 +239,68 @@ namespace umesh {
                               bool remeshVertices
                               )
   {
-    FaceConn::SP faceConn = FaceConn::compute(input);
-    auto &faces = faceConn->faces;
+    const size_t numTets   = input->tets.size();
+    const size_t numPyrs   = input->pyrs.size();
+    const size_t numWedges = input->wedges.size();
+    std::vector<ShellFacet> facets
+      = computeShellFacets(input,input->numVolumeElements(),[&](size_t i){
+          if (i < numTets) return UMesh::PrimRef(UMesh::TET,i);
+          i -= numTets;
+          if (i < numPyrs) return UMesh::PrimRef(UMesh::PYR,i);
+          i -= numPyrs;
+          if (i < numWedges) return UMesh::PrimRef(UMesh::WEDGE,i);
+          i -= numWedges;
+          return UMesh::PrimRef(UMesh::HEX,i);
+        });
+    UMesh::SP output = computeShell(facets);
+    facets.clear();
+    facets.shrink_to_fit();
 
-    assert(faces.empty() || !input->vertices.empty());
-    UMesh::SP output = std::make_shared<UMesh>();
+    if (remeshVertices)
+      // pull in only the used vertices, straight from the input
+      gatherUsedVertices(output,input);
+    return output;
+  }
 
-#if 1
-    output->vertices = input->vertices;
-    if (input->perVertex)  {
-      output->perVertex = std::make_shared<Attribute>();
-      output->perVertex->name = input->perVertex->name;
-      output->perVertex->values = input->perVertex->values;
-    }
+  /*! same as extractShellFaces(), but only for the given subset of
+      the input mesh's volume elements */
+  UMesh::SP extractShellFaces(UMesh::SP input,
+                              const std::vector<UMesh::PrimRef> &prims)
+  {
+    std::vector<ShellFacet> facets
+      = computeShellFacets(input,prims.size(),[&](size_t i){
+          return prims[i];
+        });
+    return computeShell(facets);
+  }
 
-    for (auto &face: faces) {
-      if (face.vertexIdx.x < 0)
-        // invalid face
-        continue;
-      
-      if (face.onFront.primIdx < 0 && face.onBack.primIdx < 0) {
-        PRINT(face.vertexIdx);
-        throw std::runtime_error("face that has BOTH sides unused!?");
-      } else if (face.onFront.primIdx < 0) {
-        if (face.vertexIdx.w < 0) {
-          // SWAP
-          vec3i tri(face.vertexIdx.x,
-                    face.vertexIdx.z,
-                    face.vertexIdx.y);
-          output->triangles.push_back(tri);
-        } else {
-          // SWAP
-          vec4i quad(face.vertexIdx.x,
-                     face.vertexIdx.w,
-                     face.vertexIdx.z,
-                     face.vertexIdx.y);
-          output->quads.push_back(quad);
-        }
-      } else if (face.onBack.primIdx < 0) {
-        if (face.vertexIdx.w < 0) {
-          // NO SWAP
-          vec3i tri(face.vertexIdx.x,
-                    face.vertexIdx.y,
-                    face.vertexIdx.z);
-          output->triangles.push_back(tri);
-        } else {
-          // NO SWAP
-          vec4i quad(face.vertexIdx.x,
-                     face.vertexIdx.y,
-                     face.vertexIdx.z,
-                     face.vertexIdx.w);
-          output->quads.push_back(quad);
-        }
-      } else {
-        /* inner face ... ignore */
-      }
-    }
-    if (remeshVertices)
-      removeUnusedVertices(output);
-#else
-    
-    
-    RemeshHelper helper(*output);
-    for (auto &face: faces) {
-      if (face.vertexIdx.x < 0)
-        // invalid face
-        continue;
-      
-      if (face.onFront.primIdx < 0 && face.onBack.primIdx < 0) {
-        PRINT(face.vertexIdx);
-        throw std::runtime_error("face that has BOTH sides unused!?");
-      } else if (face.onFront.primIdx < 0) {
-        if (face.vertexIdx.w < 0) {
-          // SWAP
-          vec3i tri(face.vertexIdx.x,
-                    face.vertexIdx.z,
-                    face.vertexIdx.y);
-          if (remeshVertices)
-            helper.translate(&tri.x,3,input);
-          output->triangles.push_back(tri);
-        } else {
-          // SWAP
-          vec4i quad(face.vertexIdx.x,
-                     face.vertexIdx.w,
-                     face.vertexIdx.z,
-                     face.vertexIdx.y);
-          if (remeshVertices)
-            helper.translate(&quad.x,4,input);
-          output->quads.push_back(quad);
+  /*! merges the shells of several disjoint subsets of the same mesh
+      into the shell of their union */
+  UMesh::SP mergeShellFaces(const std::vector<UMesh::SP> &shells)
+  {
+    std::vector<size_t> offset(shells.size()+1,0);
+    for (size_t i=0;i<shells.size();i++)
+      offset[i+1] = offset[i]+shells[i]->triangles.size()+shells[i]->quads.size();
+
+    // shell faces face outward, so they're the inverse of the (inward
+    // facing) facets they came from - which we can account for by
+    // simply starting out with flipped orientation
+    std::vector<ShellFacet> facets(offset.back());
+    parallel_for(shells.size(),[&](size_t shellID){
+        const UMesh &shell = *shells[shellID];
+        ShellFacet *out = facets.data()+offset[shellID];
+        Facet facet;
+        facet.orientation = 1;
+        for (auto &tri : shell.triangles) {
+          facet.vertexIdx = vec4i(tri.x,tri.y,tri.z,-1);
+          *out++ = makeShellFacet(facet);
         }
-      } else if (face.onBack.primIdx < 0) {
-        if (face.vertexIdx.w < 0) {
-          // NO SWAP
-          vec3i tri(face.vertexIdx.x,
-                    face.vertexIdx.y,
-                    face.vertexIdx.z);
-          if (remeshVertices)
-            helper.translate(&tri.x,3,input);
-          output->triangles.push_back(tri);
-        } else {
-          // NO SWAP
-          vec4i quad(face.vertexIdx.x,
-                     face.vertexIdx.y,
-                     face.vertexIdx.z,
-                     face.vertexIdx.w);
-          if (remeshVertices)
-            helper.translate(&quad.x,4,input);
-          output->quads.push_back(quad);
+        for (auto &quad : shell.quads) {
+          facet.vertexIdx = vec4i(quad.x,quad.y,quad.z,quad.w);
+          *out++ = makeShellFacet(facet);
         }
-      } else {
-        /* inner face ... ignore */
-      }
-    }
-#endif
-    // dbg_input = 0;
-    return output;
+      });
+    return computeShell(facets);
   }
   
-}
+} // ::umesh
@@ -25,7 +25,12 @@ namespace umesh {
     corresponds to the outside facing "shell" faces of the input
     elements (ie, all those that re not shared by two different
     elements. All surface elements in the output mesh will be
-    OUTWARD facing. */
+    OUTWARD facing.
+
+    This does not compute the full face connectivity (see FaceConn),
+    but only sorts compact per-facet keys, and keeps those facets that
+    are the only one of their face; interior faces never get
+    materialized at all. */
   UMesh::SP extractShellFaces(UMesh::SP mesh,
                               /*! if true, we'll create a new set of
                                 vertices for ONLY the required
@@ -34,5 +39,23 @@ namespace umesh {
                                 vertex indices refer to the
                                 original input mesh */
                               bool remeshVertices);
+
+  /*! same as extractShellFaces(), but for only the given subset of
+      the mesh's volume elements (eg, one brick of a partition). The
+      output is index-only, ie, its vertex indices refer to the input
+      mesh's vertex array, and it has no vertices of its own; this is
+      what mergeShellFaces() expects */
+  UMesh::SP extractShellFaces(UMesh::SP mesh,
+                              const std::vector<UMesh::PrimRef> &prims);
+
+  /*! given the (index-only) shells of several disjoint subsets of the
+      same mesh's elements - as computed by the PrimRef variant of
+      extractShellFaces() - compute the (equally index-only) shell of
+      the union of those subsets: faces that show up in two different
+      shells are shared by elements of different subsets, and thus
+      interior to the union. Merging the shells of all bricks of a
+      partition results in the same faces - in the same order - as
+      extractShellFaces() on the whole mesh */
+  UMesh::SP mergeShellFaces(const std::vector<UMesh::SP> &shells);
 } // ::umesh
 
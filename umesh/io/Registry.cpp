@@ -0,0 +1,354 @@
+// ======================================================================== //
+// Copyright 2018-2020 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "umesh/io/Registry.h"
+#include "umesh/io/UMesh.h"
+#include "umesh/io/ugrid32.h"
+#include "umesh/io/ugrid64.h"
+#include "umesh/io/fun3dScalars.h"
+#include "umesh/io/vtk.h"
+#include "umesh/io/off.h"
+#include "umesh/io/exabin.h"
+#include "umesh/io/nateBin.h"
+#include "umesh/io/obj.h"
+#include "umesh/io/TestCase.h"
+#include "umesh/io/btm/BTM.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace umesh {
+  namespace io {
+
+    /* these have to match what UMesh::writeTo()/readFrom() use */
+    const size_t bum_magic     = 0x234235567ULL;
+    const size_t bum_magic_old = 0x234235566ULL;
+
+    inline std::string toLower(std::string s)
+    {
+      for (auto &c : s) c = (char)std::tolower((unsigned char)c);
+      return s;
+    }
+    
+    inline bool endsWith(const std::string &s, const std::string &suffix)
+    {
+      return s.size() >= suffix.size()
+        && s.compare(s.size()-suffix.size(),suffix.size(),suffix) == 0;
+    }
+
+    /*! file name without any leading path */
+    inline std::string baseName(const std::string &fileName)
+    {
+      const size_t pos = fileName.find_last_of("/\\");
+      return pos == std::string::npos ? fileName : fileName.substr(pos+1);
+    }
+
+    /*! reads (up to) the first 'maxSize' bytes of given file; returns
+        false if the file cannot be opened */
+    inline bool readHead(const std::string &fileName, std::string &head,
+                         size_t maxSize = 256)
+    {
+      std::ifstream in(fileName,std::ios::binary);
+      if (!in.good()) return false;
+      head.resize(maxSize);
+      in.read(&head[0],maxSize);
+      head.resize((size_t)in.gcount());
+      return true;
+    }
+    
+    // ==================================================================
+    // Registry
+    // ==================================================================
+    
+    Registry &Registry::get()
+    {
+      static Registry registry;
+      return registry;
+    }
+
+    void Registry::add(const Format &format)
+    {
+      formats.push_back(format);
+    }
+
+    const Format *Registry::findByName(const std::string &name) const
+    {
+      for (auto it = formats.rbegin(); it != formats.rend(); ++it)
+        if (it->name == name) return &*it;
+      return nullptr;
+    }
+    
+    const Format *Registry::findByExtension(const std::string &fileName,
+                                            bool forSaving) const
+    {
+      const std::string lowerName = toLower(fileName);
+      const Format *best = nullptr;
+      size_t bestLength = 0;
+      // longest matching extension wins (eg, a '.b8.ugrid' format
+      // would win over '.ugrid'); among equally long ones the
+      // latest-added format
+      for (auto it = formats.rbegin(); it != formats.rend(); ++it) {
+        if (forSaving ? !it->save : !it->load) continue;
+        for (auto &ext : it->extensions)
+          if (ext.size() > bestLength && endsWith(lowerName,toLower(ext))) {
+            best = &*it;
+            bestLength = ext.size();
+          }
+      }
+      return best;
+    }
+    
+    const Format &Registry::detect(const std::string &fileName) const
+    {
+      std::string head;
+      if (readHead(fileName,head))
+        for (auto it = formats.rbegin(); it != formats.rend(); ++it)
+          if (it->load && it->matchesMagic && it->matchesMagic(head))
+            return *it;
+      const Format *format = findByExtension(fileName);
+      if (!format)
+        throw std::runtime_error("#umesh: could not determine format of '"
+                                 +fileName+"'");
+      return *format;
+    }
+
+    /*! the formats that are built into umesh */
+    Registry::Registry()
+    {
+      Format umesh;
+      umesh.name = "umesh";
+      umesh.extensions = { ".umesh" };
+      umesh.matchesMagic = [](const std::string &head) {
+        if (head.size() < sizeof(size_t)) return false;
+        size_t magic;
+        memcpy(&magic,head.data(),sizeof(magic));
+        return magic == bum_magic || magic == bum_magic_old;
+      };
+      umesh.load = [](const std::string &fileName, const Options &)
+      { return UMesh::loadFrom(fileName); };
+      umesh.save = [](const std::string &fileName, UMesh::SP mesh, const Options &)
+      { mesh->saveTo(fileName); };
+      add(umesh);
+
+      Format ugrid64;
+      ugrid64.name = "ugrid64";
+      ugrid64.extensions = { ".ugrid64" };
+      ugrid64.load = [](const std::string &fileName, const Options &)
+      { return UGrid64Loader::load(fileName); };
+      ugrid64.stream = [](const std::string &fileName, const Options &,
+                          UMeshWriter &out)
+      { UGrid64Loader::stream(fileName,out); };
+      add(ugrid64);
+      
+      Format ugrid32;
+      ugrid32.name = "ugrid32";
+      ugrid32.extensions = { ".ugrid", ".ugrid32" };
+      ugrid32.load = [](const std::string &fileName, const Options &)
+      { return UGrid32Loader::load(fileName); };
+      ugrid32.stream = [](const std::string &fileName, const Options &,
+                          UMeshWriter &out)
+      { UGrid32Loader::stream(fileName,out); };
+      add(ugrid32);
+
+      Format vtu;
+      vtu.name = "vtu";
+      vtu.extensions = { ".vtu" };
+      vtu.matchesMagic = [](const std::string &head)
+      { return head.find("<VTKFile") != std::string::npos; };
+      vtu.load = [](const std::string &fileName, const Options &options)
+      { return loadVTU(fileName,options.variable); };
+      vtu.save = [](const std::string &fileName, UMesh::SP mesh,
+                    const Options &options)
+      { saveVTU(fileName,mesh,options.compress); };
+      add(vtu);
+      
+      Format vtk;
+      vtk.name = "vtk";
+      vtk.extensions = { ".vtk" };
+      vtk.matchesMagic = [](const std::string &head)
+      { return head.compare(0,14,"# vtk DataFile") == 0; };
+      vtk.load = [](const std::string &fileName, const Options &options)
+      { return loadLegacyVTK(fileName,options.variable); };
+      add(vtk);
+
+      Format off;
+      off.name = "off";
+      off.extensions = { ".off" };
+      off.load = [](const std::string &fileName, const Options &)
+      { return loadOFF(fileName); };
+      add(off);
+
+      // exa AMR cells; scalars (one per cell) come from the scalar
+      // file if specified, or else from a .scalars file next to the
+      // .cells file, if there is one
+      Format exabin;
+      exabin.name = "exabin";
+      exabin.extensions = { ".cells" };
+      exabin.loadsScalarFile = true;
+      exabin.load = [](const std::string &fileName, const Options &options) {
+        std::string scalarsFileName = options.scalarFileName;
+        if (scalarsFileName == "") {
+          const std::string candidate
+            = fileName.substr(0,fileName.size()-strlen(".cells"))+".scalars";
+          if (std::ifstream(candidate).good())
+            scalarsFileName = candidate;
+        }
+        return loadExaBin(fileName,scalarsFileName);
+      };
+      add(exabin);
+
+      Format nateBin;
+      nateBin.name = "natebin";
+      nateBin.extensions = { ".bin" };
+      nateBin.load = [](const std::string &fileName, const Options &)
+      { return loadNateBin(fileName); };
+      add(nateBin);
+
+      Format btm;
+      btm.name = "btm";
+      btm.extensions = { ".btm", ".tribin" };
+      btm.load = [](const std::string &fileName, const Options &)
+      { return btm::toUMesh(btm::Mesh::load(fileName)); };
+      btm.save = [](const std::string &fileName, UMesh::SP mesh, const Options &)
+      { btm::fromUMesh(mesh)->save(fileName); };
+      add(btm);
+
+      Format obj;
+      obj.name = "obj";
+      obj.extensions = { ".obj" };
+      obj.save = [](const std::string &fileName, UMesh::SP mesh, const Options &)
+      { saveOBJ(fileName,mesh); };
+      add(obj);
+
+      // synthetic NxNxN hex grid; the 'file' doesn't have to exist,
+      // eg, '64.testcase' creates a 64^3 grid
+      Format testCase;
+      testCase.name = "testcase";
+      testCase.extensions = { ".testcase" };
+      testCase.load = [](const std::string &fileName, const Options &)
+      { return createTestCase(atoi(baseName(fileName).c_str())); };
+      add(testCase);
+    }
+
+    // ==================================================================
+    // load/save
+    // ==================================================================
+
+    inline const Format &formatForLoading(const std::string &fileName,
+                                          const Options &options)
+    {
+      if (options.format == "")
+        return Registry::get().detect(fileName);
+      const Format *format = Registry::get().findByName(options.format);
+      if (!format || !format->load)
+        throw std::runtime_error("#umesh: no format '"+options.format
+                                 +"' that supports loading");
+      return *format;
+    }
+
+    /*! replaces the mesh's scalars with those from
+        options.scalarFileName */
+    void loadScalars(UMesh::SP mesh, const Options &options)
+    {
+      const size_t numVertices = mesh->vertices.size();
+      Attribute::SP scalars = std::make_shared<Attribute>();
+      if (options.variable != "") {
+        // fun3d volume data file, which specifies for each of its
+        // values which vertex that value belongs to
+        int timeStep = options.timeStep;
+        if (timeStep < 0) {
+          std::vector<std::string> variables;
+          std::vector<int> timeSteps;
+          fun3d::getInfo(options.scalarFileName,variables,timeSteps);
+          if (timeSteps.empty())
+            throw std::runtime_error("#umesh: no time steps in '"
+                                     +options.scalarFileName+"'");
+          timeStep = timeSteps.back();
+        }
+        std::vector<uint64_t> vertexIDs;
+        std::vector<float> values
+          = fun3d::readTimeStep(options.scalarFileName,options.variable,
+                                timeStep,&vertexIDs);
+        if (vertexIDs.size() != values.size())
+          throw std::runtime_error("#umesh: inconsistent fun3d data file '"
+                                   +options.scalarFileName+"'");
+        scalars->name = options.variable;
+        scalars->values.resize(numVertices);
+        bool invalidID = false;
+        for (size_t i=0;i<values.size();i++)
+          if (vertexIDs[i] < numVertices)
+            scalars->values[vertexIDs[i]] = values[i];
+          else
+            invalidID = true;
+        if (invalidID)
+          throw std::runtime_error("#umesh: fun3d data file '"
+                                   +options.scalarFileName
+                                   +"' does not match the mesh");
+      } else {
+        // raw floats, one per vertex
+        std::ifstream in(options.scalarFileName,std::ios::binary);
+        if (!in.good())
+          throw std::runtime_error("#umesh: could not open '"
+                                   +options.scalarFileName+"'");
+        scalars->name = baseName(options.scalarFileName);
+        scalars->values.resize(numVertices);
+        readArray(in,scalars->values.data(),numVertices);
+      }
+      scalars->finalize();
+      mesh->perVertex = scalars;
+    }
+    
+    UMesh::SP load(const std::string &fileName, const Options &options)
+    {
+      const Format &format = formatForLoading(fileName,options);
+      UMesh::SP mesh = format.load(fileName,options);
+      if (!mesh)
+        throw std::runtime_error("#umesh: could not load '"+fileName+"'");
+      if (options.scalarFileName != "" && !format.loadsScalarFile)
+        loadScalars(mesh,options);
+      return mesh;
+    }
+
+    void save(const std::string &fileName, UMesh::SP mesh,
+              const Options &options)
+    {
+      const Format *format
+        = (options.format == "")
+        ? Registry::get().findByExtension(fileName,/*forSaving*/true)
+        : Registry::get().findByName(options.format);
+      if (!format || !format->save)
+        throw std::runtime_error("#umesh: don't know how to save '"+fileName+"'"
+                                 +(options.format == ""
+                                   ? std::string("")
+                                   : " in format '"+options.format+"'"));
+      format->save(fileName,mesh,options);
+    }
+
+    void convertToUMesh(const std::string &inFileName,
+                        const std::string &outFileName,
+                        const Options &options)
+    {
+      const Format &format = formatForLoading(inFileName,options);
+      if (format.stream && options.scalarFileName == "") {
+        UMeshWriter out(outFileName);
+        format.stream(inFileName,options,out);
+        out.close();
+      } else
+        load(inFileName,options)->saveTo(outFileName);
+    }
+    
+  } // ::umesh::io
+} // ::umesh
@@ -0,0 +1,142 @@
+// ======================================================================== //
+// Copyright 2018-2020 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "umesh/UMesh.h"
+#include "umesh/io/UMeshStream.h"
+#include <functional>
+
+/* a registry of all the file formats umesh can read and/or write,
+   with auto-detection (by magic number, or else by file extension),
+   so tools can simply call io::load()/io::save() rather than each
+   having to know about every format */
+
+namespace umesh {
+  namespace io {
+
+    /*! options that get passed to whatever loader/saver ends up
+        handling a given file; each format only looks at those that
+        make sense for it */
+    struct Options {
+      /*! name of the format to use (see Format::name); if empty, the
+          format gets detected from the file */
+      std::string format;
+      
+      /*! file with per-vertex scalars that will replace whatever
+          scalars the mesh comes with: either raw floats (one per
+          vertex, as used for ugrid meshes), or - if 'variable' is set -
+          a fun3d volume data file */
+      std::string scalarFileName;
+      
+      /*! name of the scalar field (vtk) or variable (fun3d data files)
+          to load; empty means 'the default one' */
+      std::string variable;
+      
+      /*! time step to load from a fun3d data file; -1 means the last
+          one in the file */
+      int timeStep = -1;
+      
+      /*! for writing: compress the output, if the format supports
+          that (vtu) */
+      bool compress = false;
+    };
+
+    /*! description of one file format. Every function other than
+        'name' and 'extensions' is optional */
+    struct Format {
+      /*! short name, as used in Options::format */
+      std::string name;
+      
+      /*! file extensions (including the dot) used by this format; the
+          first one is the default when writing */
+      std::vector<std::string> extensions;
+      
+      /*! given the first (up to) 256 bytes of a file, checks if the
+          file is in this format */
+      std::function<bool(const std::string &head)> matchesMagic;
+      
+      /*! reads the given file */
+      std::function<UMesh::SP(const std::string &fileName,
+                              const Options &options)> load;
+      
+      /*! writes the mesh to given file */
+      std::function<void(const std::string &fileName,
+                         UMesh::SP mesh,
+                         const Options &options)> save;
+      
+      /*! streams the given file into a .umesh writer, without ever
+          having the entire mesh in memory */
+      std::function<void(const std::string &fileName,
+                         const Options &options,
+                         UMeshWriter &out)> stream;
+
+      /*! whether load() itself handles Options::scalarFileName (eg,
+          because the format has per-cell scalars); otherwise
+          io::load() reads that file as per-vertex scalars */
+      bool loadsScalarFile = false;
+    };
+
+    /*! the list of known formats. All formats built into umesh are
+        registered on first use; applications can add their own (or
+        override built-in ones) via add() */
+    struct Registry {
+      /*! the (global) registry */
+      static Registry &get();
+
+      /*! adds a new format; formats added later take precedence over
+          those added earlier (including the built-in ones) */
+      void add(const Format &format);
+
+      /*! returns the format of given name, or null if there isn't any */
+      const Format *findByName(const std::string &name) const;
+
+      /*! returns the format that has given file name's extension, and
+          supports loading (or saving, if 'forSaving' is set); or null
+          if there isn't any */
+      const Format *findByExtension(const std::string &fileName,
+                                    bool forSaving=false) const;
+
+      /*! determines the format of an existing file, by magic number
+          if the format has one, or else by extension. Throws if the
+          format cannot be determined */
+      const Format &detect(const std::string &fileName) const;
+
+      std::vector<Format> formats;
+    private:
+      Registry();
+    };
+
+    /*! loads given file, in whatever format it is in (or the one
+        specified in options.format). If options.scalarFileName is set
+        the scalars get loaded from that file */
+    UMesh::SP load(const std::string &fileName,
+                   const Options &options = Options());
+
+    /*! saves the mesh in the format determined by the file's
+        extension (or the one specified in options.format) */
+    void save(const std::string &fileName, UMesh::SP mesh,
+              const Options &options = Options());
+
+    /*! converts given file to a .umesh file; formats that support
+        streaming get streamed (unless separate scalars need to be
+        merged in), all others get loaded and saved */
+    void convertToUMesh(const std::string &inFileName,
+                        const std::string &outFileName,
+                        const Options &options = Options());
+
+  } // ::umesh::io
+} // ::umesh
@@ -1,5 +1,5 @@
 // ======================================================================== //
-// Copyright 2018-2019 Ingo Wald                                            //
+// Copyright 2018-2020 Ingo Wald                                            //
 //                                                                          //
 // Licensed under the Apache License, Version 2.0 (the "License");          //
 // you may not use this file except in compliance with the License.         //
@@ -14,9 +14,9 @@
 // limitations under the License.                                           //
 // ======================================================================== //
 
-#include "TestCase.h"
+#include "umesh/io/TestCase.h"
 
-namespace tetty {
+namespace umesh {
   namespace io {
 
     inline int vertexID(int N, int x, int y, int z)
@@ -24,41 +24,47 @@ namespace tetty {
       return x + (N+1)*(y+ (N+1)*(z));
     }
     
-    UMesh::SP createTestCase(const std::string &dataFileName)
+    UMesh::SP createTestCase(int N)
     {
+      if (N < 1)
+        throw std::runtime_error("#umesh: invalid test case size "
+                                 +std::to_string(N));
       UMesh::SP mesh = std::make_shared<UMesh>();
-      int N = atoi(dataFileName.c_str());
       mesh->perVertex = std::make_shared<Attribute>();
 
-      for (int iz=0;iz<=N;iz++)
-        for (int iy=0;iy<=N;iy++)
-          for (int ix=0;ix<=N;ix++) {
-            vec3f v(vec3i(ix,iy,iz));
-            mesh->vertex.push_back(v);
-            mesh->perVertex->value.push_back(length(v));
-          }
+      const size_t numVertices = size_t(N+1)*(N+1)*(N+1);
+      mesh->vertices.resize(numVertices);
+      mesh->perVertex->values.resize(numVertices);
+      parallel_for(N+1,[&](int iz){
+          for (int iy=0;iy<=N;iy++)
+            for (int ix=0;ix<=N;ix++) {
+              const int i = vertexID(N,ix,iy,iz);
+              const vec3f v(vec3i(ix,iy,iz));
+              mesh->vertices[i] = v;
+              mesh->perVertex->values[i] = length(v);
+            }
+        });
       mesh->perVertex->finalize();
 
-      for (int iz=0;iz<N;iz++)
-        for (int iy=0;iy<N;iy++)
-          for (int ix=0;ix<N;ix++) {
-            UMesh::Hex hex;
-            hex.base.x = vertexID(N,ix+0,iy+0,iz+0);
-            hex.base.y = vertexID(N,ix+1,iy+0,iz+0);
-            hex.base.z = vertexID(N,ix+1,iy+1,iz+0);
-            hex.base.w = vertexID(N,ix+0,iy+1,iz+0);
-
-            hex.top.x = vertexID(N,ix+0,iy+0,iz+1);
-            hex.top.y = vertexID(N,ix+0,iy+1,iz+1);
-            hex.top.z = vertexID(N,ix+1,iy+1,iz+1);
-            hex.top.w = vertexID(N,ix+1,iy+0,iz+1);
-
-            mesh->hexes.push_back(hex);
-          }
+      mesh->hexes.resize(size_t(N)*N*N);
+      parallel_for(N,[&](int iz){
+          for (int iy=0;iy<N;iy++)
+            for (int ix=0;ix<N;ix++)
+              // VTK ordering: bottom face, then top face, both
+              // counter-clockwise
+              mesh->hexes[ix+N*(iy+N*iz)]
+                = Hex(vertexID(N,ix+0,iy+0,iz+0),
+                      vertexID(N,ix+1,iy+0,iz+0),
+                      vertexID(N,ix+1,iy+1,iz+0),
+                      vertexID(N,ix+0,iy+1,iz+0),
+                      vertexID(N,ix+0,iy+0,iz+1),
+                      vertexID(N,ix+1,iy+0,iz+1),
+                      vertexID(N,ix+1,iy+1,iz+1),
+                      vertexID(N,ix+0,iy+1,iz+1));
+        });
       mesh->finalize();
       return mesh;
     }
       
-  } // ::tetty::io
-} // ::tetty
-
+  } // ::umesh::io
+} // ::umesh
@@ -1,5 +1,5 @@
 // ======================================================================== //
-// Copyright 2018-2019 Ingo Wald                                            //
+// Copyright 2018-2020 Ingo Wald                                            //
 //                                                                          //
 // Licensed under the Apache License, Version 2.0 (the "License");          //
 // you may not use this file except in compliance with the License.         //
@@ -14,13 +14,17 @@
 // limitations under the License.                                           //
 // ======================================================================== //
 
-#include "tetty/umesh/UMesh.h"
+#pragma once
 
-namespace tetty {
+#include "umesh/UMesh.h"
+
+namespace umesh {
   namespace io {
-    
-    UMesh::SP createTestCase(const std::string &dataFileName);
-      
-  } // ::tetty::io
-} // ::tetty
 
+    /*! creates a synthetic test mesh of NxNxN unit hexes, with a
+        per-vertex scalar field of each vertex's distance to the
+        origin */
+    UMesh::SP createTestCase(int N);
+      
+  } // ::umesh::io
+} // ::umesh
@@ -0,0 +1,326 @@
+// ======================================================================== //
+// Copyright 2018-2020 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "umesh/io/UMeshStream.h"
+#include "umesh/parallel_for.h"
+#include <cstdio>
+#include <atomic>
+
+namespace umesh {
+  namespace io {
+
+    /* these have to match what UMesh::writeTo()/readFrom() use */
+    const size_t bum_magic     = 0x234235567ULL;
+    const size_t bum_magic_old = 0x234235566ULL;
+
+    // ==================================================================
+    // UMeshReader
+    // ==================================================================
+
+    UMeshReader::UMeshReader(const std::string &fileName)
+      : in(fileName, std::ios_base::binary),
+        fileName(fileName)
+    {
+      if (!in.good())
+        throw std::runtime_error("#umesh: could not open '"+fileName+"'");
+
+      bool supportsMultipleAttributes = true;
+      size_t magic;
+      readElement(in,magic);
+      if (magic != bum_magic) {
+        if (magic != bum_magic_old)
+          throw std::runtime_error("wrong magic number in umesh file ...");
+        supportsMultipleAttributes = false;
+      }
+      numVertices = skipVector(sizeof(vec3f),verticesOffset);
+
+      size_t numPerVertexAttributes = 1;
+      if (supportsMultipleAttributes)
+        readElement(in,numPerVertexAttributes);
+      for (size_t i=0;i<numPerVertexAttributes;i++) {
+        std::string name;
+        if (supportsMultipleAttributes)
+          readString(in,name);
+        size_t offset;
+        size_t num = skipVector(sizeof(float),offset);
+        if (i == 0) {
+          hasScalars    = true;
+          scalarsName   = name;
+          scalarsOffset = offset;
+          numScalars    = num;
+        }
+      }
+
+      size_t numPerElementAttributes = 0;
+      if (supportsMultipleAttributes)
+        readElement(in,numPerElementAttributes);
+      for (size_t i=0;i<numPerElementAttributes;i++) {
+        std::string name;
+        readString(in,name);
+        size_t offset;
+        size_t num = skipVector(sizeof(float),offset);
+        if (i == 0) {
+          hasCellScalars    = true;
+          cellScalarsName   = name;
+          cellScalarsOffset = offset;
+          numCellScalars    = num;
+        }
+      }
+
+      numTriangles = skipVector(sizeof(Triangle),trianglesOffset);
+      numQuads     = skipVector(sizeof(Quad),quadsOffset);
+      numTets      = skipVector(sizeof(Tet),tetsOffset);
+      numPyrs      = skipVector(sizeof(Pyr),pyrsOffset);
+      numWedges    = skipVector(sizeof(Wedge),wedgesOffset);
+      numHexes     = skipVector(sizeof(Hex),hexesOffset);
+      // vertex tags are optional (older files don't have them)
+      if (in.peek() != EOF)
+        numVertexTags = skipVector(sizeof(size_t),vertexTagsOffset);
+    }
+
+    size_t UMeshReader::skipVector(size_t elementSize, size_t &offset)
+    {
+      size_t N;
+      readElement(in,N);
+      offset = (size_t)in.tellg();
+      in.seekg(N*elementSize,std::ios::cur);
+      if (!in.good())
+        throw std::runtime_error("#umesh: truncated umesh file '"+fileName+"'");
+      return N;
+    }
+
+    template<typename T>
+    void UMeshReader::readRange(size_t offset, size_t numInFile,
+                                size_t begin, size_t count,
+                                std::vector<T> &result)
+    {
+      begin = std::min(begin,numInFile);
+      count = std::min(count,numInFile-begin);
+      result.resize(count);
+      if (count == 0) return;
+      in.clear();
+      in.seekg(offset+begin*sizeof(T),std::ios::beg);
+      readArray(in,result.data(),count);
+    }
+
+    void UMeshReader::readVertices(std::vector<vec3f> &vertices)
+    { readRange(verticesOffset,numVertices,0,numVertices,vertices); }
+
+    Attribute::SP UMeshReader::readScalars()
+    {
+      if (!hasScalars) return {};
+      Attribute::SP scalars = std::make_shared<Attribute>();
+      scalars->name = scalarsName;
+      readRange(scalarsOffset,numScalars,0,numScalars,scalars->values);
+      scalars->finalize();
+      return scalars;
+    }
+
+    Attribute::SP UMeshReader::readCellScalars()
+    {
+      if (!hasCellScalars) return {};
+      Attribute::SP scalars = std::make_shared<Attribute>();
+      scalars->name = cellScalarsName;
+      readRange(cellScalarsOffset,numCellScalars,0,numCellScalars,scalars->values);
+      scalars->finalize();
+      return scalars;
+    }
+
+    void UMeshReader::readTriangles(size_t begin, size_t count, std::vector<Triangle> &result)
+    { readRange(trianglesOffset,numTriangles,begin,count,result); }
+
+    void UMeshReader::readQuads(size_t begin, size_t count, std::vector<Quad> &result)
+    { readRange(quadsOffset,numQuads,begin,count,result); }
+
+    void UMeshReader::readTets(size_t begin, size_t count, std::vector<Tet> &result)
+    { readRange(tetsOffset,numTets,begin,count,result); }
+
+    void UMeshReader::readPyrs(size_t begin, size_t count, std::vector<Pyr> &result)
+    { readRange(pyrsOffset,numPyrs,begin,count,result); }
+
+    void UMeshReader::readWedges(size_t begin, size_t count, std::vector<Wedge> &result)
+    { readRange(wedgesOffset,numWedges,begin,count,result); }
+
+    void UMeshReader::readHexes(size_t begin, size_t count, std::vector<Hex> &result)
+    { readRange(hexesOffset,numHexes,begin,count,result); }
+
+    void UMeshReader::readVertexTags(std::vector<size_t> &result)
+    { readRange(vertexTagsOffset,numVertexTags,0,numVertexTags,result); }
+
+    // ==================================================================
+    // UMeshWriter
+    // ==================================================================
+
+    void UMeshWriter::Section::open(const std::string &fileName)
+    {
+      this->fileName = fileName;
+      out.open(fileName,std::ios_base::binary);
+      if (!out.good())
+        throw std::runtime_error("#umesh: could not create temp file '"+fileName+"'");
+    }
+
+    void UMeshWriter::Section::add(const void *data, size_t count, size_t elementSize)
+    {
+      out.write((const char *)data,count*elementSize);
+      if (!out.good())
+        throw std::runtime_error("#umesh: error writing to '"+fileName+"'");
+      this->count += count;
+    }
+
+    void UMeshWriter::Section::copyTo(std::ostream &dst,
+                                      const std::vector<int> *remap)
+    {
+      out.close();
+      writeElement(dst,count);
+      if (count) {
+        std::ifstream in(fileName,std::ios_base::binary);
+        if (!remap)
+          dst << in.rdbuf();
+        else {
+          // element types are all plain arrays of int indices
+          in.seekg(0,std::ios::end);
+          size_t numIndices = size_t(in.tellg()) / sizeof(int);
+          in.seekg(0,std::ios::beg);
+          std::vector<int> indices;
+          const size_t chunkSize = 16*1024*1024;
+          for (size_t chunkBegin=0;chunkBegin<numIndices;chunkBegin+=chunkSize) {
+            const size_t chunk = std::min(chunkSize,numIndices-chunkBegin);
+            indices.resize(chunk);
+            readArray(in,indices.data(),chunk);
+            std::atomic<bool> dropped(false);
+            parallel_for_blocked(0,chunk,64*1024,[&](size_t begin, size_t end){
+                for (size_t i=begin;i<end;i++) {
+                  const int idx = indices[i];
+                  indices[i]
+                    = (idx < 0 || size_t(idx) >= remap->size())
+                    ? -1
+                    : (*remap)[idx];
+                  if (indices[i] < 0)
+                    dropped = true;
+                }
+              });
+            if (dropped)
+              throw std::runtime_error("#umesh: element in '"+fileName
+                                       +"' refers to a vertex that got dropped");
+            writeArray(dst,indices.data(),chunk);
+          }
+        }
+      }
+      std::remove(fileName.c_str());
+    }
+
+    UMeshWriter::UMeshWriter(const std::string &fileName)
+      : fileName(fileName)
+    {
+      vertices.open(fileName+".tmp.vertices");
+      scalars.open(fileName+".tmp.scalars");
+      triangles.open(fileName+".tmp.triangles");
+      quads.open(fileName+".tmp.quads");
+      tets.open(fileName+".tmp.tets");
+      pyrs.open(fileName+".tmp.pyrs");
+      wedges.open(fileName+".tmp.wedges");
+      hexes.open(fileName+".tmp.hexes");
+      vertexTags.open(fileName+".tmp.vertexTags");
+    }
+
+    UMeshWriter::~UMeshWriter()
+    {
+      if (!closed)
+        try { close(); } catch (...) { /* nothing we can do here */ }
+    }
+
+    void UMeshWriter::setScalarsName(const std::string &name)
+    { scalarsName = name; }
+
+    void UMeshWriter::setVertexRemap(const std::vector<int> *newID)
+    { vertexRemap = newID; }
+
+    void UMeshWriter::addVertices(const vec3f *v, const float *s, size_t count)
+    {
+      if (vertices.count && ((s != nullptr) != (scalars.count != 0)))
+        throw std::runtime_error("#umesh: either all or no vertices need scalars");
+      vertices.add(v,count,sizeof(*v));
+      if (s)
+        scalars.add(s,count,sizeof(*s));
+    }
+
+    void UMeshWriter::addTriangles(const Triangle *prims, size_t count)
+    { triangles.add(prims,count,sizeof(*prims)); }
+
+    void UMeshWriter::addQuads(const Quad *prims, size_t count)
+    { quads.add(prims,count,sizeof(*prims)); }
+
+    void UMeshWriter::addTets(const Tet *prims, size_t count)
+    { tets.add(prims,count,sizeof(*prims)); }
+
+    void UMeshWriter::addPyrs(const Pyr *prims, size_t count)
+    { pyrs.add(prims,count,sizeof(*prims)); }
+
+    void UMeshWriter::addWedges(const Wedge *prims, size_t count)
+    { wedges.add(prims,count,sizeof(*prims)); }
+
+    void UMeshWriter::addHexes(const Hex *prims, size_t count)
+    { hexes.add(prims,count,sizeof(*prims)); }
+
+    void UMeshWriter::addVertexTags(const size_t *tags, size_t count)
+    { vertexTags.add(tags,count,sizeof(*tags)); }
+
+    void UMeshWriter::close()
+    {
+      if (closed) return;
+      closed = true;
+
+      std::ofstream out(fileName,std::ios_base::binary);
+      if (!out.good())
+        throw std::runtime_error("#umesh: could not open '"+fileName+"' for writing");
+      writeElement(out,bum_magic);
+      vertices.copyTo(out);
+
+      // same layout as UMesh::writeTo(): numPerVertexAttributes, then
+      // name and values for each
+      const bool hasScalars = (scalars.count > 0);
+      if (hasScalars && scalars.count != vertices.count)
+        throw std::runtime_error("#umesh: number of scalars does not match"
+                                 " number of vertices");
+      size_t numPerVertexAttributes = hasScalars ? 1 : 0;
+      writeElement(out,numPerVertexAttributes);
+      if (hasScalars)
+        writeString(out,scalarsName);
+      if (hasScalars)
+        scalars.copyTo(out);
+      else {
+        scalars.out.close();
+        std::remove(scalars.fileName.c_str());
+      }
+      size_t numPerElementAttributes = 0;
+      writeElement(out,numPerElementAttributes);
+
+      triangles.copyTo(out,vertexRemap);
+      quads.copyTo(out,vertexRemap);
+      tets.copyTo(out,vertexRemap);
+      pyrs.copyTo(out,vertexRemap);
+      wedges.copyTo(out,vertexRemap);
+      hexes.copyTo(out,vertexRemap);
+      if (vertexTags.count && vertexTags.count != vertices.count)
+        throw std::runtime_error("#umesh: number of vertex tags does not match"
+                                 " number of vertices");
+      vertexTags.copyTo(out);
+      if (!out.good())
+        throw std::runtime_error("#umesh: error writing '"+fileName+"'");
+    }
+
+  } // ::umesh::io
+} // ::umesh
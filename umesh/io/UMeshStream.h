@@ -0,0 +1,178 @@
+// ======================================================================== //
+// Copyright 2018-2020 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "umesh/UMesh.h"
+#include "umesh/io/IO.h"
+
+/* helper classes for reading and writing .umesh files (the format
+   used by UMesh::saveTo()/UMesh::loadFrom()) piece by piece, without
+   ever having to hold the entire mesh in memory */
+
+namespace umesh {
+  namespace io {
+
+    /*! reads a .umesh file section by section. the constructor only
+        parses the file's header, and records where in the file each
+        of the arrays lives; the actual data is only read on request,
+        and element arrays can be read in arbitrary sub-ranges
+        (chunks) */
+    struct UMeshReader {
+      UMeshReader(const std::string &fileName);
+
+      /*! read the full vertex array */
+      void readVertices(std::vector<vec3f> &vertices);
+
+      /*! read the (first) per-vertex scalar field, if the file
+          contains one. returns null if it does not */
+      Attribute::SP readScalars();
+
+      /*! read the (first) per-element scalar field (see
+          UMesh::perElement), if the file contains one. returns null if
+          it does not */
+      Attribute::SP readCellScalars();
+
+      /*! read elements [begin,begin+count) of the given type; count
+          will get clamped to the number of elements actually in the
+          file */
+      void readTriangles(size_t begin, size_t count, std::vector<Triangle> &result);
+      void readQuads(size_t begin, size_t count, std::vector<Quad> &result);
+      void readTets(size_t begin, size_t count, std::vector<Tet> &result);
+      void readPyrs(size_t begin, size_t count, std::vector<Pyr> &result);
+      void readWedges(size_t begin, size_t count, std::vector<Wedge> &result);
+      void readHexes(size_t begin, size_t count, std::vector<Hex> &result);
+
+      /*! read the per-vertex tags; result is empty if the file does
+          not have any */
+      void readVertexTags(std::vector<size_t> &result);
+
+      size_t numVertices  = 0;
+      size_t numTriangles = 0;
+      size_t numQuads     = 0;
+      size_t numTets      = 0;
+      size_t numPyrs      = 0;
+      size_t numWedges    = 0;
+      size_t numHexes     = 0;
+      size_t numVertexTags = 0;
+
+    private:
+      template<typename T>
+      void readRange(size_t offset, size_t numInFile,
+                     size_t begin, size_t count,
+                     std::vector<T> &result);
+
+      /*! read the vector count at current position, record the
+          offset of its data, and skip over it */
+      size_t skipVector(size_t elementSize, size_t &offset);
+
+      std::ifstream in;
+      const std::string fileName;
+
+      /*! file offsets of the _data_ of the respective arrays (ie,
+          right after each array's size_t count) */
+      size_t verticesOffset  = 0;
+      size_t scalarsOffset   = 0;
+      size_t numScalars      = 0;
+      std::string scalarsName;
+      bool   hasScalars      = false;
+      size_t cellScalarsOffset = 0;
+      size_t numCellScalars    = 0;
+      std::string cellScalarsName;
+      bool   hasCellScalars    = false;
+      size_t trianglesOffset = 0;
+      size_t quadsOffset     = 0;
+      size_t tetsOffset      = 0;
+      size_t pyrsOffset      = 0;
+      size_t wedgesOffset    = 0;
+      size_t hexesOffset     = 0;
+      size_t vertexTagsOffset = 0;
+    };
+
+    /*! writes a .umesh file from pieces that can be added in any
+        order, and in as many chunks as desired. since the file format
+        requires each array to be stored contiguously (and with its
+        size up front), each array gets spilled to its own temporary
+        file while writing; close() then stitches those together into
+        the final .umesh file, and removes the temporaries. Memory use
+        is thus independent of the size of the mesh being written.
+        Files written this way never have a per-element attribute */
+    struct UMeshWriter {
+      UMeshWriter(const std::string &fileName);
+      /*! will call close() if not done explicitly */
+      ~UMeshWriter();
+
+      /*! sets the name of the per-vertex scalar field. Note that
+          _either_ all or none of the vertices have to come with
+          scalars */
+      void setScalarsName(const std::string &name);
+
+      /*! append vertices (and, optionally, their scalars - can be
+          null if the mesh has no scalars) */
+      void addVertices(const vec3f *vertices, const float *scalars, size_t count);
+      void addTriangles(const Triangle *prims, size_t count);
+      void addQuads(const Quad *prims, size_t count);
+      void addTets(const Tet *prims, size_t count);
+      void addPyrs(const Pyr *prims, size_t count);
+      void addWedges(const Wedge *prims, size_t count);
+      void addHexes(const Hex *prims, size_t count);
+
+      /*! append per-vertex tags (see UMesh::vertexTag); if any are
+          added at all, there have to be as many as there are
+          vertices by the time the file gets closed */
+      void addVertexTags(const size_t *tags, size_t count);
+
+      /*! number of vertices added so far */
+      size_t numVertices() const { return vertices.count; }
+
+      /*! have close() translate every element's vertex indices
+          through the given table (newID[oldID]; -1 for vertices that
+          got dropped). Since sections can be added in any order this
+          lets a producer emit elements first, and then add only
+          those vertices that actually got used. Table must stay
+          alive until close() */
+      void setVertexRemap(const std::vector<int> *newID);
+
+      /*! assemble final file from all pieces added so far */
+      void close();
+
+      /*! one array of the output file, spilled to a temp file */
+      struct Section {
+        void open(const std::string &fileName);
+        void add(const void *data, size_t count, size_t elementSize);
+        /*! copy this section's data - with its size_t count prefix -
+            to given output stream, then delete the temp file. If
+            'remap' is specified the section is taken to be an array
+            of vertex indices, each of which gets translated */
+        void copyTo(std::ostream &out,
+                    const std::vector<int> *remap = nullptr);
+
+        std::string   fileName;
+        std::ofstream out;
+        size_t        count = 0;
+      };
+    private:
+      const std::string fileName;
+      std::string scalarsName;
+      bool        closed = false;
+      const std::vector<int> *vertexRemap = nullptr;
+
+      Section vertices, scalars, triangles, quads, tets, pyrs, wedges, hexes;
+      Section vertexTags;
+    };
+
+  } // ::umesh::io
+} // ::umesh
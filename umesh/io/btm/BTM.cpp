@@ -21,10 +21,12 @@
 namespace umesh {
   namespace btm {
 
-    static Mesh::SP load(const std::string &fileName)
+    Mesh::SP Mesh::load(const std::string &fileName)
     {
       Mesh::SP mesh = std::make_shared<Mesh>();
       std::ifstream in(fileName,std::ios::binary);
+      if (!in.good())
+        throw std::runtime_error("#umesh: could not open '"+fileName+"'");
       mesh->loadFrom(in);
       return mesh;
     }
@@ -42,6 +44,8 @@ namespace umesh {
     void Mesh::save(const std::string &fileName) const
     {
       std::ofstream out(fileName,std::ios::binary);
+      if (!out.good())
+        throw std::runtime_error("#umesh: could not open '"+fileName+"' for writing");
       saveTo(out);
     }
       
@@ -55,5 +59,47 @@ namespace umesh {
       io::writeVector(out,triColor);
     }
       
+    /*! converts the surface elements of given umesh to a btm mesh;
+        quads get split into two triangles along the diagonal through
+        their lowest vertex index */
+    Mesh::SP fromUMesh(UMesh::SP in)
+    {
+      Mesh::SP mesh = std::make_shared<Mesh>();
+      mesh->vertex = in->vertices;
+      const size_t numTris = in->triangles.size();
+      mesh->index.resize(numTris+2*in->quads.size());
+      parallel_for_blocked(0,numTris,16*1024,[&](size_t begin, size_t end){
+          for (size_t i=begin;i<end;i++)
+            mesh->index[i] = in->triangles[i];
+        });
+      parallel_for_blocked(0,in->quads.size(),16*1024,[&](size_t begin, size_t end){
+          for (size_t i=begin;i<end;i++) {
+            vec4i index = in->quads[i];
+            int lowest = arg_min(index);
+            mesh->index[numTris+2*i+0] = vec3i(index[(lowest+0)%4],
+                                               index[(lowest+1)%4],
+                                               index[(lowest+2)%4]);
+            mesh->index[numTris+2*i+1] = vec3i(index[(lowest+0)%4],
+                                               index[(lowest+2)%4],
+                                               index[(lowest+3)%4]);
+          }
+        });
+      return mesh;
+    }
+
+    /*! creates a umesh with the btm mesh's vertices and triangles */
+    UMesh::SP toUMesh(Mesh::SP in)
+    {
+      UMesh::SP mesh = std::make_shared<UMesh>();
+      mesh->vertices = in->vertex;
+      mesh->triangles.resize(in->index.size());
+      parallel_for_blocked(0,in->index.size(),16*1024,[&](size_t begin, size_t end){
+          for (size_t i=begin;i<end;i++)
+            mesh->triangles[i] = in->index[i];
+        });
+      mesh->finalize();
+      return mesh;
+    }
+      
   } // ::umesh::btm
 } // ::umesh
@@ -60,6 +60,16 @@ namespace umesh {
         'index' */
       std::vector<vec3f> triColor;
     };
+
+    /*! converts the surface elements of given umesh to a btm mesh
+        (with only vertices and indices set); quads get split into two
+        triangles along the diagonal through their lowest vertex
+        index, volume elements get ignored */
+    Mesh::SP fromUMesh(UMesh::SP mesh);
+
+    /*! creates a umesh with the btm mesh's vertices and triangles;
+        all other vertex/triangle data gets dropped */
+    UMesh::SP toUMesh(Mesh::SP mesh);
       
   } // ::umesh::btm
 } // ::umesh
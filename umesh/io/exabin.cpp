@@ -0,0 +1,169 @@
+// ======================================================================== //
+// Copyright 2018-2020 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "umesh/io/exabin.h"
+#include "umesh/io/IO.h"
+#if UMESH_HAVE_TBB
+# include "tbb/parallel_sort.h"
+#endif
+#include <algorithm>
+
+namespace umesh {
+  namespace io {
+
+    /*! one record in a .cells file */
+    struct ExaCell {
+      vec3i pos;
+      int   level;
+    };
+
+    /*! one hex corner, with the (lattice) position it is at, and
+        where in the hex array it belongs (8*hexID+cornerID) */
+    struct ExaCorner {
+      inline bool operator<(const ExaCorner &other) const
+      {
+        if (pos.x != other.pos.x) return pos.x < other.pos.x;
+        if (pos.y != other.pos.y) return pos.y < other.pos.y;
+        if (pos.z != other.pos.z) return pos.z < other.pos.z;
+        return ref < other.ref;
+      }
+      vec3i    pos;
+      uint32_t ref;
+    };
+
+    /*! reads the entire (binary) file into an array of T's */
+    template<typename T>
+    void readAll(const std::string &fileName, std::vector<T> &result)
+    {
+      std::ifstream in(fileName,std::ios::binary|std::ios::ate);
+      if (!in.good())
+        throw std::runtime_error("#umesh: could not open '"+fileName+"'");
+      const size_t numBytes = (size_t)in.tellg();
+      if (numBytes % sizeof(T))
+        throw std::runtime_error("#umesh: size of '"+fileName+"' is not"
+                                 " a multiple of its record size");
+      result.resize(numBytes/sizeof(T));
+      in.seekg(0);
+      readArray(in,result.data(),result.size());
+    }
+
+    UMesh::SP loadExaBin(const std::string &cellsFileName,
+                         const std::string &scalarsFileName)
+    {
+      std::vector<ExaCell> cells;
+      readAll(cellsFileName,cells);
+      std::vector<float> cellScalars;
+      if (scalarsFileName != "") {
+        readAll(scalarsFileName,cellScalars);
+        if (cellScalars.size() != cells.size())
+          throw std::runtime_error("#umesh: number of scalars in '"+scalarsFileName
+                                   +"' does not match number of cells in '"
+                                   +cellsFileName+"'");
+      }
+      const size_t numCells = cells.size();
+      if (8*numCells > size_t(std::numeric_limits<uint32_t>::max()))
+        throw std::runtime_error("#umesh: too many cells in '"+cellsFileName+"'");
+
+      // all hex corners, in VTK order
+      const vec3i cornerOffset[8] = {
+        {0,0,0},{1,0,0},{1,1,0},{0,1,0},
+        {0,0,1},{1,0,1},{1,1,1},{0,1,1}
+      };
+      const size_t numCorners = 8*numCells;
+      std::vector<ExaCorner> corners(numCorners);
+      parallel_for_blocked(0,numCells,16*1024,[&](size_t begin, size_t end){
+          for (size_t i=begin;i<end;i++) {
+            const int width = 1 << cells[i].level;
+            for (int c=0;c<8;c++)
+              corners[8*i+c] = { cells[i].pos+cornerOffset[c]*width,
+                                 uint32_t(8*i+c) };
+          }
+        });
+
+      // weld: sort all corners by position; each run of equal
+      // positions becomes one vertex
+#if UMESH_HAVE_TBB
+      tbb::parallel_sort(corners.begin(),corners.end());
+#else
+      std::sort(corners.begin(),corners.end());
+#endif
+      
+      const size_t blockSize = 64*1024;
+      const size_t numBlocks = divRoundUp(numCorners,blockSize);
+      std::vector<size_t> blockVertexBegin(numBlocks+1,0);
+      parallel_for(numBlocks,[&](size_t block){
+          const size_t begin = block*blockSize;
+          const size_t end   = std::min(begin+blockSize,numCorners);
+          size_t count = 0;
+          for (size_t i=begin;i<end;i++)
+            if (i == 0 || corners[i].pos != corners[i-1].pos) ++count;
+          blockVertexBegin[block+1] = count;
+        });
+      for (size_t b=0;b<numBlocks;b++)
+        blockVertexBegin[b+1] += blockVertexBegin[b];
+      const size_t numVertices = blockVertexBegin[numBlocks];
+      if (numVertices > (size_t)std::numeric_limits<int>::max())
+        throw std::runtime_error("#umesh: too many vertices for 32-bit vertex indices");
+
+      UMesh::SP mesh = std::make_shared<UMesh>();
+      mesh->vertices.resize(numVertices);
+      mesh->hexes.resize(numCells);
+      if (!cellScalars.empty()) {
+        mesh->perVertex = std::make_shared<Attribute>();
+        mesh->perVertex->values.resize(numVertices);
+      }
+      // each block handles all runs that _start_ within it (which
+      // may extend into the next block). Each run already is the
+      // (sorted) list of cells using that vertex, so the scalars get
+      // averaged right here rather than with cellToVertex(), which
+      // would have to rebuild just that adjacency
+      parallel_for(numBlocks,[&](size_t block){
+          const size_t begin = block*blockSize;
+          const size_t end   = std::min(begin+blockSize,numCorners);
+          int vertexID = int(blockVertexBegin[block])-1;
+          size_t i = begin;
+          // skip the tail of a run that started in the previous block
+          while (i < end && i > 0 && corners[i].pos == corners[i-1].pos) ++i;
+          while (i < end) {
+            ++vertexID;
+            const vec3i pos = corners[i].pos;
+            mesh->vertices[vertexID] = vec3f(pos);
+            double sum = 0.;
+            size_t count = 0;
+            for (;i<numCorners && corners[i].pos == pos;i++) {
+              const uint32_t ref = corners[i].ref;
+              mesh->hexes[ref/8][ref%8] = vertexID;
+              if (!cellScalars.empty()) {
+                sum += cellScalars[ref/8];
+                ++count;
+              }
+            }
+            if (count)
+              mesh->perVertex->values[vertexID] = float(sum/count);
+          }
+        });
+      if (mesh->perVertex) {
+        mesh->perVertex->finalize();
+        mesh->perElement = std::make_shared<Attribute>();
+        mesh->perElement->values = std::move(cellScalars);
+        mesh->perElement->finalize();
+      }
+      mesh->finalize();
+      return mesh;
+    }
+
+  } // ::umesh::io
+} // ::umesh
@@ -0,0 +1,36 @@
+// ======================================================================== //
+// Copyright 2018-2020 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "umesh/UMesh.h"
+
+namespace umesh {
+  namespace io {
+
+    /*! loads an 'exabin' AMR data set - a .cells file with one
+        {vec3i pos; int level} record per cell (a cube of width
+        1<<level, with its lower corner at pos), plus (optionally) a
+        .scalars file with one float per cell - as a hex mesh. Hex
+        corners at the same lattice position get welded into a single
+        vertex. The per-cell scalars become the mesh's perElement
+        attribute; each vertex's scalar is the average of the scalars
+        of all cells that share it */
+    UMesh::SP loadExaBin(const std::string &cellsFileName,
+                         const std::string &scalarsFileName = "");
+
+  } // ::umesh::io
+} // ::umesh
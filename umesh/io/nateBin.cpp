@@ -0,0 +1,78 @@
+// ======================================================================== //
+// Copyright 2018-2020 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "umesh/io/nateBin.h"
+#include "umesh/io/IO.h"
+#include "umesh/convertAttributes.h"
+#include <atomic>
+
+namespace umesh {
+  namespace io {
+
+    UMesh::SP loadNateBin(const std::string &fileName)
+    {
+      std::ifstream in(fileName,std::ios::binary);
+      if (!in.good())
+        throw std::runtime_error("#umesh: could not open '"+fileName+"'");
+
+      uint32_t pointsPerPrim, numPoints, numIndices;
+      uint8_t  dataIsPerCell;
+      readElement(in,pointsPerPrim);
+      readElement(in,numPoints);
+      readElement(in,numIndices);
+      readElement(in,dataIsPerCell);
+      if (pointsPerPrim != 4)
+        throw std::runtime_error("#umesh: '"+fileName+"' has "
+                                 +std::to_string(pointsPerPrim)
+                                 +" points per prim (only tets are supported)");
+      const size_t numTets = numIndices/4;
+      
+      UMesh::SP mesh = std::make_shared<UMesh>();
+      mesh->vertices.resize(numPoints);
+      readArray(in,mesh->vertices.data(),numPoints);
+
+      std::vector<float> scalars(dataIsPerCell ? numTets : numPoints);
+      readArray(in,scalars.data(),scalars.size());
+      
+      mesh->tets.resize(numTets);
+      readArray(in,mesh->tets.data(),numTets);
+
+      std::atomic<bool> invalidIndex(false);
+      parallel_for_blocked(0,numTets,16*1024,[&](size_t begin, size_t end){
+          for (size_t i=begin;i<end;i++)
+            for (int j=0;j<4;j++)
+              if ((uint32_t)mesh->tets[i][j] >= numPoints)
+                invalidIndex = true;
+        });
+      if (invalidIndex)
+        throw std::runtime_error("#umesh: invalid vertex index in '"+fileName+"'");
+
+      if (dataIsPerCell) {
+        mesh->perElement = std::make_shared<Attribute>();
+        mesh->perElement->values = std::move(scalars);
+        mesh->perElement->finalize();
+        mesh->perVertex = cellToVertex(mesh,mesh->perElement);
+      } else {
+        mesh->perVertex = std::make_shared<Attribute>();
+        mesh->perVertex->values = std::move(scalars);
+        mesh->perVertex->finalize();
+      }
+      mesh->finalize();
+      return mesh;
+    }
+
+  } // ::umesh::io
+} // ::umesh
@@ -1,5 +1,5 @@
 // ======================================================================== //
-// Copyright 2018-2019 Ingo Wald                                            //
+// Copyright 2018-2020 Ingo Wald                                            //
 //                                                                          //
 // Licensed under the Apache License, Version 2.0 (the "License");          //
 // you may not use this file except in compliance with the License.         //
@@ -16,14 +16,19 @@
 
 #pragma once
 
-#include "tetty/io/IO.h"
-#include "tetty/umesh/UMesh.h"
+#include "umesh/UMesh.h"
 
-namespace tetty {
+namespace umesh {
   namespace io {
 
-    UMesh::SP importExaBin(const std::string &hexFileName,
-                           const std::string &scalarFileName);
+    /*! loads a tet mesh in Nate's binary format: a header of
+        {uint32 pointsPerPrim, numPoints, numIndices; uint8
+        dataIsPerCell}, followed by the vertex positions (float3),
+        one float scalar per vertex (or per cell, if dataIsPerCell is
+        set), and the 32-bit vertex indices of all tets. Per-cell
+        scalars get stored as the mesh's perElement attribute, and
+        averaged to the vertices for its perVertex one */
+    UMesh::SP loadNateBin(const std::string &fileName);
 
-  } // ::tetty::io
-} // ::tetty
+  } // ::umesh::io
+} // ::umesh
@@ -0,0 +1,48 @@
+// ======================================================================== //
+// Copyright 2018-2020 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "umesh/io/obj.h"
+#include "umesh/io/text.h"
+
+namespace umesh {
+  namespace io {
+
+    /*! writes the surface elements (triangles and quads) of given
+        mesh in wavefront OBJ format */
+    void saveOBJ(const std::string &fileName, UMesh::SP mesh)
+    {
+      std::ofstream out(fileName,std::ios::binary);
+      if (!out.good())
+        throw std::runtime_error("#umesh: could not open '"+fileName+"' for writing");
+      writeTextParallel(out,mesh->vertices.size(),[&](TextBlock &out, size_t i){
+          const vec3f v = mesh->vertices[i];
+          out << "v " << v.x << " " << v.y << " " << v.z << "\n";
+        });
+      writeTextParallel(out,mesh->triangles.size(),[&](TextBlock &out, size_t i){
+          const Triangle t = mesh->triangles[i];
+          out << "f " << (t.x+1) << " " << (t.y+1) << " " << (t.z+1) << "\n";
+        });
+      writeTextParallel(out,mesh->quads.size(),[&](TextBlock &out, size_t i){
+          const Quad q = mesh->quads[i];
+          out << "f " << (q.x+1) << " " << (q.y+1)
+              << " " << (q.z+1) << " " << (q.w+1) << "\n";
+        });
+      if (!out.good())
+        throw std::runtime_error("#umesh: error writing '"+fileName+"'");
+    }
+
+  } // ::umesh::io
+} // ::umesh
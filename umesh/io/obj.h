@@ -1,5 +1,5 @@
 // ======================================================================== //
-// Copyright 2018-2019 Ingo Wald                                            //
+// Copyright 2018-2020 Ingo Wald                                            //
 //                                                                          //
 // Licensed under the Apache License, Version 2.0 (the "License");          //
 // you may not use this file except in compliance with the License.         //
@@ -16,13 +16,16 @@
 
 #pragma once
 
-#include "tetty/io/IO.h"
-#include "tetty/umesh/UMesh.h"
+#include "umesh/UMesh.h"
 
-namespace tetty {
+namespace umesh {
   namespace io {
 
-    UMesh::SP importNateBIN(const std::string &fileName);
+    /*! writes the surface elements (triangles and quads) of given
+        mesh in wavefront OBJ format; volume elements get
+        ignored. Formatting happens in parallel (see
+        writeTextParallel()) */
+    void saveOBJ(const std::string &fileName, UMesh::SP mesh);
 
-  } // ::tetty::io
-} // ::tetty
+  } // ::umesh::io
+} // ::umesh
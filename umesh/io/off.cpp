@@ -0,0 +1,115 @@
+// ======================================================================== //
+// Copyright 2018-2020 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "umesh/io/off.h"
+#include "umesh/io/text.h"
+#include <atomic>
+#include <cstring>
+
+namespace umesh {
+  namespace io {
+
+    /*! skips whitespace, then parses the next number in [s,lineEnd) */
+    template<typename T>
+    inline void nextNumber(const char *&s, const char *lineEnd, T &v)
+    {
+      while (s < lineEnd && isSpace(*s)) ++s;
+      if (s == lineEnd)
+        throw std::runtime_error("#umesh: missing value in off file");
+      parseNumber(s,lineEnd,v);
+    }
+
+    /*! reads the entire file, then parses its lines in parallel: the
+        first line has the number of vertices and tets, followed by one
+        line per vertex (position and scalar), and one per tet */
+    UMesh::SP loadOFF(const std::string &fileName)
+    {
+      std::vector<char> text;
+      readEntireFile(fileName,text);
+      const char *begin = text.data();
+      const char *end   = text.data()+text.size()-1;
+
+      UMesh::SP mesh = std::make_shared<UMesh>();
+      mesh->perVertex = std::make_shared<Attribute>();
+
+      const char *s = begin;
+      while (s < end && isSpace(*s)) ++s;
+      const char *eol = (const char *)memchr(s,'\n',end-s);
+      if (!eol) eol = end;
+      int64_t numVerts, numTets;
+      nextNumber(s,eol,numVerts);
+      nextNumber(s,eol,numTets);
+
+      mesh->vertices.resize(numVerts);
+      mesh->perVertex->values.resize(numVerts);
+      std::vector<vec4i> tets(numTets);
+      const size_t numLines
+        = parseLinesParallel(eol,end,[&](size_t lineID,
+                                         const char *lineBegin,
+                                         const char *lineEnd) {
+            const char *s = lineBegin;
+            if (lineID < (size_t)numVerts) {
+              vec3f &v = mesh->vertices[lineID];
+              double f;
+              nextNumber(s,lineEnd,v.x);
+              nextNumber(s,lineEnd,v.y);
+              nextNumber(s,lineEnd,v.z);
+              nextNumber(s,lineEnd,f);
+              mesh->perVertex->values[lineID] = (float)f;
+            } else if (lineID < size_t(numVerts+numTets)) {
+              vec4i &tet = tets[lineID-numVerts];
+              nextNumber(s,lineEnd,tet.x);
+              nextNumber(s,lineEnd,tet.y);
+              nextNumber(s,lineEnd,tet.z);
+              nextNumber(s,lineEnd,tet.w);
+            }
+          });
+      if (numLines < size_t(numVerts+numTets))
+        throw std::runtime_error("#umesh: off file '"+fileName+"' is truncated");
+
+      // swap order if required, and mark (to then drop) flat tets
+      std::atomic<bool> invalidIndex(false);
+      parallel_for_blocked(0,numTets,16*1024,[&](size_t begin, size_t end){
+          for (size_t i=begin;i<end;i++) {
+            vec4i &tet = tets[i];
+            if (std::min(std::min(tet.x,tet.y),std::min(tet.z,tet.w)) < 0 ||
+                std::max(std::max(tet.x,tet.y),std::max(tet.z,tet.w)) >= numVerts) {
+              invalidIndex = true;
+              return;
+            }
+            const vec3f v0 = mesh->vertices[tet.x];
+            const vec3f v1 = mesh->vertices[tet.y];
+            const vec3f v2 = mesh->vertices[tet.z];
+            const vec3f v3 = mesh->vertices[tet.w];
+            float volume = dot(v3-v0,cross(v1-v0,v2-v0));
+            if (volume == 0.f)
+              tet = vec4i(-1);
+            else if (volume < 0.f)
+              std::swap(tet.y,tet.w);
+          }
+        });
+      if (invalidIndex)
+        throw std::runtime_error("#umesh: invalid vertex index in off file '"+fileName+"'");
+      mesh->tets.reserve(numTets);
+      for (auto tet : tets)
+        if (tet.x >= 0)
+          mesh->tets.push_back(tet);
+      mesh->finalize();
+      return mesh;
+    }
+
+  } // ::umesh::io
+} // ::umesh
@@ -1,5 +1,5 @@
 // ======================================================================== //
-// Copyright 2018-2019 Ingo Wald                                            //
+// Copyright 2018-2020 Ingo Wald                                            //
 //                                                                          //
 // Licensed under the Apache License, Version 2.0 (the "License");          //
 // you may not use this file except in compliance with the License.         //
@@ -16,13 +16,18 @@
 
 #pragma once
 
-#include "tetty/io/IO.h"
-#include "tetty/umesh/UMesh.h"
+#include "umesh/UMesh.h"
 
-namespace tetty {
+namespace umesh {
   namespace io {
 
-    UMesh::SP importOFF(const std::string &fileName);
+    /*! loads a tet mesh in the (text-based) 'off' format used by some
+        tet-mesh generators: a first line with the number of vertices
+        and tets, followed by one line per vertex (position plus a
+        scalar), and one line per tet (four 0-based vertex
+        indices). Tets with negative volume get re-oriented, and flat
+        tets get dropped */
+    UMesh::SP loadOFF(const std::string &fileName);
 
-  } // ::tetty::io
-} // ::tetty
+  } // ::umesh::io
+} // ::umesh
@@ -0,0 +1,136 @@
+// ======================================================================== //
+// Copyright 2018-2020 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+
+#include "umesh/io/text.h"
+#include <cstdio>
+#include <cstdlib>
+#if defined(__has_include)
+# if __has_include(<charconv>)
+#  include <charconv>
+# endif
+#endif
+
+/* std::to_chars/from_chars for floating point types give shortest
+   round-trip formatting and fast parsing, but are only available with
+   newer standard libraries; we fall back to printf/strtod otherwise */
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+# define UMESH_HAVE_FLOAT_CHARCONV 1
+#endif
+
+namespace umesh {
+  namespace io {
+
+    TextBlock &TextBlock::operator<<(float f)
+    {
+      char buf[32];
+#if UMESH_HAVE_FLOAT_CHARCONV
+      text.append(buf,std::to_chars(buf,buf+sizeof(buf),f).ptr);
+#else
+      text.append(buf,snprintf(buf,sizeof(buf),"%.9g",f));
+#endif
+      return *this;
+    }
+
+    TextBlock &TextBlock::operator<<(double f)
+    {
+      char buf[32];
+#if UMESH_HAVE_FLOAT_CHARCONV
+      text.append(buf,std::to_chars(buf,buf+sizeof(buf),f).ptr);
+#else
+      text.append(buf,snprintf(buf,sizeof(buf),"%.17g",f));
+#endif
+      return *this;
+    }
+
+    void readEntireFile(const std::string &fileName, std::vector<char> &data)
+    {
+      std::ifstream in(fileName, std::ios_base::binary);
+      if (!in.good())
+        throw std::runtime_error("#umesh: could not open '"+fileName+"'");
+      in.seekg(0,std::ios::end);
+      const size_t size = (size_t)in.tellg();
+      in.seekg(0,std::ios::beg);
+      data.resize(size+1);
+      in.read(data.data(),size);
+      if (!in.good())
+        throw std::runtime_error("#umesh: error reading '"+fileName+"'");
+      data[size] = 0;
+    }
+
+    inline void invalidNumber(const char *s, const char *end)
+    {
+      const char *e = s;
+      while (e < end && e < s+32 && !isSpace(*e)) ++e;
+      throw std::runtime_error("#umesh: invalid number '"+std::string(s,e)
+                               +"' in text data");
+    }
+
+    template<typename T>
+    inline void parseFloat(const char *&s, const char *end, T &v)
+    {
+#if UMESH_HAVE_FLOAT_CHARCONV
+      // (from_chars doesn't accept a leading '+')
+      const char *b = (s < end && *s == '+') ? s+1 : s;
+      auto result = std::from_chars(b,end,v);
+      if (result.ec == std::errc::result_out_of_range)
+        // (from_chars rejects values that under- or overflow; treat
+        // those the same way strtod would, as zero or infinity)
+        v = (T)strtod(b,nullptr);
+      else if (result.ec != std::errc() || result.ptr == b)
+        invalidNumber(s,end);
+      s = result.ptr;
+#else
+      char *e;
+      v = (T)strtod(s,&e);
+      if (e == s) invalidNumber(s,end);
+      s = e;
+#endif
+    }
+
+    void parseNumber(const char *&s, const char *end, float &v)
+    { parseFloat(s,end,v); }
+
+    void parseNumber(const char *&s, const char *end, double &v)
+    { parseFloat(s,end,v); }
+
+    void parseNumber(const char *&s, const char *end, int64_t &v)
+    {
+      const char *begin = s;
+      bool negative = false;
+      if (s < end && (*s == '-' || *s == '+'))
+        negative = (*s++ == '-');
+      if (s == end || *s < '0' || *s > '9')
+        invalidNumber(begin,end);
+      uint64_t u = 0;
+      while (s < end && *s >= '0' && *s <= '9')
+        u = 10*u + (*s++ - '0');
+      v = negative ? -int64_t(u) : int64_t(u);
+    }
+
+    const char *skipTokens(const char *s, const char *end, size_t count)
+    {
+      for (size_t i=0;i<count;i++) {
+        while (s < end && isSpace(*s)) ++s;
+        if (s == end)
+          throw std::runtime_error("#umesh: unexpected end of text data");
+        while (s < end && !isSpace(*s)) ++s;
+      }
+      return s;
+    }
+
+  } // ::umesh::io
+} // ::umesh
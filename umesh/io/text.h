@@ -0,0 +1,238 @@
+// ======================================================================== //
+// Copyright 2018-2020 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+
+#pragma once
+
+#include "umesh/UMesh.h"
+#include "umesh/io/IO.h"
+#include <cstring>
+#include <type_traits>
+
+/* helpers for fast reading and writing of text-based file formats
+   (obj, off, .ts, ascii vtk, ...): formatting happens into in-memory
+   blocks (in parallel, and without any iostream/locale overhead)
+   that then get written with large writes; parsing happens in
+   parallel on the entire file's contents, after splitting it into
+   chunks at token or line boundaries */
+
+namespace umesh {
+  namespace io {
+
+    // ==================================================================
+    // writing
+    // ==================================================================
+
+    /*! a block of text that gets assembled in memory. Integers get
+        formatted with a simple hand-rolled loop, floats in their
+        shortest representation that still reads back to the exact
+        same value */
+    struct TextBlock {
+      inline TextBlock &operator<<(const char *s) { text.append(s); return *this; }
+      inline TextBlock &operator<<(const std::string &s) { text.append(s); return *this; }
+      inline TextBlock &operator<<(char c) { text.push_back(c); return *this; }
+      TextBlock &operator<<(float f);
+      TextBlock &operator<<(double f);
+
+      /*! all integer types (other than char) */
+      template<typename T>
+      inline typename std::enable_if<std::is_integral<T>::value,TextBlock &>::type
+      operator<<(T i)
+      {
+        char buf[24];
+        char *end = buf+sizeof(buf), *s = end;
+        const bool negative = (i < 0);
+        // (go through unsigned, so even the most negative value works)
+        typename std::make_unsigned<T>::type u = i;
+        if (negative) u = 0-u;
+        do { *--s = char('0'+(u % 10)); u /= 10; } while (u);
+        if (negative) *--s = '-';
+        text.append(s,end);
+        return *this;
+      }
+
+      std::string text;
+    };
+
+    /*! writes numItems items' text to the given stream: blocks of
+        items get formatted (through writeItem(block,itemID)) in
+        parallel, and are then written in order, a limited number of
+        blocks at a time (so we never need more than that in
+        memory) */
+    template<typename WriteItem>
+    void writeTextParallel(std::ostream &out,
+                           size_t numItems,
+                           const WriteItem &writeItem)
+    {
+      const size_t blockSize     = 16*1024;
+      const size_t blocksPerWave = 256;
+      const size_t numBlocks     = (numItems+blockSize-1)/blockSize;
+      std::vector<TextBlock> blocks;
+      for (size_t waveBegin=0;waveBegin<numBlocks;waveBegin+=blocksPerWave) {
+        const size_t waveEnd = std::min(waveBegin+blocksPerWave,numBlocks);
+        blocks.resize(waveEnd-waveBegin);
+        parallel_for(waveEnd-waveBegin,[&](size_t i){
+            const size_t begin = (waveBegin+i)*blockSize;
+            const size_t end   = std::min(begin+blockSize,numItems);
+            blocks[i].text.clear();
+            for (size_t itemID=begin;itemID<end;itemID++)
+              writeItem(blocks[i],itemID);
+          });
+        for (auto &block : blocks)
+          out.write(block.text.data(),block.text.size());
+        if (!out.good())
+          throw std::runtime_error("#umesh: error writing text output");
+      }
+    }
+
+    // ==================================================================
+    // reading
+    // ==================================================================
+
+    /*! reads the entire file into memory; the data gets terminated
+        by an extra zero so parsing code can never run past the
+        end */
+    void readEntireFile(const std::string &fileName, std::vector<char> &data);
+
+    inline bool isSpace(char c)
+    { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+
+    /*! parse a single number starting at 's' (which must not be
+        whitespace), and advance 's' to right after it; throws if
+        there is no valid number */
+    void parseNumber(const char *&s, const char *end, float &v);
+    void parseNumber(const char *&s, const char *end, double &v);
+    void parseNumber(const char *&s, const char *end, int64_t &v);
+    inline void parseNumber(const char *&s, const char *end, int &v)
+    { int64_t i; parseNumber(s,end,i); v = (int)i; }
+    inline void parseNumber(const char *&s, const char *end, uint8_t &v)
+    { int64_t i; parseNumber(s,end,i); v = (uint8_t)i; }
+
+    /*! skips over 'count' whitespace-separated tokens, starting at
+        's', and returns the position right after the last one */
+    const char *skipTokens(const char *s, const char *end, size_t count);
+
+    /*! parses 'count' whitespace-separated numbers from
+        [begin,end). The text gets cut into chunks (at whitespace),
+        the tokens in each chunk get counted in parallel, and after a
+        prefix sum over those counts each chunk gets parsed - again in
+        parallel - into its part of the output */
+    template<typename T>
+    void parseNumbersParallel(const char *begin, const char *end, size_t count,
+                              std::vector<T> &out)
+    {
+      const size_t chunkSize = 1<<20;
+      const size_t numChars  = end-begin;
+      const size_t numChunks = std::max(size_t(1),numChars/chunkSize);
+      std::vector<const char *> chunkBegin(numChunks+1);
+      chunkBegin[0] = begin;
+      chunkBegin[numChunks] = end;
+      for (size_t i=1;i<numChunks;i++) {
+        const char *s = begin+(i*numChars)/numChunks;
+        while (s < end && !isSpace(*s)) ++s;
+        chunkBegin[i] = s;
+      }
+      std::vector<size_t> numTokens(numChunks+1,0);
+      parallel_for(numChunks,[&](size_t chunk){
+          size_t n = 0;
+          bool inToken = false;
+          for (const char *s=chunkBegin[chunk];s<chunkBegin[chunk+1];s++) {
+            const bool space = isSpace(*s);
+            if (!space && !inToken) ++n;
+            inToken = !space;
+          }
+          numTokens[chunk+1] = n;
+        });
+      for (size_t i=0;i<numChunks;i++)
+        numTokens[i+1] += numTokens[i];
+      if (numTokens[numChunks] < count)
+        throw std::runtime_error("#umesh: expected "+std::to_string(count)
+                                 +" values in ascii data, but found only "
+                                 +std::to_string(numTokens[numChunks]));
+      out.resize(count);
+      parallel_for(numChunks,[&](size_t chunk){
+          size_t idx = numTokens[chunk];
+          const char *s   = chunkBegin[chunk];
+          const char *end = chunkBegin[chunk+1];
+          while (idx < count) {
+            while (s < end && isSpace(*s)) ++s;
+            if (s >= end) break;
+            parseNumber(s,end,out[idx++]);
+          }
+        });
+    }
+
+    /*! calls lambda(lineBegin,lineEnd) for each non-blank line in
+        [begin,end); lineEnd is the position of the line's '\n' (or
+        'end') */
+    template<typename Lambda>
+    inline void forEachNonBlankLine(const char *begin, const char *end,
+                                    const Lambda &lambda)
+    {
+      const char *s = begin;
+      while (s < end) {
+        const char *eol = (const char *)memchr(s,'\n',end-s);
+        if (!eol) eol = end;
+        for (const char *c=s;c<eol;c++)
+          if (!isSpace(*c)) { lambda(s,eol); break; }
+        s = eol+1;
+      }
+    }
+
+    /*! calls parseLine(lineID,lineBegin,lineEnd) for every non-blank
+        line in [begin,end), in parallel. Lines get numbered
+        consecutively from 0 (blank lines don't count), so the caller
+        can tell from the ID what a given line contains. The text gets
+        cut into chunks at line boundaries, non-blank lines get
+        counted per chunk (in parallel), and after a prefix sum each
+        chunk gets parsed - again in parallel. Returns the number of
+        (non-blank) lines */
+    template<typename ParseLine>
+    size_t parseLinesParallel(const char *begin, const char *end,
+                              const ParseLine &parseLine)
+    {
+      const size_t chunkSize = 1<<20;
+      const size_t numChars  = end-begin;
+      const size_t numChunks = std::max(size_t(1),numChars/chunkSize);
+      std::vector<const char *> chunkBegin(numChunks+1);
+      chunkBegin[0] = begin;
+      chunkBegin[numChunks] = end;
+      for (size_t i=1;i<numChunks;i++) {
+        const char *s = begin+(i*numChars)/numChunks;
+        while (s < end && *s != '\n') ++s;
+        chunkBegin[i] = (s < end) ? s+1 : end;
+      }
+      std::vector<size_t> numLines(numChunks+1,0);
+      parallel_for(numChunks,[&](size_t chunk){
+          size_t n = 0;
+          forEachNonBlankLine(chunkBegin[chunk],chunkBegin[chunk+1],
+                              [&](const char *, const char *){ ++n; });
+          numLines[chunk+1] = n;
+        });
+      for (size_t i=0;i<numChunks;i++)
+        numLines[i+1] += numLines[i];
+      parallel_for(numChunks,[&](size_t chunk){
+          size_t lineID = numLines[chunk];
+          forEachNonBlankLine(chunkBegin[chunk],chunkBegin[chunk+1],
+                              [&](const char *lineBegin, const char *lineEnd){
+                                parseLine(lineID++,lineBegin,lineEnd);
+                              });
+        });
+      return numLines[numChunks];
+    }
+
+  } // ::umesh::io
+} // ::umesh
@@ -15,6 +15,7 @@
 // ======================================================================== //
 
 #include "ugrid32.h"
+#include "ugridStream.h"
 #include <fstream>
 
 #ifndef PRINT
@@ -40,6 +41,12 @@ namespace umesh {
       return UGrid32Loader(dataFileName,scalarFileName).result;
     }
 
+    void UGrid32Loader::stream(const std::string &dataFileName,
+                                 UMeshWriter &out)
+    {
+      streamUGrid<uint32_t,float>(dataFileName,out);
+    }
+
     inline bool notDegenerate(const std::vector<vec3f> &vertices,
                               const uint32_t index[],
                               const size_t N)
@@ -17,6 +17,7 @@
 #pragma once
 
 #include "umesh/io/IO.h"
+#include "umesh/io/UMeshStream.h"
 #include "umesh/UMesh.h"
 
 namespace umesh {
@@ -28,6 +29,12 @@ namespace umesh {
 
       static UMesh::SP load(const std::string &dataFileName,
                             const std::string &scalarFileName="");
+
+      /*! streams given ugrid32 file into a .umesh writer, reading
+          elements in chunks; only the vertices ever need to be held
+          in memory. Produces the same elements as load() */
+      static void stream(const std::string &dataFileName,
+                         UMeshWriter &out);
       
       UMesh::SP result; 
     };
@@ -15,6 +15,7 @@
 // ======================================================================== //
 
 #include "ugrid64.h"
+#include "ugridStream.h"
 #include <fstream>
 
 namespace umesh {
@@ -26,6 +27,12 @@ namespace umesh {
       return UGrid64Loader(dataFileName,scalarFileName).result;
     }
 
+    void UGrid64Loader::stream(const std::string &dataFileName,
+                                 UMeshWriter &out)
+    {
+      streamUGrid<size_t,double>(dataFileName,out);
+    }
+
     inline bool notDegenerate(const std::vector<vec3f> &vertices,
                               const size_t index[],
                               const size_t N)
@@ -18,6 +18,7 @@
 
 #include "umesh/UMesh.h"
 #include "umesh/io/IO.h"
+#include "umesh/io/UMeshStream.h"
 
 namespace umesh {
   namespace io {
@@ -29,6 +30,12 @@ namespace umesh {
 
       static UMesh::SP load(const std::string &dataFileName,
                             const std::string &scalarFileName="");
+
+      /*! streams given ugrid64 file into a .umesh writer, reading
+          elements in chunks; only the vertices ever need to be held
+          in memory. Produces the same elements as load() */
+      static void stream(const std::string &dataFileName,
+                         UMeshWriter &out);
       
       UMesh::SP result; 
     };
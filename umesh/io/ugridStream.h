@@ -0,0 +1,163 @@
+// ======================================================================== //
+// Copyright 2018-2020 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+/* (internal) streaming reader for the ugrid32/ugrid64 file formats,
+   shared by ugrid32.cpp and ugrid64.cpp */
+
+#include "umesh/io/UMeshStream.h"
+#include <atomic>
+
+namespace umesh {
+  namespace io {
+
+    /*! same test as the ugrid loaders use: a prim is degenerate if its
+        bounding box is flat in any dimension, or - for four-vertex
+        prims - if any two of its vertices coincide */
+    template<int N>
+    inline bool isDegenerateUGridPrim(const vec3f *vertices, const int *idx)
+    {
+      box3f bounds;
+      for (int i=0;i<N;i++)
+        bounds.extend(vertices[idx[i]]);
+      if (bounds.lower.x==bounds.upper.x ||
+          bounds.lower.y==bounds.upper.y ||
+          bounds.lower.z==bounds.upper.z)
+        return true;
+      if (N == 4)
+        for (int i=0;i<4;i++)
+          for (int j=i+1;j<4;j++)
+            if (vertices[idx[i]] == vertices[idx[j]]) return true;
+      return false;
+    }
+
+    /*! reads 'count' prims of type Prim (with 1-based indices of type
+        index_t in the file) in chunks, converts them to 0-based int
+        indices, drops degenerate ones, and passes the rest to 'add' */
+    template<typename Prim, typename index_t, typename AddPrims>
+    void streamUGridPrims(std::istream &in, size_t count,
+                          const std::vector<vec3f> &vertices,
+                          const AddPrims &add)
+    {
+      const int N = Prim::numVertices;
+      const size_t chunkSize = 1024*1024;
+      std::vector<index_t> indices;
+      std::vector<Prim>    prims;
+      std::vector<uint8_t> degenerate;
+      for (size_t chunkBegin=0;chunkBegin<count;chunkBegin+=chunkSize) {
+        const size_t numPrims = std::min(chunkSize,count-chunkBegin);
+        indices.resize(N*numPrims);
+        readArray(in,indices.data(),indices.size());
+        prims.resize(numPrims);
+        degenerate.resize(numPrims);
+        std::atomic<bool> invalidIndex(false);
+        parallel_for_blocked(0,numPrims,16*1024,[&](size_t begin, size_t end){
+            for (size_t i=begin;i<end;i++) {
+              int idx[N];
+              for (int j=0;j<N;j++) {
+                const int64_t index = int64_t(indices[N*i+j])-1;
+                if (index < 0 || index >= (int64_t)vertices.size()) {
+                  invalidIndex = true;
+                  return;
+                }
+                idx[j] = (int)index;
+              }
+              degenerate[i] = isDegenerateUGridPrim<N>(vertices.data(),idx);
+              Prim &prim = prims[i];
+              for (int j=0;j<N;j++)
+                prim[j] = idx[j];
+            }
+          });
+        if (invalidIndex)
+          throw std::runtime_error("#umesh: invalid vertex index in ugrid file");
+        size_t numGood = 0;
+        for (size_t i=0;i<numPrims;i++)
+          if (!degenerate[i])
+            prims[numGood++] = prims[i];
+        add(prims.data(),numGood);
+      }
+    }
+
+    /*! streams a ugrid file (with index_t indices and coord_t vertex
+        coordinates) into given writer, without ever holding more than
+        the vertices plus one chunk of elements in memory. Produces the
+        same mesh as the respective loader would */
+    template<typename index_t, typename coord_t>
+    void streamUGrid(const std::string &fileName, UMeshWriter &out)
+    {
+      std::ifstream in(fileName, std::ios_base::binary);
+      if (!in.good())
+        throw std::runtime_error("#umesh: could not open '"+fileName+"'");
+
+      struct {
+        index_t n_verts, n_tris, n_quads, n_tets, n_pyrs, n_prisms, n_hexes;
+      } header;
+      readElement(in,header);
+
+      std::vector<vec3f> vertices(header.n_verts);
+      const size_t chunkSize = 1024*1024;
+      std::vector<coord_t> coords;
+      for (size_t chunkBegin=0;chunkBegin<vertices.size();chunkBegin+=chunkSize) {
+        const size_t count = std::min(chunkSize,vertices.size()-chunkBegin);
+        coords.resize(3*count);
+        readArray(in,coords.data(),coords.size());
+        parallel_for_blocked(0,count,16*1024,[&](size_t begin, size_t end){
+            for (size_t i=begin;i<end;i++)
+              vertices[chunkBegin+i] = vec3f((float)coords[3*i+0],
+                                             (float)coords[3*i+1],
+                                             (float)coords[3*i+2]);
+          });
+      }
+      out.addVertices(vertices.data(),nullptr,vertices.size());
+
+      streamUGridPrims<Triangle,index_t>
+        (in,header.n_tris,vertices,[&](const Triangle *prims, size_t count)
+         { out.addTriangles(prims,count); });
+      streamUGridPrims<Quad,index_t>
+        (in,header.n_quads,vertices,[&](const Quad *prims, size_t count)
+         { out.addQuads(prims,count); });
+
+      // skip surface IDs
+      in.seekg((header.n_tris+header.n_quads)*sizeof(index_t),std::ios::cur);
+
+      streamUGridPrims<Tet,index_t>
+        (in,header.n_tets,vertices,[&](const Tet *prims, size_t count)
+         { out.addTets(prims,count); });
+      streamUGridPrims<Pyr,index_t>
+        (in,header.n_pyrs,vertices,[&](const Pyr *prims, size_t count)
+         { out.addPyrs(prims,count); });
+      streamUGridPrims<Wedge,index_t>
+        (in,header.n_prisms,vertices,[&](const Wedge *prims, size_t count){
+          // ugrid wedges have front and back side swapped relative to
+          // VTK ordering (see the loaders)
+          std::vector<Wedge> swapped(prims,prims+count);
+          for (auto &w : swapped) {
+            const Wedge org = w;
+            for (int j=0;j<3;j++) {
+              w[j]   = org[j+3];
+              w[j+3] = org[j];
+            }
+          }
+          out.addWedges(swapped.data(),count);
+        });
+      streamUGridPrims<Hex,index_t>
+        (in,header.n_hexes,vertices,[&](const Hex *prims, size_t count)
+         { out.addHexes(prims,count); });
+    }
+
+  } // ::umesh::io
+} // ::umesh
@@ -0,0 +1,1447 @@
+// ======================================================================== //
+// Copyright 2018-2020 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+
+#include "umesh/io/vtk.h"
+#include "umesh/io/text.h"
+#include "umesh/convertAttributes.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <map>
+#if UMESH_HAVE_ZLIB
+# include <zlib.h>
+#endif
+
+namespace umesh {
+  namespace io {
+
+    /*! number of array elements (values, cells, ...) processed per
+        task in parallel loops */
+    const size_t vtkBlockSize = 64*1024;
+
+    // ==================================================================
+    // generic helpers for both file formats
+    // ==================================================================
+
+    inline bool endsWith(const std::string &s, const std::string &suffix)
+    {
+      return s.size() >= suffix.size()
+        && s.compare(s.size()-suffix.size(),suffix.size(),suffix) == 0;
+    }
+
+    /*! returns position of first occurrence of 'what' in
+        [text+pos,text+size), or 'size' if not found */
+    inline size_t findString(const char *text, size_t size, size_t pos,
+                             const char *what)
+    {
+      const char *end = text+size;
+      const char *found = std::search(text+pos,end,what,what+strlen(what));
+      return found-text;
+    }
+
+    inline uint32_t base64Value(char c)
+    {
+      if (c >= 'A' && c <= 'Z') return c-'A';
+      if (c >= 'a' && c <= 'z') return c-'a'+26;
+      if (c >= '0' && c <= '9') return c-'0'+52;
+      if (c == '+') return 62;
+      if (c == '/') return 63;
+      if (c == '=') return 0;
+      throw std::runtime_error("#umesh: invalid character in base64 data");
+    }
+
+    /*! decodes base64-encoded text in [begin,end), which must not
+        contain any whitespace. Note that VTK encodes header and data
+        of an array separately, so there can be padding in the middle
+        of the text; we thus decode group by group (of four
+        characters), and let each group have its own padding. Done in
+        parallel, by first counting output bytes per block of groups */
+    void decodeBase64(const char *begin, const char *end,
+                      std::vector<uint8_t> &out)
+    {
+      const size_t numGroups = (end-begin)/4;
+      const size_t numBlocks = divRoundUp(numGroups,vtkBlockSize);
+      std::vector<size_t> blockOut(numBlocks+1,0);
+      parallel_for(numBlocks,[&](size_t block){
+          const size_t g_end = std::min(numGroups,(block+1)*vtkBlockSize);
+          size_t n = 0;
+          for (size_t g=block*vtkBlockSize;g<g_end;g++) {
+            const char *group = begin+4*g;
+            n += 3 - (group[2] == '=') - (group[3] == '=');
+          }
+          blockOut[block+1] = n;
+        });
+      for (size_t i=0;i<numBlocks;i++)
+        blockOut[i+1] += blockOut[i];
+      out.resize(blockOut[numBlocks]);
+      parallel_for(numBlocks,[&](size_t block){
+          const size_t g_end = std::min(numGroups,(block+1)*vtkBlockSize);
+          uint8_t *o = out.data()+blockOut[block];
+          for (size_t g=block*vtkBlockSize;g<g_end;g++) {
+            const char *group = begin+4*g;
+            const uint32_t bits
+              = (base64Value(group[0]) << 18)
+              | (base64Value(group[1]) << 12)
+              | (base64Value(group[2]) <<  6)
+              | (base64Value(group[3]) <<  0);
+            *o++ = uint8_t(bits >> 16);
+            if (group[2] != '=') *o++ = uint8_t(bits >> 8);
+            if (group[3] != '=') *o++ = uint8_t(bits);
+          }
+        });
+    }
+
+    /*! a data array's values in (little-endian) binary form, plus
+        the VTK type name ("Float32", "Int64", ...) they're stored as */
+    struct RawArray {
+      std::string type;
+      std::vector<uint8_t> bytes;
+    };
+
+    inline size_t typeSize(const std::string &type)
+    {
+      if (type == "Int8"  || type == "UInt8")  return 1;
+      if (type == "Int16" || type == "UInt16") return 2;
+      if (type == "Int32" || type == "UInt32" || type == "Float32") return 4;
+      if (type == "Int64" || type == "UInt64" || type == "Float64") return 8;
+      throw std::runtime_error("#umesh: unsupported vtk data type '"+type+"'");
+    }
+
+    template<typename T, typename S>
+    void convertValues(const uint8_t *in, size_t count, T *out)
+    {
+      parallel_for_blocked(0,count,vtkBlockSize,[&](size_t begin, size_t end){
+          for (size_t i=begin;i<end;i++) {
+            S s;
+            memcpy(&s,in+i*sizeof(S),sizeof(S));
+            out[i] = T(s);
+          }
+        });
+    }
+
+    /*! converts the raw array's values (whatever type they're stored
+        as) to T */
+    template<typename T>
+    void convertArray(const RawArray &raw, std::vector<T> &out)
+    {
+      const size_t count = raw.bytes.size() / typeSize(raw.type);
+      out.resize(count);
+      const uint8_t *in = raw.bytes.data();
+      if      (raw.type == "Int8")    convertValues<T,int8_t>  (in,count,out.data());
+      else if (raw.type == "UInt8")   convertValues<T,uint8_t> (in,count,out.data());
+      else if (raw.type == "Int16")   convertValues<T,int16_t> (in,count,out.data());
+      else if (raw.type == "UInt16")  convertValues<T,uint16_t>(in,count,out.data());
+      else if (raw.type == "Int32")   convertValues<T,int32_t> (in,count,out.data());
+      else if (raw.type == "UInt32")  convertValues<T,uint32_t>(in,count,out.data());
+      else if (raw.type == "Int64")   convertValues<T,int64_t> (in,count,out.data());
+      else if (raw.type == "UInt64")  convertValues<T,uint64_t>(in,count,out.data());
+      else if (raw.type == "Float32") convertValues<T,float>   (in,count,out.data());
+      else                            convertValues<T,double>  (in,count,out.data());
+    }
+
+    /*! how a given VTK cell type maps to umesh elements: quadratic
+        and higher-order cells store their corner vertices first (in
+        the same order as the respective linear cell), so they simply
+        get reduced to those corners. 'order' (if non-null) permutes
+        the corners, for voxels and pixels */
+    struct VTKCellType {
+      UMesh::PrimType primType;
+      int numCorners;
+      const int *order;
+    };
+
+    inline VTKCellType vtkCellType(int type)
+    {
+      static const int voxelOrder[8] = { 0,1,3,2,4,5,7,6 };
+      switch (type) {
+      case  5: // VTK_TRIANGLE
+      case 22: // VTK_QUADRATIC_TRIANGLE
+      case 34: // VTK_BIQUADRATIC_TRIANGLE
+      case 69: // VTK_LAGRANGE_TRIANGLE
+      case 76: // VTK_BEZIER_TRIANGLE
+        return { UMesh::TRI,3,nullptr };
+      case  8: // VTK_PIXEL
+        return { UMesh::QUAD,4,voxelOrder };
+      case  9: // VTK_QUAD
+      case 23: // VTK_QUADRATIC_QUAD
+      case 28: // VTK_BIQUADRATIC_QUAD
+      case 30: // VTK_QUADRATIC_LINEAR_QUAD
+      case 70: // VTK_LAGRANGE_QUADRILATERAL
+      case 77: // VTK_BEZIER_QUADRILATERAL
+        return { UMesh::QUAD,4,nullptr };
+      case 10: // VTK_TETRA
+      case 24: // VTK_QUADRATIC_TETRA
+      case 71: // VTK_LAGRANGE_TETRAHEDRON
+      case 78: // VTK_BEZIER_TETRAHEDRON
+        return { UMesh::TET,4,nullptr };
+      case 11: // VTK_VOXEL
+        return { UMesh::HEX,8,voxelOrder };
+      case 12: // VTK_HEXAHEDRON
+      case 25: // VTK_QUADRATIC_HEXAHEDRON
+      case 29: // VTK_TRIQUADRATIC_HEXAHEDRON
+      case 33: // VTK_BIQUADRATIC_QUADRATIC_HEXAHEDRON
+      case 72: // VTK_LAGRANGE_HEXAHEDRON
+      case 79: // VTK_BEZIER_HEXAHEDRON
+        return { UMesh::HEX,8,nullptr };
+      case 13: // VTK_WEDGE
+      case 26: // VTK_QUADRATIC_WEDGE
+      case 31: // VTK_QUADRATIC_LINEAR_WEDGE
+      case 32: // VTK_BIQUADRATIC_QUADRATIC_WEDGE
+      case 73: // VTK_LAGRANGE_WEDGE
+      case 80: // VTK_BEZIER_WEDGE
+        return { UMesh::WEDGE,6,nullptr };
+      case 14: // VTK_PYRAMID
+      case 27: // VTK_QUADRATIC_PYRAMID
+      case 74: // VTK_LAGRANGE_PYRAMID
+      case 81: // VTK_BEZIER_PYRAMID
+        return { UMesh::PYR,5,nullptr };
+      default:
+        return { UMesh::INVALID,0,nullptr };
+      }
+    }
+
+    template<typename Prim>
+    inline void setCorners(Prim &prim, const int64_t *ids,
+                           const int *order, size_t vertexOffset)
+    {
+      for (int i=0;i<Prim::numVertices;i++)
+        prim[i] = int(vertexOffset + ids[order ? order[i] : i]);
+    }
+
+    /*! the cells of one vtu piece or legacy file, in VTK's
+        connectivity/offsets/types form; cell i uses vertices
+        connectivity[offsets[i]..offsets[i+1]) */
+    struct VTKCells {
+      std::vector<int64_t> connectivity;
+      std::vector<int64_t> offsets;
+      std::vector<uint8_t> types;
+
+      size_t size() const { return types.size(); }
+
+      /*! checks that offsets are consistent with the connectivity
+          array, and that all vertex indices are in range */
+      void validate(size_t numVertices) const;
+    };
+
+    void VTKCells::validate(size_t numVertices) const
+    {
+      const size_t numCells = size();
+      if (offsets.size() != numCells+1 || offsets[0] != 0
+          || (size_t)offsets[numCells] != connectivity.size())
+        throw std::runtime_error("#umesh: inconsistent cell offsets in vtk file");
+      std::atomic<bool> bad(false);
+      parallel_for_blocked(0,numCells,vtkBlockSize,[&](size_t begin, size_t end){
+          for (size_t i=begin;i<end;i++) {
+            if (offsets[i+1] < offsets[i]) { bad = true; return; }
+            for (int64_t j=offsets[i];j<offsets[i+1];j++)
+              if (connectivity[j] < 0 || (size_t)connectivity[j] >= numVertices)
+                { bad = true; return; }
+          }
+        });
+      if (bad)
+        throw std::runtime_error("#umesh: invalid cell in vtk file");
+    }
+
+    /*! per-element values of cells that get added to a mesh, kept
+        separately for each element type, so they can be assembled
+        into umesh's global element order once all cells are in */
+    struct CellValues {
+      /*! concatenate per-type values into tris, quads, tets, pyrs,
+          wedges, hexes order */
+      Attribute::SP assemble(const std::string &name) const;
+
+      std::vector<float> perType[UMesh::INVALID];
+    };
+
+    Attribute::SP CellValues::assemble(const std::string &name) const
+    {
+      Attribute::SP attribute = std::make_shared<Attribute>();
+      attribute->name = name;
+      for (int t=0;t<UMesh::INVALID;t++)
+        attribute->values.insert(attribute->values.end(),
+                                 perType[t].begin(),perType[t].end());
+      attribute->finalize();
+      return attribute;
+    }
+
+    /*! appends the given (validated) cells to the mesh, with vertex
+        indices shifted by 'vertexOffset'. Done in two parallel passes:
+        first count each block's elements of each type, then - after a
+        prefix sum - write them to their final positions, which
+        retains the order of the cells in the file. If 'cellValues'
+        is given (one per cell) those get appended to 'values' in the
+        same way */
+    void addCells(UMesh &mesh, const VTKCells &cells, size_t vertexOffset,
+                  const float *cellValues = nullptr,
+                  CellValues *values = nullptr)
+    {
+      const size_t numCells  = cells.size();
+      const size_t numBlocks = divRoundUp(numCells,vtkBlockSize);
+      const int numTypes = UMesh::INVALID+1;
+      std::vector<size_t> counts((numBlocks+1)*numTypes,0);
+      parallel_for(numBlocks,[&](size_t block){
+          size_t *blockCounts = counts.data()+(block+1)*numTypes;
+          const size_t end = std::min(numCells,(block+1)*vtkBlockSize);
+          for (size_t i=block*vtkBlockSize;i<end;i++) {
+            VTKCellType type = vtkCellType(cells.types[i]);
+            if (cells.offsets[i+1]-cells.offsets[i] < type.numCorners)
+              type.primType = UMesh::INVALID;
+            blockCounts[type.primType]++;
+          }
+        });
+      // exclusive prefix sum per type, starting at whatever the mesh
+      // already contains
+      size_t *base = counts.data();
+      base[UMesh::TRI]   = mesh.triangles.size();
+      base[UMesh::QUAD]  = mesh.quads.size();
+      base[UMesh::TET]   = mesh.tets.size();
+      base[UMesh::PYR]   = mesh.pyrs.size();
+      base[UMesh::WEDGE] = mesh.wedges.size();
+      base[UMesh::HEX]   = mesh.hexes.size();
+      base[UMesh::INVALID] = 0;
+      for (size_t block=0;block<numBlocks;block++)
+        for (int t=0;t<numTypes;t++)
+          counts[(block+1)*numTypes+t] += counts[block*numTypes+t];
+      const size_t *total = counts.data()+numBlocks*numTypes;
+      mesh.triangles.resize(total[UMesh::TRI]);
+      mesh.quads.resize(total[UMesh::QUAD]);
+      mesh.tets.resize(total[UMesh::TET]);
+      mesh.pyrs.resize(total[UMesh::PYR]);
+      mesh.wedges.resize(total[UMesh::WEDGE]);
+      mesh.hexes.resize(total[UMesh::HEX]);
+      if (cellValues)
+        for (int t=0;t<UMesh::INVALID;t++)
+          values->perType[t].resize(total[t]);
+      if (total[UMesh::INVALID])
+        std::cout << "#umesh: warning - skipped " << total[UMesh::INVALID]
+                  << " cells of unsupported type (vertices, lines, polygons,"
+                  << " polyhedra, ...)" << std::endl;
+
+      parallel_for(numBlocks,[&](size_t block){
+          size_t next[UMesh::INVALID+1];
+          for (int t=0;t<numTypes;t++)
+            next[t] = counts[block*numTypes+t];
+          const size_t end = std::min(numCells,(block+1)*vtkBlockSize);
+          for (size_t i=block*vtkBlockSize;i<end;i++) {
+            const VTKCellType type = vtkCellType(cells.types[i]);
+            const int64_t *ids = cells.connectivity.data()+cells.offsets[i];
+            if (cells.offsets[i+1]-cells.offsets[i] < type.numCorners)
+              continue;
+            if (cellValues && type.primType != UMesh::INVALID)
+              values->perType[type.primType][next[type.primType]] = cellValues[i];
+            switch (type.primType) {
+            case UMesh::TRI:
+              setCorners(mesh.triangles[next[UMesh::TRI]++],ids,type.order,vertexOffset);
+              break;
+            case UMesh::QUAD:
+              setCorners(mesh.quads[next[UMesh::QUAD]++],ids,type.order,vertexOffset);
+              break;
+            case UMesh::TET:
+              setCorners(mesh.tets[next[UMesh::TET]++],ids,type.order,vertexOffset);
+              break;
+            case UMesh::PYR:
+              setCorners(mesh.pyrs[next[UMesh::PYR]++],ids,type.order,vertexOffset);
+              break;
+            case UMesh::WEDGE:
+              setCorners(mesh.wedges[next[UMesh::WEDGE]++],ids,type.order,vertexOffset);
+              break;
+            case UMesh::HEX:
+              setCorners(mesh.hexes[next[UMesh::HEX]++],ids,type.order,vertexOffset);
+              break;
+            default:
+              break;
+            }
+          }
+        });
+    }
+
+    /*! appends 'count' points (with three float or double coordinates
+        each) to the mesh's vertex array */
+    void addVertices(UMesh &mesh, const std::vector<float> &coords)
+    {
+      const size_t numPoints = coords.size()/3;
+      const size_t begin = mesh.vertices.size();
+      mesh.vertices.resize(begin+numPoints);
+      parallel_for_blocked(0,numPoints,vtkBlockSize,[&](size_t b, size_t e){
+          for (size_t i=b;i<e;i++)
+            mesh.vertices[begin+i]
+              = vec3f(coords[3*i+0],coords[3*i+1],coords[3*i+2]);
+        });
+      if (mesh.vertices.size() > (size_t)std::numeric_limits<int>::max())
+        throw std::runtime_error("#umesh: too many vertices for 32-bit vertex indices");
+    }
+
+    // ==================================================================
+    // VTK XML (.vtu) files
+    // ==================================================================
+
+    /*! a start tag, end tag, or empty-element tag in an xml file */
+    struct XMLTag {
+      std::string get(const std::string &attrib,
+                      const std::string &defaultValue = "") const
+      {
+        auto it = attributes.find(attrib);
+        return it == attributes.end() ? defaultValue : it->second;
+      }
+      
+      std::string name;
+      std::map<std::string,std::string> attributes;
+      bool isEnd   = false;
+      bool isEmpty = false;
+      /*! position right after this tag's closing '>' */
+      size_t end = 0;
+    };
+
+    /*! finds the next tag at or after 'pos', skipping over comments,
+        processing instructions, and declarations; returns false if
+        there is none */
+    bool nextXMLTag(const char *text, size_t size, size_t &pos, XMLTag &tag)
+    {
+      while (true) {
+        const char *lt = (const char *)memchr(text+pos,'<',size-pos);
+        if (!lt) return false;
+        pos = lt-text;
+        if (pos+1 >= size) return false;
+        if (strncmp(lt,"<!--",4) == 0)
+          pos = findString(text,size,pos,"-->")+3;
+        else if (lt[1] == '?' || lt[1] == '!')
+          pos = findString(text,size,pos,">")+1;
+        else
+          break;
+        if (pos > size) return false;
+      }
+      tag = XMLTag();
+      size_t i = pos+1;
+      if (text[i] == '/') { tag.isEnd = true; ++i; }
+      while (i < size && !isSpace(text[i]) && text[i] != '>' && text[i] != '/')
+        tag.name.push_back(text[i++]);
+      while (i < size) {
+        while (i < size && isSpace(text[i])) ++i;
+        if (i >= size) break;
+        if (text[i] == '/') { tag.isEmpty = true; ++i; continue; }
+        if (text[i] == '>') { ++i; break; }
+        std::string attrib;
+        while (i < size && !isSpace(text[i]) && text[i] != '=' && text[i] != '>')
+          attrib.push_back(text[i++]);
+        while (i < size && isSpace(text[i])) ++i;
+        if (i >= size || text[i] != '=')
+          throw std::runtime_error("#umesh: malformed xml attribute '"+attrib+"'");
+        ++i;
+        while (i < size && isSpace(text[i])) ++i;
+        const char quote = text[i++];
+        if (quote != '"' && quote != '\'')
+          throw std::runtime_error("#umesh: malformed xml attribute '"+attrib+"'");
+        std::string value;
+        while (i < size && text[i] != quote)
+          value.push_back(text[i++]);
+        ++i;
+        tag.attributes[attrib] = value;
+      }
+      tag.end = pos = i;
+      return true;
+    }
+
+    /*! a DataArray element in a vtu file, with everything required
+        to (later) read its data */
+    struct VTUArray {
+      std::string name;
+      std::string type;
+      std::string format;
+      int numComponents = 1;
+      /*! for appended arrays: offset within the appended data */
+      size_t offset = 0;
+      /*! for inline arrays: range of the element's content */
+      size_t contentBegin = 0, contentEnd = 0;
+      bool valid = false;
+    };
+
+    struct VTUPiece {
+      size_t numPoints = 0;
+      size_t numCells  = 0;
+      VTUArray points, connectivity, offsets, types;
+      std::vector<VTUArray> pointData, cellData;
+      std::string activePointScalars, activeCellScalars;
+    };
+
+    /*! a vtu file in memory, with the locations of all its pieces'
+        data arrays */
+    struct VTUFile {
+      VTUFile(const std::string &fileName);
+
+      /*! reads given array (of expected number of values), and
+          converts it to T */
+      template<typename T>
+      void read(const VTUArray &array, size_t expectedCount, std::vector<T> &out);
+
+      std::vector<char>     text;
+      std::vector<VTUPiece> pieces;
+      bool uint64Header = false;
+      bool compressed   = false;
+      /*! range of the appended data (right after the '_' marker) */
+      size_t appendedBegin = 0, appendedEnd = 0;
+      bool appendedIsBase64 = false;
+      /*! offsets of all appended arrays, sorted, to find where each
+          base64-encoded array ends */
+      std::vector<size_t> appendedOffsets;
+
+    private:
+      /*! extracts the actual array data from a binary-encoded data
+          array in [begin,end): a header, followed by either the raw
+          data, or by a number of zlib-compressed blocks */
+      void unpack(const uint8_t *begin, const uint8_t *end, RawArray &raw);
+    };
+
+    VTUFile::VTUFile(const std::string &fileName)
+    {
+      readEntireFile(fileName,text);
+      const size_t size = text.size()-1;
+      enum { NONE, POINTS, CELLS, POINT_DATA, CELL_DATA } section = NONE;
+      size_t pos = 0;
+      XMLTag tag;
+      while (nextXMLTag(text.data(),size,pos,tag)) {
+        const bool isStart = !tag.isEnd;
+        if (tag.name == "VTKFile" && isStart) {
+          if (tag.get("type") != "UnstructuredGrid")
+            throw std::runtime_error("#umesh: '"+fileName+"' is not a vtk unstructured grid");
+          if (tag.get("byte_order","LittleEndian") != "LittleEndian")
+            throw std::runtime_error("#umesh: big-endian vtu files are not supported");
+          uint64Header = (tag.get("header_type","UInt32") == "UInt64");
+          const std::string compressor = tag.get("compressor");
+          if (compressor != "" && compressor != "vtkZLibDataCompressor")
+            throw std::runtime_error("#umesh: unsupported vtu compressor '"+compressor+"'");
+          compressed = (compressor != "");
+        } else if (tag.name == "Piece" && isStart) {
+          pieces.push_back(VTUPiece());
+          pieces.back().numPoints = std::stoull(tag.get("NumberOfPoints","0"));
+          pieces.back().numCells  = std::stoull(tag.get("NumberOfCells","0"));
+        } else if (tag.name == "Points") {
+          section = (isStart && !tag.isEmpty) ? POINTS : NONE;
+        } else if (tag.name == "Cells") {
+          section = (isStart && !tag.isEmpty) ? CELLS : NONE;
+        } else if (tag.name == "PointData") {
+          section = (isStart && !tag.isEmpty) ? POINT_DATA : NONE;
+          if (isStart && !pieces.empty())
+            pieces.back().activePointScalars = tag.get("Scalars");
+        } else if (tag.name == "CellData") {
+          section = (isStart && !tag.isEmpty) ? CELL_DATA : NONE;
+          if (isStart && !pieces.empty())
+            pieces.back().activeCellScalars = tag.get("Scalars");
+        } else if (tag.name == "DataArray" && isStart) {
+          VTUArray array;
+          array.valid  = true;
+          array.name   = tag.get("Name");
+          array.type   = tag.get("type");
+          array.format = tag.get("format","ascii");
+          array.numComponents = std::stoi(tag.get("NumberOfComponents","1"));
+          array.offset = std::stoull(tag.get("offset","0"));
+          if (!tag.isEmpty) {
+            array.contentBegin = tag.end;
+            array.contentEnd = pos = findString(text.data(),size,pos,"</DataArray");
+          }
+          if (array.format == "appended")
+            appendedOffsets.push_back(array.offset);
+          if (section == NONE || pieces.empty())
+            continue;
+          VTUPiece &piece = pieces.back();
+          if (section == POINTS)
+            piece.points = array;
+          else if (section == CELLS && array.name == "connectivity")
+            piece.connectivity = array;
+          else if (section == CELLS && array.name == "offsets")
+            piece.offsets = array;
+          else if (section == CELLS && array.name == "types")
+            piece.types = array;
+          else if (section == POINT_DATA)
+            piece.pointData.push_back(array);
+          else if (section == CELL_DATA)
+            piece.cellData.push_back(array);
+        } else if (tag.name == "AppendedData" && isStart) {
+          appendedIsBase64 = (tag.get("encoding") == "base64");
+          const char *marker = (const char *)memchr(text.data()+tag.end,'_',size-tag.end);
+          if (!marker)
+            throw std::runtime_error("#umesh: no '_' marker in vtu appended data");
+          appendedBegin = marker-text.data()+1;
+          // the (raw) data can contain anything, so look for the
+          // closing tag from the end of the file
+          appendedEnd = size;
+          const char *closing = "</AppendedData>";
+          for (size_t i=size;i>appendedBegin+strlen(closing);--i)
+            if (strncmp(text.data()+i-strlen(closing),closing,strlen(closing)) == 0)
+              { appendedEnd = i-strlen(closing); break; }
+          // raw data can legitimately end in bytes that look like
+          // whitespace (eg, a last cell type of VTK_TETRA=10='\n'),
+          // so only trim base64-encoded data; raw arrays' sizes come
+          // from their headers anyway
+          while (appendedIsBase64 && appendedEnd > appendedBegin
+                 && isSpace(text[appendedEnd-1]))
+            --appendedEnd;
+          break;
+        }
+      }
+      if (pieces.empty())
+        throw std::runtime_error("#umesh: no pieces in vtu file '"+fileName+"'");
+      std::sort(appendedOffsets.begin(),appendedOffsets.end());
+    }
+
+    void VTUFile::unpack(const uint8_t *begin, const uint8_t *end, RawArray &raw)
+    {
+      const size_t intSize = uint64Header ? 8 : 4;
+      auto headerInt = [&](size_t i) -> size_t {
+        if (begin+(i+1)*intSize > end)
+          throw std::runtime_error("#umesh: truncated vtu data array");
+        if (uint64Header) {
+          uint64_t v; memcpy(&v,begin+i*intSize,intSize); return v;
+        } else {
+          uint32_t v; memcpy(&v,begin+i*intSize,intSize); return v;
+        }
+      };
+      if (!compressed) {
+        const size_t numBytes = headerInt(0);
+        const uint8_t *data = begin+intSize;
+        if (data+numBytes > end)
+          throw std::runtime_error("#umesh: truncated vtu data array");
+        raw.bytes.resize(numBytes);
+        parallel_for_blocked(0,numBytes,1<<20,[&](size_t b, size_t e){
+            memcpy(raw.bytes.data()+b,data+b,e-b);
+          });
+        return;
+      }
+#if UMESH_HAVE_ZLIB
+      const size_t numBlocks     = headerInt(0);
+      const size_t blockSize     = headerInt(1);
+      const size_t lastBlockSize = headerInt(2);
+      std::vector<size_t> blockBegin(numBlocks+1);
+      blockBegin[0] = (3+numBlocks)*intSize;
+      for (size_t i=0;i<numBlocks;i++)
+        blockBegin[i+1] = blockBegin[i]+headerInt(3+i);
+      if (begin+blockBegin[numBlocks] > end)
+        throw std::runtime_error("#umesh: truncated vtu data array");
+      const size_t numBytes
+        = numBlocks == 0
+        ? 0
+        : (numBlocks-1)*blockSize + (lastBlockSize ? lastBlockSize : blockSize);
+      raw.bytes.resize(numBytes);
+      // blocks got compressed independently, so can get decompressed
+      // in parallel, too
+      std::atomic<bool> failed(false);
+      parallel_for(numBlocks,[&](size_t block){
+          const size_t expected = std::min(blockSize,numBytes-block*blockSize);
+          uLongf outSize = expected;
+          int rc = uncompress(raw.bytes.data()+block*blockSize,&outSize,
+                              begin+blockBegin[block],
+                              blockBegin[block+1]-blockBegin[block]);
+          if (rc != Z_OK || outSize != expected)
+            failed = true;
+        });
+      if (failed)
+        throw std::runtime_error("#umesh: error decompressing vtu data array");
+#else
+      throw std::runtime_error("#umesh: vtu file uses zlib compression, but umesh"
+                               " was built without zlib support");
+#endif
+    }
+
+    template<typename T>
+    void VTUFile::read(const VTUArray &array, size_t expectedCount, std::vector<T> &out)
+    {
+      if (!array.valid)
+        throw std::runtime_error("#umesh: missing data array in vtu file");
+      if (array.format == "ascii") {
+        parseNumbersParallel(text.data()+array.contentBegin,
+                             text.data()+array.contentEnd,
+                             expectedCount,out);
+        return;
+      }
+      RawArray raw;
+      raw.type = array.type;
+      std::vector<uint8_t> decoded;
+      if (array.format == "binary") {
+        std::string base64;
+        base64.reserve(array.contentEnd-array.contentBegin);
+        for (size_t i=array.contentBegin;i<array.contentEnd;i++)
+          if (!isSpace(text[i])) base64.push_back(text[i]);
+        decodeBase64(base64.data(),base64.data()+base64.size(),decoded);
+        unpack(decoded.data(),decoded.data()+decoded.size(),raw);
+      } else if (array.format == "appended") {
+        const size_t begin = appendedBegin+array.offset;
+        if (begin > appendedEnd)
+          throw std::runtime_error("#umesh: invalid offset in vtu data array");
+        // each array ends where the next one starts (or at the end
+        // of the appended data), so a bad size header cannot make
+        // one array read into another
+        auto next = std::upper_bound(appendedOffsets.begin(),appendedOffsets.end(),
+                                     array.offset);
+        const size_t end
+          = (next == appendedOffsets.end())
+          ? appendedEnd
+          : std::min(appendedEnd,appendedBegin+*next);
+        if (appendedIsBase64) {
+          decodeBase64(text.data()+begin,text.data()+end,decoded);
+          unpack(decoded.data(),decoded.data()+decoded.size(),raw);
+        } else
+          unpack((const uint8_t *)text.data()+begin,
+                 (const uint8_t *)text.data()+end,raw);
+      } else
+        throw std::runtime_error("#umesh: unsupported vtu data array format '"
+                                 +array.format+"'");
+      convertArray(raw,out);
+      if (out.size() != expectedCount)
+        throw std::runtime_error("#umesh: vtu data array '"+array.name+"' has "
+                                 +std::to_string(out.size())+" values, expected "
+                                 +std::to_string(expectedCount));
+    }
+
+    /*! finds the scalar field to load in the given list of arrays:
+        the one with the given name (if specified), else the active one
+        (if any), else the first one with only one component. Returns
+        null if none was found */
+    const VTUArray *findField(const std::vector<VTUArray> &arrays,
+                              const std::string &fieldName,
+                              const std::string &activeName)
+    {
+      for (auto &array : arrays)
+        if (array.numComponents == 1 && fieldName != "" && array.name == fieldName)
+          return &array;
+      if (fieldName != "") return nullptr;
+      for (auto &array : arrays)
+        if (array.numComponents == 1 && activeName != "" && array.name == activeName)
+          return &array;
+      for (auto &array : arrays)
+        if (array.numComponents == 1)
+          return &array;
+      return nullptr;
+    }
+
+    UMesh::SP loadVTU(const std::string &fileName, const std::string &fieldName)
+    {
+      VTUFile file(fileName);
+      UMesh::SP mesh = std::make_shared<UMesh>();
+
+      // decide on the field (and whether it's point or cell data) by
+      // the first piece; all others have to have the same
+      const VTUPiece &first = file.pieces[0];
+      const VTUArray *pointField
+        = findField(first.pointData,fieldName,first.activePointScalars);
+      const VTUArray *field
+        = pointField
+        ? pointField
+        : findField(first.cellData,fieldName,first.activeCellScalars);
+      // (files without any scalar field have neither)
+      const bool isCellField = (field != nullptr && pointField == nullptr);
+      if (!field && fieldName != "")
+        throw std::runtime_error("#umesh: no scalar field '"+fieldName+"' in '"+fileName+"'");
+      const std::string name = field ? field->name : "";
+      if (field && !isCellField) {
+        mesh->perVertex = std::make_shared<Attribute>();
+        mesh->perVertex->name = name;
+      }
+      // the cell field that becomes perElement: either the field
+      // itself, or - next to a point field - the active cell scalars
+      // (as written by saveVTU()), if any
+      const VTUArray *cellField
+        = isCellField
+        ? field
+        : (field && first.activeCellScalars != ""
+           ? findField(first.cellData,first.activeCellScalars,"")
+           : nullptr);
+      const std::string cellName = cellField ? cellField->name : "";
+      CellValues cellValues;
+
+      for (auto &piece : file.pieces) {
+        const size_t vertexOffset = mesh->vertices.size();
+        std::vector<float> coords;
+        if (piece.numPoints > 0) {
+          if (piece.points.numComponents != 3)
+            throw std::runtime_error("#umesh: vtu points need three components");
+          file.read(piece.points,3*piece.numPoints,coords);
+        }
+        addVertices(*mesh,coords);
+
+        VTKCells cells;
+        if (piece.numCells > 0) {
+          file.read(piece.offsets,piece.numCells,cells.offsets);
+          cells.offsets.insert(cells.offsets.begin(),int64_t(0));
+          file.read(piece.connectivity,(size_t)cells.offsets.back(),cells.connectivity);
+          file.read(piece.types,piece.numCells,cells.types);
+        } else
+          cells.offsets.push_back(0);
+        cells.validate(piece.numPoints);
+
+        if (cellField) {
+          const VTUArray *pieceField = findField(piece.cellData,cellName,"");
+          if (!pieceField)
+            throw std::runtime_error("#umesh: scalar field '"+cellName
+                                     +"' missing in some pieces of '"+fileName+"'");
+          std::vector<float> pieceValues;
+          file.read(*pieceField,piece.numCells,pieceValues);
+          addCells(*mesh,cells,vertexOffset,pieceValues.data(),&cellValues);
+        } else
+          addCells(*mesh,cells,vertexOffset);
+
+        if (field && !isCellField) {
+          const VTUArray *pieceField = findField(piece.pointData,name,"");
+          if (!pieceField)
+            throw std::runtime_error("#umesh: scalar field '"+name
+                                     +"' missing in some pieces of '"+fileName+"'");
+          std::vector<float> pointValues;
+          file.read(*pieceField,piece.numPoints,pointValues);
+          std::vector<float> &values = mesh->perVertex->values;
+          values.insert(values.end(),pointValues.begin(),pointValues.end());
+        }
+      }
+      if (cellField)
+        mesh->perElement = cellValues.assemble(cellName);
+      if (isCellField)
+        mesh->perVertex = cellToVertex(mesh,mesh->perElement);
+      if (mesh->perVertex)
+        mesh->perVertex->finalize();
+      mesh->finalize();
+      return mesh;
+    }
+
+    // ==================================================================
+    // legacy VTK (.vtk) files
+    // ==================================================================
+
+    /*! maps a legacy vtk data type name to the respective vtu type
+        name (legacy binary files use 32-bit vtkIdType's) */
+    inline std::string legacyTypeName(const std::string &type)
+    {
+      if (type == "unsigned_char")  return "UInt8";
+      if (type == "char")           return "Int8";
+      if (type == "unsigned_short") return "UInt16";
+      if (type == "short")          return "Int16";
+      if (type == "unsigned_int")   return "UInt32";
+      if (type == "int")            return "Int32";
+      if (type == "vtkIdType")      return "Int32";
+      if (type == "unsigned_long")  return "UInt64";
+      if (type == "vtktypeuint64")  return "UInt64";
+      if (type == "long")           return "Int64";
+      if (type == "vtktypeint64")   return "Int64";
+      if (type == "float")          return "Float32";
+      if (type == "double")         return "Float64";
+      throw std::runtime_error("#umesh: unsupported legacy vtk data type '"+type+"'");
+    }
+
+    /*! sequential parser for the keywords of a legacy vtk file, with
+        (parallel) parsing of the data blocks between them */
+    struct LegacyVTKParser {
+      LegacyVTKParser(const std::string &fileName);
+
+      /*! next whitespace-separated token, or "" at end of file */
+      std::string nextToken();
+      size_t nextInt() { return std::stoull(nextToken()); }
+      /*! skips to the beginning of the next line */
+      void skipLine();
+
+      /*! reads 'count' values of given (legacy) type, and converts
+          them to T; or skips them if 'out' is null */
+      template<typename T>
+      void readValues(size_t count, const std::string &type, std::vector<T> *out);
+
+      std::vector<char> data;
+      size_t size   = 0;
+      size_t pos    = 0;
+      bool   binary = false;
+    };
+
+    LegacyVTKParser::LegacyVTKParser(const std::string &fileName)
+    {
+      readEntireFile(fileName,data);
+      size = data.size()-1;
+      if (strncmp(data.data(),"# vtk DataFile",14) != 0)
+        throw std::runtime_error("#umesh: '"+fileName+"' is not a legacy vtk file");
+      skipLine();
+      // title
+      skipLine();
+      const std::string encoding = nextToken();
+      if (encoding == "BINARY")
+        binary = true;
+      else if (encoding != "ASCII")
+        throw std::runtime_error("#umesh: invalid encoding '"+encoding+"' in legacy vtk file");
+    }
+
+    std::string LegacyVTKParser::nextToken()
+    {
+      while (pos < size && isSpace(data[pos])) ++pos;
+      const size_t begin = pos;
+      while (pos < size && !isSpace(data[pos])) ++pos;
+      return std::string(data.data()+begin,data.data()+pos);
+    }
+
+    void LegacyVTKParser::skipLine()
+    {
+      while (pos < size && data[pos] != '\n') ++pos;
+      if (pos < size) ++pos;
+    }
+
+    template<typename T>
+    void LegacyVTKParser::readValues(size_t count, const std::string &type,
+                                     std::vector<T> *out)
+    {
+      if (!binary) {
+        const char *begin = data.data()+pos;
+        const char *end   = skipTokens(begin,data.data()+size,count);
+        if (out) parseNumbersParallel(begin,end,count,*out);
+        pos = end-data.data();
+        return;
+      }
+      // binary data starts right after the line with the keyword,
+      // and is big-endian
+      skipLine();
+      RawArray raw;
+      raw.type = legacyTypeName(type);
+      const size_t elementSize = typeSize(raw.type);
+      const size_t numBytes = count*elementSize;
+      if (pos+numBytes > size)
+        throw std::runtime_error("#umesh: truncated legacy vtk file");
+      if (out) {
+        raw.bytes.resize(numBytes);
+        const uint8_t *in = (const uint8_t *)data.data()+pos;
+        parallel_for_blocked(0,count,vtkBlockSize,[&](size_t begin, size_t end){
+            for (size_t i=begin;i<end;i++)
+              for (size_t j=0;j<elementSize;j++)
+                raw.bytes[i*elementSize+j] = in[i*elementSize+elementSize-1-j];
+          });
+        convertArray(raw,*out);
+      }
+      pos += numBytes;
+    }
+
+    /*! a scalar field (point or cell data) in a legacy vtk file */
+    struct LegacyField {
+      std::string name;
+      std::vector<float> values;
+      bool valid = false;
+    };
+
+    UMesh::SP loadLegacyVTK(const std::string &fileName, const std::string &fieldName)
+    {
+      LegacyVTKParser in(fileName);
+      std::vector<float> coords;
+      VTKCells cells;
+      size_t numPoints = 0;
+      LegacyField pointField, cellField;
+      /* legacy files have no notion of 'active' scalars, so the first
+         single-component SCALARS of each section play that role: if
+         no field name is given they are preferred over other arrays,
+         and next to a point field the cell data's become the
+         perElement attribute (the same way loadVTU() uses the active
+         scalars) */
+      LegacyField activePointScalars, activeCellScalars;
+      enum { NONE, POINT_DATA, CELL_DATA } section = NONE;
+      size_t sectionSize = 0;
+
+      /* reads a single-component array of the current section if it
+         is the one we're looking for (or, if no name was given, if
+         it's the first one in this section), or if it's the
+         section's active scalars; and skips it otherwise */
+      auto readField = [&](const std::string &name, int numComponents,
+                           size_t count, const std::string &type,
+                           bool isScalars) {
+        LegacyField *field
+          = section == POINT_DATA ? &pointField
+          : section == CELL_DATA  ? &cellField
+          : nullptr;
+        LegacyField *activeScalars
+          = section == POINT_DATA ? &activePointScalars
+          : section == CELL_DATA  ? &activeCellScalars
+          : nullptr;
+        const bool wanted
+          = field && numComponents == 1 && !field->valid
+          && (fieldName == "" || fieldName == name);
+        const bool active
+          = activeScalars && isScalars && numComponents == 1
+          && !activeScalars->valid;
+        LegacyField *target
+          = wanted ? field : (active ? activeScalars : nullptr);
+        in.readValues(count*numComponents,type,target ? &target->values : nullptr);
+        if (wanted) {
+          field->name = name;
+          field->valid = true;
+        }
+        if (active) {
+          activeScalars->name = name;
+          activeScalars->valid = true;
+          if (wanted)
+            activeScalars->values = field->values;
+        }
+      };
+
+      std::string keyword = in.nextToken();
+      if (keyword != "DATASET" || in.nextToken() != "UNSTRUCTURED_GRID")
+        throw std::runtime_error("#umesh: '"+fileName+"' is not a vtk unstructured grid");
+      while ((keyword = in.nextToken()) != "") {
+        if (keyword == "POINTS") {
+          numPoints = in.nextInt();
+          const std::string type = in.nextToken();
+          in.readValues(3*numPoints,type,&coords);
+        } else if (keyword == "CELLS") {
+          const size_t a = in.nextInt();
+          const size_t b = in.nextInt();
+          const size_t afterHeader = in.pos;
+          if (in.nextToken() == "OFFSETS") {
+            // new (5.1) layout: 'a' offsets, 'b' indices
+            in.readValues(a,in.nextToken(),&cells.offsets);
+            if (in.nextToken() != "CONNECTIVITY")
+              throw std::runtime_error("#umesh: expected CONNECTIVITY in legacy vtk file");
+            in.readValues(b,in.nextToken(),&cells.connectivity);
+          } else {
+            // old layout: 'a' cells, as 'b' ints of vertex count
+            // followed by that many indices
+            in.pos = afterHeader;
+            std::vector<int64_t> list;
+            in.readValues(b,"int",&list);
+            cells.offsets.resize(a+1);
+            cells.offsets[0] = 0;
+            size_t listPos = 0;
+            for (size_t i=0;i<a;i++) {
+              if (listPos >= b || list[listPos] < 0)
+                throw std::runtime_error("#umesh: invalid CELLS in legacy vtk file");
+              cells.offsets[i+1] = cells.offsets[i]+list[listPos];
+              listPos += list[listPos]+1;
+            }
+            if (listPos != b)
+              throw std::runtime_error("#umesh: invalid CELLS in legacy vtk file");
+            cells.connectivity.resize(cells.offsets[a]);
+            parallel_for_blocked(0,a,vtkBlockSize,[&](size_t begin, size_t end){
+                for (size_t i=begin;i<end;i++)
+                  std::copy(list.begin()+cells.offsets[i]+i+1,
+                            list.begin()+cells.offsets[i+1]+i+1,
+                            cells.connectivity.begin()+cells.offsets[i]);
+              });
+          }
+        } else if (keyword == "CELL_TYPES") {
+          const size_t n = in.nextInt();
+          in.readValues(n,"int",&cells.types);
+        } else if (keyword == "POINT_DATA" || keyword == "CELL_DATA") {
+          section = (keyword == "POINT_DATA") ? POINT_DATA : CELL_DATA;
+          sectionSize = in.nextInt();
+        } else if (keyword == "SCALARS") {
+          const std::string name = in.nextToken();
+          const std::string type = in.nextToken();
+          // number of components is optional
+          std::string next = in.nextToken();
+          int numComponents = 1;
+          if (next != "LOOKUP_TABLE") {
+            numComponents = std::stoi(next);
+            next = in.nextToken();
+          }
+          if (next != "LOOKUP_TABLE")
+            throw std::runtime_error("#umesh: expected LOOKUP_TABLE in legacy vtk file");
+          in.nextToken();
+          readField(name,numComponents,sectionSize,type,/*isScalars:*/true);
+        } else if (keyword == "FIELD") {
+          in.nextToken();
+          const size_t numArrays = in.nextInt();
+          for (size_t i=0;i<numArrays;i++) {
+            const std::string name = in.nextToken();
+            const int numComponents = (int)in.nextInt();
+            const size_t numTuples = in.nextInt();
+            const std::string type = in.nextToken();
+            if (section == NONE || numTuples != sectionSize)
+              in.readValues<float>(numComponents*numTuples,type,nullptr);
+            else
+              readField(name,numComponents,numTuples,type,/*isScalars:*/false);
+          }
+        } else if (keyword == "VECTORS" || keyword == "NORMALS") {
+          in.nextToken();
+          in.readValues<float>(3*sectionSize,in.nextToken(),nullptr);
+        } else if (keyword == "TENSORS") {
+          in.nextToken();
+          in.readValues<float>(9*sectionSize,in.nextToken(),nullptr);
+        } else if (keyword == "TEXTURE_COORDINATES") {
+          in.nextToken();
+          const size_t dim = in.nextInt();
+          in.readValues<float>(dim*sectionSize,in.nextToken(),nullptr);
+        } else if (keyword == "COLOR_SCALARS") {
+          in.nextToken();
+          const size_t n = in.nextInt();
+          in.readValues<float>(n*sectionSize,in.binary ? "unsigned_char" : "float",nullptr);
+        } else if (keyword == "LOOKUP_TABLE") {
+          in.nextToken();
+          const size_t n = in.nextInt();
+          in.readValues<float>(4*n,in.binary ? "unsigned_char" : "float",nullptr);
+        } else if (keyword == "METADATA") {
+          // metadata block ends with an empty line
+          in.skipLine();
+          while (in.pos < in.size) {
+            const size_t lineBegin = in.pos;
+            in.skipLine();
+            bool empty = true;
+            for (size_t i=lineBegin;i<in.pos;i++)
+              if (!isSpace(in.data[i])) empty = false;
+            if (empty) break;
+          }
+        } else
+          throw std::runtime_error("#umesh: unsupported keyword '"+keyword
+                                   +"' in legacy vtk file '"+fileName+"'");
+      }
+
+      if (cells.offsets.empty())
+        cells.offsets.push_back(0);
+      if (cells.types.size()+1 != cells.offsets.size())
+        throw std::runtime_error("#umesh: number of CELL_TYPES does not match"
+                                 " number of CELLS in legacy vtk file");
+      cells.validate(numPoints);
+
+      if (fieldName == "" && activePointScalars.valid)
+        pointField = std::move(activePointScalars);
+      if (fieldName == "" && activeCellScalars.valid)
+        cellField = activeCellScalars;
+      if (!pointField.valid && !cellField.valid && fieldName != "")
+        throw std::runtime_error("#umesh: no scalar field '"+fieldName+"' in '"+fileName+"'");
+      const bool isCellField = !pointField.valid && cellField.valid;
+      // the cell field that becomes perElement: either the field
+      // itself, or - next to a point field - the active cell scalars
+      const LegacyField *perElementField
+        = isCellField
+        ? &cellField
+        : (pointField.valid && activeCellScalars.valid
+           ? &activeCellScalars
+           : nullptr);
+      if (perElementField && perElementField->values.size() != cells.size())
+        throw std::runtime_error("#umesh: cell data size does not match"
+                                 " number of cells in legacy vtk file");
+
+      UMesh::SP mesh = std::make_shared<UMesh>();
+      addVertices(*mesh,coords);
+      if (perElementField) {
+        CellValues cellValues;
+        addCells(*mesh,cells,0,perElementField->values.data(),&cellValues);
+        mesh->perElement = cellValues.assemble(perElementField->name);
+      } else
+        addCells(*mesh,cells,0);
+      if (isCellField)
+        mesh->perVertex = cellToVertex(mesh,mesh->perElement);
+
+      if (pointField.valid) {
+        mesh->perVertex = std::make_shared<Attribute>();
+        mesh->perVertex->name = pointField.name;
+        mesh->perVertex->values = std::move(pointField.values);
+        mesh->perVertex->finalize();
+      }
+      mesh->finalize();
+      return mesh;
+    }
+
+    // ==================================================================
+    // writing VTK XML (.vtu) files
+    // ==================================================================
+
+    /*! size (in bytes) of the chunks in which generated arrays get
+        produced, and of the blocks that get compressed individually */
+    const size_t vtuChunkSize = 1<<20;
+
+    /*! one data array to be written to the appended section of a vtu
+        file. Its data is either the concatenation of some existing
+        memory ranges (which then get written as they are, without
+        any copies), or gets generated on the fly, chunk by chunk */
+    struct VTUOutArray {
+      /*! copies bytes [begin,end) of this array's data to 'out'; for
+          generated arrays these have to be multiples of elementSize */
+      void getBytes(size_t begin, size_t end, uint8_t *out) const;
+
+      std::string name;
+      std::string type;
+      int    numComponents = 1;
+      size_t numBytes      = 0;
+      /*! memory ranges (pointer and size in bytes) this array
+          consists of, if not generated */
+      std::vector<std::pair<const void *,size_t>> segments;
+      /*! generates elements [begin,end) of this array */
+      std::function<void(size_t,size_t,uint8_t*)> generate;
+      size_t elementSize = 1;
+    };
+
+    void VTUOutArray::getBytes(size_t begin, size_t end, uint8_t *out) const
+    {
+      if (generate) {
+        generate(begin/elementSize,end/elementSize,out);
+        return;
+      }
+      size_t segBegin = 0;
+      for (auto &seg : segments) {
+        const size_t segEnd = segBegin+seg.second;
+        const size_t b = std::max(begin,segBegin);
+        const size_t e = std::min(end,segEnd);
+        if (b < e)
+          memcpy(out+(b-begin),(const uint8_t *)seg.first+(b-segBegin),e-b);
+        segBegin = segEnd;
+      }
+    }
+
+    /*! writes one array (UInt64 header plus data) to the appended
+        section. Uncompressed, existing memory gets written as is, and
+        generated data gets produced - in parallel - one batch of
+        chunks at a time. Compressed, batches of blocks get produced
+        and compressed in parallel, and then written in order; the
+        header with the compressed block sizes gets written once those
+        are known */
+    void writeAppended(std::ofstream &out, const VTUOutArray &array, bool compress)
+    {
+      const size_t batchSize = 16;
+      if (!compress) {
+        const uint64_t numBytes = array.numBytes;
+        writeElement(out,numBytes);
+        if (!array.generate) {
+          for (auto &seg : array.segments)
+            out.write((const char *)seg.first,seg.second);
+          return;
+        }
+        std::vector<uint8_t> batch(std::min(array.numBytes,batchSize*vtuChunkSize));
+        for (size_t begin=0;begin<array.numBytes;begin+=batch.size()) {
+          const size_t end = std::min(array.numBytes,begin+batch.size());
+          parallel_for_blocked(begin,end,vtuChunkSize,[&](size_t b, size_t e){
+              array.getBytes(b,e,batch.data()+(b-begin));
+            });
+          out.write((const char *)batch.data(),end-begin);
+        }
+        return;
+      }
+#if UMESH_HAVE_ZLIB
+      const size_t numBlocks = divRoundUp(array.numBytes,vtuChunkSize);
+      std::vector<uint64_t> header(3+numBlocks);
+      header[0] = numBlocks;
+      header[1] = vtuChunkSize;
+      header[2] = array.numBytes % vtuChunkSize;
+      const std::streampos headerPos = out.tellp();
+      writeArray(out,header.data(),header.size());
+      std::vector<std::vector<uint8_t>> raw(batchSize), compressed(batchSize);
+      std::atomic<bool> failed(false);
+      for (size_t batchBegin=0;batchBegin<numBlocks;batchBegin+=batchSize) {
+        const size_t batchEnd = std::min(numBlocks,batchBegin+batchSize);
+        parallel_for(batchEnd-batchBegin,[&](size_t i){
+            const size_t begin = (batchBegin+i)*vtuChunkSize;
+            const size_t end   = std::min(array.numBytes,begin+vtuChunkSize);
+            raw[i].resize(end-begin);
+            array.getBytes(begin,end,raw[i].data());
+            uLongf size = compressBound(end-begin);
+            compressed[i].resize(size);
+            if (compress2(compressed[i].data(),&size,raw[i].data(),end-begin,
+                          Z_BEST_SPEED) != Z_OK)
+              failed = true;
+            compressed[i].resize(size);
+          });
+        if (failed)
+          throw std::runtime_error("#umesh: error compressing vtu data array");
+        for (size_t i=0;i<batchEnd-batchBegin;i++) {
+          header[3+batchBegin+i] = compressed[i].size();
+          writeArray(out,compressed[i].data(),compressed[i].size());
+        }
+      }
+      const std::streampos endPos = out.tellp();
+      out.seekp(headerPos);
+      writeArray(out,header.data(),header.size());
+      out.seekp(endPos);
+#else
+      throw std::runtime_error("#umesh: cannot write compressed vtu files,"
+                               " umesh was built without zlib support");
+#endif
+    }
+
+    /*! writes the mesh as a VTK XML unstructured grid (.vtu) file */
+    void saveVTU(const std::string &fileName, UMesh::SP mesh, bool compress)
+    {
+#if !UMESH_HAVE_ZLIB
+      if (compress)
+        throw std::runtime_error("#umesh: cannot write compressed vtu files,"
+                                 " umesh was built without zlib support");
+#endif
+      static_assert(sizeof(Hex) == 8*sizeof(int) && sizeof(Wedge) == 6*sizeof(int)
+                    && sizeof(Pyr) == 5*sizeof(int) && sizeof(Tet) == 4*sizeof(int)
+                    && sizeof(Quad) == 4*sizeof(int) && sizeof(Triangle) == 3*sizeof(int),
+                    "element vertex indices have to be laid out contiguously");
+      // all elements, in the order in which they get written
+      struct ElementArray {
+        const void *data;
+        size_t      count;
+        int         numVertices;
+        uint8_t     vtkType;
+      };
+      const ElementArray elements[6] = {
+        { mesh->triangles.data(),mesh->triangles.size(),3, 5 /* VTK_TRIANGLE */   },
+        { mesh->quads.data(),    mesh->quads.size(),    4, 9 /* VTK_QUAD */       },
+        { mesh->tets.data(),     mesh->tets.size(),     4,10 /* VTK_TETRA */      },
+        { mesh->pyrs.data(),     mesh->pyrs.size(),     5,14 /* VTK_PYRAMID */    },
+        { mesh->wedges.data(),   mesh->wedges.size(),   6,13 /* VTK_WEDGE */      },
+        { mesh->hexes.data(),    mesh->hexes.size(),    8,12 /* VTK_HEXAHEDRON */ },
+      };
+      size_t cellBegin[7] = { 0 }, connBegin[7] = { 0 };
+      for (int k=0;k<6;k++) {
+        cellBegin[k+1] = cellBegin[k]+elements[k].count;
+        connBegin[k+1] = connBegin[k]+elements[k].count*elements[k].numVertices;
+      }
+      const size_t numCells = cellBegin[6];
+      // which element array cell 'i' is in
+      auto arrayOf = [&](size_t i) {
+        int k = 0;
+        while (cellBegin[k+1] <= i) ++k;
+        return k;
+      };
+
+      std::vector<VTUOutArray> cellData(mesh->perElement ? 1 : 0);
+      if (mesh->perElement) {
+        if (mesh->perElement->values.size() != numCells)
+          throw std::runtime_error("#umesh: number of per-element values does not"
+                                   " match number of elements");
+        VTUOutArray &scalars = cellData[0];
+        scalars.name = mesh->perElement->name == "" ? "cellScalars" : mesh->perElement->name;
+        scalars.type = "Float32";
+        scalars.numBytes = numCells*sizeof(float);
+        scalars.segments.push_back({mesh->perElement->values.data(),scalars.numBytes});
+      }
+
+      std::vector<VTUOutArray> pointData(mesh->perVertex ? 1 : 0);
+      if (mesh->perVertex) {
+        if (mesh->perVertex->values.size() != mesh->vertices.size())
+          throw std::runtime_error("#umesh: number of scalars does not match"
+                                   " number of vertices");
+        VTUOutArray &scalars = pointData[0];
+        scalars.name = mesh->perVertex->name == "" ? "scalars" : mesh->perVertex->name;
+        scalars.type = "Float32";
+        scalars.numBytes = mesh->perVertex->values.size()*sizeof(float);
+        scalars.segments.push_back({mesh->perVertex->values.data(),scalars.numBytes});
+      }
+
+      VTUOutArray points;
+      points.name = "Points";
+      points.type = "Float32";
+      points.numComponents = 3;
+      points.numBytes = mesh->vertices.size()*sizeof(vec3f);
+      points.segments.push_back({mesh->vertices.data(),points.numBytes});
+
+      std::vector<VTUOutArray> cells(3);
+      VTUOutArray &connectivity = cells[0];
+      connectivity.name = "connectivity";
+      connectivity.type = "Int32";
+      connectivity.numBytes = connBegin[6]*sizeof(int);
+      for (int k=0;k<6;k++)
+        if (elements[k].count)
+          connectivity.segments.push_back
+            ({elements[k].data,elements[k].count*elements[k].numVertices*sizeof(int)});
+
+      VTUOutArray &offsets = cells[1];
+      offsets.name = "offsets";
+      offsets.type = "Int64";
+      offsets.elementSize = sizeof(int64_t);
+      offsets.numBytes = numCells*sizeof(int64_t);
+      offsets.generate = [&](size_t begin, size_t end, uint8_t *out) {
+        int k = arrayOf(begin);
+        for (size_t i=begin;i<end;i++) {
+          while (cellBegin[k+1] <= i) ++k;
+          const int64_t offset
+            = connBegin[k]+(i-cellBegin[k]+1)*elements[k].numVertices;
+          memcpy(out+(i-begin)*sizeof(offset),&offset,sizeof(offset));
+        }
+      };
+
+      VTUOutArray &types = cells[2];
+      types.name = "types";
+      types.type = "UInt8";
+      types.numBytes = numCells;
+      types.generate = [&](size_t begin, size_t end, uint8_t *out) {
+        int k = arrayOf(begin);
+        for (size_t i=begin;i<end;i++) {
+          while (cellBegin[k+1] <= i) ++k;
+          out[i-begin] = elements[k].vtkType;
+        }
+      };
+
+      std::ofstream out(fileName,std::ios_base::binary);
+      if (!out.good())
+        throw std::runtime_error("#umesh: could not open '"+fileName+"' for writing");
+
+      // the xml header, with placeholders for the array offsets (we
+      // only know those once the - possibly compressed - data has
+      // been written), which get patched in at the end
+      std::vector<const VTUOutArray *> arrays;
+      std::vector<std::streampos> offsetPos;
+      auto writeDataArray = [&](const VTUOutArray &array) {
+        out << "        <DataArray type=\"" << array.type << "\" Name=\"" << array.name << "\"";
+        if (array.numComponents != 1)
+          out << " NumberOfComponents=\"" << array.numComponents << "\"";
+        out << " format=\"appended\" offset=\"";
+        offsetPos.push_back(out.tellp());
+        out << std::string(20,'0') << "\"/>\n";
+        arrays.push_back(&array);
+      };
+      out << "<?xml version=\"1.0\"?>\n"
+          << "<VTKFile type=\"UnstructuredGrid\" version=\"1.0\""
+          << " byte_order=\"LittleEndian\" header_type=\"UInt64\""
+          << (compress ? " compressor=\"vtkZLibDataCompressor\"" : "") << ">\n"
+          << "  <UnstructuredGrid>\n"
+          << "    <Piece NumberOfPoints=\"" << mesh->vertices.size()
+          << "\" NumberOfCells=\"" << numCells << "\">\n";
+      if (pointData.empty())
+        out << "      <PointData>\n";
+      else
+        out << "      <PointData Scalars=\"" << pointData[0].name << "\">\n";
+      for (auto &array : pointData)
+        writeDataArray(array);
+      out << "      </PointData>\n";
+      if (cellData.empty())
+        out << "      <CellData>\n";
+      else
+        out << "      <CellData Scalars=\"" << cellData[0].name << "\">\n";
+      for (auto &array : cellData)
+        writeDataArray(array);
+      out << "      </CellData>\n"
+          << "      <Points>\n";
+      writeDataArray(points);
+      out << "      </Points>\n"
+          << "      <Cells>\n";
+      for (auto &array : cells)
+        writeDataArray(array);
+      out << "      </Cells>\n"
+          << "    </Piece>\n"
+          << "  </UnstructuredGrid>\n"
+          << "  <AppendedData encoding=\"raw\">\n"
+          << "   _";
+
+      const std::streampos appendedBegin = out.tellp();
+      std::vector<size_t> arrayOffsets;
+      for (auto array : arrays) {
+        arrayOffsets.push_back(size_t(out.tellp()-appendedBegin));
+        writeAppended(out,*array,compress);
+      }
+      out << "\n  </AppendedData>\n"
+          << "</VTKFile>\n";
+      for (size_t i=0;i<arrays.size();i++) {
+        char offset[32];
+        snprintf(offset,sizeof(offset),"%020llu",(unsigned long long)arrayOffsets[i]);
+        out.seekp(offsetPos[i]);
+        out.write(offset,20);
+      }
+      if (!out.good())
+        throw std::runtime_error("#umesh: error writing '"+fileName+"'");
+    }
+
+    UMesh::SP loadVTK(const std::string &fileName, const std::string &fieldName)
+    {
+      if (endsWith(fileName,".vtu"))
+        return loadVTU(fileName,fieldName);
+      if (endsWith(fileName,".vtk"))
+        return loadLegacyVTK(fileName,fieldName);
+      throw std::runtime_error("#umesh: unknown vtk file extension in '"+fileName+"'");
+    }
+
+  } // ::umesh::io
+} // ::umesh
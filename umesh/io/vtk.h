@@ -0,0 +1,79 @@
+// ======================================================================== //
+// Copyright 2018-2020 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+
+#pragma once
+
+#include "umesh/UMesh.h"
+#include "umesh/io/IO.h"
+
+/* native readers for VTK unstructured grids - both the XML (.vtu)
+   and the legacy (.vtk) file formats - and a native .vtu writer, none
+   of which require libvtk */
+
+namespace umesh {
+  namespace io {
+
+    /*! loads a VTK XML unstructured grid (.vtu) file. Supports ascii,
+        inline (base64) binary, and appended (raw or base64) data
+        arrays, with or without vtkZLibDataCompressor compression
+        (the latter only if umesh was built with zlib). All pieces in
+        the file get merged into a single mesh.
+
+        VTK's linear cells get mapped to the respective umesh
+        elements; quadratic (and higher-order) cells get reduced to
+        their corner vertices; all other cells (vertices, lines,
+        polygons, polyhedra, ...) get skipped, with a warning.
+
+        If 'fieldName' is specified the scalar field of that name gets
+        loaded as the mesh's per-vertex attribute; otherwise the
+        active (or else the first) single-component point-data array
+        is used. If the field is a cell-data array it becomes the
+        mesh's perElement attribute (for the cells that were not
+        skipped), and gets averaged to the vertices for its perVertex
+        one; next to a point-data field, the active cell-data scalars
+        (if any) become the perElement attribute. */
+    UMesh::SP loadVTU(const std::string &fileName,
+                      const std::string &fieldName = "");
+
+    /*! loads a legacy-format VTK (.vtk) file with an
+        UNSTRUCTURED_GRID dataset, in either ASCII or BINARY encoding,
+        and in both the old (counts-and-indices) and the new
+        (offsets/connectivity) CELLS layout. Cells and scalars get
+        handled the same way as in loadVTU(); since legacy files do
+        not mark any scalars as active, the first single-component
+        SCALARS of each (point or cell data) section take that role */
+    UMesh::SP loadLegacyVTK(const std::string &fileName,
+                            const std::string &fieldName = "");
+
+    /*! loads either a .vtu or a legacy .vtk file, depending on the
+        file's extension */
+    UMesh::SP loadVTK(const std::string &fileName,
+                      const std::string &fieldName = "");
+
+    /*! writes the mesh as a VTK XML unstructured grid (.vtu) file,
+        with all arrays in 'raw' appended binary form; perVertex gets
+        written as point data, perElement as cell data. Points,
+        scalars, and connectivity get written straight from the mesh's own
+        arrays; offsets and cell types get generated in chunks, so
+        writing needs (almost) no memory beyond the mesh itself. If
+        'compress' is set all arrays get zlib-compressed, in parallel
+        blocks (requires umesh to be built with zlib) */
+    void saveVTU(const std::string &fileName, UMesh::SP mesh,
+                 bool compress = false);
+
+  } // ::umesh::io
+} // ::umesh
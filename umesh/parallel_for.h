@@ -27,6 +27,7 @@
 #if UMESH_HAVE_TBB
 #include <tbb/parallel_for.h>
 #include <tbb/task_arena.h>
+#include <tbb/parallel_invoke.h>
 #define UMESH_HAVE_PARALLEL_FOR 1
 #endif
 
@@ -76,6 +77,19 @@ namespace umesh {
       taskFunction(block_begin,std::min(block_begin+blockSize,end));
   }
   
+  /*! runs both tasks, concurrently if we can, and returns once both
+      are done */
+  template<typename TASK_A, typename TASK_B>
+  inline void parallel_invoke(const TASK_A &taskA, const TASK_B &taskB)
+  {
+#if UMESH_HAVE_TBB
+    tbb::parallel_invoke(taskA,taskB);
+#else
+    taskA();
+    taskB();
+#endif
+  }
+  
   template<typename TASK_T>
   void parallel_for_blocked(size_t begin, size_t end, size_t blockSize,
                             const TASK_T &taskFunction)
@@ -0,0 +1,1609 @@
+// ======================================================================== //
+// Copyright 2018-2020 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "umesh/partition.h"
+#include "umesh/FaceConn.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <queue>
+#include <unordered_set>
+
+namespace umesh {
+
+  /*! number of candidate split planes (+1) per axis for SAH splits */
+  enum { numSAHBins = 32 };
+
+  /*! bricks with fewer prims than this get split serially (binning,
+      partitioning, and recursion); larger ones in parallel */
+  const size_t parallelThreshold = 64*1024;
+
+  /*! bounds of a brick's prims, and of their centroids */
+  struct BrickBounds {
+    inline void extend(const BrickBounds &other)
+    {
+      bounds.extend(other.bounds);
+      centBounds.extend(other.centBounds);
+    }
+    box3f bounds;
+    box3f centBounds;
+  };
+
+  inline float halfArea(const box3f &box)
+  {
+    if (box.lower.x > box.upper.x) return 0.f;
+    const vec3f d = box.upper - box.lower;
+    return d.x*d.y + d.y*d.z + d.z*d.x;
+  }
+
+  /*! one SAH bin, for one axis */
+  struct SAHBin {
+    box3f  bounds;
+    size_t count = 0;
+  };
+
+  /*! the bins for all three axes */
+  struct SAHBins {
+    inline void extend(const SAHBins &other)
+    {
+      for (int dim=0;dim<3;dim++)
+        for (int b=0;b<numSAHBins;b++) {
+          bin[dim][b].bounds.extend(other.bin[dim][b].bounds);
+          bin[dim][b].count += other.bin[dim][b].count;
+        }
+    }
+    SAHBin bin[3][numSAHBins];
+  };
+
+  /*! computes result = reduce(result,f(begin,end)) over all blocks of
+      [begin,end), in parallel for large ranges; blocks get merged in
+      order, so the result is the same no matter the number of
+      threads */
+  template<typename T, typename BlockFunc>
+  inline void blockedReduce(size_t begin, size_t end, T &result,
+                            const BlockFunc &blockFunc)
+  {
+    const size_t blockSize = 16*1024;
+    if (end-begin < parallelThreshold) {
+      blockFunc(begin,end,result);
+      return;
+    }
+    const size_t numBlocks = (end-begin+blockSize-1)/blockSize;
+    std::vector<T> blockResult(numBlocks);
+    parallel_for(numBlocks,[&](size_t blockID){
+        const size_t blockBegin = begin+blockID*blockSize;
+        blockFunc(blockBegin,std::min(blockBegin+blockSize,end),
+                  blockResult[blockID]);
+      });
+    for (auto &r : blockResult)
+      result.extend(r);
+  }
+
+  /*! does the actual work for partitionObjectSpace() */
+  struct ObjectSpacePartitioner {
+    ObjectSpacePartitioner(UMesh::SP mesh,
+                           size_t leafThreshold,
+                           SplitMethod splitMethod);
+
+    /*! a leaf brick, as a range of our primIDs array */
+    struct Leaf {
+      size_t begin, end;
+      box3f  bounds;
+    };
+    
+    /*! recursively partitions prims primIDs[begin,end) into at most
+        maxBricks bricks */
+    void build(size_t begin, size_t end,
+               const BrickBounds &brickBounds,
+               size_t maxBricks);
+
+    BrickBounds computeBounds(size_t begin, size_t end) const;
+
+    /*! splits the given range in two, such that the left half has
+        (close to) the given fraction of the prims; returns the number
+        of prims that end up on the left side (which, for valid
+        splits, is neither 0 nor the full range) */
+    size_t splitMedian(size_t begin, size_t end,
+                       const BrickBounds &brickBounds,
+                       double leftFraction = .5);
+    /*! splits the given range in two at the SAH-optimal plane;
+        returns the number of prims that end up on the left side */
+    size_t splitSAH(size_t begin, size_t end, const BrickBounds &brickBounds);
+
+    /*! re-orders primIDs[begin,end) such that all prims for which
+        isLeft(primID) is true come first; returns the number of
+        those */
+    template<typename IsLeft>
+    size_t partition(size_t begin, size_t end, const IsLeft &isLeft);
+
+    inline float centroid(size_t primID, int dim) const
+    { return .5f*(lower[dim][primID]+upper[dim][primID]); }
+    
+    const size_t      leafThreshold;
+    const SplitMethod splitMethod;
+    
+    std::vector<UMesh::PrimRef> prims;
+
+    /*! bounds of all prims, as one array per dimension */
+    std::vector<float> lower[3];
+    std::vector<float> upper[3];
+
+    /*! the prims (as indices into 'prims') we're partitioning - each
+        brick in progress is one range of this array */
+    std::vector<size_t> primIDs;
+    /*! scratch space for partitioning, same size as primIDs */
+    std::vector<size_t> scratch;
+
+    std::mutex        leavesMutex;
+    std::vector<Leaf> leaves;
+  };
+
+  ObjectSpacePartitioner::ObjectSpacePartitioner(UMesh::SP mesh,
+                                                 size_t leafThreshold,
+                                                 SplitMethod splitMethod)
+    : leafThreshold(leafThreshold),
+      splitMethod(splitMethod)
+  {
+    mesh->createVolumePrimRefs(prims);
+    const size_t numPrims = prims.size();
+    for (int dim=0;dim<3;dim++) {
+      lower[dim].resize(numPrims);
+      upper[dim].resize(numPrims);
+    }
+    primIDs.resize(numPrims);
+    scratch.resize(numPrims);
+    parallel_for_blocked(0,numPrims,16*1024,[&](size_t begin, size_t end){
+        for (size_t i=begin;i<end;i++) {
+          const box3f box = mesh->getBounds(prims[i]);
+          for (int dim=0;dim<3;dim++) {
+            lower[dim][i] = box.lower[dim];
+            upper[dim][i] = box.upper[dim];
+          }
+          primIDs[i] = i;
+        }
+      });
+  }
+
+  BrickBounds ObjectSpacePartitioner::computeBounds(size_t begin, size_t end) const
+  {
+    BrickBounds result;
+    blockedReduce(begin,end,result,[&](size_t begin, size_t end,
+                                       BrickBounds &blockBounds){
+        for (size_t i=begin;i<end;i++) {
+          const size_t primID = primIDs[i];
+          const vec3f lo(lower[0][primID],lower[1][primID],lower[2][primID]);
+          const vec3f hi(upper[0][primID],upper[1][primID],upper[2][primID]);
+          blockBounds.bounds.extend(box3f(lo,hi));
+          blockBounds.centBounds.extend(.5f*(lo+hi));
+        }
+      });
+    return result;
+  }
+
+  template<typename IsLeft>
+  size_t ObjectSpacePartitioner::partition(size_t begin, size_t end,
+                                           const IsLeft &isLeft)
+  {
+    if (end-begin < parallelThreshold)
+      return std::partition(primIDs.begin()+begin,primIDs.begin()+end,isLeft)
+        - (primIDs.begin()+begin);
+
+    // count left prims per block, scan, and scatter to scratch
+    // space; then copy back
+    const size_t blockSize = 16*1024;
+    const size_t numBlocks = (end-begin+blockSize-1)/blockSize;
+    std::vector<size_t> numLeft(numBlocks+1,0);
+    parallel_for(numBlocks,[&](size_t blockID){
+        const size_t blockBegin = begin+blockID*blockSize;
+        const size_t blockEnd   = std::min(blockBegin+blockSize,end);
+        size_t count = 0;
+        for (size_t i=blockBegin;i<blockEnd;i++)
+          count += isLeft(primIDs[i]);
+        numLeft[blockID+1] = count;
+      });
+    for (size_t blockID=0;blockID<numBlocks;blockID++)
+      numLeft[blockID+1] += numLeft[blockID];
+    const size_t totalLeft = numLeft[numBlocks];
+    parallel_for(numBlocks,[&](size_t blockID){
+        const size_t blockBegin = begin+blockID*blockSize;
+        const size_t blockEnd   = std::min(blockBegin+blockSize,end);
+        size_t l = begin+numLeft[blockID];
+        size_t r = begin+totalLeft+(blockBegin-begin)-numLeft[blockID];
+        for (size_t i=blockBegin;i<blockEnd;i++) {
+          const size_t primID = primIDs[i];
+          if (isLeft(primID))
+            scratch[l++] = primID;
+          else
+            scratch[r++] = primID;
+        }
+      });
+    parallel_for_blocked(begin,end,blockSize,[&](size_t begin, size_t end){
+        std::copy(scratch.begin()+begin,scratch.begin()+end,primIDs.begin()+begin);
+      });
+    return totalLeft;
+  }
+  
+  size_t ObjectSpacePartitioner::splitSAH(size_t begin, size_t end,
+                                          const BrickBounds &brickBounds)
+  {
+    const box3f &centBounds = brickBounds.centBounds;
+    vec3f scale;
+    for (int dim=0;dim<3;dim++) {
+      const float width = centBounds.upper[dim]-centBounds.lower[dim];
+      scale[dim] = (width > 0.f) ? (numSAHBins/width) : 0.f;
+    }
+    auto binOf = [&](size_t primID, int dim) {
+      const float f = (centroid(primID,dim)-centBounds.lower[dim])*scale[dim];
+      return std::min(int(numSAHBins)-1,std::max(0,int(f)));
+    };
+
+    // bin ...
+    SAHBins bins;
+    blockedReduce(begin,end,bins,[&](size_t begin, size_t end,
+                                     SAHBins &blockBins){
+        for (size_t i=begin;i<end;i++) {
+          const size_t primID = primIDs[i];
+          const box3f box(vec3f(lower[0][primID],lower[1][primID],lower[2][primID]),
+                          vec3f(upper[0][primID],upper[1][primID],upper[2][primID]));
+          for (int dim=0;dim<3;dim++) {
+            SAHBin &bin = blockBins.bin[dim][binOf(primID,dim)];
+            bin.bounds.extend(box);
+            bin.count++;
+          }
+        }
+      });
+
+    // ... find the cheapest plane (between bins 'bestBin-1' and
+    // 'bestBin') ...
+    int   bestDim  = -1;
+    int   bestBin  = -1;
+    float bestCost = INFINITY;
+    for (int dim=0;dim<3;dim++) {
+      if (scale[dim] == 0.f) continue;
+      float  rightArea[numSAHBins];
+      size_t rightCount[numSAHBins];
+      box3f  box;
+      size_t count = 0;
+      for (int b=numSAHBins-1;b>0;--b) {
+        box.extend(bins.bin[dim][b].bounds);
+        count += bins.bin[dim][b].count;
+        rightArea[b]  = halfArea(box);
+        rightCount[b] = count;
+      }
+      box   = box3f();
+      count = 0;
+      for (int b=1;b<numSAHBins;b++) {
+        box.extend(bins.bin[dim][b-1].bounds);
+        count += bins.bin[dim][b-1].count;
+        if (count == 0 || rightCount[b] == 0) continue;
+        const float cost = halfArea(box)*count + rightArea[b]*rightCount[b];
+        if (cost < bestCost) {
+          bestCost = cost;
+          bestDim  = dim;
+          bestBin  = b;
+        }
+      }
+    }
+    if (bestDim < 0)
+      return splitMedian(begin,end,brickBounds);
+
+    // ... and split there
+    return partition(begin,end,[&](size_t primID){
+        return binOf(primID,bestDim) < bestBin;
+      });
+  }
+
+  size_t ObjectSpacePartitioner::splitMedian(size_t begin, size_t end,
+                                             const BrickBounds &brickBounds,
+                                             double leftFraction)
+  {
+    const int dim = arg_max(brickBounds.centBounds.size());
+    const size_t numPrims = end-begin;
+    const size_t numLeft
+      = std::min(std::max(size_t(numPrims*leftFraction+.5),size_t(1)),numPrims-1);
+    const size_t mid = begin+numLeft;
+    std::nth_element(primIDs.begin()+begin,
+                     primIDs.begin()+mid,
+                     primIDs.begin()+end,
+                     [&](size_t a, size_t b){
+                       const float ca = centroid(a,dim);
+                       const float cb = centroid(b,dim);
+                       return (ca < cb) || ((ca == cb) && (a < b));
+                     });
+    return mid-begin;
+  }
+  
+  void ObjectSpacePartitioner::build(size_t begin, size_t end,
+                                     const BrickBounds &brickBounds,
+                                     size_t maxBricks)
+  {
+    const size_t numPrims = end-begin;
+    if (numPrims < std::max(leafThreshold,size_t(2)) ||
+        maxBricks <= 1 ||
+        brickBounds.centBounds.lower == brickBounds.centBounds.upper) {
+      // either small enough, out of bricks, or can't split this any
+      // more ...
+      std::lock_guard<std::mutex> lock(leavesMutex);
+      leaves.push_back({begin,end,brickBounds.bounds});
+      return;
+    }
+
+    size_t numLeft, maxLeft;
+    switch (splitMethod) {
+    case SPLIT_SAH:
+      // distribute available bricks according to size of the halves
+      numLeft = splitSAH(begin,end,brickBounds);
+      maxLeft = size_t(double(maxBricks)*numLeft/numPrims+.5);
+      maxLeft = std::min(std::max(maxLeft,size_t(1)),maxBricks-1);
+      break;
+    case SPLIT_MEDIAN:
+      // split prims according to how the available bricks get
+      // distributed, so all final bricks get the same size
+      maxLeft = maxBricks/2;
+      numLeft = splitMedian(begin,end,brickBounds,double(maxLeft)/maxBricks);
+      break;
+    default:
+      throw std::runtime_error("invalid split method");
+    }
+    const size_t mid = begin+numLeft;
+    const size_t maxRight = maxBricks-maxLeft;
+
+    auto buildLeft = [&]() {
+      build(begin,mid,computeBounds(begin,mid),maxLeft);
+    };
+    auto buildRight = [&]() {
+      build(mid,end,computeBounds(mid,end),maxRight);
+    };
+    if (numPrims < parallelThreshold) {
+      buildLeft();
+      buildRight();
+    } else
+      parallel_invoke(buildLeft,buildRight);
+  }
+
+  /*! computes an *object* space partitioning of the mesh's volume
+      elements into bricks */
+  std::vector<ObjectSpaceBrick>
+  partitionObjectSpace(UMesh::SP mesh,
+                       size_t leafThreshold,
+                       size_t maxBricks,
+                       SplitMethod splitMethod)
+  {
+    if (!mesh) throw std::runtime_error("null input mesh");
+    if (maxBricks < 1) throw std::runtime_error("need at least one brick");
+
+    ObjectSpacePartitioner partitioner(mesh,leafThreshold,splitMethod);
+    const size_t numPrims = partitioner.primIDs.size();
+    if (numPrims == 0)
+      return {};
+    partitioner.build(0,numPrims,partitioner.computeBounds(0,numPrims),maxBricks);
+
+    // leaves got created in whatever order the threads finished;
+    // sort them to get the same result every time
+    auto &leaves = partitioner.leaves;
+    std::sort(leaves.begin(),leaves.end(),
+              [](const ObjectSpacePartitioner::Leaf &a,
+                 const ObjectSpacePartitioner::Leaf &b){
+                return a.begin < b.begin;
+              });
+    std::vector<ObjectSpaceBrick> bricks(leaves.size());
+    parallel_for(leaves.size(),[&](size_t brickID){
+        auto &leaf  = leaves[brickID];
+        auto &brick = bricks[brickID];
+        brick.bounds = leaf.bounds;
+        brick.prims.resize(leaf.end-leaf.begin);
+        // store prims in mesh order, for better memory access
+        // patterns when extracting the brick's elements
+        std::sort(partitioner.primIDs.begin()+leaf.begin,
+                  partitioner.primIDs.begin()+leaf.end);
+        for (size_t i=leaf.begin;i<leaf.end;i++)
+          brick.prims[i-leaf.begin] = partitioner.prims[partitioner.primIDs[i]];
+      });
+    return bricks;
+  }
+  
+  // ==================================================================
+  // space filling curve partitioning
+  // ==================================================================
+
+  /*! number of bits per dimension for the space filling curves */
+  enum { curveBits = 21 };
+  
+  /*! spreads the lower 21 bits of x out to every third bit */
+  inline uint64_t spreadBits3(uint64_t x)
+  {
+    x &= 0x1fffff;
+    x = (x | (x << 32)) & 0x1f00000000ffffULL;
+    x = (x | (x << 16)) & 0x1f0000ff0000ffULL;
+    x = (x | (x <<  8)) & 0x100f00f00f00f00fULL;
+    x = (x | (x <<  4)) & 0x10c30c30c30c30c3ULL;
+    x = (x | (x <<  2)) & 0x1249249249249249ULL;
+    return x;
+  }
+
+  /*! interleaves the bits of three 21-bit values, with x's bits as
+      the most significant of each triple */
+  inline uint64_t interleaveBits3(uint32_t x, uint32_t y, uint32_t z)
+  {
+    return (spreadBits3(x) << 2) | (spreadBits3(y) << 1) | spreadBits3(z);
+  }
+
+  inline uint64_t mortonCode(vec3i cell)
+  {
+    return interleaveBits3(cell.x,cell.y,cell.z);
+  }
+
+  /*! 3D hilbert code, computed by converting the cell coordinates to
+      the hilbert curve's 'transposed' form (J. Skilling, "Programming
+      the Hilbert curve", 2004), and interleaving those */
+  inline uint64_t hilbertCode(vec3i cell)
+  {
+    uint32_t X[3] = { uint32_t(cell.x), uint32_t(cell.y), uint32_t(cell.z) };
+    const uint32_t M = 1u << (curveBits-1);
+    // inverse undo
+    for (uint32_t Q = M; Q > 1; Q >>= 1) {
+      const uint32_t P = Q-1;
+      for (int i=0;i<3;i++)
+        if (X[i] & Q)
+          X[0] ^= P;
+        else {
+          const uint32_t t = (X[0] ^ X[i]) & P;
+          X[0] ^= t;
+          X[i] ^= t;
+        }
+    }
+    // gray encode
+    for (int i=1;i<3;i++)
+      X[i] ^= X[i-1];
+    uint32_t t = 0;
+    for (uint32_t Q = M; Q > 1; Q >>= 1)
+      if (X[2] & Q) t ^= Q-1;
+    for (int i=0;i<3;i++)
+      X[i] ^= t;
+    return interleaveBits3(X[0],X[1],X[2]);
+  }
+
+  /*! sorts (key,value) pairs by key with a parallel, stable LSD radix
+      sort; digits where all keys are the same get skipped */
+  void radixSort(std::vector<uint64_t> &keys,
+                 std::vector<size_t>   &values,
+                 int numKeyBits)
+  {
+    enum { digitBits = 11, numBuckets = 1<<digitBits };
+    const size_t N = keys.size();
+    const size_t blockSize = 64*1024;
+    const size_t numBlocks = (N+blockSize-1)/blockSize;
+    std::vector<uint64_t> tmpKeys(N);
+    std::vector<size_t>   tmpValues(N);
+    std::vector<size_t>   histogram(numBlocks*numBuckets);
+    for (int shift=0;shift<numKeyBits;shift+=digitBits) {
+      // per-block histogram of this digit ...
+      parallel_for(numBlocks,[&](size_t blockID){
+          size_t *hist = histogram.data()+blockID*numBuckets;
+          std::fill(hist,hist+numBuckets,0);
+          const size_t begin = blockID*blockSize;
+          const size_t end   = std::min(begin+blockSize,N);
+          for (size_t i=begin;i<end;i++)
+            hist[(keys[i] >> shift) & (numBuckets-1)]++;
+        });
+      // ... turned into each block's output offsets (digit-major,
+      // then by block, which keeps this stable) ...
+      size_t sum = 0;
+      bool allSameDigit = false;
+      for (int digit=0;digit<numBuckets;digit++) {
+        size_t digitCount = 0;
+        for (size_t blockID=0;blockID<numBlocks;blockID++) {
+          size_t &h = histogram[blockID*numBuckets+digit];
+          const size_t count = h;
+          h = sum;
+          sum += count;
+          digitCount += count;
+        }
+        if (digitCount == N) allSameDigit = true;
+      }
+      if (allSameDigit) continue;
+      // ... and scatter
+      parallel_for(numBlocks,[&](size_t blockID){
+          size_t *offset = histogram.data()+blockID*numBuckets;
+          const size_t begin = blockID*blockSize;
+          const size_t end   = std::min(begin+blockSize,N);
+          for (size_t i=begin;i<end;i++) {
+            const size_t pos = offset[(keys[i] >> shift) & (numBuckets-1)]++;
+            tmpKeys[pos]   = keys[i];
+            tmpValues[pos] = values[i];
+          }
+        });
+      keys.swap(tmpKeys);
+      values.swap(tmpValues);
+    }
+  }
+
+  inline int numVerticesOf(size_t primType)
+  {
+    switch (primType) {
+    case UMesh::TET:   return Tet::numVertices;
+    case UMesh::PYR:   return Pyr::numVertices;
+    case UMesh::WEDGE: return Wedge::numVertices;
+    case UMesh::HEX:   return Hex::numVertices;
+    default:
+      throw std::runtime_error("not a volume element!?");
+    }
+  }
+  
+  /*! creates bricks from a list of prims, given as ranges
+      [brickBegin[b],brickBegin[b+1]) of prims[order[...]]; bricks'
+      prims end up in mesh order (for better memory access patterns
+      of whoever uses those bricks), and get their bounds computed */
+  std::vector<ObjectSpaceBrick>
+  gatherBricks(UMesh::SP mesh,
+               const std::vector<UMesh::PrimRef> &prims,
+               std::vector<size_t> &order,
+               const std::vector<size_t> &brickBegin)
+  {
+    const size_t blockSize = 16*1024;
+    const size_t numBricks = brickBegin.size()-1;
+    std::vector<ObjectSpaceBrick> bricks(numBricks);
+    parallel_for(numBricks,[&](size_t brickID){
+        const size_t begin = brickBegin[brickID];
+        const size_t end   = brickBegin[brickID+1];
+        std::sort(order.begin()+begin,order.begin()+end);
+        ObjectSpaceBrick &brick = bricks[brickID];
+        brick.prims.resize(end-begin);
+        BrickBounds bounds;
+        parallel_for_blocked(begin,end,blockSize,[&](size_t blockBegin, size_t blockEnd){
+            for (size_t i=blockBegin;i<blockEnd;i++)
+              brick.prims[i-begin] = prims[order[i]];
+          });
+        blockedReduce(begin,end,bounds,[&](size_t blockBegin, size_t blockEnd,
+                                           BrickBounds &blockBounds){
+            for (size_t i=blockBegin;i<blockEnd;i++)
+              blockBounds.bounds.extend(mesh->getBounds(prims[order[i]]));
+          });
+        brick.bounds = bounds.bounds;
+      });
+    return bricks;
+  }
+  
+  std::vector<ObjectSpaceBrick>
+  partitionSpaceFillingCurve(UMesh::SP mesh,
+                             size_t numBricks,
+                             SpaceFillingCurve curve,
+                             BrickWeight weight)
+  {
+    if (!mesh) throw std::runtime_error("null input mesh");
+    if (numBricks < 1) throw std::runtime_error("need at least one brick");
+
+    std::vector<UMesh::PrimRef> prims;
+    mesh->createVolumePrimRefs(prims);
+    const size_t numPrims = prims.size();
+    if (numPrims == 0)
+      return {};
+    numBricks = std::min(numBricks,numPrims);
+    const size_t blockSize = 16*1024;
+    
+    // compute centroids, and their bounds ...
+    std::vector<vec3f> centroids(numPrims);
+    BrickBounds rootBounds;
+    blockedReduce(0,numPrims,rootBounds,[&](size_t begin, size_t end,
+                                            BrickBounds &blockBounds){
+        for (size_t i=begin;i<end;i++) {
+          const box3f box = mesh->getBounds(prims[i]);
+          centroids[i] = box.center();
+          blockBounds.bounds.extend(box);
+          blockBounds.centBounds.extend(centroids[i]);
+        }
+      });
+
+    // ... to quantize them to the curve's grid of cells, and compute
+    // their codes ...
+    const box3f &centBounds = rootBounds.centBounds;
+    const float maxCell = float((1<<curveBits)-1);
+    vec3f scale;
+    for (int dim=0;dim<3;dim++) {
+      const float width = centBounds.upper[dim]-centBounds.lower[dim];
+      scale[dim] = (width > 0.f) ? (maxCell/width) : 0.f;
+    }
+    std::vector<uint64_t> codes(numPrims);
+    std::vector<size_t>   order(numPrims);
+    parallel_for_blocked(0,numPrims,blockSize,[&](size_t begin, size_t end){
+        for (size_t i=begin;i<end;i++) {
+          vec3i cell;
+          for (int dim=0;dim<3;dim++)
+            cell[dim] = std::min(int(maxCell),std::max(0,int((centroids[i][dim]-centBounds.lower[dim])*scale[dim])));
+          codes[i] = (curve == CURVE_HILBERT) ? hilbertCode(cell) : mortonCode(cell);
+          order[i] = i;
+        }
+      });
+    centroids.clear();
+    centroids.shrink_to_fit();
+
+    // ... and sort by those
+    radixSort(codes,order,3*curveBits);
+    codes.clear();
+    codes.shrink_to_fit();
+
+    // compute (inclusive) prefix sum over weights, in curve order
+    size_t numRefs = 0;
+    for (auto type : { UMesh::TET, UMesh::PYR, UMesh::WEDGE, UMesh::HEX }) {
+      const size_t count
+        = (type == UMesh::TET) ? mesh->tets.size()
+        : (type == UMesh::PYR) ? mesh->pyrs.size()
+        : (type == UMesh::WEDGE) ? mesh->wedges.size()
+        : mesh->hexes.size();
+      numRefs += count*numVerticesOf(type);
+    }
+    const double bytesPerVertex
+      = sizeof(vec3f)+(mesh->perVertex ? sizeof(float) : 0);
+    const double bytesPerRef
+      = sizeof(int) + mesh->vertices.size()*bytesPerVertex/std::max(numRefs,size_t(1));
+    auto weightOf = [&](const UMesh::PrimRef &prim) -> double {
+      switch (weight) {
+      case WEIGHT_ELEMENTS: return 1.;
+      case WEIGHT_VERTICES: return numVerticesOf(prim.type);
+      case WEIGHT_BYTES:    return numVerticesOf(prim.type)*bytesPerRef;
+      default:
+        throw std::runtime_error("invalid brick weight");
+      }
+    };
+    std::vector<double> weightSum(numPrims);
+    const size_t numBlocks = (numPrims+blockSize-1)/blockSize;
+    std::vector<double> blockSum(numBlocks+1,0.);
+    parallel_for(numBlocks,[&](size_t blockID){
+        const size_t begin = blockID*blockSize;
+        const size_t end   = std::min(begin+blockSize,numPrims);
+        double sum = 0.;
+        for (size_t i=begin;i<end;i++)
+          weightSum[i] = (sum += weightOf(prims[order[i]]));
+        blockSum[blockID+1] = sum;
+      });
+    for (size_t blockID=0;blockID<numBlocks;blockID++)
+      blockSum[blockID+1] += blockSum[blockID];
+    parallel_for(numBlocks,[&](size_t blockID){
+        const size_t begin = blockID*blockSize;
+        const size_t end   = std::min(begin+blockSize,numPrims);
+        for (size_t i=begin;i<end;i++)
+          weightSum[i] += blockSum[blockID];
+      });
+
+    // cut into ranges of equal weight - making sure each brick gets
+    // at least one element
+    const double totalWeight = weightSum.back();
+    std::vector<size_t> brickBegin(numBricks+1);
+    brickBegin[0] = 0;
+    brickBegin[numBricks] = numPrims;
+    for (size_t b=1;b<numBricks;b++) {
+      const double target = totalWeight*b/numBricks;
+      size_t cut = std::lower_bound(weightSum.begin(),weightSum.end(),target)
+        - weightSum.begin();
+      // lower_bound finds the element that crosses target; cut after
+      // it if that's closer
+      if (cut < numPrims &&
+          weightSum[cut]-target < target-(weightSum[cut]-weightOf(prims[order[cut]])))
+        cut++;
+      brickBegin[b]
+        = std::min(std::max(cut,brickBegin[b-1]+1),numPrims-(numBricks-b));
+    }
+    weightSum.clear();
+    weightSum.shrink_to_fit();
+
+    return gatherBricks(mesh,prims,order,brickBegin);
+  }
+  
+  // ==================================================================
+  // halos
+  // ==================================================================
+
+  /*! maps PrimRefs of volume elements to a single linear element
+      index (in the order createVolumePrimRefs() creates them), and
+      back */
+  struct VolumeElementIndex {
+    VolumeElementIndex(const UMesh &mesh)
+    {
+      begin[0] = 0;
+      begin[1] = begin[0]+mesh.tets.size();
+      begin[2] = begin[1]+mesh.pyrs.size();
+      begin[3] = begin[2]+mesh.wedges.size();
+      begin[4] = begin[3]+mesh.hexes.size();
+    }
+    inline size_t size() const { return begin[4]; }
+    inline size_t linear(size_t primType, size_t primID) const
+    {
+      if (primType < UMesh::TET || primType > UMesh::HEX)
+        throw std::runtime_error("not a volume element!?");
+      return begin[primType-UMesh::TET]+primID;
+    }
+    inline UMesh::PrimRef primRef(size_t idx) const
+    {
+      int t = 0;
+      while (idx >= begin[t+1]) ++t;
+      return UMesh::PrimRef(UMesh::PrimType(UMesh::TET+t),idx-begin[t]);
+    }
+    size_t begin[5];
+  };
+
+  /*! for each element, the ID of the brick it is in (or -1 if none) */
+  std::vector<size_t> computeOwners(const VolumeElementIndex &elements,
+                                    const std::vector<ObjectSpaceBrick> &bricks)
+  {
+    std::vector<size_t> owner(elements.size(),size_t(-1));
+    parallel_for(bricks.size(),[&](size_t brickID){
+        for (auto &prim : bricks[brickID].prims)
+          owner[elements.linear(prim.type,prim.ID)] = brickID;
+      });
+    return owner;
+  }
+
+  /*! calls lambda(vertexID) for each vertex of given volume element */
+  template<typename Lambda>
+  inline void forEachVertex(const UMesh &mesh, const UMesh::PrimRef &prim,
+                            const Lambda &lambda)
+  {
+    switch (prim.type) {
+    case UMesh::TET:
+      for (int i=0;i<Tet::numVertices;i++) lambda(mesh.tets[prim.ID][i]);
+      break;
+    case UMesh::PYR:
+      for (int i=0;i<Pyr::numVertices;i++) lambda(mesh.pyrs[prim.ID][i]);
+      break;
+    case UMesh::WEDGE:
+      for (int i=0;i<Wedge::numVertices;i++) lambda(mesh.wedges[prim.ID][i]);
+      break;
+    case UMesh::HEX:
+      for (int i=0;i<Hex::numVertices;i++) lambda(mesh.hexes[prim.ID][i]);
+      break;
+    default:
+      throw std::runtime_error("not a volume element!?");
+    }
+  }
+
+  /*! a graph (or any other one-to-many relation) in compressed-row
+      form: the neighbors of node 'i' are
+      neighbor[begin[i]..begin[i+1]) */
+  struct CSRGraph {
+    /*! builds the graph from a list of (node,neighbor) pairs; both
+        vectors get consumed in the process */
+    void build(size_t numNodes,
+               std::vector<uint64_t> &nodes,
+               std::vector<size_t>   &neighbors);
+
+    std::vector<size_t> begin;
+    std::vector<size_t> neighbor;
+  };
+
+  void CSRGraph::build(size_t numNodes,
+                       std::vector<uint64_t> &nodes,
+                       std::vector<size_t>   &neighbors)
+  {
+    int numKeyBits = 1;
+    while (numKeyBits < 64 && (uint64_t(numNodes) >> numKeyBits)) ++numKeyBits;
+    radixSort(nodes,neighbors,numKeyBits);
+
+    // nodes are now sorted, so each node's begin is where the
+    // previous node's pairs end
+    begin.resize(numNodes+1);
+    parallel_for_blocked(0,numNodes+1,16*1024,[&](size_t b, size_t e){
+        for (size_t node=b;node<e;node++)
+          begin[node] = std::lower_bound(nodes.begin(),nodes.end(),node)
+            - nodes.begin();
+      });
+    neighbor.swap(neighbors);
+    nodes.clear();
+    nodes.shrink_to_fit();
+  }
+
+  /*! element-to-element adjacency through shared faces */
+  void computeFaceNeighbors(UMesh::SP mesh,
+                            const VolumeElementIndex &elements,
+                            CSRGraph &graph)
+  {
+    FaceConn::SP faceConn = FaceConn::compute(mesh);
+    const std::vector<FaceConn::SharedFace> &faces = faceConn->faces;
+    auto isInterior = [&](const FaceConn::SharedFace &face) {
+      return face.onFront.primIdx >= 0 && face.onBack.primIdx >= 0;
+    };
+    // count interior faces ...
+    const size_t blockSize = 16*1024;
+    const size_t numBlocks = (faces.size()+blockSize-1)/blockSize;
+    std::vector<size_t> blockOffset(numBlocks+1,0);
+    parallel_for(numBlocks,[&](size_t blockID){
+        const size_t begin = blockID*blockSize;
+        const size_t end   = std::min(begin+blockSize,faces.size());
+        size_t count = 0;
+        for (size_t i=begin;i<end;i++)
+          if (isInterior(faces[i])) count++;
+        blockOffset[blockID+1] = count;
+      });
+    for (size_t blockID=0;blockID<numBlocks;blockID++)
+      blockOffset[blockID+1] += blockOffset[blockID];
+    // ... and emit two pairs - one per direction - for each
+    std::vector<uint64_t> nodes(2*blockOffset[numBlocks]);
+    std::vector<size_t>   neighbors(nodes.size());
+    parallel_for(numBlocks,[&](size_t blockID){
+        const size_t begin = blockID*blockSize;
+        const size_t end   = std::min(begin+blockSize,faces.size());
+        size_t out = 2*blockOffset[blockID];
+        for (size_t i=begin;i<end;i++) {
+          const FaceConn::SharedFace &face = faces[i];
+          if (!isInterior(face)) continue;
+          const size_t front
+            = elements.linear(face.onFront.primType,face.onFront.primIdx);
+          const size_t back
+            = elements.linear(face.onBack.primType,face.onBack.primIdx);
+          nodes[out] = front; neighbors[out] = back;  out++;
+          nodes[out] = back;  neighbors[out] = front; out++;
+        }
+      });
+    faceConn = nullptr;
+    graph.build(elements.size(),nodes,neighbors);
+  }
+
+  /*! vertex-to-element incidence (ie, for each vertex, the elements
+      that use it) */
+  void computeVertexElements(UMesh::SP mesh,
+                             const VolumeElementIndex &elements,
+                             CSRGraph &graph)
+  {
+    const size_t numElements = elements.size();
+    const size_t blockSize = 16*1024;
+    const size_t numBlocks = (numElements+blockSize-1)/blockSize;
+    std::vector<size_t> blockOffset(numBlocks+1,0);
+    parallel_for(numBlocks,[&](size_t blockID){
+        const size_t begin = blockID*blockSize;
+        const size_t end   = std::min(begin+blockSize,numElements);
+        size_t count = 0;
+        for (size_t i=begin;i<end;i++)
+          count += numVerticesOf(elements.primRef(i).type);
+        blockOffset[blockID+1] = count;
+      });
+    for (size_t blockID=0;blockID<numBlocks;blockID++)
+      blockOffset[blockID+1] += blockOffset[blockID];
+    std::vector<uint64_t> vertices(blockOffset[numBlocks]);
+    std::vector<size_t>   users(vertices.size());
+    parallel_for(numBlocks,[&](size_t blockID){
+        const size_t begin = blockID*blockSize;
+        const size_t end   = std::min(begin+blockSize,numElements);
+        size_t out = blockOffset[blockID];
+        for (size_t i=begin;i<end;i++)
+          forEachVertex(*mesh,elements.primRef(i),[&](int vertexID){
+              vertices[out] = vertexID;
+              users[out]    = i;
+              out++;
+            });
+      });
+    graph.build(mesh->vertices.size(),vertices,users);
+  }
+
+  /*! given bricks that partition the mesh's volume elements (ie, each
+      element is in exactly one brick, as with the partitioners
+      above), computes each brick's 'halo': all elements of _other_
+      bricks that are within 'numRings' steps (through the given kind
+      of adjacency) of any element of that brick. Returns one list of
+      ghost elements per brick, in ascending element order */
+  std::vector<std::vector<UMesh::PrimRef>>
+  computeHalos(UMesh::SP mesh,
+               const std::vector<ObjectSpaceBrick> &bricks,
+               int numRings,
+               HaloAdjacency adjacency)
+  {
+    if (!mesh) throw std::runtime_error("null input mesh");
+    const size_t numBricks = bricks.size();
+    std::vector<std::vector<UMesh::PrimRef>> halos(numBricks);
+    if (numRings < 1 || numBricks < 2)
+      return halos;
+
+    const VolumeElementIndex elements(*mesh);
+    std::vector<size_t> owner = computeOwners(elements,bricks);
+
+    CSRGraph graph;
+    if (adjacency == HALO_FACE_NEIGHBORS)
+      computeFaceNeighbors(mesh,elements,graph);
+    else
+      computeVertexElements(mesh,elements,graph);
+
+    /* calls lambda(neighbor) for each neighbor of given element;
+       neighbors may get reported more than once */
+    auto forEachNeighbor = [&](size_t elementID, const auto &lambda) {
+      if (adjacency == HALO_FACE_NEIGHBORS) {
+        for (size_t i=graph.begin[elementID];i<graph.begin[elementID+1];i++)
+          lambda(graph.neighbor[i]);
+      } else {
+        forEachVertex(*mesh,elements.primRef(elementID),[&](int vertexID){
+            for (size_t i=graph.begin[vertexID];i<graph.begin[vertexID+1];i++)
+              lambda(graph.neighbor[i]);
+          });
+      }
+    };
+
+    // grow each brick's halo ring by ring, starting with the brick's
+    // own elements; every ring only needs to look at the neighbors of
+    // the previous ring
+    parallel_for(numBricks,[&](size_t brickID){
+        std::unordered_set<size_t> ghosts;
+        std::vector<size_t> frontier, nextFrontier;
+        for (auto &prim : bricks[brickID].prims)
+          frontier.push_back(elements.linear(prim.type,prim.ID));
+        for (int ring=0;ring<numRings && !frontier.empty();ring++) {
+          nextFrontier.clear();
+          for (auto elementID : frontier)
+            forEachNeighbor(elementID,[&](size_t neighbor){
+                if (owner[neighbor] == brickID) return;
+                if (ghosts.insert(neighbor).second)
+                  nextFrontier.push_back(neighbor);
+              });
+          frontier.swap(nextFrontier);
+        }
+        std::vector<size_t> sorted(ghosts.begin(),ghosts.end());
+        std::sort(sorted.begin(),sorted.end());
+        std::vector<UMesh::PrimRef> &halo = halos[brickID];
+        halo.resize(sorted.size());
+        for (size_t i=0;i<sorted.size();i++)
+          halo[i] = elements.primRef(sorted[i]);
+      });
+    return halos;
+  }
+  
+  // ==================================================================
+  // multilevel graph partitioning
+  // ==================================================================
+
+  /*! an undirected graph with weighted nodes and edges, in
+      compressed-row form; each edge is stored once for each of its
+      two nodes */
+  struct WeightedGraph {
+    inline size_t numNodes() const { return nodeWeight.size(); }
+
+    /*! (re-)builds the graph's edges, in parallel; forEachEdge(node,
+        edges) has to append all (neighbor,weight) pairs of the given
+        node to 'edges'; multiple edges to the same neighbor get
+        merged (and their weights added up) */
+    template<typename ForEachEdge>
+    void buildEdges(const ForEachEdge &forEachEdge);
+
+    int64_t totalNodeWeight() const;
+
+    std::vector<size_t>  begin;
+    std::vector<size_t>  neighbor;
+    std::vector<int>     edgeWeight;
+    std::vector<int64_t> nodeWeight;
+  };
+
+  typedef std::vector<std::pair<size_t,int>> EdgeList;
+
+  /*! sorts given edges by neighbor, and merges duplicates */
+  inline void mergeEdges(EdgeList &edges)
+  {
+    std::sort(edges.begin(),edges.end());
+    size_t numMerged = 0;
+    for (size_t i=0;i<edges.size();i++) {
+      if (numMerged && edges[numMerged-1].first == edges[i].first)
+        edges[numMerged-1].second += edges[i].second;
+      else
+        edges[numMerged++] = edges[i];
+    }
+    edges.resize(numMerged);
+  }
+
+  template<typename ForEachEdge>
+  void WeightedGraph::buildEdges(const ForEachEdge &forEachEdge)
+  {
+    const size_t N = numNodes();
+    const size_t blockSize = 4*1024;
+    begin.resize(N+1);
+    begin[0] = 0;
+    // count (merged) edges per node ...
+    parallel_for_blocked(0,N,blockSize,[&](size_t blockBegin, size_t blockEnd){
+        EdgeList edges;
+        for (size_t node=blockBegin;node<blockEnd;node++) {
+          edges.clear();
+          forEachEdge(node,edges);
+          mergeEdges(edges);
+          begin[node+1] = edges.size();
+        }
+      });
+    for (size_t node=0;node<N;node++)
+      begin[node+1] += begin[node];
+    // ... then do it again, and write them out
+    neighbor.resize(begin[N]);
+    edgeWeight.resize(begin[N]);
+    parallel_for_blocked(0,N,blockSize,[&](size_t blockBegin, size_t blockEnd){
+        EdgeList edges;
+        for (size_t node=blockBegin;node<blockEnd;node++) {
+          edges.clear();
+          forEachEdge(node,edges);
+          mergeEdges(edges);
+          for (size_t i=0;i<edges.size();i++) {
+            neighbor[begin[node]+i]   = edges[i].first;
+            edgeWeight[begin[node]+i] = edges[i].second;
+          }
+        }
+      });
+  }
+
+  int64_t WeightedGraph::totalNodeWeight() const
+  {
+    int64_t sum = 0;
+    for (auto w : nodeWeight) sum += w;
+    return sum;
+  }
+
+  /*! a bisection of a graph: which side each node is on, and the
+      weights of the two sides */
+  struct Bisection {
+    Bisection(const WeightedGraph &graph,
+              int64_t targetWeight0,
+              float imbalance);
+
+    /*! amount by which the two sides exceed their max weights */
+    inline int64_t overweight() const
+    {
+      return std::max(int64_t(0),sideWeight[0]-maxWeight[0])
+        +    std::max(int64_t(0),sideWeight[1]-maxWeight[1]);
+    }
+    /*! whether this is a better bisection than one with given
+        overweight and cut */
+    inline bool betterThan(int64_t otherOverweight, int64_t otherCut) const
+    {
+      const int64_t ow = overweight();
+      return (ow < otherOverweight) || (ow == otherOverweight && cut < otherCut);
+    }
+    void computeSideWeights();
+    void computeCut();
+
+    /*! greedily grows side 0 from some seed nodes, and keeps the best
+        of those (after refinement) */
+    void initialize();
+    /*! Fiduccia-Mattheyses refinement, for up to given number of
+        passes */
+    void refine(int maxPasses);
+
+    const WeightedGraph &graph;
+    std::vector<uint8_t> side;
+    int64_t sideWeight[2];
+    int64_t targetWeight[2];
+    int64_t maxWeight[2];
+    int64_t cut = 0;
+  };
+
+  Bisection::Bisection(const WeightedGraph &graph,
+                       int64_t targetWeight0,
+                       float imbalance)
+    : graph(graph),
+      side(graph.numNodes(),1)
+  {
+    const int64_t totalWeight = graph.totalNodeWeight();
+    int64_t maxNodeWeight = 0;
+    for (auto w : graph.nodeWeight)
+      maxNodeWeight = std::max(maxNodeWeight,w);
+    targetWeight[0] = targetWeight0;
+    targetWeight[1] = totalWeight-targetWeight0;
+    // on coarse levels (with heavy nodes) allow for at least one node
+    // worth of imbalance, or there may not be any legal move at all;
+    // finer levels will then fix that
+    for (int s=0;s<2;s++)
+      maxWeight[s] = std::max(int64_t(targetWeight[s]*(1.f+imbalance)),
+                              targetWeight[s]+maxNodeWeight);
+  }
+
+  void Bisection::computeSideWeights()
+  {
+    sideWeight[0] = sideWeight[1] = 0;
+    for (size_t node=0;node<graph.numNodes();node++)
+      sideWeight[side[node]] += graph.nodeWeight[node];
+  }
+
+  void Bisection::computeCut()
+  {
+    cut = 0;
+    for (size_t node=0;node<graph.numNodes();node++)
+      for (size_t i=graph.begin[node];i<graph.begin[node+1];i++)
+        if (side[graph.neighbor[i]] != side[node])
+          cut += graph.edgeWeight[i];
+    cut /= 2;
+  }
+
+  void Bisection::initialize()
+  {
+    const size_t N = graph.numNodes();
+    const int numTries = 16;
+    std::vector<uint8_t> bestSide;
+    int64_t bestOverweight = 0, bestCut = 0;
+    std::vector<int64_t> gain(N);
+    for (int tryID=0;tryID<numTries && tryID<(int)N;tryID++) {
+      // greedily grow side 0 from a seed, always adding the node
+      // that reduces the cut the most, until side 0 has the target
+      // weight; if the seed's component is exhausted before that,
+      // continue with the next node not yet in side 0
+      std::fill(side.begin(),side.end(),1);
+      for (size_t node=0;node<N;node++) {
+        gain[node] = 0;
+        for (size_t i=graph.begin[node];i<graph.begin[node+1];i++)
+          gain[node] -= graph.edgeWeight[i];
+      }
+      std::priority_queue<std::pair<int64_t,size_t>> queue;
+      int64_t weight0 = 0;
+      size_t nextSeed = (tryID*N)/numTries;
+      while (weight0 < targetWeight[0]) {
+        while (!queue.empty() &&
+               (side[queue.top().second] == 0 ||
+                gain[queue.top().second] != queue.top().first))
+          queue.pop();
+        size_t node;
+        if (queue.empty()) {
+          node = nextSeed;
+          while (side[node] == 0)
+            node = (node+1) % N;
+          nextSeed = node;
+        } else
+          node = queue.top().second;
+        side[node] = 0;
+        weight0 += graph.nodeWeight[node];
+        for (size_t i=graph.begin[node];i<graph.begin[node+1];i++) {
+          const size_t nb = graph.neighbor[i];
+          if (side[nb] == 0) continue;
+          gain[nb] += 2*graph.edgeWeight[i];
+          queue.push({gain[nb],nb});
+        }
+      }
+      computeSideWeights();
+      refine(4);
+      if (bestSide.empty() || betterThan(bestOverweight,bestCut)) {
+        bestSide = side;
+        bestOverweight = overweight();
+        bestCut = cut;
+      }
+    }
+    side = bestSide;
+    computeSideWeights();
+    computeCut();
+  }
+
+  void Bisection::refine(int maxPasses)
+  {
+    const size_t N = graph.numNodes();
+    std::vector<int64_t> gain(N);
+    std::vector<uint8_t> locked(N);
+    std::vector<size_t>  moves;
+    typedef std::pair<int64_t,size_t> QueueEntry;
+    computeCut();
+    for (int pass=0;pass<maxPasses;pass++) {
+      // gain of a node = how much the cut would shrink if it switched
+      // sides; only nodes on the boundary can have positive gains
+      std::priority_queue<QueueEntry> queue[2];
+      parallel_for_blocked(0,N,16*1024,[&](size_t blockBegin, size_t blockEnd){
+          for (size_t node=blockBegin;node<blockEnd;node++) {
+            int64_t g = 0;
+            for (size_t i=graph.begin[node];i<graph.begin[node+1];i++)
+              g += (side[graph.neighbor[i]] != side[node])
+                ? graph.edgeWeight[i] : -graph.edgeWeight[i];
+            gain[node] = g;
+            locked[node] = false;
+          }
+        });
+      for (size_t node=0;node<N;node++)
+        for (size_t i=graph.begin[node];i<graph.begin[node+1];i++)
+          if (side[graph.neighbor[i]] != side[node]) {
+            queue[side[node]].push({gain[node],node});
+            break;
+          }
+
+      const int64_t startOverweight = overweight();
+      const int64_t startCut = cut;
+      int64_t bestOverweight = startOverweight, bestCut = startCut;
+      size_t bestNumMoves = 0;
+      const size_t maxMovesWithoutImprovement
+        = std::max(size_t(50),std::min(size_t(1000),N/100));
+      moves.clear();
+      while (moves.size()-bestNumMoves < maxMovesWithoutImprovement) {
+        // drop stale queue entries ...
+        for (int s=0;s<2;s++)
+          while (!queue[s].empty() &&
+                 (locked[queue[s].top().second] ||
+                  side[queue[s].top().second] != s ||
+                  gain[queue[s].top().second] != queue[s].top().first))
+            queue[s].pop();
+        // ... and pick which side to move from: an overweight side
+        // has to give away nodes; otherwise take the better gain
+        // among the legal moves
+        int from = -1;
+        for (int s=0;s<2;s++) {
+          if (queue[s].empty()) continue;
+          const size_t node = queue[s].top().second;
+          const bool legal
+            = (sideWeight[1-s]+graph.nodeWeight[node] <= maxWeight[1-s])
+            || (sideWeight[s] > maxWeight[s]);
+          if (!legal) continue;
+          if (sideWeight[s] > maxWeight[s]) { from = s; break; }
+          if (from < 0 || queue[s].top().first > queue[from].top().first)
+            from = s;
+        }
+        if (from < 0) {
+          // neither top node can legally move; drop the heavier one
+          // and try again
+          int drop = -1;
+          for (int s=0;s<2;s++)
+            if (!queue[s].empty() &&
+                (drop < 0 || graph.nodeWeight[queue[s].top().second]
+                 > graph.nodeWeight[queue[drop].top().second]))
+              drop = s;
+          if (drop < 0) break;
+          queue[drop].pop();
+          continue;
+        }
+
+        const size_t node = queue[from].top().second;
+        queue[from].pop();
+        side[node] = 1-from;
+        locked[node] = true;
+        sideWeight[from]   -= graph.nodeWeight[node];
+        sideWeight[1-from] += graph.nodeWeight[node];
+        cut -= gain[node];
+        moves.push_back(node);
+        for (size_t i=graph.begin[node];i<graph.begin[node+1];i++) {
+          const size_t nb = graph.neighbor[i];
+          gain[nb] += (side[nb] == side[node])
+            ? -2*graph.edgeWeight[i] : 2*graph.edgeWeight[i];
+          if (!locked[nb])
+            queue[side[nb]].push({gain[nb],nb});
+        }
+        if (betterThan(bestOverweight,bestCut)) {
+          bestOverweight = overweight();
+          bestCut = cut;
+          bestNumMoves = moves.size();
+        }
+      }
+      // roll back everything after the best state we've seen
+      while (moves.size() > bestNumMoves) {
+        const size_t node = moves.back();
+        moves.pop_back();
+        sideWeight[side[node]]   -= graph.nodeWeight[node];
+        side[node] = 1-side[node];
+        sideWeight[side[node]]   += graph.nodeWeight[node];
+      }
+      cut = bestCut;
+      if (bestOverweight == startOverweight && bestCut == startCut)
+        break;
+    }
+  }
+
+  /*! pseudo-random (but deterministic) number for a pair of nodes,
+      to break ties between equally good matches */
+  inline uint64_t hashPair(uint64_t a, uint64_t b)
+  {
+    uint64_t h = a*0x9e3779b97f4a7c15ULL ^ (b+0x632be59bd9b4e019ULL);
+    h ^= h >> 31; h *= 0xbf58476d1ce4e5b9ULL; h ^= h >> 29;
+    return h;
+  }
+
+  /*! coarsens given graph by heavy-edge matching, in parallel
+      rounds of 'propose' and 'accept': in each round every
+      not-yet-matched node proposes to the not-yet-matched neighbor
+      it shares the heaviest edge with, and every pair of nodes that
+      proposed to each other gets matched. Ratings (and tie-breaks)
+      are symmetric, so each round matches at least all locally
+      heaviest edges; and since each round only reads what previous
+      rounds wrote, the result does not depend on the number of
+      threads. Nodes still unmatched after the last round stay on
+      their own. 'coarseOf' returns the coarse node for each fine
+      one */
+  void coarsen(const WeightedGraph &fine,
+               int64_t maxNodeWeight,
+               WeightedGraph &coarse,
+               std::vector<size_t> &coarseOf)
+  {
+    const size_t N = fine.numNodes();
+    const size_t unmatched = size_t(-1);
+    const size_t blockSize = 16*1024;
+    const int    maxRounds = 8;
+    std::vector<size_t> match(N,unmatched);
+    std::vector<size_t> proposal(N);
+    for (int round=0;round<maxRounds;round++) {
+      // propose ...
+      parallel_for_blocked(0,N,blockSize,[&](size_t begin, size_t end){
+          for (size_t node=begin;node<end;node++) {
+            size_t best = unmatched;
+            if (match[node] == unmatched) {
+              double bestRating = 0.;
+              for (size_t i=fine.begin[node];i<fine.begin[node+1];i++) {
+                const size_t nb = fine.neighbor[i];
+                if (match[nb] != unmatched || nb == node) continue;
+                if (fine.nodeWeight[node]+fine.nodeWeight[nb] > maxNodeWeight) continue;
+                const double w = fine.edgeWeight[i];
+                const double rating
+                  = w*w/(double(fine.nodeWeight[node])*double(fine.nodeWeight[nb]));
+                if (rating > bestRating ||
+                    (rating == bestRating && best != unmatched &&
+                     hashPair(std::min(node,nb),std::max(node,nb))
+                     > hashPair(std::min(node,best),std::max(node,best)))) {
+                  best = nb;
+                  bestRating = rating;
+                }
+              }
+            }
+            proposal[node] = best;
+          }
+        });
+      // ... and accept
+      std::atomic<size_t> numMatched(0);
+      parallel_for_blocked(0,N,blockSize,[&](size_t begin, size_t end){
+          size_t count = 0;
+          for (size_t node=begin;node<end;node++) {
+            const size_t partner = proposal[node];
+            if (partner != unmatched && proposal[partner] == node) {
+              match[node] = partner;
+              ++count;
+            }
+          }
+          numMatched += count;
+        });
+      if (numMatched == 0) break;
+    }
+    parallel_for_blocked(0,N,blockSize,[&](size_t begin, size_t end){
+        for (size_t node=begin;node<end;node++)
+          if (match[node] == unmatched) match[node] = node;
+      });
+    
+    // the smaller of each matched pair becomes the coarse node
+    coarseOf.resize(N);
+    std::vector<size_t> fineOf;
+    for (size_t node=0;node<N;node++)
+      if (match[node] >= node) {
+        coarseOf[node] = fineOf.size()/2;
+        fineOf.push_back(node);
+        fineOf.push_back(match[node]);
+      } else
+        coarseOf[node] = coarseOf[match[node]];
+    const size_t numCoarse = fineOf.size()/2;
+    coarse.nodeWeight.resize(numCoarse);
+    parallel_for_blocked(0,numCoarse,16*1024,[&](size_t begin, size_t end){
+        for (size_t c=begin;c<end;c++) {
+          const size_t a = fineOf[2*c+0], b = fineOf[2*c+1];
+          coarse.nodeWeight[c]
+            = fine.nodeWeight[a] + ((b != a) ? fine.nodeWeight[b] : 0);
+        }
+      });
+    coarse.buildEdges([&](size_t c, EdgeList &edges){
+        const size_t a = fineOf[2*c+0], b = fineOf[2*c+1];
+        for (size_t node : { a, b }) {
+          for (size_t i=fine.begin[node];i<fine.begin[node+1];i++) {
+            const size_t nb = coarseOf[fine.neighbor[i]];
+            if (nb != c) edges.push_back({nb,fine.edgeWeight[i]});
+          }
+          if (b == a) break;
+        }
+      });
+  }
+
+  /*! multilevel bisection of given graph, such that side 0 gets
+      (roughly) the target weight */
+  void bisect(const WeightedGraph &graph,
+              int64_t targetWeight0,
+              float imbalance,
+              std::vector<uint8_t> &side)
+  {
+    const size_t coarsestSize = 256;
+    const int64_t maxNodeWeight
+      = std::max(int64_t(1),int64_t(1.5f*graph.totalNodeWeight()/coarsestSize));
+
+    // coarsen ...
+    std::vector<std::shared_ptr<WeightedGraph>> levels;
+    std::vector<std::vector<size_t>> coarseOf;
+    const WeightedGraph *current = &graph;
+    while (current->numNodes() > coarsestSize) {
+      std::shared_ptr<WeightedGraph> coarse = std::make_shared<WeightedGraph>();
+      std::vector<size_t> map;
+      coarsen(*current,maxNodeWeight,*coarse,map);
+      // stop once matching doesn't get us anywhere any more
+      if (coarse->numNodes() > .95f*current->numNodes())
+        break;
+      levels.push_back(coarse);
+      coarseOf.push_back(std::move(map));
+      current = coarse.get();
+    }
+
+    // ... bisect the coarsest graph ...
+    std::vector<uint8_t> coarseSide;
+    {
+      Bisection bisection(*current,targetWeight0,imbalance);
+      bisection.initialize();
+      coarseSide.swap(bisection.side);
+    }
+    
+    // ... and project back, refining along the way
+    for (int level=(int)levels.size()-1;level>=0;--level) {
+      const WeightedGraph &fine = (level == 0) ? graph : *levels[level-1];
+      const std::vector<size_t> &map = coarseOf[level];
+      Bisection bisection(fine,targetWeight0,imbalance);
+      parallel_for_blocked(0,fine.numNodes(),16*1024,[&](size_t begin, size_t end){
+          for (size_t node=begin;node<end;node++)
+            bisection.side[node] = coarseSide[map[node]];
+        });
+      bisection.computeSideWeights();
+      bisection.refine(8);
+      coarseSide.swap(bisection.side);
+      levels.resize(level);
+    }
+    side.swap(coarseSide);
+  }
+
+  /*! recursively bisects a graph into given number of parts */
+  struct GraphPartitioner {
+    GraphPartitioner(std::vector<size_t> &partOf,
+                     size_t numParts,
+                     float imbalance)
+      : partOf(partOf)
+    {
+      // tolerances of all levels of recursion multiply up, so split
+      // the allowed imbalance among those
+      int depth = 0;
+      while ((size_t(1) << depth) < numParts) ++depth;
+      levelImbalance = std::pow(1.f+imbalance,1.f/std::max(depth,1))-1.f;
+    }
+
+    /*! partition graph whose nodes correspond to given (original)
+        nodeIDs into parts [firstPart,firstPart+numParts) */
+    void partition(const WeightedGraph &graph,
+                   const std::vector<size_t> &nodeIDs,
+                   size_t numParts,
+                   size_t firstPart);
+
+    std::vector<size_t> &partOf;
+    float levelImbalance;
+  };
+
+  void GraphPartitioner::partition(const WeightedGraph &graph,
+                                   const std::vector<size_t> &nodeIDs,
+                                   size_t numParts,
+                                   size_t firstPart)
+  {
+    const size_t N = graph.numNodes();
+    if (numParts == 1 || N <= 1) {
+      for (auto nodeID : nodeIDs)
+        partOf[nodeID] = firstPart;
+      return;
+    }
+
+    const size_t numLeft = numParts/2;
+    const int64_t targetWeight0
+      = int64_t(double(graph.totalNodeWeight())*numLeft/numParts);
+    std::vector<uint8_t> side;
+    bisect(graph,targetWeight0,levelImbalance,side);
+
+    // extract the two halves as graphs of their own ...
+    std::vector<size_t> localID(N);
+    std::vector<size_t> subNodeIDs[2];
+    for (size_t node=0;node<N;node++) {
+      localID[node] = subNodeIDs[side[node]].size();
+      subNodeIDs[side[node]].push_back(nodeIDs[node]);
+    }
+    WeightedGraph subGraph[2];
+    std::vector<size_t> parentID[2];
+    for (int s=0;s<2;s++) {
+      parentID[s].reserve(subNodeIDs[s].size());
+      for (size_t node=0;node<N;node++)
+        if (side[node] == s) parentID[s].push_back(node);
+      subGraph[s].nodeWeight.resize(parentID[s].size());
+      for (size_t i=0;i<parentID[s].size();i++)
+        subGraph[s].nodeWeight[i] = graph.nodeWeight[parentID[s][i]];
+      subGraph[s].buildEdges([&](size_t node, EdgeList &edges){
+          const size_t parent = parentID[s][node];
+          for (size_t i=graph.begin[parent];i<graph.begin[parent+1];i++) {
+            const size_t nb = graph.neighbor[i];
+            if (side[nb] == s)
+              edges.push_back({localID[nb],graph.edgeWeight[i]});
+          }
+        });
+      parentID[s].clear();
+      parentID[s].shrink_to_fit();
+    }
+
+    // ... and recurse into those, in parallel
+    parallel_invoke([&](){
+        partition(subGraph[0],subNodeIDs[0],numLeft,firstPart);
+      },[&](){
+        partition(subGraph[1],subNodeIDs[1],numParts-numLeft,firstPart+numLeft);
+      });
+  }
+
+  std::vector<ObjectSpaceBrick>
+  partitionGraph(UMesh::SP mesh,
+                 size_t numParts,
+                 BrickWeight weight,
+                 float imbalance)
+  {
+    if (!mesh) throw std::runtime_error("null input mesh");
+    if (numParts < 1) throw std::runtime_error("need at least one brick");
+
+    std::vector<UMesh::PrimRef> prims;
+    mesh->createVolumePrimRefs(prims);
+    const size_t numPrims = prims.size();
+    if (numPrims == 0)
+      return {};
+    numParts = std::min(numParts,numPrims);
+
+    // build the dual graph: one node per element, weighted by either
+    // element or vertex count (for bytes, that's what they scale
+    // with), and one edge per shared face
+    const VolumeElementIndex elements(*mesh);
+    WeightedGraph graph;
+    graph.nodeWeight.resize(numPrims);
+    parallel_for_blocked(0,numPrims,16*1024,[&](size_t begin, size_t end){
+        for (size_t i=begin;i<end;i++)
+          graph.nodeWeight[i]
+            = (weight == WEIGHT_ELEMENTS) ? 1 : numVerticesOf(prims[i].type);
+      });
+    {
+      CSRGraph faceNeighbors;
+      computeFaceNeighbors(mesh,elements,faceNeighbors);
+      graph.buildEdges([&](size_t node, EdgeList &edges){
+          for (size_t i=faceNeighbors.begin[node];i<faceNeighbors.begin[node+1];i++)
+            edges.push_back({faceNeighbors.neighbor[i],1});
+        });
+    }
+
+    std::vector<size_t> partOf(numPrims);
+    std::vector<size_t> nodeIDs(numPrims);
+    for (size_t i=0;i<numPrims;i++) nodeIDs[i] = i;
+    GraphPartitioner partitioner(partOf,numParts,imbalance);
+    partitioner.partition(graph,nodeIDs,numParts,0);
+    graph = WeightedGraph();
+
+    // sort elements by part (counting sort, which keeps them in mesh
+    // order), and drop empty parts
+    std::vector<size_t> partBegin(numParts+1,0);
+    for (size_t i=0;i<numPrims;i++)
+      partBegin[partOf[i]+1]++;
+    for (size_t part=0;part<numParts;part++)
+      partBegin[part+1] += partBegin[part];
+    std::vector<size_t> order(numPrims);
+    {
+      std::vector<size_t> pos(partBegin.begin(),partBegin.end()-1);
+      for (size_t i=0;i<numPrims;i++)
+        order[pos[partOf[i]]++] = i;
+    }
+    partBegin.erase(std::unique(partBegin.begin(),partBegin.end()),
+                    partBegin.end());
+    return gatherBricks(mesh,prims,order,partBegin);
+  }
+
+  /*! returns how many of the mesh's faces are shared by elements of
+      different bricks (ie, the edge cut of a partitioning) */
+  size_t countCutFaces(UMesh::SP mesh,
+                       const std::vector<ObjectSpaceBrick> &bricks)
+  {
+    if (!mesh) throw std::runtime_error("null input mesh");
+    const VolumeElementIndex elements(*mesh);
+    std::vector<size_t> owner = computeOwners(elements,bricks);
+    CSRGraph faceNeighbors;
+    computeFaceNeighbors(mesh,elements,faceNeighbors);
+    const size_t blockSize = 16*1024;
+    const size_t numBlocks = (elements.size()+blockSize-1)/blockSize;
+    std::vector<size_t> blockCut(numBlocks,0);
+    parallel_for(numBlocks,[&](size_t blockID){
+        const size_t begin = blockID*blockSize;
+        const size_t end   = std::min(begin+blockSize,elements.size());
+        for (size_t i=begin;i<end;i++)
+          for (size_t j=faceNeighbors.begin[i];j<faceNeighbors.begin[i+1];j++)
+            if (owner[faceNeighbors.neighbor[j]] != owner[i])
+              blockCut[blockID]++;
+      });
+    size_t numCut = 0;
+    for (auto c : blockCut) numCut += c;
+    // each cut face was counted from both sides
+    return numCut/2;
+  }
+  
+} // ::umesh
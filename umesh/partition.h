@@ -0,0 +1,140 @@
+// ======================================================================== //
+// Copyright 2018-2020 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "umesh/UMesh.h"
+
+namespace umesh {
+
+  /*! how to pick the plane at which a brick gets split in two */
+  typedef enum {
+    /*! binned surface area heuristic: picks the plane (among a set
+        of candidate planes along each axis) that minimizes the sum
+        of the two halves' numbers of prims, weighted by the surface
+        area of their bounds */
+    SPLIT_SAH,
+    /*! object median along the widest axis of the prims' centroids;
+        both halves get (almost exactly) the same number of prims */
+    SPLIT_MEDIAN
+  } SplitMethod;
+
+  /*! one brick of an object space partitioning: a set of prims (none
+      of which is in any other brick), and their bounds */
+  struct ObjectSpaceBrick {
+    std::vector<UMesh::PrimRef> prims;
+    box3f                       bounds;
+  };
+
+  /*! computes an *object* space partitioning of the mesh's volume
+      elements into bricks, by recursively splitting bricks in two
+      until they have fewer than 'leafThreshold' prims, or until
+      'maxBricks' bricks have been created (whichever comes first -
+      the available number of bricks gets distributed across the two
+      halves of each split according to their number of prims).
+      Bricks' bounds may overlap, but each prim ends up in exactly
+      one brick.
+
+      Prim bounds get computed only once, up front; all splits then
+      work on an array of prim indices, with the binning and
+      partitioning of large bricks done in parallel, and the two
+      halves of each split getting further split concurrently. The
+      result is deterministic, no matter how many threads are used. */
+  std::vector<ObjectSpaceBrick>
+  partitionObjectSpace(UMesh::SP mesh,
+                       size_t leafThreshold,
+                       size_t maxBricks = size_t(-1),
+                       SplitMethod splitMethod = SPLIT_SAH);
+
+  /*! which space filling curve to order elements along */
+  typedef enum { CURVE_MORTON, CURVE_HILBERT } SpaceFillingCurve;
+
+  /*! what to balance across bricks */
+  typedef enum {
+    /*! number of elements */
+    WEIGHT_ELEMENTS,
+    /*! number of element vertices (ie, sum of elements' vertex counts) */
+    WEIGHT_VERTICES,
+    /*! estimated memory footprint: each element's index data, plus
+        its share of the vertex data (positions and scalars), assuming
+        vertices are shared equally among all elements referencing
+        them */
+    WEIGHT_BYTES
+  } BrickWeight;
+
+  /*! partitions the mesh's volume elements into (up to) 'numBricks'
+      bricks of (as close as possible) equal weight: computes 63-bit
+      Morton or Hilbert codes of all element centroids, radix-sorts
+      the elements by those codes, and cuts the resulting sequence
+      into ranges of equal weight. Unlike partitionObjectSpace()
+      this does not recursively split, but only makes a few linear
+      passes over all elements (all of which run in parallel). As
+      with partitionObjectSpace(), each element ends up in exactly
+      one brick, and bricks' bounds may overlap. */
+  std::vector<ObjectSpaceBrick>
+  partitionSpaceFillingCurve(UMesh::SP mesh,
+                             size_t numBricks,
+                             SpaceFillingCurve curve = CURVE_HILBERT,
+                             BrickWeight weight = WEIGHT_ELEMENTS);
+
+  /*! partitions the mesh's volume elements into (up to) 'numParts'
+      bricks of (roughly) equal weight, trying to minimize the number
+      of faces shared between different bricks. This works on the
+      mesh's dual graph (elements as nodes, shared faces as edges,
+      see FaceConn), using multilevel recursive bisection: each
+      bisection coarsens the graph by heavy-edge matching, bisects
+      the coarsest graph, and then refines that bisection with
+      Fiduccia-Mattheyses while projecting it back to the finer
+      levels. 'imbalance' is the fraction by which a brick's weight
+      may exceed the average.
+
+      Unlike the purely geometric partitioners this follows the
+      mesh's connectivity, so it produces much smaller interfaces for
+      anisotropic meshes (such as boundary layers). Each element ends
+      up in exactly one brick; bricks' bounds may overlap. */
+  std::vector<ObjectSpaceBrick>
+  partitionGraph(UMesh::SP mesh,
+                 size_t numParts,
+                 BrickWeight weight = WEIGHT_ELEMENTS,
+                 float imbalance = .03f);
+
+  /*! returns how many of the mesh's faces are shared by elements of
+      different bricks (ie, the edge cut of a partitioning) */
+  size_t countCutFaces(UMesh::SP mesh,
+                       const std::vector<ObjectSpaceBrick> &bricks);
+
+  /*! which elements are considered neighbors when growing halos */
+  typedef enum {
+    /*! elements that share a face */
+    HALO_FACE_NEIGHBORS,
+    /*! elements that share at least one vertex */
+    HALO_VERTEX_NEIGHBORS
+  } HaloAdjacency;
+
+  /*! given bricks that partition the mesh's volume elements (ie, each
+      element is in exactly one brick, as with the partitioners
+      above), computes each brick's 'halo': all elements of _other_
+      bricks that are within 'numRings' steps (through the given kind
+      of adjacency) of any element of that brick. Returns one list of
+      ghost elements per brick, in ascending element order; see
+      extractSubMesh() for creating a brick's mesh with those */
+  std::vector<std::vector<UMesh::PrimRef>>
+  computeHalos(UMesh::SP mesh,
+               const std::vector<ObjectSpaceBrick> &bricks,
+               int numRings = 1,
+               HaloAdjacency adjacency = HALO_FACE_NEIGHBORS);
+
+} // ::umesh
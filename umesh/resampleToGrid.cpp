@@ -0,0 +1,235 @@
+// ======================================================================== //
+// Copyright 2018-2020 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+
+#include "umesh/resampleToGrid.h"
+#include "umesh/sampleElement.h"
+
+namespace umesh {
+
+  /*! voxel tiles are tileSize^3 voxels (16KB of floats); slabs are
+      one tile deep */
+  enum { tileSize = 16 };
+
+  /*! a regular grid of voxel centers */
+  struct VoxelGrid {
+    VoxelGrid(const box3f &domain, const vec3i &dims)
+      : lower(domain.lower), dims(dims)
+    {
+      for (int dim=0;dim<3;dim++)
+        cellSize[dim] = (domain.upper[dim]-domain.lower[dim])/dims[dim];
+    }
+
+    inline vec3f voxelCenter(int i, int j, int k) const
+    {
+      return vec3f(lower.x+(i+.5f)*cellSize.x,
+                   lower.y+(j+.5f)*cellSize.y,
+                   lower.z+(k+.5f)*cellSize.z);
+    }
+
+    /*! computes range [begin,end] (inclusive) of voxels whose
+        centers are within given box; returns false if there are
+        none. The range is padded by a tiny fraction of a voxel, so
+        centers that lie (up to rounding) right on the box's faces
+        still get tested against the element */
+    inline bool voxelRange(const box3f &box, vec3i &begin, vec3i &end) const
+    {
+      const float pad = 1e-3f;
+      for (int dim=0;dim<3;dim++) {
+        begin[dim] = std::max(0,int(ceilf((box.lower[dim]-lower[dim])/cellSize[dim]-.5f-pad)));
+        end[dim]   = std::min(dims[dim]-1,int(floorf((box.upper[dim]-lower[dim])/cellSize[dim]-.5f+pad)));
+        if (begin[dim] > end[dim]) return false;
+      }
+      return true;
+    }
+
+    vec3f lower;
+    vec3f cellSize;
+    vec3i dims;
+  };
+
+  /*! bins the given items into a 2D array of numBins.x*numBins.y
+      bins, in parallel; each item can go into a rectangle of bins,
+      given by binRange(item, lo, hi) (inclusive; returning false if
+      the item goes into no bin at all). Returns bins' items in
+      'binItems', where items of bin 'b' are
+      binItems[binBegin[b]..binBegin[b+1]) - in the same order as
+      in 'items' */
+  template<typename BinRange>
+  void binItems(const std::vector<size_t> &items,
+                const vec2i &numBins2D,
+                const BinRange &binRange,
+                std::vector<size_t> &binBegin,
+                std::vector<size_t> &binItems)
+  {
+    const size_t numBins = size_t(numBins2D.x)*numBins2D.y;
+    auto forEachBin = [&](size_t item, size_t *binCounter, bool scatter) {
+      vec2i lo, hi;
+      if (!binRange(item,lo,hi)) return;
+      for (int y=lo.y;y<=hi.y;y++)
+        for (int x=lo.x;x<=hi.x;x++) {
+          size_t &counter = binCounter[size_t(y)*numBins2D.x+x];
+          if (scatter)
+            binItems[counter] = item;
+          counter++;
+        }
+    };
+    const size_t numItems = items.size();
+    const size_t blockSize = 16*1024;
+    const size_t numBlocks = (numItems+blockSize-1)/blockSize;
+    // per-block histograms ...
+    std::vector<size_t> offsets(numBlocks*numBins,0);
+    parallel_for(numBlocks,[&](size_t blockID){
+        size_t *count = offsets.data()+blockID*numBins;
+        const size_t begin = blockID*blockSize;
+        const size_t end   = std::min(begin+blockSize,numItems);
+        for (size_t i=begin;i<end;i++)
+          forEachBin(items[i],count,false);
+      });
+    // ... turned into each block's write offsets (bin-major, then by
+    // block, which keeps items in order) ...
+    binBegin.resize(numBins+1);
+    size_t sum = 0;
+    for (size_t b=0;b<numBins;b++) {
+      binBegin[b] = sum;
+      for (size_t blockID=0;blockID<numBlocks;blockID++) {
+        size_t &offset = offsets[blockID*numBins+b];
+        const size_t count = offset;
+        offset = sum;
+        sum += count;
+      }
+    }
+    binBegin[numBins] = sum;
+    // ... and scatter
+    binItems.resize(sum);
+    parallel_for(numBlocks,[&](size_t blockID){
+        size_t *offset = offsets.data()+blockID*numBins;
+        const size_t begin = blockID*blockSize;
+        const size_t end   = std::min(begin+blockSize,numItems);
+        for (size_t i=begin;i<end;i++)
+          forEachBin(items[i],offset,true);
+      });
+  }
+
+  void resampleToGrid(UMesh::SP mesh,
+                      const box3f &domain,
+                      const vec3i &dims,
+                      const GridSlabCallback &slabCallback,
+                      float outsideValue)
+  {
+    if (!mesh) throw std::runtime_error("null input mesh");
+    if (!mesh->perVertex)
+      throw std::runtime_error("#umesh.resample: input mesh w/o scalar field");
+    if (dims.x < 1 || dims.y < 1 || dims.z < 1)
+      throw std::runtime_error("#umesh.resample: invalid grid dimensions");
+    if (!(domain.upper.x > domain.lower.x &&
+          domain.upper.y > domain.lower.y &&
+          domain.upper.z > domain.lower.z))
+      throw std::runtime_error("#umesh.resample: empty domain");
+
+    const VoxelGrid grid(domain,dims);
+    std::vector<UMesh::PrimRef> prims;
+    mesh->createVolumePrimRefs(prims);
+    std::vector<size_t> primIDs(prims.size());
+    for (size_t i=0;i<prims.size();i++) primIDs[i] = i;
+
+    // sort elements into the slabs their voxel ranges overlap
+    const int numSlabs = divRoundUp(dims.z,(int)tileSize);
+    std::vector<size_t> slabBegin, slabPrims;
+    binItems(primIDs,vec2i(1,numSlabs),
+             [&](size_t primID, vec2i &binLo, vec2i &binHi){
+               vec3i lo, hi;
+               if (!grid.voxelRange(mesh->getBounds(prims[primID]),lo,hi))
+                 return false;
+               binLo = vec2i(0,lo.z/tileSize);
+               binHi = vec2i(0,hi.z/tileSize);
+               return true;
+             },slabBegin,slabPrims);
+    primIDs.clear();
+    primIDs.shrink_to_fit();
+
+    const int numTilesX = divRoundUp(dims.x,(int)tileSize);
+    const int numTilesY = divRoundUp(dims.y,(int)tileSize);
+    const size_t numTiles = size_t(numTilesX)*numTilesY;
+    const size_t sliceSize = size_t(dims.x)*dims.y;
+    std::vector<float> slab;
+    std::vector<size_t> tileBegin, tilePrims;
+    for (int slabID=0;slabID<numSlabs;slabID++) {
+      const int zBegin = slabID*tileSize;
+      const int zEnd   = std::min(zBegin+(int)tileSize,dims.z);
+      slab.resize(sliceSize*(zEnd-zBegin));
+      std::fill(slab.begin(),slab.end(),outsideValue);
+
+      // sort this slab's elements into tiles ...
+      std::vector<size_t> thisSlabPrims(slabPrims.begin()+slabBegin[slabID],
+                                        slabPrims.begin()+slabBegin[slabID+1]);
+      binItems(thisSlabPrims,vec2i(numTilesX,numTilesY),
+               [&](size_t primID, vec2i &binLo, vec2i &binHi){
+                 vec3i lo, hi;
+                 if (!grid.voxelRange(mesh->getBounds(prims[primID]),lo,hi))
+                   return false;
+                 binLo = vec2i(lo.x/tileSize,lo.y/tileSize);
+                 binHi = vec2i(hi.x/tileSize,hi.y/tileSize);
+                 return true;
+               },tileBegin,tilePrims);
+
+      // ... and rasterize each tile's elements into the tile's voxels
+      parallel_for(numTiles,[&](size_t tileID){
+          const int tileX = int(tileID % numTilesX);
+          const int tileY = int(tileID / numTilesX);
+          const vec3i tileLo(tileX*tileSize,tileY*tileSize,zBegin);
+          const vec3i tileHi(std::min((tileX+1)*(int)tileSize,dims.x)-1,
+                             std::min((tileY+1)*(int)tileSize,dims.y)-1,
+                             zEnd-1);
+          for (size_t i=tileBegin[tileID];i<tileBegin[tileID+1];i++) {
+            const UMesh::PrimRef prim = prims[tilePrims[i]];
+            vec3i lo, hi;
+            if (!grid.voxelRange(mesh->getBounds(prim),lo,hi))
+              continue;
+            for (int dim=0;dim<3;dim++) {
+              lo[dim] = std::max(lo[dim],tileLo[dim]);
+              hi[dim] = std::min(hi[dim],tileHi[dim]);
+            }
+            for (int iz=lo.z;iz<=hi.z;iz++)
+              for (int iy=lo.y;iy<=hi.y;iy++)
+                for (int ix=lo.x;ix<=hi.x;ix++) {
+                  float value;
+                  if (sampleElement(*mesh,prim,grid.voxelCenter(ix,iy,iz),value))
+                    slab[(iz-zBegin)*sliceSize+size_t(iy)*dims.x+ix] = value;
+                }
+          }
+        });
+      slabCallback(zBegin,zEnd,slab.data());
+    }
+  }
+
+  /*! same as above, but returns the entire volume (x-fastest) */
+  std::vector<float> resampleToGrid(UMesh::SP mesh,
+                                    const box3f &domain,
+                                    const vec3i &dims,
+                                    float outsideValue)
+  {
+    const size_t sliceSize = size_t(dims.x)*dims.y;
+    std::vector<float> volume(sliceSize*dims.z);
+    resampleToGrid(mesh,domain,dims,
+                   [&](int zBegin, int zEnd, const float *voxels){
+                     std::copy(voxels,voxels+sliceSize*(zEnd-zBegin),
+                               volume.begin()+sliceSize*zBegin);
+                   },outsideValue);
+    return volume;
+  }
+
+} // ::umesh
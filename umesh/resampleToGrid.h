@@ -0,0 +1,58 @@
+// ======================================================================== //
+// Copyright 2018-2020 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+
+#pragma once
+
+#include "umesh/UMesh.h"
+#include <functional>
+
+namespace umesh {
+
+  /*! receives one slab of z-slices [zBegin,zEnd) of a resampled
+      volume; voxels are x-fastest, then y, then z, and only valid
+      for the duration of the call */
+  typedef std::function<void(int zBegin, int zEnd, const float *voxels)>
+  GridSlabCallback;
+
+  /*! resamples the mesh's (first) per-vertex scalar field onto a
+      regular grid of dims.x*dims.y*dims.z voxels that spans
+      'domain'; voxel (i,j,k) samples the field at the voxel's center,
+      domain.lower+(vec3f(i,j,k)+.5f)*domain.size()/dims. Voxels
+      outside of all elements get 'outsideValue'.
+
+      Rather than locating each voxel in the mesh, this works the
+      other way around: each element gets rasterized into the voxels
+      its bounds overlap, with the exact point-in-element tests and
+      interpolation of sampleElement.h. The volume gets produced in
+      slabs of z-slices (which are handed to 'slabCallback' as soon
+      as they are done, so the full volume never has to be in
+      memory); within each slab, elements are binned into
+      cache-sized tiles of voxels, and tiles are processed in
+      parallel. */
+  void resampleToGrid(UMesh::SP mesh,
+                      const box3f &domain,
+                      const vec3i &dims,
+                      const GridSlabCallback &slabCallback,
+                      float outsideValue = 0.f);
+
+  /*! same as above, but returns the entire volume (x-fastest) */
+  std::vector<float> resampleToGrid(UMesh::SP mesh,
+                                    const box3f &domain,
+                                    const vec3i &dims,
+                                    float outsideValue = 0.f);
+
+} // ::umesh
@@ -0,0 +1,262 @@
+// ======================================================================== //
+// Copyright 2018-2020 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+
+#pragma once
+
+#include "umesh/UMesh.h"
+#include <cmath>
+
+/* point-in-element tests, and interpolation of per-vertex scalars,
+   for all volumetric element types. Tets are linear, so for those
+   both are computed directly from barycentric coordinates; pyramids,
+   wedges, and hexes can have non-planar (bilinear) faces, so for
+   those we invert the element's (VTK) isoparametric mapping with a
+   few Newton iterations, and then test the resulting parametric
+   coordinates against the element's parametric domain */
+
+namespace umesh {
+
+  /*! tolerance (in parametric space) for points on an element's
+      boundary to still count as inside */
+  const float insideElementEpsilon = 1e-5f;
+
+  /*! max newton iterations for inverting an element's mapping */
+  enum { maxNewtonIterations = 16 };
+
+  /*! newton iterations stop once a step changes the parametric
+      coordinates by less than this */
+  const float newtonTolerance = 1e-5f;
+
+  /*! inverts an element's isoparametric mapping with Newton's method:
+      finds parametric coordinates 'pc' such that sum(w_i(pc)*v_i) =
+      P, where shapeFunctions(pc,w,dw) computes the N weights w_i,
+      and their derivatives dw_i (wrt the three parametric
+      coordinates). Returns false if that doesn't converge */
+  template<int N, typename ShapeFunctions>
+  inline bool invertMapping(const vec3f *v,
+                            const vec3f &P,
+                            vec3f &pc,
+                            float *w,
+                            const ShapeFunctions &shapeFunctions)
+  {
+    box3f bounds;
+    for (int i=0;i<N;i++) bounds.extend(v[i]);
+    const vec3f extent = bounds.upper-bounds.lower;
+    // cheap early-out for points that can't possibly be inside
+    const float slack = insideElementEpsilon*std::max(extent.x,std::max(extent.y,extent.z));
+    if (P.x < bounds.lower.x-slack || P.x > bounds.upper.x+slack ||
+        P.y < bounds.lower.y-slack || P.y > bounds.upper.y+slack ||
+        P.z < bounds.lower.z-slack || P.z > bounds.upper.z+slack)
+      return false;
+    // work relative to the element's first vertex, so rounding
+    // errors scale with the element's size rather than with how far
+    // it is from the origin; and test convergence in parametric
+    // space, since the world-space residual can't get below the
+    // rounding error of the (interpolated) coordinates
+    vec3f local[N];
+    for (int i=0;i<N;i++) local[i] = v[i]-v[0];
+    const vec3f localP = P-v[0];
+    vec3f dw[N];
+    for (int iter=0;iter<maxNewtonIterations;iter++) {
+      shapeFunctions(pc,w,dw);
+      vec3f x(0.f), dr(0.f), ds(0.f), dt(0.f);
+      for (int i=0;i<N;i++) {
+        x  = x  + w[i]*local[i];
+        dr = dr + dw[i].x*local[i];
+        ds = ds + dw[i].y*local[i];
+        dt = dt + dw[i].z*local[i];
+      }
+      const mat3f J(dr,ds,dt);
+      const float det = determinant(J);
+      if (det == 0.f || std::isnan(det))
+        return false;
+      const vec3f step = inverse(J)*(localP-x);
+      pc = pc + step;
+      if (fabsf(step.x) <= newtonTolerance &&
+          fabsf(step.y) <= newtonTolerance &&
+          fabsf(step.z) <= newtonTolerance) {
+        shapeFunctions(pc,w,dw);
+        return true;
+      }
+    }
+    shapeFunctions(pc,w,dw);
+    return false;
+  }
+
+  /*! tests whether tet contains P; if so, returns the interpolation
+      weights of its four vertices */
+  inline bool locateInTet(const UMesh &mesh, const Tet &tet,
+                          const vec3f &P, float *w)
+  {
+    const vec3f v0 = mesh.vertices[tet.x];
+    const vec3f v1 = mesh.vertices[tet.y];
+    const vec3f v2 = mesh.vertices[tet.z];
+    const vec3f v3 = mesh.vertices[tet.w];
+    const float vol = dot(v1-v0,cross(v2-v0,v3-v0));
+    if (vol == 0.f) return false;
+    // volumes of the sub-tets opposite each vertex; these all have
+    // the same sign as the full tet's iff P is inside
+    const float b1 = dot(P-v0,cross(v2-v0,v3-v0))/vol;
+    const float b2 = dot(v1-v0,cross(P-v0,v3-v0))/vol;
+    const float b3 = dot(v1-v0,cross(v2-v0,P-v0))/vol;
+    const float b0 = 1.f-b1-b2-b3;
+    const float eps = -insideElementEpsilon;
+    if (b0 < eps || b1 < eps || b2 < eps || b3 < eps)
+      return false;
+    w[0] = b0; w[1] = b1; w[2] = b2; w[3] = b3;
+    return true;
+  }
+
+  /*! tests whether pyramid contains P; if so, returns the
+      interpolation weights of its five vertices (base first, then
+      top) */
+  inline bool locateInPyr(const UMesh &mesh, const Pyr &pyr,
+                          const vec3f &P, float *w)
+  {
+    vec3f v[5];
+    for (int i=0;i<5;i++) v[i] = mesh.vertices[pyr[i]];
+    vec3f pc(.5f,.5f,.2f);
+    if (!invertMapping<5>(v,P,pc,w,[](const vec3f &pc, float *w, vec3f *dw){
+          const float r = pc.x, s = pc.y, t = pc.z;
+          w[0] = (1.f-r)*(1.f-s)*(1.f-t);
+          w[1] = r*(1.f-s)*(1.f-t);
+          w[2] = r*s*(1.f-t);
+          w[3] = (1.f-r)*s*(1.f-t);
+          w[4] = t;
+          dw[0] = vec3f(-(1.f-s)*(1.f-t),-(1.f-r)*(1.f-t),-(1.f-r)*(1.f-s));
+          dw[1] = vec3f( (1.f-s)*(1.f-t),-r*(1.f-t),      -r*(1.f-s));
+          dw[2] = vec3f( s*(1.f-t),       r*(1.f-t),      -r*s);
+          dw[3] = vec3f(-s*(1.f-t),       (1.f-r)*(1.f-t),-(1.f-r)*s);
+          dw[4] = vec3f(0.f,0.f,1.f);
+        }))
+      return false;
+    const float eps = insideElementEpsilon;
+    return
+      pc.x >= -eps && pc.x <= 1.f+eps &&
+      pc.y >= -eps && pc.y <= 1.f+eps &&
+      pc.z >= -eps && pc.z <= 1.f+eps;
+  }
+
+  /*! tests whether wedge contains P; if so, returns the
+      interpolation weights of its six vertices */
+  inline bool locateInWedge(const UMesh &mesh, const Wedge &wedge,
+                            const vec3f &P, float *w)
+  {
+    vec3f v[6];
+    for (int i=0;i<6;i++) v[i] = mesh.vertices[wedge[i]];
+    vec3f pc(1.f/3.f,1.f/3.f,.5f);
+    if (!invertMapping<6>(v,P,pc,w,[](const vec3f &pc, float *w, vec3f *dw){
+          const float r = pc.x, s = pc.y, t = pc.z;
+          const float u = 1.f-r-s;
+          w[0] = u*(1.f-t);
+          w[1] = r*(1.f-t);
+          w[2] = s*(1.f-t);
+          w[3] = u*t;
+          w[4] = r*t;
+          w[5] = s*t;
+          dw[0] = vec3f(-(1.f-t),-(1.f-t),-u);
+          dw[1] = vec3f(  1.f-t,   0.f,   -r);
+          dw[2] = vec3f(   0.f,   1.f-t,  -s);
+          dw[3] = vec3f(  -t,     -t,      u);
+          dw[4] = vec3f(   t,      0.f,    r);
+          dw[5] = vec3f(   0.f,    t,      s);
+        }))
+      return false;
+    const float eps = insideElementEpsilon;
+    return
+      pc.x >= -eps && pc.y >= -eps && pc.x+pc.y <= 1.f+eps &&
+      pc.z >= -eps && pc.z <= 1.f+eps;
+  }
+
+  /*! tests whether hex contains P; if so, returns the interpolation
+      weights of its eight vertices */
+  inline bool locateInHex(const UMesh &mesh, const Hex &hex,
+                          const vec3f &P, float *w)
+  {
+    vec3f v[8];
+    for (int i=0;i<8;i++) v[i] = mesh.vertices[hex[i]];
+    vec3f pc(.5f);
+    if (!invertMapping<8>(v,P,pc,w,[](const vec3f &pc, float *w, vec3f *dw){
+          const float r = pc.x, s = pc.y, t = pc.z;
+          const float r0 = 1.f-r, s0 = 1.f-s, t0 = 1.f-t;
+          w[0] = r0*s0*t0; w[1] = r*s0*t0; w[2] = r*s*t0; w[3] = r0*s*t0;
+          w[4] = r0*s0*t;  w[5] = r*s0*t;  w[6] = r*s*t;  w[7] = r0*s*t;
+          dw[0] = vec3f(-s0*t0,-r0*t0,-r0*s0);
+          dw[1] = vec3f( s0*t0,-r*t0, -r*s0);
+          dw[2] = vec3f( s*t0,  r*t0, -r*s);
+          dw[3] = vec3f(-s*t0,  r0*t0,-r0*s);
+          dw[4] = vec3f(-s0*t, -r0*t,  r0*s0);
+          dw[5] = vec3f( s0*t, -r*t,   r*s0);
+          dw[6] = vec3f( s*t,   r*t,   r*s);
+          dw[7] = vec3f(-s*t,   r0*t,  r0*s);
+        }))
+      return false;
+    const float eps = insideElementEpsilon;
+    return
+      pc.x >= -eps && pc.x <= 1.f+eps &&
+      pc.y >= -eps && pc.y <= 1.f+eps &&
+      pc.z >= -eps && pc.z <= 1.f+eps;
+  }
+
+  /*! tests whether given volume element contains P; if so, returns
+      the interpolation weights of the element's vertices (in the
+      element's vertex order; up to 8 of them) */
+  inline bool locateInElement(const UMesh &mesh,
+                              const UMesh::PrimRef &prim,
+                              const vec3f &P,
+                              float *w)
+  {
+    switch (prim.type) {
+    case UMesh::TET:   return locateInTet(mesh,mesh.tets[prim.ID],P,w);
+    case UMesh::PYR:   return locateInPyr(mesh,mesh.pyrs[prim.ID],P,w);
+    case UMesh::WEDGE: return locateInWedge(mesh,mesh.wedges[prim.ID],P,w);
+    case UMesh::HEX:   return locateInHex(mesh,mesh.hexes[prim.ID],P,w);
+    default:
+      throw std::runtime_error("not a volume element!?");
+    }
+  }
+
+  /*! tests whether given volume element contains P; if so,
+      interpolates the mesh's (first) per-vertex scalar field at P */
+  inline bool sampleElement(const UMesh &mesh,
+                            const UMesh::PrimRef &prim,
+                            const vec3f &P,
+                            float &value)
+  {
+    float w[8];
+    if (!locateInElement(mesh,prim,P,w))
+      return false;
+    const std::vector<float> &scalars = mesh.perVertex->values;
+    value = 0.f;
+    switch (prim.type) {
+    case UMesh::TET:
+      for (int i=0;i<4;i++) value += w[i]*scalars[mesh.tets[prim.ID][i]];
+      break;
+    case UMesh::PYR:
+      for (int i=0;i<5;i++) value += w[i]*scalars[mesh.pyrs[prim.ID][i]];
+      break;
+    case UMesh::WEDGE:
+      for (int i=0;i<6;i++) value += w[i]*scalars[mesh.wedges[prim.ID][i]];
+      break;
+    case UMesh::HEX:
+      for (int i=0;i<8;i++) value += w[i]*scalars[mesh.hexes[prim.ID][i]];
+      break;
+    }
+    return true;
+  }
+
+} // ::umesh
@@ -15,8 +15,11 @@
 // ======================================================================== //
 
 #include "umesh/tetrahedralize.h"
+#include "umesh/io/UMeshStream.h"
 #include <algorithm>
+#include <limits>
 #include <set>
+#include <unordered_map>
 
 #ifndef PRINT
 #ifdef __CUDA_ARCH__
@@ -48,6 +51,69 @@ namespace umesh {
       }
     }
 
+    /*! constructor for streaming mode: 'out' will only ever hold the
+        input vertices (which we take over from the caller), all
+        newly created vertices and all tets get handed out through
+        flush() */
+    MergedMesh(std::vector<vec3f> &&inputVertices,
+               Attribute::SP inputScalars)
+      : out(std::make_shared<UMesh>()),
+        passThroughFlatElements(false),
+        streaming(true)
+    {
+      out->vertices  = std::move(inputVertices);
+      out->perVertex = inputScalars;
+      nextStreamedID = out->vertices.size();
+    }
+
+    /*! position of given vertex; in streaming mode newly created
+        vertices are no longer in 'out', but (for as long as anybody
+        can still refer to them) in 'livePositions' */
+    inline vec3f position(int ID) const
+    {
+      if (!streaming || (size_t)ID < out->vertices.size())
+        return out->vertices[ID];
+      auto it = livePositions.find(ID);
+      assert(it != livePositions.end());
+      return it->second;
+    }
+
+    /*! streaming mode only: hand all tets and new vertices created
+        since the last flush to the writer, and forget about all
+        newly created vertices that can no longer get referenced */
+    void flush(io::UMeshWriter &writer)
+    {
+      writer.addTets(out->tets.data(),out->tets.size());
+      out->tets.clear();
+      writer.addVertices(newPositions.data(),
+                         out->perVertex ? newValues.data() : nullptr,
+                         newPositions.size());
+      newPositions.clear();
+      newValues.clear();
+      evictExpiredFaces();
+      for (auto ID : retiredIDs)
+        livePositions.erase(ID);
+      retiredIDs.clear();
+      ++currentChunk;
+    }
+
+    /*! streaming mode only: drop all open faces that expire with the
+        current chunk, ie, that have a vertex no later chunk uses -
+        no later element can share such a face, so it is a boundary
+        face, and its center can no longer get referenced */
+    void evictExpiredFaces()
+    {
+      if (currentChunk >= expiringFaces.size()) return;
+      for (auto &key : expiringFaces[currentChunk]) {
+        auto it = openFaces.find(key);
+        if (it == openFaces.end()) continue;
+        retiredIDs.push_back(it->second);
+        openFaces.erase(it);
+        ++numBoundaryFaces;
+      }
+      std::vector<vec4i>().swap(expiringFaces[currentChunk]);
+    }
+
     inline float length(const vec3f v) { return sqrtf(dot(v,v)); }
     
     inline float volume(const vec3f &v0,
@@ -90,10 +156,10 @@ namespace umesh {
           tet.z == tet.w)
         /* degenerate/flat tet .... so in either case: dump this */
         return;
-      vec3f a = out->vertices[tet.x];
-      vec3f b = out->vertices[tet.y];
-      vec3f c = out->vertices[tet.z];
-      vec3f d = out->vertices[tet.w];
+      vec3f a = position(tet.x);
+      vec3f b = position(tet.y);
+      vec3f c = position(tet.z);
+      vec3f d = position(tet.w);
       float volume = dot(d-a,cross(b-a,c-a));
       
       if (volume == 0.f)
@@ -118,11 +184,11 @@ namespace umesh {
     void add(const UMesh::Pyr &pyr, const std::string &dbg="")
     {
       if (passThroughFlatElements) {
-        const vec3f v0 = out->vertices[pyr[0]];
-        const vec3f v1 = out->vertices[pyr[1]];
-        const vec3f v2 = out->vertices[pyr[2]];
-        const vec3f v3 = out->vertices[pyr[3]];
-        const vec3f v4 = out->vertices[pyr[4]];
+        const vec3f v0 = position(pyr[0]);
+        const vec3f v1 = position(pyr[1]);
+        const vec3f v2 = position(pyr[2]);
+        const vec3f v3 = position(pyr[3]);
+        const vec3f v4 = position(pyr[4]);
         if (flat(v0,v1,v2,v3)) {
           if (volume(v0,v1,v2,v4) < 0.f) {
             UMesh::Pyr _pyr = pyr;
@@ -144,12 +210,12 @@ namespace umesh {
 
     void add(const UMesh::Wedge &wedge)
     {
-      const vec3f v0 = out->vertices[wedge[0]];
-      const vec3f v1 = out->vertices[wedge[1]];
-      const vec3f v2 = out->vertices[wedge[2]];
-      const vec3f v3 = out->vertices[wedge[3]];
-      const vec3f v4 = out->vertices[wedge[4]];
-      const vec3f v5 = out->vertices[wedge[5]];
+      const vec3f v0 = position(wedge[0]);
+      const vec3f v1 = position(wedge[1]);
+      const vec3f v2 = position(wedge[2]);
+      const vec3f v3 = position(wedge[3]);
+      const vec3f v4 = position(wedge[4]);
+      const vec3f v5 = position(wedge[5]);
       if (v2 == v5)
         throw std::runtime_error("wedge that should be a pyramid!?");
       
@@ -228,14 +294,14 @@ namespace umesh {
     void add(const UMesh::Hex &hex)
     {
       if (passThroughFlatElements) {
-        const vec3f v0 = out->vertices[hex[0]];
-        const vec3f v1 = out->vertices[hex[1]];
-        const vec3f v2 = out->vertices[hex[2]];
-        const vec3f v3 = out->vertices[hex[3]];
-        const vec3f v4 = out->vertices[hex[4]];
-        const vec3f v5 = out->vertices[hex[5]];
-        const vec3f v6 = out->vertices[hex[6]];
-        const vec3f v7 = out->vertices[hex[7]];
+        const vec3f v0 = position(hex[0]);
+        const vec3f v1 = position(hex[1]);
+        const vec3f v2 = position(hex[2]);
+        const vec3f v3 = position(hex[3]);
+        const vec3f v4 = position(hex[4]);
+        const vec3f v5 = position(hex[5]);
+        const vec3f v6 = position(hex[6]);
+        const vec3f v7 = position(hex[7]);
         if (flat(v0,v1,v2,v3) &&
             flat(v4,v5,v6,v7) &&
             flat(v1,v2,v6,v5) &&
@@ -280,6 +346,7 @@ namespace umesh {
     int getCenter(std::vector<int> idx)
     {
       std::sort(idx.begin(),idx.end());
+      if (streaming) return getCenterStreaming(idx);
       auto it = newVertices.find(idx);
       if (it != newVertices.end())
         return it->second;
@@ -287,9 +354,9 @@ namespace umesh {
       vec3f centerPos = vec3f(0.f);
       float centerVal = 0.f;
       for (auto i : idx) {
-        if (in->perVertex)
-          centerVal += in->perVertex->values[i];
-        centerPos = centerPos + in->vertices[i];
+        if (out->perVertex)
+          centerVal += out->perVertex->values[i];
+        centerPos = centerPos + out->vertices[i];
       }
       centerVal *= (1.f/idx.size());
       centerPos = centerPos * (1.f/idx.size());
@@ -311,11 +378,99 @@ namespace umesh {
       return ID;
     }
 
+    /*! streaming-mode version of getCenter(): since elements arrive
+        in chunks we cannot keep a table of all centers ever created;
+        instead, we only track quad faces that have been seen exactly
+        once so far (keyed by their sorted vertex indices), and drop
+        them once the second (and last) element sharing that face
+        has picked up its center. Element centers are never shared
+        to begin with, so those don't get tracked at all. Since IDs
+        are handed out in element order, the resulting vertex array
+        is exactly the same as in the in-memory version. */
+    int getCenterStreaming(const std::vector<int> &idx)
+    {
+      const bool sharedFace = (idx.size() == 4);
+      if (sharedFace) {
+        const vec4i key(idx[0],idx[1],idx[2],idx[3]);
+        auto it = openFaces.find(key);
+        if (it != openFaces.end()) {
+          const int ID = it->second;
+          openFaces.erase(it);
+          retiredIDs.push_back(ID);
+          return ID;
+        }
+      }
+      
+      vec3f centerPos = vec3f(0.f);
+      float centerVal = 0.f;
+      for (auto i : idx) {
+        if (out->perVertex)
+          centerVal += out->perVertex->values[i];
+        centerPos = centerPos + out->vertices[i];
+      }
+      centerVal *= (1.f/idx.size());
+      centerPos = centerPos * (1.f/idx.size());
+
+      const int ID = (int)nextStreamedID++;
+      newPositions.push_back(centerPos);
+      newValues.push_back(centerVal);
+      livePositions[ID] = centerPos;
+      if (sharedFace) {
+        const vec4i key(idx[0],idx[1],idx[2],idx[3]);
+        openFaces[key] = ID;
+        if (!lastChunkOf.empty()) {
+          uint32_t expires = lastChunkOf[idx[0]];
+          for (auto i : idx)
+            expires = std::min(expires,lastChunkOf[i]);
+          expiringFaces[expires].push_back(key);
+        }
+      } else
+        retiredIDs.push_back(ID);
+      return ID;
+    }
+    
     std::map<vec3f,int> vertices;
     std::map<std::vector<int>,int> newVertices;
     UMesh::SP in, out;
     /*! if true, then we'll tessellate only curved elements */
     bool passThroughFlatElements;
+
+    // ------------------------------------------------------------------
+    // streaming mode only
+    // ------------------------------------------------------------------
+    struct FaceKeyHash {
+      inline size_t operator()(const vec4i &k) const
+      {
+        size_t h = 0;
+        for (int i=0;i<4;i++)
+          h = h * 0x9e3779b97f4a7c15ull + (uint32_t)k[i];
+        return h ^ (h >> 29);
+      }
+    };
+    struct FaceKeyEqual {
+      inline bool operator()(const vec4i &a, const vec4i &b) const
+      { return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w; }
+    };
+    bool streaming = false;
+    size_t nextStreamedID = 0;
+    /*! faces seen exactly once so far, and the ID of their center */
+    std::unordered_map<vec4i,int,FaceKeyHash,FaceKeyEqual> openFaces;
+    /*! positions of all created vertices that can still get referenced */
+    std::unordered_map<int,vec3f> livePositions;
+    /*! vertices created since last flush */
+    std::vector<vec3f> newPositions;
+    std::vector<float> newValues;
+    /*! IDs that can no longer get referenced after the current chunk */
+    std::vector<int>   retiredIDs;
+    /*! for each input vertex, the last chunk with an element that has
+        a quad face using it (if empty, open faces never expire) */
+    std::vector<uint32_t> lastChunkOf;
+    /*! open faces, by the chunk after which they can no longer get
+        matched (see evictExpiredFaces()) */
+    std::vector<std::vector<vec4i>> expiringFaces;
+    uint32_t currentChunk = 0;
+    /*! number of open faces that expired (ie, were boundary faces) */
+    size_t numBoundaryFaces = 0;
   };
 
 
@@ -517,5 +672,100 @@ namespace umesh {
               << " from " << sizeString(in) << std::endl;
     return merged.out;
   }
+
+  /*! records given chunk as the last one using each of the given
+      elements' vertices */
+  template<typename T>
+  void markLastChunk(const std::vector<T> &elements,
+                     uint32_t chunkID,
+                     std::vector<uint32_t> &lastChunkOf)
+  {
+    for (auto &elt : elements)
+      for (int i=0;i<T::numVertices;i++)
+        lastChunkOf[elt[i]] = chunkID;
+  }
+
+  /*! out-of-core version of tetrahedralize() - see header */
+  void tetrahedralizeStreaming(const std::string &inFileName,
+                               const std::string &outFileName,
+                               size_t chunkSize)
+  {
+    if (chunkSize == 0)
+      throw std::runtime_error("tetrahedralizeStreaming: invalid chunk size");
+    io::UMeshReader reader(inFileName);
+
+    std::vector<vec3f> vertices;
+    reader.readVertices(vertices);
+    Attribute::SP scalars = reader.readScalars();
+
+    // original vertices go to the output first, and with same IDs
+    io::UMeshWriter writer(outFileName);
+    if (scalars) writer.setScalarsName(scalars->name);
+    writer.addVertices(vertices.data(),
+                       scalars ? scalars->values.data() : nullptr,
+                       vertices.size());
+    const size_t numInputVertices = vertices.size();
+    MergedMesh merged(std::move(vertices),scalars);
+
+    std::vector<Tet>   tets;
+    std::vector<Pyr>   pyrs;
+    std::vector<Wedge> wedges;
+    std::vector<Hex>   hexes;
+
+    // quad faces can only get shared by elements that use all of
+    // their vertices, so a first pass over the pyrs, wedges, and
+    // hexes records each vertex's last chunk; open faces then get
+    // dropped as soon as that chunk is done for any of their
+    // vertices, rather than staying around until the end
+    const size_t numChunks
+      = divRoundUp(reader.numTets,chunkSize)
+      + divRoundUp(reader.numPyrs,chunkSize)
+      + divRoundUp(reader.numWedges,chunkSize)
+      + divRoundUp(reader.numHexes,chunkSize);
+    if (numChunks >= size_t(std::numeric_limits<uint32_t>::max()))
+      throw std::runtime_error("tetrahedralizeStreaming: chunk size too small");
+    merged.lastChunkOf.resize(numInputVertices,0);
+    merged.expiringFaces.resize(numChunks);
+    uint32_t chunkID = (uint32_t)divRoundUp(reader.numTets,chunkSize);
+    for (size_t begin=0;begin<reader.numPyrs;begin+=chunkSize) {
+      reader.readPyrs(begin,chunkSize,pyrs);
+      markLastChunk(pyrs,chunkID++,merged.lastChunkOf);
+    }
+    for (size_t begin=0;begin<reader.numWedges;begin+=chunkSize) {
+      reader.readWedges(begin,chunkSize,wedges);
+      markLastChunk(wedges,chunkID++,merged.lastChunkOf);
+    }
+    for (size_t begin=0;begin<reader.numHexes;begin+=chunkSize) {
+      reader.readHexes(begin,chunkSize,hexes);
+      markLastChunk(hexes,chunkID++,merged.lastChunkOf);
+    }
+    for (size_t begin=0;begin<reader.numTets;begin+=chunkSize) {
+      reader.readTets(begin,chunkSize,tets);
+      for (auto tet : tets) merged.add(tet);
+      merged.flush(writer);
+    }
+    for (size_t begin=0;begin<reader.numPyrs;begin+=chunkSize) {
+      reader.readPyrs(begin,chunkSize,pyrs);
+      for (auto pyr : pyrs) merged.add(pyr);
+      merged.flush(writer);
+    }
+    for (size_t begin=0;begin<reader.numWedges;begin+=chunkSize) {
+      reader.readWedges(begin,chunkSize,wedges);
+      for (auto wedge : wedges) merged.add(wedge);
+      merged.flush(writer);
+    }
+    for (size_t begin=0;begin<reader.numHexes;begin+=chunkSize) {
+      reader.readHexes(begin,chunkSize,hexes);
+      for (auto hex : hexes) merged.add(hex);
+      merged.flush(writer);
+    }
+    std::cout << "done streaming tetrahedralization, got "
+              << prettyNumber(writer.numVertices()) << " vertices ("
+              << prettyNumber(writer.numVertices()-numInputVertices)
+              << " new ones); "
+              << prettyNumber(merged.numBoundaryFaces+merged.openFaces.size())
+              << " faces were used by only one element" << std::endl;
+    writer.close();
+  }
   
 } // ::umesh
@@ -57,6 +57,22 @@ namespace umesh {
       this will ALSO (do the best job it can at) flipping
       negative-volume leemnts to positive volume */
   UMesh::SP tetrahedralize_maintainFlatElements(UMesh::SP mesh);
+
+  /*! out-of-core version of tetrahedralize(): reads the input .umesh
+      file chunk by chunk (at most 'chunkSize' elements at a time),
+      and writes the resulting tets - and newly created vertices -
+      directly to 'outFileName' as it goes. Only the input's vertices
+      (and scalars) are ever fully resident in memory; element data
+      is bounded by the chunk size, and the only other state is the
+      table of quad faces that have so far been seen by only one
+      element. Faces get dropped from that table once no later chunk
+      uses all of their vertices (which takes one extra read pass
+      over the non-tet elements, and a chunk index per input vertex),
+      so it only holds the current 'front' of faces, not the entire
+      boundary. Output is the same as tetrahedralize(loadFrom(inFileName)) */
+  void tetrahedralizeStreaming(const std::string &inFileName,
+                               const std::string &outFileName,
+                               size_t chunkSize = (1ull<<20));
   
 } // ::umesh
 